@@ -0,0 +1,81 @@
+#ifndef __FRAMEWORK_AABB_H__
+#define __FRAMEWORK_AABB_H__
+
+#include <algorithm>
+
+/// @brief Axis-aligned bounding box.
+struct Aabb
+{
+	Vec3 min;
+	Vec3 max;
+
+	Aabb() {}
+	MATH_CONSTEXPR Aabb(const Vec3& bmin, const Vec3& bmax) : min(bmin), max(bmax) {}
+};
+
+namespace aabb
+{
+	/// @brief Creates the bounding box of a sphere.
+	inline Aabb FromSphere(const Vec3& center, float radius)
+	{
+		return Aabb(Vec3(center.x - radius, center.y - radius, center.z - radius),
+					Vec3(center.x + radius, center.y + radius, center.z + radius));
+	}
+
+	/// @brief Creates the smallest box enclosing both boxes.
+	inline Aabb Merge(const Aabb& a, const Aabb& b)
+	{
+		return Aabb(Vec3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+					Vec3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+	}
+
+	/// @brief Grows the box by the specified margin on all sides.
+	inline Aabb Expand(const Aabb& a, float margin)
+	{
+		return Aabb(Vec3(a.min.x - margin, a.min.y - margin, a.min.z - margin),
+					Vec3(a.max.x + margin, a.max.y + margin, a.max.z + margin));
+	}
+
+	/// @brief Half the surface area of the box, used as the cost of a node when building trees.
+	inline float HalfArea(const Aabb& a)
+	{
+		Vec3 d = a.max - a.min;
+		return d.x*d.y + d.y*d.z + d.z*d.x;
+	}
+
+	/// @return True if outer completely contains inner.
+	inline bool Contains(const Aabb& outer, const Aabb& inner)
+	{
+		return	outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+				inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+	}
+
+	/// @return True if the boxes overlap.
+	inline bool Overlaps(const Aabb& a, const Aabb& b)
+	{
+		return	a.min.x <= b.max.x && b.min.x <= a.max.x &&
+				a.min.y <= b.max.y && b.min.y <= a.max.y &&
+				a.min.z <= b.max.z && b.min.z <= a.max.z;
+	}
+
+	/// @brief Ray/Box intersection using the slab method [Real-Time Rendering 16.7.1]
+	/// @param inv_direction 1 / ray direction for each axis, infinite for axes the ray is parallel to.
+	/// @param max_distance Only intersections closer than this are reported.
+	/// @param distance Distance to where the ray enters the box, 0 if the origin is inside the box.
+	/// @return True if the ray intersects the box within [0, max_distance].
+	inline bool RayIntersect(const Aabb& a, const Vec3& origin, const Vec3& inv_direction, float max_distance, float& distance)
+	{
+		float tx0 = (a.min.x - origin.x) * inv_direction.x, tx1 = (a.max.x - origin.x) * inv_direction.x;
+		float ty0 = (a.min.y - origin.y) * inv_direction.y, ty1 = (a.max.y - origin.y) * inv_direction.y;
+		float tz0 = (a.min.z - origin.z) * inv_direction.z, tz1 = (a.max.z - origin.z) * inv_direction.z;
+
+		float tmin = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+		float tmax = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), max_distance));
+
+		distance = tmin;
+		return tmin <= tmax;
+	}
+};
+
+
+#endif // __FRAMEWORK_AABB_H__
@@ -0,0 +1,273 @@
+#include "Common.h"
+
+#include "AabbTree.h"
+
+
+AabbTree::AabbTree(float margin)
+	: _root(NULL_NODE),
+	_free_list(NULL_NODE),
+	_margin(margin)
+{
+}
+AabbTree::~AabbTree()
+{
+}
+//-------------------------------------------------------------------------------
+uint32_t AabbTree::Insert(const Aabb& bounds, void* user_data)
+{
+	uint32_t proxy = AllocateNode();
+	_nodes[proxy].bounds = aabb::Expand(bounds, _margin);
+	_nodes[proxy].user_data = user_data;
+	_nodes[proxy].height = 0;
+
+	InsertLeaf(proxy);
+	return proxy;
+}
+void AabbTree::Remove(uint32_t proxy)
+{
+	assert(proxy < _nodes.size() && _nodes[proxy].IsLeaf());
+
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+}
+bool AabbTree::Update(uint32_t proxy, const Aabb& bounds)
+{
+	assert(proxy < _nodes.size() && _nodes[proxy].IsLeaf());
+
+	// Still within the enlarged bounds, unless the object shrunk a lot
+	Aabb& current = _nodes[proxy].bounds;
+	if(aabb::Contains(current, bounds) && aabb::Contains(bounds, aabb::Expand(current, -2.0f * _margin)))
+		return false;
+
+	RemoveLeaf(proxy);
+	_nodes[proxy].bounds = aabb::Expand(bounds, _margin);
+	InsertLeaf(proxy);
+	return true;
+}
+void AabbTree::Clear()
+{
+	_nodes.clear();
+	_root = NULL_NODE;
+	_free_list = NULL_NODE;
+}
+//-------------------------------------------------------------------------------
+void* AabbTree::UserData(uint32_t proxy) const
+{
+	assert(proxy < _nodes.size());
+	return _nodes[proxy].user_data;
+}
+const Aabb& AabbTree::Bounds(uint32_t proxy) const
+{
+	assert(proxy < _nodes.size());
+	return _nodes[proxy].bounds;
+}
+uint32_t AabbTree::Height() const
+{
+	if(_root == NULL_NODE)
+		return 0;
+	return _nodes[_root].height;
+}
+//-------------------------------------------------------------------------------
+uint32_t AabbTree::AllocateNode()
+{
+	uint32_t index;
+	if(_free_list != NULL_NODE)
+	{
+		index = _free_list;
+		_free_list = _nodes[index].parent;
+	}
+	else
+	{
+		index = (uint32_t)_nodes.size();
+		_nodes.push_back(Node());
+	}
+
+	Node& node = _nodes[index];
+	node.parent = node.child1 = node.child2 = NULL_NODE;
+	node.height = 0;
+	node.user_data = NULL;
+	return index;
+}
+void AabbTree::FreeNode(uint32_t node)
+{
+	_nodes[node].parent = _free_list;
+	_nodes[node].height = -1;
+	_free_list = node;
+}
+void AabbTree::InsertLeaf(uint32_t leaf)
+{
+	if(_root == NULL_NODE)
+	{
+		_root = leaf;
+		_nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// Find the best sibling by descending the tree, at every node the cost of adding the leaf
+	//	as a sibling is compared to the lowest possible cost of pushing it further down either child.
+	//	The cost is the surface area of the new parent plus the increase in area for all ancestors.
+	const Aabb& leaf_bounds = _nodes[leaf].bounds;
+	uint32_t index = _root;
+	while(!_nodes[index].IsLeaf())
+	{
+		const Node& node = _nodes[index];
+
+		float area = aabb::HalfArea(node.bounds);
+		float combined_area = aabb::HalfArea(aabb::Merge(node.bounds, leaf_bounds));
+
+		// Cost of creating a new parent for this node and the leaf
+		float cost = 2.0f * combined_area;
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritance_cost = 2.0f * (combined_area - area);
+
+		float cost1 = aabb::HalfArea(aabb::Merge(_nodes[node.child1].bounds, leaf_bounds)) + inheritance_cost;
+		if(!_nodes[node.child1].IsLeaf())
+			cost1 -= aabb::HalfArea(_nodes[node.child1].bounds);
+
+		float cost2 = aabb::HalfArea(aabb::Merge(_nodes[node.child2].bounds, leaf_bounds)) + inheritance_cost;
+		if(!_nodes[node.child2].IsLeaf())
+			cost2 -= aabb::HalfArea(_nodes[node.child2].bounds);
+
+		if(cost < cost1 && cost < cost2)
+			break;
+
+		index = (cost1 < cost2) ? node.child1 : node.child2;
+	}
+
+	uint32_t sibling = index;
+
+	// Create a new parent for the sibling and the leaf, note that this may reallocate _nodes
+	uint32_t old_parent = _nodes[sibling].parent;
+	uint32_t new_parent = AllocateNode();
+	_nodes[new_parent].parent = old_parent;
+	_nodes[new_parent].bounds = aabb::Merge(_nodes[leaf].bounds, _nodes[sibling].bounds);
+	_nodes[new_parent].height = _nodes[sibling].height + 1;
+	_nodes[new_parent].child1 = sibling;
+	_nodes[new_parent].child2 = leaf;
+	_nodes[sibling].parent = new_parent;
+	_nodes[leaf].parent = new_parent;
+
+	if(old_parent != NULL_NODE)
+	{
+		if(_nodes[old_parent].child1 == sibling)
+			_nodes[old_parent].child1 = new_parent;
+		else
+			_nodes[old_parent].child2 = new_parent;
+	}
+	else
+	{
+		_root = new_parent;
+	}
+
+	RefitAncestors(_nodes[leaf].parent);
+}
+void AabbTree::RemoveLeaf(uint32_t leaf)
+{
+	if(leaf == _root)
+	{
+		_root = NULL_NODE;
+		return;
+	}
+
+	// The sibling takes the place of the parent
+	uint32_t parent = _nodes[leaf].parent;
+	uint32_t grand_parent = _nodes[parent].parent;
+	uint32_t sibling = (_nodes[parent].child1 == leaf) ? _nodes[parent].child2 : _nodes[parent].child1;
+
+	if(grand_parent != NULL_NODE)
+	{
+		if(_nodes[grand_parent].child1 == parent)
+			_nodes[grand_parent].child1 = sibling;
+		else
+			_nodes[grand_parent].child2 = sibling;
+		_nodes[sibling].parent = grand_parent;
+		FreeNode(parent);
+
+		RefitAncestors(grand_parent);
+	}
+	else
+	{
+		_root = sibling;
+		_nodes[sibling].parent = NULL_NODE;
+		FreeNode(parent);
+	}
+}
+void AabbTree::RefitAncestors(uint32_t index)
+{
+	while(index != NULL_NODE)
+	{
+		index = Balance(index);
+
+		Node& node = _nodes[index];
+		const Node& child1 = _nodes[node.child1];
+		const Node& child2 = _nodes[node.child2];
+
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.bounds = aabb::Merge(child1.bounds, child2.bounds);
+
+		index = node.parent;
+	}
+}
+uint32_t AabbTree::Balance(uint32_t a)
+{
+	// Rotates the taller child of a up if the heights of the children differ by more than one (AVL rotation).
+	//	Given a with the children b and c, where c is the taller and has the children f and g:
+	//	c replaces a, a becomes the first child of c and the taller of f and g stays as the second
+	//	child of c. The shorter of f and g replaces c as a child of a. The same is done the other
+	//	way around if b is the taller.
+	Node& node_a = _nodes[a];
+	if(node_a.IsLeaf() || node_a.height < 2)
+		return a;
+
+	uint32_t b = node_a.child1;
+	uint32_t c = node_a.child2;
+	int32_t balance = _nodes[c].height - _nodes[b].height;
+
+	if(balance > 1 || balance < -1)
+	{
+		// Rotate the taller child (up) up, the shorter child (other) stays below a
+		uint32_t up = balance > 1 ? c : b;
+		Node& node_up = _nodes[up];
+
+		uint32_t f = node_up.child1;
+		uint32_t g = node_up.child2;
+
+		// Swap a and up
+		node_up.child1 = a;
+		node_up.parent = node_a.parent;
+		node_a.parent = up;
+
+		if(node_up.parent != NULL_NODE)
+		{
+			if(_nodes[node_up.parent].child1 == a)
+				_nodes[node_up.parent].child1 = up;
+			else
+				_nodes[node_up.parent].child2 = up;
+		}
+		else
+		{
+			_root = up;
+		}
+
+		// The taller grandchild stays with up, the shorter one moves under a
+		uint32_t keep = f, move = g;
+		if(_nodes[f].height < _nodes[g].height)
+			std::swap(keep, move);
+
+		node_up.child2 = keep;
+		if(up == c)
+			node_a.child2 = move;
+		else
+			node_a.child1 = move;
+		_nodes[move].parent = a;
+
+		node_a.bounds = aabb::Merge(_nodes[node_a.child1].bounds, _nodes[node_a.child2].bounds);
+		node_a.height = 1 + std::max(_nodes[node_a.child1].height, _nodes[node_a.child2].height);
+
+		node_up.bounds = aabb::Merge(node_a.bounds, _nodes[keep].bounds);
+		node_up.height = 1 + std::max(node_a.height, _nodes[keep].height);
+
+		return up;
+	}
+	return a;
+}
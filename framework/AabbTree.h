@@ -0,0 +1,253 @@
+#ifndef __FRAMEWORK_AABBTREE_H__
+#define __FRAMEWORK_AABBTREE_H__
+
+#include "Aabb.h"
+#include "Frustum.h"
+
+/// @brief Dynamic bounding volume hierarchy of axis-aligned boxes.
+///
+///	Every object in the tree is a leaf (proxy) holding a user pointer. The boxes stored in the leaves
+///	are enlarged by a margin, objects moving within their enlarged box only need a cheap containment
+///	test when updated, only objects moving outside it are reinserted. New leaves are placed where they
+///	enlarge the tree the least (By surface area) and the tree is kept balanced by rotations, so all
+///	operations and queries are O(log n) for reasonably distributed objects.
+class AabbTree
+{
+public:
+	enum { NULL_NODE = 0xffffffff };
+
+	/// @param margin The boxes in the tree are enlarged by this margin on all sides.
+	AabbTree(float margin);
+	~AabbTree();
+
+	/// @brief Inserts an object.
+	/// @return Proxy identifying the object, stays valid until the object is removed.
+	uint32_t Insert(const Aabb& bounds, void* user_data);
+
+	/// @brief Removes an object.
+	void Remove(uint32_t proxy);
+
+	/// @brief Updates the bounds of an object.
+	/// @return True if the object was reinserted, false if the new bounds were still within the enlarged bounds.
+	bool Update(uint32_t proxy, const Aabb& bounds);
+
+	/// @brief Removes all objects.
+	void Clear();
+
+	/// @return The user pointer of the specified proxy.
+	void* UserData(uint32_t proxy) const;
+
+	/// @return The enlarged bounds of the specified proxy.
+	const Aabb& Bounds(uint32_t proxy) const;
+
+	/// @return Height of the tree, 0 for an empty tree or a single object.
+	uint32_t Height() const;
+
+	/// @brief Finds all objects with enlarged bounds overlapping the specified box.
+	/// @param callback Called as callback(user_data) for every object found, returns false to stop the query.
+	template<typename Callback>
+	void Query(const Aabb& bounds, Callback& callback) const;
+
+	/// @brief Finds all objects with enlarged bounds overlapping the specified frustum. Each node is only tested
+	///	against the planes its parent wasn't completely inside, subtrees completely inside the frustum are
+	///	reported without any further tests.
+	/// @param callback Called as callback(user_data, inside) for every object found, inside is true if the enlarged
+	///		bounds are completely inside the frustum. Returns false to stop the query.
+	template<typename Callback>
+	void QueryFrustum(const Frustum& frustum, Callback& callback) const;
+
+	/// @brief Casts a ray through the tree, visiting the objects in roughly front to back order.
+	///	Only objects with enlarged bounds intersecting the ray within the current max distance are visited.
+	/// @param direction Direction of the ray, doesn't have to be normalized but distances are in units of its length.
+	/// @param callback Called as callback(user_data, max_distance) for every object visited, returns the
+	///		new max distance. Returning the distance to a hit makes the cast find the nearest hit, returning
+	///		a negative value stops the cast.
+	template<typename Callback>
+	void RayCast(const Vec3& origin, const Vec3& direction, float max_distance, Callback& callback) const;
+
+private:
+	struct Node
+	{
+		Aabb bounds;
+		uint32_t parent; // Next node in the free list for free nodes
+		uint32_t child1;
+		uint32_t child2;
+		int32_t height; // 0 for leaves, -1 for free nodes
+		void* user_data;
+
+		bool IsLeaf() const { return child1 == NULL_NODE; }
+	};
+
+	/// Max depth of the traversal stacks, the balancing keeps the height far below this.
+	enum { MAX_STACK_SIZE = 128 };
+
+	uint32_t AllocateNode();
+	void FreeNode(uint32_t node);
+
+	void InsertLeaf(uint32_t leaf);
+	void RemoveLeaf(uint32_t leaf);
+
+	/// Refits bounds and heights of all ancestors of node, balancing the tree on the way up.
+	void RefitAncestors(uint32_t node);
+
+	/// Performs a rotation at node if it's unbalanced.
+	/// @return The node now at the position of node.
+	uint32_t Balance(uint32_t node);
+
+	std::vector<Node> _nodes;
+	uint32_t _root;
+	uint32_t _free_list;
+	float _margin;
+};
+
+template<typename Callback>
+void AabbTree::Query(const Aabb& bounds, Callback& callback) const
+{
+	if(_root == NULL_NODE)
+		return;
+
+	uint32_t stack[MAX_STACK_SIZE];
+	uint32_t stack_size = 0;
+	stack[stack_size++] = _root;
+
+	while(stack_size)
+	{
+		const Node& node = _nodes[stack[--stack_size]];
+		if(!aabb::Overlaps(node.bounds, bounds))
+			continue;
+
+		if(node.IsLeaf())
+		{
+			if(!callback(node.user_data))
+				return;
+		}
+		else
+		{
+			assert(stack_size + 2 <= MAX_STACK_SIZE);
+			stack[stack_size++] = node.child1;
+			stack[stack_size++] = node.child2;
+		}
+	}
+}
+
+template<typename Callback>
+void AabbTree::QueryFrustum(const Frustum& frustum, Callback& callback) const
+{
+	if(_root == NULL_NODE)
+		return;
+
+	struct Entry
+	{
+		uint32_t node;
+		uint32_t plane_mask; // Planes left to test, see frustum::TestAabb
+	};
+	Entry stack[MAX_STACK_SIZE];
+	uint32_t stack_size = 0;
+
+	stack[stack_size].node = _root;
+	stack[stack_size].plane_mask = Frustum::ALL_PLANES;
+	++stack_size;
+
+	while(stack_size)
+	{
+		--stack_size;
+		const Node& node = _nodes[stack[stack_size].node];
+		uint32_t plane_mask = stack[stack_size].plane_mask;
+		if(plane_mask && !frustum::TestAabb(frustum, node.bounds, plane_mask))
+			continue;
+
+		if(node.IsLeaf())
+		{
+			if(!callback(node.user_data, plane_mask == 0))
+				return;
+		}
+		else
+		{
+			assert(stack_size + 2 <= MAX_STACK_SIZE);
+			stack[stack_size].node = node.child1;
+			stack[stack_size].plane_mask = plane_mask;
+			++stack_size;
+			stack[stack_size].node = node.child2;
+			stack[stack_size].plane_mask = plane_mask;
+			++stack_size;
+		}
+	}
+}
+
+template<typename Callback>
+void AabbTree::RayCast(const Vec3& origin, const Vec3& direction, float max_distance, Callback& callback) const
+{
+	if(_root == NULL_NODE)
+		return;
+
+	// Division by zero gives infinity, which the slab test handles
+	Vec3 inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	// The nearer child is always visited first, the other one is saved along with its distance
+	//	so that it can be skipped if a closer hit has been found by the time it's reached.
+	struct Entry
+	{
+		uint32_t node;
+		float distance;
+	};
+	Entry stack[MAX_STACK_SIZE];
+	uint32_t stack_size = 0;
+
+	float distance;
+	if(!aabb::RayIntersect(_nodes[_root].bounds, origin, inv_direction, max_distance, distance))
+		return;
+
+	stack[stack_size].node = _root;
+	stack[stack_size].distance = distance;
+	++stack_size;
+
+	while(stack_size)
+	{
+		--stack_size;
+		if(stack[stack_size].distance > max_distance)
+			continue;
+
+		uint32_t index = stack[stack_size].node;
+		while(index != NULL_NODE)
+		{
+			const Node& node = _nodes[index];
+			if(node.IsLeaf())
+			{
+				max_distance = callback(node.user_data, max_distance);
+				if(max_distance < 0.0f)
+					return;
+				break;
+			}
+
+			float distance1, distance2;
+			bool hit1 = aabb::RayIntersect(_nodes[node.child1].bounds, origin, inv_direction, max_distance, distance1);
+			bool hit2 = aabb::RayIntersect(_nodes[node.child2].bounds, origin, inv_direction, max_distance, distance2);
+
+			if(hit1 && hit2)
+			{
+				uint32_t near_child = node.child1, far_child = node.child2;
+				if(distance2 < distance1)
+				{
+					std::swap(near_child, far_child);
+					std::swap(distance1, distance2);
+				}
+
+				assert(stack_size < MAX_STACK_SIZE);
+				stack[stack_size].node = far_child;
+				stack[stack_size].distance = distance2;
+				++stack_size;
+
+				index = near_child;
+			}
+			else if(hit1)
+				index = node.child1;
+			else if(hit2)
+				index = node.child2;
+			else
+				index = NULL_NODE;
+		}
+	}
+}
+
+
+#endif // __FRAMEWORK_AABBTREE_H__
@@ -32,6 +32,7 @@
 #include "Debug.h"
 #include "Vector.h"
 #include "Matrix.h"
+#include "Quat.h"
 
 
 #endif // __COMMON_H__
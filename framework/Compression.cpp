@@ -0,0 +1,397 @@
+#include "Common.h"
+
+#include "Compression.h"
+#include "Parallel.h"
+
+#include <string.h>
+#include <algorithm>
+
+
+namespace compression_internal
+{
+	const uint32_t frame_magic = 0x4b425a4c; // "LZBK"
+	const uint32_t frame_version = 1;
+	const size_t frame_header_size = 24;
+
+	const uint32_t stored_flag = 0x80000000; // Set on blocks that are stored uncompressed
+
+	/// A compressed block never decompresses to more than this many times its size, each additional
+	///	match length byte adds at most 255 bytes of output.
+	const uint64_t max_expansion = 255;
+
+	const int hash_bits = 14;
+	const size_t min_match = 4;
+	const size_t max_offset = 65535;
+
+	/// Minimum number of blocks handled by each thread.
+	const uint32_t blocks_per_chunk = 2;
+
+	inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, 4);
+		return value;
+	}
+	inline uint32_t Read32LE(const uint8_t* p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+	inline void Write32LE(uint8_t* p, uint32_t value)
+	{
+		p[0] = (uint8_t)value; p[1] = (uint8_t)(value >> 8); p[2] = (uint8_t)(value >> 16); p[3] = (uint8_t)(value >> 24);
+	}
+
+	inline uint32_t Hash(uint32_t sequence)
+	{
+		// Multiplicative hashing (Knuth)
+		return (sequence * 2654435761u) >> (32 - hash_bits);
+	}
+
+	inline uint8_t* WriteLength(uint8_t* op, size_t length)
+	{
+		while(length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = (uint8_t)length;
+		return op;
+	}
+	inline bool ReadLength(const uint8_t*& ip, const uint8_t* ip_end, size_t& length)
+	{
+		uint8_t b;
+		do
+		{
+			if(ip >= ip_end)
+				return false;
+			b = *ip++;
+			length += b;
+		}
+		while(b == 255);
+		return true;
+	}
+
+	/// Writes a sequence of literals followed by a match, match_length is 0 for the last sequence of a block.
+	uint8_t* WriteSequence(uint8_t* op, const uint8_t* literals, size_t literal_count, size_t offset, size_t match_length)
+	{
+		uint8_t* token = op++;
+
+		*token = (uint8_t)((literal_count >= 15 ? 15 : literal_count) << 4);
+		if(literal_count >= 15)
+			op = WriteLength(op, literal_count - 15);
+
+		memcpy(op, literals, literal_count);
+		op += literal_count;
+
+		if(match_length > 0)
+		{
+			*op++ = (uint8_t)(offset & 0xff);
+			*op++ = (uint8_t)(offset >> 8);
+
+			size_t length = match_length - min_match;
+			*token |= (uint8_t)(length >= 15 ? 15 : length);
+			if(length >= 15)
+				op = WriteLength(op, length - 15);
+		}
+		return op;
+	}
+
+	struct FrameLayout
+	{
+		uint32_t block_size;
+		uint32_t block_count;
+		uint64_t raw_size;
+
+		const uint8_t* table; // Compressed size of each block
+		const uint8_t* blocks; // First block
+		std::vector<uint64_t> offsets; // Offset of each block, relative to blocks
+	};
+
+	bool ReadFrameLayout(const uint8_t* data, size_t size, FrameLayout& layout)
+	{
+		if(size < frame_header_size || Read32LE(data) != frame_magic || Read32LE(data + 4) > frame_version)
+			return false;
+
+		layout.block_size = Read32LE(data + 8);
+		layout.block_count = Read32LE(data + 12);
+		layout.raw_size = (uint64_t)Read32LE(data + 16) | ((uint64_t)Read32LE(data + 20) << 32);
+
+		if(layout.block_size == 0 || layout.raw_size > (uint64_t)size * max_expansion ||
+			(uint64_t)layout.block_count != (layout.raw_size + layout.block_size - 1) / layout.block_size ||
+			(uint64_t)layout.block_count * 4 > size - frame_header_size)
+			return false;
+
+		layout.table = data + frame_header_size;
+		layout.blocks = layout.table + layout.block_count * 4;
+
+		// Every block needs to be large enough to hold its part of the uncompressed size, this bounds the size
+		//	of the output to what the input can actually produce before anything is allocated
+		uint64_t available = (uint64_t)(data + size - layout.blocks);
+		uint64_t offset = 0;
+		layout.offsets.resize(layout.block_count);
+		for(uint32_t i = 0; i < layout.block_count; ++i)
+		{
+			uint32_t entry = Read32LE(layout.table + i * 4);
+			uint64_t compressed_size = entry & ~stored_flag;
+			uint64_t raw_size = std::min((uint64_t)layout.block_size, layout.raw_size - (uint64_t)i * layout.block_size);
+			if((entry & stored_flag) ? compressed_size != raw_size : raw_size > compressed_size * max_expansion)
+				return false;
+
+			layout.offsets[i] = offset;
+			offset += compressed_size;
+		}
+		return offset <= available;
+	}
+
+	struct CompressTask
+	{
+		const uint8_t* data;
+		size_t size;
+		uint32_t block_size;
+		std::vector<std::string>& blocks;
+		std::vector<uint32_t>& block_sizes;
+
+		CompressTask(const uint8_t* d, size_t s, uint32_t bs, std::vector<std::string>& b, std::vector<uint32_t>& sizes)
+			: data(d), size(s), block_size(bs), blocks(b), block_sizes(sizes) {}
+
+		void operator()(uint32_t , uint32_t begin, uint32_t end)
+		{
+			for(uint32_t i = begin; i < end; ++i)
+			{
+				size_t offset = (size_t)i * block_size;
+				size_t raw_size = std::min((size_t)block_size, size - offset);
+
+				std::string& block = blocks[i];
+				block.resize(compression::CompressBound(raw_size));
+				size_t compressed_size = compression::CompressBlock(data + offset, raw_size, &block[0], block.size());
+				if(compressed_size == 0 || compressed_size >= raw_size)
+				{
+					// Block doesn't compress, store it as is
+					block.assign((const char*)data + offset, raw_size);
+					block_sizes[i] = (uint32_t)raw_size | stored_flag;
+				}
+				else
+				{
+					block.resize(compressed_size);
+					block_sizes[i] = (uint32_t)compressed_size;
+				}
+			}
+		}
+	};
+
+	struct DecompressTask
+	{
+		const FrameLayout& layout;
+		uint8_t* out;
+		bool* results;
+
+		DecompressTask(const FrameLayout& l, uint8_t* o, bool* r) : layout(l), out(o), results(r) {}
+
+		void operator()(uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			bool result = true;
+			for(uint32_t i = begin; i < end && result; ++i)
+			{
+				uint64_t offset = (uint64_t)i * layout.block_size;
+				size_t raw_size = (size_t)std::min((uint64_t)layout.block_size, layout.raw_size - offset);
+
+				uint32_t entry = Read32LE(layout.table + i * 4);
+				const uint8_t* block = layout.blocks + layout.offsets[i];
+				if(entry & stored_flag)
+				{
+					result = ((entry & ~stored_flag) == raw_size);
+					if(result)
+						memcpy(out + offset, block, raw_size);
+				}
+				else
+				{
+					result = compression::DecompressBlock(block, entry, out + offset, raw_size);
+				}
+			}
+			results[chunk] = result;
+		}
+	};
+};
+
+//-------------------------------------------------------------------------------
+size_t compression::CompressBound(size_t size)
+{
+	// Worst case is all literals: one token plus one length byte per 255 literals.
+	return size + size / 255 + 16;
+}
+size_t compression::CompressBlock(const void* src, size_t src_size, void* dst, size_t dst_capacity)
+{
+	using namespace compression_internal;
+
+	if(dst_capacity < CompressBound(src_size))
+		return 0;
+
+	const uint8_t* ip = (const uint8_t*)src;
+	const uint8_t* ip_begin = ip;
+	const uint8_t* ip_end = ip + src_size;
+	const uint8_t* anchor = ip; // Start of pending literals
+	uint8_t* op = (uint8_t*)dst;
+
+	// Maps the hash of 4 bytes to the last position (+1) that sequence was seen at, 0 means empty.
+	std::vector<uint32_t> table(1 << hash_bits, 0);
+
+	while(ip + min_match <= ip_end)
+	{
+		uint32_t sequence = Read32(ip);
+		uint32_t& entry = table[Hash(sequence)];
+		const uint8_t* ref = ip_begin + (entry != 0 ? entry - 1 : 0);
+		bool found = (entry != 0 && (size_t)(ip - ref) <= max_offset && Read32(ref) == sequence);
+		entry = (uint32_t)(ip - ip_begin) + 1;
+
+		if(!found)
+		{
+			++ip;
+			continue;
+		}
+
+		// Extend the match as far as possible
+		const uint8_t* match_end = ip + min_match;
+		ref += min_match;
+		while(match_end < ip_end && *match_end == *ref)
+		{
+			++match_end;
+			++ref;
+		}
+
+		op = WriteSequence(op, anchor, ip - anchor, match_end - ref, match_end - ip);
+		ip = anchor = match_end;
+	}
+
+	// Remaining literals
+	op = WriteSequence(op, anchor, ip_end - anchor, 0, 0);
+	return op - (uint8_t*)dst;
+}
+bool compression::DecompressBlock(const void* src, size_t src_size, void* dst, size_t dst_size)
+{
+	using namespace compression_internal;
+
+	const uint8_t* ip = (const uint8_t*)src;
+	const uint8_t* ip_end = ip + src_size;
+	uint8_t* op = (uint8_t*)dst;
+	uint8_t* op_begin = op;
+	uint8_t* op_end = op + dst_size;
+
+	while(true)
+	{
+		if(ip >= ip_end)
+			return false;
+
+		uint8_t token = *ip++;
+
+		// Literals
+		size_t literal_count = token >> 4;
+		if(literal_count == 15 && !ReadLength(ip, ip_end, literal_count))
+			return false;
+		if(literal_count > (size_t)(ip_end - ip) || literal_count > (size_t)(op_end - op))
+			return false;
+
+		memcpy(op, ip, literal_count);
+		op += literal_count;
+		ip += literal_count;
+
+		if(ip == ip_end)
+			break; // Last sequence
+
+		// Match
+		if(ip_end - ip < 2)
+			return false;
+		size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+		ip += 2;
+
+		size_t match_length = token & 15;
+		if(match_length == 15 && !ReadLength(ip, ip_end, match_length))
+			return false;
+		match_length += min_match;
+
+		if(offset == 0 || offset > (size_t)(op - op_begin) || match_length > (size_t)(op_end - op))
+			return false;
+
+		const uint8_t* ref = op - offset;
+		if(offset >= match_length)
+		{
+			memcpy(op, ref, match_length);
+			op += match_length;
+		}
+		else
+		{
+			// Overlapping match, repeats the last offset bytes
+			for(size_t i = 0; i < match_length; ++i)
+				*op++ = *ref++;
+		}
+	}
+
+	return op == op_end;
+}
+//-------------------------------------------------------------------------------
+void compression::Compress(const void* data, size_t size, std::string& out, uint32_t block_size)
+{
+	using namespace compression_internal;
+
+	assert(block_size > 0 && block_size < stored_flag);
+
+	uint32_t block_count = (uint32_t)((size + block_size - 1) / block_size);
+
+	std::vector<std::string> blocks(block_count);
+	std::vector<uint32_t> block_sizes(block_count);
+
+	CompressTask task((const uint8_t*)data, size, block_size, blocks, block_sizes);
+	parallel::ForEachChunk(block_count, parallel::ChunkCount(block_count, blocks_per_chunk), task);
+
+	// Frame header and block table
+	out.resize(frame_header_size + block_count * 4);
+	uint8_t* header = (uint8_t*)&out[0];
+	Write32LE(header, frame_magic);
+	Write32LE(header + 4, frame_version);
+	Write32LE(header + 8, block_size);
+	Write32LE(header + 12, block_count);
+	Write32LE(header + 16, (uint32_t)((uint64_t)size & 0xffffffff));
+	Write32LE(header + 20, (uint32_t)((uint64_t)size >> 32));
+	for(uint32_t i = 0; i < block_count; ++i)
+	{
+		Write32LE(header + frame_header_size + i * 4, block_sizes[i]);
+	}
+
+	// Blocks
+	for(uint32_t i = 0; i < block_count; ++i)
+	{
+		out += blocks[i];
+	}
+}
+bool compression::Decompress(const void* data, size_t size, std::string& out)
+{
+	using namespace compression_internal;
+
+	FrameLayout layout;
+	if(!ReadFrameLayout((const uint8_t*)data, size, layout))
+		return false;
+
+	out.resize((size_t)layout.raw_size);
+	if(layout.raw_size == 0)
+		return true;
+
+	uint32_t chunk_count = parallel::ChunkCount(layout.block_count, blocks_per_chunk);
+
+	// std::vector<bool> is packed, so use a plain array of bools for the per-chunk results
+	bool* chunk_results = new bool[chunk_count];
+	DecompressTask task(layout, (uint8_t*)&out[0], chunk_results);
+	parallel::ForEachChunk(layout.block_count, chunk_count, task);
+
+	bool result = true;
+	for(uint32_t i = 0; i < chunk_count; ++i)
+		result = result && chunk_results[i];
+	delete [] chunk_results;
+
+	if(!result)
+		out.clear();
+	return result;
+}
+bool compression::IsCompressed(const void* data, size_t size)
+{
+	return size >= compression_internal::frame_header_size &&
+		compression_internal::Read32LE((const uint8_t*)data) == compression_internal::frame_magic;
+}
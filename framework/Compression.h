@@ -0,0 +1,53 @@
+#ifndef __COMPRESSION_H__
+#define __COMPRESSION_H__
+
+#include <string>
+
+/// @brief Self-contained LZ77 style compression.
+///
+///	Data is split into blocks that are compressed independently of each other, which allows both
+///	compression and decompression to be spread over multiple threads.
+///
+///	Compressed block: A sequence of (token, literals, match) where
+///		token		: 1 byte, high 4 bits: literal count, low 4 bits: match length - 4.
+///						A value of 15 means the count continues in the following bytes (each byte
+///						is added to the count, until a byte that is not 255).
+///		literals	: The literal bytes.
+///		match		: 2 byte little-endian offset back into the already decompressed data,
+///						followed by any additional match length bytes.
+///	The last sequence of a block holds only literals, it is terminated by the end of the block.
+///
+///	Frame: Header (magic, version, block size, block count, total uncompressed size), followed by the
+///		size of each compressed block and then the blocks themselves.
+namespace compression
+{
+	enum { DEFAULT_BLOCK_SIZE = 256 * 1024 };
+
+	/// @brief Returns the maximum size a block of the specified size can have after compression.
+	size_t CompressBound(size_t size);
+
+	/// @brief Compresses a single block.
+	/// @param dst Destination buffer, needs to be at least CompressBound(src_size) bytes.
+	/// @return The size of the compressed block, 0 if dst_capacity was too small.
+	size_t CompressBlock(const void* src, size_t src_size, void* dst, size_t dst_capacity);
+
+	/// @brief Decompresses a single block.
+	/// @param dst_size Expected size of the decompressed data.
+	/// @return True if the block was successfully decompressed into exactly dst_size bytes, false if the block was corrupt.
+	bool DecompressBlock(const void* src, size_t src_size, void* dst, size_t dst_size);
+
+	/// @brief Compresses the specified data into a frame of independent blocks.
+	/// @param out The compressed frame will be stored in this variable.
+	void Compress(const void* data, size_t size, std::string& out, uint32_t block_size = DEFAULT_BLOCK_SIZE);
+
+	/// @brief Decompresses a frame created by Compress.
+	/// @param out The decompressed data will be stored in this variable.
+	/// @return True if the decompression was successful, false if the data was corrupt.
+	bool Decompress(const void* data, size_t size, std::string& out);
+
+	/// @return True if the specified data starts with a compressed frame header.
+	bool IsCompressed(const void* data, size_t size);
+
+};
+
+#endif // __COMPRESSION_H__
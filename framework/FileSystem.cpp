@@ -0,0 +1,444 @@
+#include "Common.h"
+
+#include "FileSystem.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+
+#ifndef PLATFORM_WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+
+//-------------------------------------------------------------------------------
+file_system::MappedFile::MappedFile()
+	: _data(0),
+	_size(0),
+	_open(false)
+{
+#ifdef PLATFORM_WIN32
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = NULL;
+#else
+	_fd = -1;
+#endif
+}
+file_system::MappedFile::~MappedFile()
+{
+	Close();
+}
+bool file_system::MappedFile::Open(const char* filename)
+{
+	Close();
+
+#ifdef PLATFORM_WIN32
+	_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(_file, &size))
+	{
+		Close();
+		return false;
+	}
+	_size = (size_t)size.QuadPart;
+
+	// Empty files can't be mapped, they are represented by a null view of size 0
+	if(_size != 0)
+	{
+		_mapping = CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(_mapping != NULL)
+			_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if(_data == 0)
+		{
+			Close();
+			return false;
+		}
+	}
+#else
+	_fd = open(filename, O_RDONLY);
+	if(_fd == -1)
+		return false;
+
+	struct stat st;
+	if(fstat(_fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		Close();
+		return false;
+	}
+	_size = (size_t)st.st_size;
+
+	// Empty files can't be mapped, they are represented by a null view of size 0
+	if(_size != 0)
+	{
+		void* data = mmap(0, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+		if(data == MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+		_data = (const char*)data;
+
+		// Loaders read the file front to back
+		madvise(data, _size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	_open = true;
+	return true;
+}
+void file_system::MappedFile::Close()
+{
+#ifdef PLATFORM_WIN32
+	if(_data)
+		UnmapViewOfFile(_data);
+	if(_mapping != NULL)
+		CloseHandle(_mapping);
+	if(_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = NULL;
+#else
+	if(_data)
+		munmap((void*)_data, _size);
+	if(_fd != -1)
+		close(_fd);
+
+	_fd = -1;
+#endif
+
+	_data = 0;
+	_size = 0;
+	_open = false;
+}
+bool file_system::MappedFile::IsOpen() const
+{
+	return _open;
+}
+const char* file_system::MappedFile::Data() const
+{
+	return _data;
+}
+size_t file_system::MappedFile::Size() const
+{
+	return _size;
+}
+//-------------------------------------------------------------------------------
+file_system::FileWriter::FileWriter()
+	: _buffer_used(0),
+	_failed(false)
+{
+#ifdef PLATFORM_WIN32
+	_file = INVALID_HANDLE_VALUE;
+#else
+	_fd = -1;
+#endif
+}
+file_system::FileWriter::~FileWriter()
+{
+	// Anything not committed is thrown away, an atomic writer never replaces the target on its own.
+	Discard();
+}
+bool file_system::FileWriter::Open(const char* filename, uint32_t flags)
+{
+	Discard();
+
+	assert((flags & (ATOMIC | APPEND)) != (ATOMIC | APPEND));
+
+	_filename = filename;
+	_temp_filename = "";
+	if(flags & ATOMIC)
+		_temp_filename = _filename + ".tmp";
+
+	const char* path = (flags & ATOMIC) ? _temp_filename.c_str() : filename;
+
+#ifdef PLATFORM_WIN32
+	if(flags & APPEND)
+		_file = CreateFileA(path, FILE_APPEND_DATA, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	else
+		_file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(_file == INVALID_HANDLE_VALUE)
+		return false;
+#else
+	_fd = open(path, O_WRONLY | O_CREAT | ((flags & APPEND) ? O_APPEND : O_TRUNC), 0644);
+	if(_fd == -1)
+		return false;
+#endif
+
+	_buffer.resize(BUFFER_SIZE);
+	_buffer_used = 0;
+	_failed = false;
+	return true;
+}
+bool file_system::FileWriter::Write(const void* data, size_t size)
+{
+	if(!IsOpen() || _failed)
+		return false;
+
+	const char* src = (const char*)data;
+	while(size > 0)
+	{
+		if(_buffer_used == 0 && size >= _buffer.size())
+		{
+			// Nothing to gain from copying large writes into the buffer, pass them on directly
+			return WriteToFile(src, size);
+		}
+
+		size_t count = std::min(size, _buffer.size() - _buffer_used);
+		memcpy(&_buffer[_buffer_used], src, count);
+		_buffer_used += count;
+		src += count;
+		size -= count;
+
+		if(_buffer_used == _buffer.size() && !Flush())
+			return false;
+	}
+	return true;
+}
+bool file_system::FileWriter::Flush()
+{
+	bool result = WriteToFile(_buffer.empty() ? 0 : &_buffer[0], _buffer_used);
+	_buffer_used = 0;
+	return result;
+}
+bool file_system::FileWriter::WriteToFile(const char* data, size_t size)
+{
+	size_t written = 0;
+	while(written < size && !_failed)
+	{
+#ifdef PLATFORM_WIN32
+		DWORD count = 0;
+		DWORD chunk = (DWORD)std::min<size_t>(size - written, 0x40000000);
+		if(!WriteFile(_file, data + written, chunk, &count, NULL))
+			_failed = true;
+		written += count;
+#else
+		ssize_t count = write(_fd, data + written, size - written);
+		if(count < 0 && errno == EINTR)
+			continue;
+		if(count <= 0)
+			_failed = true;
+		else
+			written += (size_t)count;
+#endif
+	}
+	return !_failed;
+}
+bool file_system::FileWriter::Commit()
+{
+	if(!IsOpen())
+		return false;
+
+	bool result = Flush();
+
+	if(!_temp_filename.empty())
+	{
+		// Make sure the data has reached the disk before the rename does, otherwise a crash
+		//	could leave the target replaced by an incomplete file.
+#ifdef PLATFORM_WIN32
+		result = result && FlushFileBuffers(_file);
+#else
+		result = result && (fsync(_fd) == 0);
+#endif
+	}
+
+	CloseFile();
+	result = result && !_failed;
+
+	if(!_temp_filename.empty())
+	{
+		if(result)
+		{
+#ifdef PLATFORM_WIN32
+			result = MoveFileExA(_temp_filename.c_str(), _filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+			result = rename(_temp_filename.c_str(), _filename.c_str()) == 0;
+#endif
+		}
+		if(!result)
+			remove(_temp_filename.c_str());
+		_temp_filename = "";
+	}
+
+	_buffer.clear();
+	return result;
+}
+void file_system::FileWriter::Discard()
+{
+	if(!IsOpen())
+		return;
+
+	CloseFile();
+	if(!_temp_filename.empty())
+		remove(_temp_filename.c_str());
+
+	_temp_filename = "";
+	_buffer.clear();
+	_buffer_used = 0;
+}
+bool file_system::FileWriter::IsOpen() const
+{
+#ifdef PLATFORM_WIN32
+	return _file != INVALID_HANDLE_VALUE;
+#else
+	return _fd != -1;
+#endif
+}
+void file_system::FileWriter::CloseFile()
+{
+#ifdef PLATFORM_WIN32
+	if(_file != INVALID_HANDLE_VALUE && !CloseHandle(_file))
+		_failed = true;
+	_file = INVALID_HANDLE_VALUE;
+#else
+	if(_fd != -1 && close(_fd) != 0)
+		_failed = true;
+	_fd = -1;
+#endif
+}
+//-------------------------------------------------------------------------------
+bool file_system::WriteFileAtomic(const char* filename, const void* data, size_t size)
+{
+	FileWriter writer;
+	if(!writer.Open(filename, FileWriter::ATOMIC))
+		return false;
+
+	writer.Write(data, size);
+	return writer.Commit();
+}
+//-------------------------------------------------------------------------------
+bool file_system::FileStat(const char* filename, int64_t& modified_time, int64_t& size)
+{
+#ifdef PLATFORM_WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if(!GetFileAttributesExA(filename, GetFileExInfoStandard, &attributes))
+		return false;
+
+	modified_time = ((int64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	size = ((int64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+#else
+	struct stat st;
+	if(stat(filename, &st) != 0)
+		return false;
+
+	modified_time = (int64_t)st.st_mtime;
+	size = (int64_t)st.st_size;
+#endif
+	return true;
+}
+//-------------------------------------------------------------------------------
+file_system::FileWatcher::FileWatcher()
+	: _watching(false),
+	_exists(false),
+	_modified_time(0),
+	_size(0)
+{
+#ifdef __linux__
+	_inotify = -1;
+#endif
+}
+file_system::FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+bool file_system::FileWatcher::Watch(const char* filename)
+{
+	Stop();
+
+	_filename = filename;
+	_watching = true;
+	_exists = FileStat(filename, _modified_time, _size);
+
+#ifdef __linux__
+	// inotify reports changes by name within the watched directory
+	std::string directory = ".";
+	_name = _filename;
+
+	size_t separator = _filename.rfind('/');
+	if(separator != std::string::npos)
+	{
+		directory = _filename.substr(0, std::max<size_t>(separator, 1));
+		_name = _filename.substr(separator + 1);
+	}
+
+	_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(_inotify != -1 &&
+		inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_CREATE) == -1)
+	{
+		close(_inotify);
+		_inotify = -1;
+	}
+	if(_inotify == -1)
+		debug::Printf("FileWatcher: inotify not available for '%s', polling instead.\n", filename);
+#endif
+	return true;
+}
+void file_system::FileWatcher::Stop()
+{
+#ifdef __linux__
+	if(_inotify != -1)
+		close(_inotify);
+	_inotify = -1;
+#endif
+	_watching = false;
+}
+bool file_system::FileWatcher::Poll()
+{
+	if(!_watching)
+		return false;
+
+#ifdef __linux__
+	if(_inotify != -1)
+	{
+		bool changed = false;
+
+		// Drain all pending events, several events for the same file count as a single change
+		char buffer[4096];
+		while(true)
+		{
+			ssize_t length = read(_inotify, buffer, sizeof(buffer));
+			if(length <= 0)
+				break;
+
+			for(ssize_t offset = 0; offset < length; )
+			{
+				const inotify_event* evt = (const inotify_event*)(buffer + offset);
+				if(evt->len > 0 && _name == evt->name)
+					changed = true;
+				offset += sizeof(inotify_event) + evt->len;
+			}
+		}
+
+		// Keep the stat up to date in case we have to fall back to polling
+		if(changed)
+			_exists = FileStat(_filename.c_str(), _modified_time, _size);
+		return changed;
+	}
+#endif
+	return PollStat();
+}
+bool file_system::FileWatcher::PollStat()
+{
+	int64_t modified_time = 0, size = 0;
+	bool exists = FileStat(_filename.c_str(), modified_time, size);
+
+	bool changed = (exists != _exists) || (exists && (modified_time != _modified_time || size != _size));
+
+	_exists = exists;
+	_modified_time = modified_time;
+	_size = size;
+	return changed;
+}
@@ -0,0 +1,159 @@
+#ifndef __FILESYSTEM_H__
+#define __FILESYSTEM_H__
+
+#include <string>
+#include <vector>
+
+/// @brief Utilities for reading and writing files.
+namespace file_system
+{
+	/// @brief Read-only view of a complete file mapped into memory.
+	///	The file contents can be parsed directly out of the mapping without copying them into a buffer first.
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		/// @brief Maps the specified file, any previously mapped file is closed.
+		/// @return True if the file was mapped successfully, false if not.
+		bool Open(const char* filename);
+
+		/// @brief Unmaps the file, any pointers returned by Data are invalid after this.
+		void Close();
+
+		bool IsOpen() const;
+
+		/// @return Pointer to the file contents, valid until the file is closed. Not null-terminated.
+		const char* Data() const;
+
+		/// @return Size of the file in bytes.
+		size_t Size() const;
+
+	private:
+		const char* _data;
+		size_t _size;
+		bool _open;
+
+#ifdef PLATFORM_WIN32
+		HANDLE _file;
+		HANDLE _mapping;
+#else
+		int _fd;
+#endif
+
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+	};
+
+	/// @brief Buffered sequential writer.
+	///
+	///	Writes are collected in a buffer and passed on to the file in large pieces. If opened with ATOMIC the
+	///	data is written to a temporary file next to the target, which replaces the target first when Commit is
+	///	called. This way the target file is either the old or the complete new file, even if the application
+	///	crashes in the middle of writing it.
+	class FileWriter
+	{
+	public:
+		enum Flags
+		{
+			ATOMIC = 1,
+			APPEND = 2 // Writes are appended to any existing file, can't be combined with ATOMIC
+		};
+		enum { BUFFER_SIZE = 64 * 1024 };
+
+		FileWriter();
+		~FileWriter();
+
+		/// @brief Opens the specified file for writing, truncating any existing file (unless ATOMIC or APPEND is specified).
+		/// @return True if the file was opened successfully, false if not.
+		bool Open(const char* filename, uint32_t flags = 0);
+
+		/// @brief Appends data to the file.
+		/// @return False if any write to the file has failed.
+		bool Write(const void* data, size_t size);
+
+		/// @brief Flushes all written data and closes the file, for atomic writers this replaces the target file.
+		/// @return True if all data was successfully written, false if not. A failed atomic write leaves the target untouched.
+		bool Commit();
+
+		/// @brief Closes the file without committing it, for atomic writers the temporary file is removed.
+		void Discard();
+
+		bool IsOpen() const;
+
+	private:
+		std::string _filename;
+		std::string _temp_filename; // Empty if not atomic
+
+		std::vector<char> _buffer;
+		size_t _buffer_used;
+		bool _failed;
+
+#ifdef PLATFORM_WIN32
+		HANDLE _file;
+#else
+		int _fd;
+#endif
+
+		bool Flush();
+		bool WriteToFile(const char* data, size_t size);
+		void CloseFile();
+
+		FileWriter(const FileWriter&);
+		FileWriter& operator=(const FileWriter&);
+	};
+
+	/// @brief Atomically replaces the contents of the specified file (See FileWriter::ATOMIC).
+	/// @return True if the file was successfully written, false if not.
+	bool WriteFileAtomic(const char* filename, const void* data, size_t size);
+
+	/// @brief Reads the modification time and size of the specified file.
+	/// @return True if the file exists, false if not.
+	bool FileStat(const char* filename, int64_t& modified_time, int64_t& size);
+
+	/// @brief Detects modifications of a file, e.g. by an external tool.
+	///
+	///	On Linux the directory of the file is watched with inotify, which reports both files written in place
+	///	and files replaced by renaming (See FileWriter::ATOMIC). On other platforms, or if inotify isn't
+	///	available, the modification time and size of the file are compared every time Poll is called.
+	class FileWatcher
+	{
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		/// @brief Starts watching the specified file, which doesn't have to exist yet. Stops watching any previous file.
+		/// @return True if successful, false if not.
+		bool Watch(const char* filename);
+
+		/// @brief Stops watching the file.
+		void Stop();
+
+		/// @return True if the file has been modified, created or removed since the last call to Poll or Watch.
+		bool Poll();
+
+	private:
+		std::string _filename;
+		bool _watching;
+
+		// Used when polling
+		bool _exists;
+		int64_t _modified_time;
+		int64_t _size;
+
+#ifdef __linux__
+		std::string _name; // File name without the directory, as reported by inotify
+		int _inotify; // -1 if not used
+#endif
+
+		/// @return True if the file has changed since the last stat.
+		bool PollStat();
+
+		FileWatcher(const FileWatcher&);
+		FileWatcher& operator=(const FileWatcher&);
+	};
+};
+
+
+#endif // __FILESYSTEM_H__
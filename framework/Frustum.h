@@ -0,0 +1,59 @@
+#ifndef __FRAMEWORK_FRUSTUM_H__
+#define __FRAMEWORK_FRUSTUM_H__
+
+#include "Aabb.h"
+
+/// @brief View frustum as six planes facing inwards.
+///
+///	Each plane is stored as (nx, ny, nz, d) with a normalized normal, a point p is on the inside of the
+///	plane if dot(n, p) + d >= 0, and the distance to the plane is dot(n, p) + d.
+struct Frustum
+{
+	enum Plane
+	{
+		PLANE_LEFT,
+		PLANE_RIGHT,
+		PLANE_BOTTOM,
+		PLANE_TOP,
+		PLANE_NEAR,
+		PLANE_FAR,
+		PLANE_COUNT
+	};
+	/// Mask with all planes set, see frustum::TestAabb.
+	enum { ALL_PLANES = (1 << PLANE_COUNT) - 1 };
+
+	Vec4 planes[PLANE_COUNT];
+};
+
+namespace frustum
+{
+	/// @brief Extracts the frustum planes from a view-projection matrix [Gribb, Hartmann, "Fast Extraction
+	///		of Viewing Frustum Planes from the World-View-Projection Matrix"].
+	/// @param view_projection Projection * view, the planes are then in world-space. Passing only a projection
+	///		matrix gives the planes in view-space.
+	inline Frustum FromMatrix(const Mat4x4& view_projection);
+
+	/// @return True if the sphere is at least partly inside the frustum.
+	inline bool TestSphere(const Frustum& f, const Vec3& center, float radius);
+
+	/// @brief Tests a box against the planes in plane_mask, planes that the box is completely inside are
+	///		removed from the mask. Children of a box only need to be tested against the planes left in the
+	///		mask, and with an empty mask the box is completely inside the frustum.
+	/// @param plane_mask Bit i set for each plane i to test (See Frustum::Plane).
+	/// @return False if the box is completely outside any of the tested planes, true if it may be inside the frustum.
+	inline bool TestAabb(const Frustum& f, const Aabb& box, uint32_t& plane_mask);
+
+	/// @brief Tests many spheres against the frustum, four per SIMD operation (See Simd.h).
+	///	Input is structure-of-arrays buffers the same as for RayBatch.h, the results are exactly the same as
+	///	calling TestSphere for each sphere.
+	/// @param count Number of spheres.
+	/// @param visible Filled with the indices of the spheres at least partly inside the frustum, in increasing
+	///		order. Room for count indices is needed.
+	/// @return Number of indices written to visible.
+	inline uint32_t CullSpheres(const Frustum& f, const float* x, const float* y, const float* z, const float* radius,
+		uint32_t count, uint32_t* visible);
+};
+
+#include "Frustum.inl"
+
+#endif // __FRAMEWORK_FRUSTUM_H__
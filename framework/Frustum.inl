@@ -0,0 +1,117 @@
+// Implementation of Frustum.h
+//	CullSpheres performs the same operations in the same order as TestSphere, which handles the
+//	remaining spheres, so both give the same results.
+
+namespace frustum_internal
+{
+	/// @return Row i of the matrix.
+	inline Vec4 Row(const Mat4x4& m, int i)
+	{
+		return Vec4((&m.col[0].x)[i], (&m.col[1].x)[i], (&m.col[2].x)[i], (&m.col[3].x)[i]);
+	}
+
+	/// @return The plane a + sign * b, normalized.
+	inline Vec4 Plane(const Vec4& a, const Vec4& b, float sign)
+	{
+		Vec4 plane(a.x + sign * b.x, a.y + sign * b.y, a.z + sign * b.z, a.w + sign * b.w);
+		float inv_length = 1.0f / sqrtf(plane.x*plane.x + plane.y*plane.y + plane.z*plane.z);
+		return Vec4(plane.x * inv_length, plane.y * inv_length, plane.z * inv_length, plane.w * inv_length);
+	}
+};
+
+inline Frustum frustum::FromMatrix(const Mat4x4& view_projection)
+{
+	using namespace frustum_internal;
+
+	// A point is inside the clip volume if -w <= x, y, z <= w, where (x, y, z, w) are the rows of the
+	//	matrix multiplied with the point. Each inequality is a plane, e.g. w + x >= 0 for the left plane.
+	Vec4 x = Row(view_projection, 0);
+	Vec4 y = Row(view_projection, 1);
+	Vec4 z = Row(view_projection, 2);
+	Vec4 w = Row(view_projection, 3);
+
+	Frustum result;
+	result.planes[Frustum::PLANE_LEFT] = Plane(w, x, 1.0f);
+	result.planes[Frustum::PLANE_RIGHT] = Plane(w, x, -1.0f);
+	result.planes[Frustum::PLANE_BOTTOM] = Plane(w, y, 1.0f);
+	result.planes[Frustum::PLANE_TOP] = Plane(w, y, -1.0f);
+	result.planes[Frustum::PLANE_NEAR] = Plane(w, z, 1.0f);
+	result.planes[Frustum::PLANE_FAR] = Plane(w, z, -1.0f);
+	return result;
+}
+
+inline bool frustum::TestSphere(const Frustum& f, const Vec3& center, float radius)
+{
+	for(int i = 0; i < Frustum::PLANE_COUNT; ++i)
+	{
+		const Vec4& p = f.planes[i];
+		if(p.x*center.x + p.y*center.y + p.z*center.z + p.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+inline bool frustum::TestAabb(const Frustum& f, const Aabb& box, uint32_t& plane_mask)
+{
+	Vec3 center = (box.min + box.max) * 0.5f;
+	Vec3 extents = (box.max - box.min) * 0.5f;
+
+	for(int i = 0; i < Frustum::PLANE_COUNT; ++i)
+	{
+		if((plane_mask & (1 << i)) == 0)
+			continue;
+
+		// Distance from the center, and how far the box reaches towards the plane from the center
+		const Vec4& p = f.planes[i];
+		float distance = p.x*center.x + p.y*center.y + p.z*center.z + p.w;
+		float reach = extents.x*fabsf(p.x) + extents.y*fabsf(p.y) + extents.z*fabsf(p.z);
+
+		if(distance < -reach)
+			return false;
+		if(distance >= reach)
+			plane_mask &= ~(1 << i);
+	}
+	return true;
+}
+
+inline uint32_t frustum::CullSpheres(const Frustum& f, const float* x, const float* y, const float* z, const float* radius,
+	uint32_t count, uint32_t* visible)
+{
+	simd::float4 px[Frustum::PLANE_COUNT], py[Frustum::PLANE_COUNT], pz[Frustum::PLANE_COUNT], pw[Frustum::PLANE_COUNT];
+	for(int i = 0; i < Frustum::PLANE_COUNT; ++i)
+	{
+		px[i] = simd::Splat(f.planes[i].x);
+		py[i] = simd::Splat(f.planes[i].y);
+		pz[i] = simd::Splat(f.planes[i].z);
+		pw[i] = simd::Splat(f.planes[i].w);
+	}
+
+	uint32_t visible_count = 0;
+	uint32_t i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		simd::float4 cx = simd::Load(x + i), cy = simd::Load(y + i), cz = simd::Load(z + i);
+		simd::float4 neg_radius = simd::Negate(simd::Load(radius + i));
+
+		simd::float4 outside = simd::CmpLt(simd::Add(simd::Add(simd::Add(simd::Mul(px[0], cx), simd::Mul(py[0], cy)), simd::Mul(pz[0], cz)), pw[0]), neg_radius);
+		for(int p = 1; p < Frustum::PLANE_COUNT; ++p)
+		{
+			simd::float4 distance = simd::Add(simd::Add(simd::Add(simd::Mul(px[p], cx), simd::Mul(py[p], cy)), simd::Mul(pz[p], cz)), pw[p]);
+			outside = simd::Or(outside, simd::CmpLt(distance, neg_radius));
+		}
+
+		// Every index is written, but the count is only advanced for visible spheres. The index written
+		//	is never past i + 3, so this stays within the count indices provided.
+		uint32_t mask = ~(uint32_t)simd::MoveMask(outside);
+		visible[visible_count] = i; visible_count += mask & 1;
+		visible[visible_count] = i + 1; visible_count += (mask >> 1) & 1;
+		visible[visible_count] = i + 2; visible_count += (mask >> 2) & 1;
+		visible[visible_count] = i + 3; visible_count += (mask >> 3) & 1;
+	}
+	for(; i < count; ++i)
+	{
+		if(TestSphere(f, Vec3(x[i], y[i], z[i]), radius[i]))
+			visible[visible_count++] = i;
+	}
+	return visible_count;
+}
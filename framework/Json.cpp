@@ -24,11 +24,34 @@ THE SOFTWARE.
 #include "Json.h"
 #include "ConfigValue.h"
 
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
 
 //-------------------------------------------------------------------------------
 
 namespace json_internal
 {
+	/// Writes a number with as few digits as possible while still reading back as the same value. Values
+	///	exactly representable as floats only have to read back as the same float, as they most likely are floats.
+	void WriteNumber(double value, std::stringstream& out)
+	{
+		bool is_float = ((double)(float)value == value);
+
+		char buffer[32];
+		for(int precision = 6; precision <= 17; ++precision)
+		{
+			sprintf(buffer, "%.*g", precision, value);
+
+			// Read back the same way the reader does
+			double result = strtod(buffer, NULL);
+			if(is_float ? ((float)result == (float)value) : (result == value))
+				break;
+		}
+		out << buffer;
+	}
+
 	void WriteTabs(int ilevel, std::stringstream& out)
 	{
 		for(int i = 0; i < ilevel; ++i)
@@ -130,7 +153,7 @@ bool json::Reader::Read(const char* doc, int64_t length, ConfigValue& root)
 	_end = doc + length;
 
 	SkipSpaces();
-	if(*_cur == '{')
+	if(Peek() == '{')
 		return ParseObject(root);
 	
 	// Assume root is an object
@@ -152,7 +175,7 @@ bool json::Reader::Read(const char* doc, int64_t length, ConfigValue& root)
 		}
 
 		SkipSpaces();
-		if(*_cur != '=' && *_cur != ':')
+		if(Peek() != '=' && Peek() != ':')
 		{
 			Error("Expected '=' or ':'");
 			return false;
@@ -167,7 +190,7 @@ bool json::Reader::Read(const char* doc, int64_t length, ConfigValue& root)
 
 		SkipSpaces();
 
-		char c = *_cur;
+		char c = Peek();
 		if(c == ',') // Separator between elements (Optional)
 		{
 			_cur++;
@@ -178,6 +201,19 @@ bool json::Reader::Read(const char* doc, int64_t length, ConfigValue& root)
 	return true;
 }
 
+char json::Reader::Peek() const
+{
+	return (_cur != _end) ? *_cur : '\0';
+}
+bool json::Reader::Expect(const char* literal)
+{
+	size_t length = strlen(literal);
+	if((size_t)(_end - _cur) < length || strncmp(_cur, literal, length) != 0)
+		return false;
+
+	_cur += length;
+	return true;
+}
 void json::Reader::SkipSpaces()
 {
 	while(_cur != _end)
@@ -199,24 +235,32 @@ bool json::Reader::ParseString(std::string& str)
 
 	// Count length first
 	const char* str_end = _cur;
-	bool quotes = (*_cur == '"'); // Keep track if this string is surrounded by quotes
+	bool quotes = (Peek() == '"'); // Keep track if this string is surrounded by quotes
 	if(quotes)
 		++str_end; // Skip starting "
+	bool terminated = false;
 	while(str_end != _end)
 	{
 		char c = *str_end++;
-		if(c == '\\')
+		if(c == '\\' && str_end != _end)
 			str_end++; // Skip checking next character	
 		else if((quotes && (c == '"')) || (!quotes && (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '=' || c == ':')))
+		{
+			terminated = true;
 			break;
+		}
 	}
 	if(quotes)
 	{
+		if(!terminated)
+			return false; // Missing trailing "
+
 		_cur += 1; // Skip starting "
 	}
-	str_end -= 1; // Skip trailing " or any trailing whitespace
+	if(terminated)
+		str_end -= 1; // Skip trailing " or any trailing whitespace
 
-	while(_cur != str_end)
+	while(_cur < str_end)
 	{
 		char c = *_cur++;
 		if(c == '\\')
@@ -261,7 +305,7 @@ bool json::Reader::ParseObject(ConfigValue& value)
 	
 	_cur++; // Skip '{'
 	SkipSpaces();
-	if(*_cur == '}') // Empty object
+	if(Peek() == '}') // Empty object
 	{
 		_cur++;
 		return true;
@@ -280,7 +324,7 @@ bool json::Reader::ParseObject(ConfigValue& value)
 		}
 
 		SkipSpaces();
-		if(*_cur != '=' && *_cur != ':')
+		if(Peek() != '=' && Peek() != ':')
 		{
 			Error("Expected '=' or ':'");
 			return false;
@@ -293,7 +337,7 @@ bool json::Reader::ParseObject(ConfigValue& value)
 
 		SkipSpaces();
 
-		char c = *_cur;
+		char c = Peek();
 		if(c == ',') // Separator between elements (Optional)
 		{
 			_cur++;
@@ -314,7 +358,7 @@ bool json::Reader::ParseArray(ConfigValue& value)
 	
 	_cur++; // Skip '['
 	SkipSpaces();
-	if(*_cur == ']')
+	if(Peek() == ']')
 	{
 		_cur++;
 		return true;
@@ -328,7 +372,7 @@ bool json::Reader::ParseArray(ConfigValue& value)
 		
 		SkipSpaces();
 
-		char c = *_cur;
+		char c = Peek();
 		if(c == ',') // Separator between elements (Optional)
 		{
 			_cur++;
@@ -346,10 +390,36 @@ bool json::Reader::ParseArray(ConfigValue& value)
 
 bool json::Reader::ParseDouble(ConfigValue& value)
 {
+	const char* number_begin = _cur;
+	while(_cur != _end)
+	{
+		char c = *_cur;
+		if((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+			++_cur;
+		else
+			break;
+	}
+	size_t length = _cur - number_begin;
+
+	// strtod expects a null-terminated string, which the document is not required to be. Numbers that
+	//	don't fit the stack buffer are rare but valid, so they get a heap copy rather than being cut short.
+	char buffer[64];
+	std::string long_number;
+	const char* number = buffer;
+	if(length < sizeof(buffer))
+	{
+		memcpy(buffer, number_begin, length);
+		buffer[length] = '\0';
+	}
+	else
+	{
+		long_number.assign(number_begin, length);
+		number = long_number.c_str();
+	}
+
 	char* number_end;
-	double number = std::strtod(_cur, &number_end);
-	value.SetDouble(number);
-	_cur = number_end;
+	value.SetDouble(std::strtod(number, &number_end));
+	_cur = number_begin + (number_end - number);
 	return true;
 }
 
@@ -408,7 +478,7 @@ bool json::Reader::ParseValue(ConfigValue& value)
 {
 	SkipSpaces();
 	bool b = true;
-	char c = *_cur;
+	char c = Peek();
 	switch(c)
 	{
 	case '{':
@@ -441,30 +511,27 @@ bool json::Reader::ParseValue(ConfigValue& value)
 		b = ParseNumber(value);
 		break;
 	case 't': // true
-		if(*(++_cur) != 'r' || *(++_cur) != 'u' || *(++_cur) != 'e')
+		if(!Expect("true"))
 		{
 			Error("Expected \"true\"");
 			return false;
 		}
-		++_cur;
 		value.SetBool(true);
 		break;
 	case 'f': // false
-		if(*(++_cur) != 'a' || *(++_cur) != 'l' || *(++_cur) != 's' || *(++_cur) != 'e')
+		if(!Expect("false"))
 		{
 			Error("Expected \"false\"");
 			return false;
 		}
-		++_cur;
 		value.SetBool(false);
 		break;
 	case 'n': // null
-		if(*(++_cur) != 'u' || *(++_cur) != 'l' || *(++_cur) != 'l')
+		if(!Expect("null"))
 		{
 			Error("Expected \"null\"");
 			return false;
 		}
-		++_cur;
 		value.SetNull();
 		break;
 	default:
@@ -487,6 +554,24 @@ void json::Writer::Write(const ConfigValue& root, std::stringstream& out, bool f
 	WriteValue(root, out);
 	out << "\n";
 }
+void json::Writer::WriteElement(const ConfigValue& node, uint32_t index, int indent_level, std::stringstream& out, bool format)
+{
+	_format = format;
+	_ilevel = indent_level;
+	WriteArrayElement(node, index, out);
+}
+void json::Writer::WriteArrayElement(const ConfigValue& node, uint32_t index, std::stringstream& out)
+{
+	if(index != 0)
+		out << ",";
+
+	if(_format)
+	{
+		out << "\n";
+		json_internal::WriteTabs(_ilevel, out);
+	}
+	WriteValue(node, out);
+}
 void json::Writer::WriteValue(const ConfigValue& node, std::stringstream& out)
 {
 	switch(node.Type())
@@ -495,7 +580,7 @@ void json::Writer::WriteValue(const ConfigValue& node, std::stringstream& out)
 		out << "null";
 		break;
 	case ConfigValue::BOOL:
-		out << node.AsBool();
+		out << (node.AsBool() ? "true" : "false");
 		break;
 	case ConfigValue::INTEGER:
 		out << node.AsInt64();
@@ -504,7 +589,7 @@ void json::Writer::WriteValue(const ConfigValue& node, std::stringstream& out)
 		out << node.AsUInt64();
 		break;
 	case ConfigValue::FLOAT:
-		out << node.AsDouble();
+		json_internal::WriteNumber(node.AsDouble(), out);
 		break;
 	case ConfigValue::STRING:
 		out << "\"";
@@ -519,15 +604,7 @@ void json::Writer::WriteValue(const ConfigValue& node, std::stringstream& out)
 			int size = node.Size(); 
 			for(int i = 0; i < size; ++i)
 			{
-				if(i != 0)
-					out << ",";
-
-				if(_format)
-				{
-					out << "\n";
-					json_internal::WriteTabs(_ilevel, out);
-				}
-				WriteValue(node[i], out);
+				WriteArrayElement(node[i], i, out);
 			}
 			if(_format)
 				out << "\n";
@@ -35,7 +35,7 @@ namespace json
 		~Reader();
 
 		/// Parses a JSON document into ConfigValues
-		///	@param doc JSON docoument
+		///	@param doc JSON docoument, doesn't need to be null-terminated
 		///	@param root This is going to be the root node
 		///	@return True if the parsing was successful, else false
 		bool Read(const char* doc, int64_t length, ConfigValue& root);
@@ -62,6 +62,14 @@ namespace json
 		bool ParseString(std::string& str);
 		void SkipSpaces();
 
+		/// Returns the current character, or '\0' at the end of the document. The document
+		///	is not required to be null-terminated, e.g. when parsing directly from a mapped file.
+		char Peek() const;
+
+		/// Skips the specified literal (e.g. "true") if it's next in the document.
+		/// @return True if the literal was found, false if not.
+		bool Expect(const char* literal);
+
 	};
 
 	class Writer
@@ -77,11 +85,22 @@ namespace json
 		///			human readable, otherwise everything is just printed on one line.
 		void Write(const ConfigValue& root, std::stringstream& out, bool format);
 
+		/// @brief Generates JSON for a single array element, laid out exactly as the element
+		///			at the specified index would be if the whole array was written with Write.
+		///			This allows large arrays to be generated in separate pieces and then concatenated.
+		/// @param node The array element.
+		/// @param index Index of the element within its array.
+		/// @param indent_level Indent level of the elements in the array.
+		/// @param out The generated JSON will be appended to this variable
+		/// @param format Should we use any formatting, see Write.
+		void WriteElement(const ConfigValue& node, uint32_t index, int indent_level, std::stringstream& out, bool format);
+
 	private:
 		bool _format;
 		int _ilevel; // Indent level
 
 		void WriteValue(const ConfigValue& node, std::stringstream& out);
+		void WriteArrayElement(const ConfigValue& node, uint32_t index, std::stringstream& out);
 	};
 };
 
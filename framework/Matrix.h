@@ -8,56 +8,85 @@ struct Mat4x4
 {
 	Vec4 col[4]; // Columns
 
+	Mat4x4() {}
+#ifdef MATH_HAS_CONSTEXPR
+	constexpr Mat4x4(const Vec4& c0, const Vec4& c1, const Vec4& c2, const Vec4& c3) : col{c0, c1, c2, c3} {}
+#else
+	Mat4x4(const Vec4& c0, const Vec4& c1, const Vec4& c2, const Vec4& c3)
+	{
+		col[0] = c0; col[1] = c1; col[2] = c2; col[3] = c3;
+	}
+#endif
 };
 
+/// @brief Same as matrix::Multiply.
+inline Mat4x4 operator*(const Mat4x4& lhs, const Mat4x4& rhs);
+inline Vec4 operator*(const Mat4x4& lhs, const Vec4& rhs);
+
 namespace matrix
 {
 	/// @brief Creates an identity matrix.
-	Mat4x4 CreateIdentity();
+	MATH_CONSTEXPR Mat4x4 CreateIdentity();
 
 	/// @brief Creates a translation matrix with the specified translation.
-	Mat4x4 CreateTranslation(const Vec3& translation);
+	MATH_CONSTEXPR Mat4x4 CreateTranslation(const Vec3& translation);
 	
 	/// @brief Creates a rotation matrix with the specified angle around the x-axis.
-	Mat4x4 CreateRotationX(float angle);
+	inline Mat4x4 CreateRotationX(float angle);
 
 	/// @brief Creates a rotation matrix with the specified angle around the y-axis.
-	Mat4x4 CreateRotationY(float angle);
+	inline Mat4x4 CreateRotationY(float angle);
 
 	/// @brief Creates a rotation matrix with the specified angle around the z-axis.
-	Mat4x4 CreateRotationZ(float angle);
+	inline Mat4x4 CreateRotationZ(float angle);
 
 	/// @brief Creates a rotation matrix with the specified rotation.
-	Mat4x4 CreateRotationXYZ(float head, float pitch, float roll);
+	inline Mat4x4 CreateRotationXYZ(float head, float pitch, float roll);
 
 	/// @brief Creates a scaling matrix with the specified scale.
-	Mat4x4 CreateScaling(const Vec3& scale);
+	MATH_CONSTEXPR Mat4x4 CreateScaling(const Vec3& scale);
 
 	/// @brief Creates a perspective projection matrix.
 	/// @param fovy Field of view angle in the y direction in radians.
 	/// @param aspect Aspect ratio (ratio of width to height).
 	/// @param znear Distance to the near clipping plane from the viewer.
 	/// @param zfar Distance to the far clipping plane from the viewer.
-	Mat4x4 CreatePerspective(float fovy, float aspect, float znear, float zfar);
+	inline Mat4x4 CreatePerspective(float fovy, float aspect, float znear, float zfar);
 
 	/// @brief Creates a view matrix from the specified arguments.
 	/// @param eye The position of the eye.
 	/// @param at The position to look at.
 	/// @param up The up vector.
-	Mat4x4 LookAt(const Vec3& eye, const Vec3& at, const Vec3& up);
+	inline Mat4x4 LookAt(const Vec3& eye, const Vec3& at, const Vec3& up);
 
 	/// @brief Multiplies two matrices.
-	Mat4x4 Multiply(const Mat4x4& lhs, const Mat4x4& rhs);
+	inline Mat4x4 Multiply(const Mat4x4& lhs, const Mat4x4& rhs);
 
 	/// @brief Multiplies a matrix and a vector.
-	Vec4 Multiply(const Mat4x4& lhs, const Vec4& rhs);
+	inline Vec4 Multiply(const Mat4x4& lhs, const Vec4& rhs);
+
+	/// @brief Transposes the specified matrix.
+	inline Mat4x4 Transpose(const Mat4x4& m);
 
 	/// @brief Calculates the determinant of the specified matrix.
-	float Determinant(const Mat4x4& m);
+	inline float Determinant(const Mat4x4& m);
 
 	/// @brief Calculates the inverse of the specified matrix.
-	Mat4x4 Inverse(const Mat4x4& m);
+	inline Mat4x4 Inverse(const Mat4x4& m);
+
+	/// @brief Calculates the inverse of an affine matrix (Any combination of rotations, scaling and translations).
+	///	The bottom row needs to be (0, 0, 0, 1).
+	inline Mat4x4 InverseAffine(const Mat4x4& m);
+
+	/// @brief Calculates the inverse of a rigid transformation (Only rotations and translations), e.g. a view matrix.
+	inline Mat4x4 InverseRigid(const Mat4x4& m);
+
+	/// @brief Calculates the inverse of a perspective projection matrix, as created by CreatePerspective.
+	///	Off-center projections are also supported.
+	inline Mat4x4 InversePerspective(const Mat4x4& m);
 
 };
 
+#include "Matrix.inl"
+
 #endif // __FRAMEWORK_MATRIX_H__
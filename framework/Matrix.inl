@@ -0,0 +1,371 @@
+// Implementation of Matrix.h, everything is inline so that calls can be optimized across the library boundary.
+
+#include "Simd.h"
+
+#include <math.h>
+
+MATH_CONSTEXPR Mat4x4 matrix::CreateIdentity()
+{
+	return Mat4x4(	Vec4(1.0f, 0.0f, 0.0f, 0.0f),
+					Vec4(0.0f, 1.0f, 0.0f, 0.0f),
+					Vec4(0.0f, 0.0f, 1.0f, 0.0f),
+					Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+MATH_CONSTEXPR Mat4x4 matrix::CreateTranslation(const Vec3& translation)
+{
+	// Translation [Real-time Rendering, 4.2, page 56]
+	return Mat4x4(	Vec4(1.0f, 0.0f, 0.0f, 0.0f),
+					Vec4(0.0f, 1.0f, 0.0f, 0.0f),
+					Vec4(0.0f, 0.0f, 1.0f, 0.0f),
+					Vec4(translation.x, translation.y, translation.z, 1.0f));
+}
+
+inline Mat4x4 matrix::CreateRotationX(float angle)
+{
+	Mat4x4 result;
+
+	// Rotation [Real-time Rendering, 4.3, page 57]
+	result.col[0] = Vec4(1.0f, 0.0f, 0.0f, 0.0f);
+	result.col[1] = Vec4(0.0f, cosf(angle), sinf(angle), 0.0f);
+	result.col[2] = Vec4(0.0f, -sinf(angle), cosf(angle), 0.0f);
+	result.col[3] = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	return result;
+}
+
+inline Mat4x4 matrix::CreateRotationY(float angle)
+{
+	Mat4x4 result;
+
+	// Rotation [Real-time Rendering, 4.4, page 57]
+	result.col[0] = Vec4(cosf(angle), 0.0f, -sinf(angle), 0.0f);
+	result.col[1] = Vec4(0.0f, 1.0f, 0.0f, 0.0f);
+	result.col[2] = Vec4(sinf(angle), 0.0f, cosf(angle), 0.0f);
+	result.col[3] = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	return result;
+}
+
+inline Mat4x4 matrix::CreateRotationZ(float angle)
+{
+	Mat4x4 result;
+
+	// Rotation [Real-time Rendering, 4.5, page 57]
+	result.col[0] = Vec4(cosf(angle), sinf(angle), 0.0f, 0.0f);
+	result.col[1] = Vec4(-sinf(angle), cosf(angle), 0.0f, 0.0f);
+	result.col[2] = Vec4(0.0f, 0.0f, 1.0f, 0.0f);
+	result.col[3] = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	return result;
+}
+
+inline Mat4x4 matrix::CreateRotationXYZ(float head, float pitch, float roll)
+{
+	// To rotate in (head, pitch, roll) we first need to create one matrix for each axis,
+	//	then we can just multiply them to get the resulting rotation matrix.
+	//	E(yaw, pitch, roll) = Rz(roll) Rx(pitch) Ry(head) [Real-time Rendering, 4.17, page 66]
+
+	Mat4x4 rx = CreateRotationX(pitch); 
+	Mat4x4 ry = CreateRotationY(head); 
+	Mat4x4 rz = CreateRotationZ(roll); 
+
+	// result = rx*(ry*rz)
+	Mat4x4 result = matrix::Multiply(ry, rz);
+	result = matrix::Multiply(rx, result);
+
+	return result;
+}
+
+MATH_CONSTEXPR Mat4x4 matrix::CreateScaling(const Vec3& scale)
+{
+	// Scaling [Real-time Rendering, 4.8, page 58]
+	return Mat4x4(	Vec4(scale.x, 0.0f, 0.0f, 0.0f),
+					Vec4(0.0f, scale.y, 0.0f, 0.0f),
+					Vec4(0.0f, 0.0f, scale.z, 0.0f),
+					Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+inline Mat4x4 matrix::CreatePerspective(float fovy, float aspect, float znear, float zfar)
+{
+	Mat4x4 result;
+
+	// Perspective projection [Real-Time Rendering, 4.69, page 96]
+	// n		: distance to the near clipping plane.
+	// f		: distance to the far clipping plane.
+	// (l, b)	: bottom-left corner of near clipping plane
+	// (r, t)	: top-right corner of near clipping plane
+
+	// 2n/(r-l)		0			(r+l)/(r-l)		0
+	// 0			2n/(t-b)	(t+b)/(t-b)		0
+	// 0			0			-(f+n)/(f-n)	-2fn/(f-n)
+	// 0			0			-1				0
+	
+	// We want a symmetric frustum:
+	//	(r+l)/(r-l) => 0
+	//	(t+b)/(t-b) => 0
+
+	float tan_half_fovy = tanf(fovy*0.5f);
+
+	// (r-l) = tan_half_fovy * aspect * n * 2	=>	2n/(r-l) = 1 / (tan_half_fovy * aspect)
+	result.col[0] = Vec4(1.0f / (tan_half_fovy*aspect), 0.0f, 0.0f, 0.0f);
+	
+	// (t-b) = tan_half_fovy * n * 2	=>	2n/(t-b) = 1 / (tan_half_fovy)
+	result.col[1] = Vec4(0.0f, 1.0f / (tan_half_fovy), 0.0f, 0.0f);
+
+	result.col[2] = Vec4(0.0f, 0.0f, -(zfar+znear)/(zfar-znear), -1.0f);
+	result.col[3] = Vec4(0.0f, 0.0f, -2 * zfar * znear / (zfar - znear), 0.0f);
+
+	return result;
+}
+
+inline Mat4x4 matrix::LookAt(const Vec3& eye, const Vec3& at, const Vec3& up)
+{
+	// http://www.cs.virginia.edu/~gfx/Courses/1999/intro.fall99.html/lookat.html
+
+	// The direction vector
+	Vec3 f = vector::Subtract(at, eye);
+	vector::Normalize(f);
+
+	// The right vector
+	Vec3 s = vector::Cross(f, up);
+	vector::Normalize(s);
+
+	// The up vector
+	Vec3 u = vector::Cross(s, f);
+
+	Mat4x4 rotation;
+
+	// Row 0
+	rotation.col[0].x = s.x;
+	rotation.col[1].x = s.y;
+	rotation.col[2].x = s.z;
+	rotation.col[3].x = 0.0f;
+	
+	// Row 1
+	rotation.col[0].y = u.x;
+	rotation.col[1].y = u.y;
+	rotation.col[2].y = u.z;
+	rotation.col[3].y = 0.0f;
+	
+	// Row 2
+	rotation.col[0].z = -f.x;
+	rotation.col[1].z = -f.y;
+	rotation.col[2].z = -f.z;
+	rotation.col[3].z = 0.0f;
+	
+	// Row 3
+	rotation.col[0].w = 0.0f;
+	rotation.col[1].w = 0.0f;
+	rotation.col[2].w = 0.0f;
+	rotation.col[3].w = 1.0f;
+
+	// Now we can get the resulting matrix by multiplying rotation with a translation matrix for the eye position.
+	// Like this:
+	//	Mat4x4 translation = matrix::CreateTranslation(Vec3(-eye.x, -eye.y, -eye.z));
+	//	Mat4x4 result = matrix::Multiply(rotation, translation);
+
+	// But a possible simplification to avoid the multiplication is to just directly insert the dot products of the 
+	//	eye position and the axes, as this will provide the same result.
+	rotation.col[3].x = -vector::Dot(s, eye);
+	rotation.col[3].y = -vector::Dot(u, eye);
+	rotation.col[3].z =  vector::Dot(f, eye);
+	rotation.col[3].w = 1.0f;
+
+	return rotation;
+}
+
+inline Mat4x4 matrix::Multiply(const Mat4x4& lhs, const Mat4x4& rhs)
+{
+	// Matrix multiplication [Real-Time Rendering, A.26, page 899]
+	//	Each column of the result is a linear combination of the columns of lhs, weighted by
+	//	the elements of the corresponding column in rhs.
+	simd::float4 l0 = simd::Load(&lhs.col[0].x);
+	simd::float4 l1 = simd::Load(&lhs.col[1].x);
+	simd::float4 l2 = simd::Load(&lhs.col[2].x);
+	simd::float4 l3 = simd::Load(&lhs.col[3].x);
+
+	Mat4x4 result;
+	for(int i = 0; i < 4; ++i)
+	{
+		const Vec4& c = rhs.col[i];
+		simd::float4 r = simd::Mul(l0, simd::Splat(c.x));
+		r = simd::MulAdd(l1, simd::Splat(c.y), r);
+		r = simd::MulAdd(l2, simd::Splat(c.z), r);
+		r = simd::MulAdd(l3, simd::Splat(c.w), r);
+		simd::Store(&result.col[i].x, r);
+	}
+	return result;
+}
+
+inline Vec4 matrix::Multiply(const Mat4x4& lhs, const Vec4& rhs)
+{
+	simd::float4 r = simd::Mul(simd::Load(&lhs.col[0].x), simd::Splat(rhs.x));
+	r = simd::MulAdd(simd::Load(&lhs.col[1].x), simd::Splat(rhs.y), r);
+	r = simd::MulAdd(simd::Load(&lhs.col[2].x), simd::Splat(rhs.z), r);
+	r = simd::MulAdd(simd::Load(&lhs.col[3].x), simd::Splat(rhs.w), r);
+
+	Vec4 result;
+	simd::Store(&result.x, r);
+	return result;
+}
+
+inline Mat4x4 matrix::Transpose(const Mat4x4& m)
+{
+	simd::float4 c0 = simd::Load(&m.col[0].x);
+	simd::float4 c1 = simd::Load(&m.col[1].x);
+	simd::float4 c2 = simd::Load(&m.col[2].x);
+	simd::float4 c3 = simd::Load(&m.col[3].x);
+	simd::Transpose(c0, c1, c2, c3);
+
+	Mat4x4 result;
+	simd::Store(&result.col[0].x, c0);
+	simd::Store(&result.col[1].x, c1);
+	simd::Store(&result.col[2].x, c2);
+	simd::Store(&result.col[3].x, c3);
+	return result;
+}
+
+namespace matrix_internal
+{
+	/// 2x2 sub-determinants of the upper two rows (s) and the lower two rows (c), shared by
+	///	the determinant and all cofactors [Eberly, The Laplace Expansion Theorem]
+	struct SubDeterminants
+	{
+		float s0, s1, s2, s3, s4, s5;
+		float c0, c1, c2, c3, c4, c5;
+
+		SubDeterminants(const Mat4x4& m)
+		{
+			// Element at row r, column c is m.col[c][r]
+			s0 = m.col[0].x*m.col[1].y - m.col[0].y*m.col[1].x;
+			s1 = m.col[0].x*m.col[2].y - m.col[0].y*m.col[2].x;
+			s2 = m.col[0].x*m.col[3].y - m.col[0].y*m.col[3].x;
+			s3 = m.col[1].x*m.col[2].y - m.col[1].y*m.col[2].x;
+			s4 = m.col[1].x*m.col[3].y - m.col[1].y*m.col[3].x;
+			s5 = m.col[2].x*m.col[3].y - m.col[2].y*m.col[3].x;
+
+			c5 = m.col[2].z*m.col[3].w - m.col[2].w*m.col[3].z;
+			c4 = m.col[1].z*m.col[3].w - m.col[1].w*m.col[3].z;
+			c3 = m.col[1].z*m.col[2].w - m.col[1].w*m.col[2].z;
+			c2 = m.col[0].z*m.col[3].w - m.col[0].w*m.col[3].z;
+			c1 = m.col[0].z*m.col[2].w - m.col[0].w*m.col[2].z;
+			c0 = m.col[0].z*m.col[1].w - m.col[0].w*m.col[1].z;
+		}
+
+		float Determinant() const
+		{
+			return s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+		}
+	};
+};
+
+inline float matrix::Determinant(const Mat4x4& m)
+{
+	return matrix_internal::SubDeterminants(m).Determinant();
+}
+inline Mat4x4 matrix::Inverse(const Mat4x4& m)
+{
+	// Inverse = adjugate / determinant, where the adjugate is built from the same 2x2 sub-determinants
+	//	as the determinant, so nothing is computed twice.
+	matrix_internal::SubDeterminants d(m);
+
+	Mat4x4 adj;
+	adj.col[0].x =  m.col[1].y*d.c5 - m.col[2].y*d.c4 + m.col[3].y*d.c3;
+	adj.col[0].y = -m.col[0].y*d.c5 + m.col[2].y*d.c2 - m.col[3].y*d.c1;
+	adj.col[0].z =  m.col[0].y*d.c4 - m.col[1].y*d.c2 + m.col[3].y*d.c0;
+	adj.col[0].w = -m.col[0].y*d.c3 + m.col[1].y*d.c1 - m.col[2].y*d.c0;
+
+	adj.col[1].x = -m.col[1].x*d.c5 + m.col[2].x*d.c4 - m.col[3].x*d.c3;
+	adj.col[1].y =  m.col[0].x*d.c5 - m.col[2].x*d.c2 + m.col[3].x*d.c1;
+	adj.col[1].z = -m.col[0].x*d.c4 + m.col[1].x*d.c2 - m.col[3].x*d.c0;
+	adj.col[1].w =  m.col[0].x*d.c3 - m.col[1].x*d.c1 + m.col[2].x*d.c0;
+
+	adj.col[2].x =  m.col[1].w*d.s5 - m.col[2].w*d.s4 + m.col[3].w*d.s3;
+	adj.col[2].y = -m.col[0].w*d.s5 + m.col[2].w*d.s2 - m.col[3].w*d.s1;
+	adj.col[2].z =  m.col[0].w*d.s4 - m.col[1].w*d.s2 + m.col[3].w*d.s0;
+	adj.col[2].w = -m.col[0].w*d.s3 + m.col[1].w*d.s1 - m.col[2].w*d.s0;
+
+	adj.col[3].x = -m.col[1].z*d.s5 + m.col[2].z*d.s4 - m.col[3].z*d.s3;
+	adj.col[3].y =  m.col[0].z*d.s5 - m.col[2].z*d.s2 + m.col[3].z*d.s1;
+	adj.col[3].z = -m.col[0].z*d.s4 + m.col[1].z*d.s2 - m.col[3].z*d.s0;
+	adj.col[3].w =  m.col[0].z*d.s3 - m.col[1].z*d.s1 + m.col[2].z*d.s0;
+
+	simd::float4 inv_det = simd::Splat(1.0f / d.Determinant());
+
+	Mat4x4 result;
+	for(int i = 0; i < 4; ++i)
+	{
+		simd::Store(&result.col[i].x, simd::Mul(simd::Load(&adj.col[i].x), inv_det));
+	}
+	return result;
+}
+inline Mat4x4 matrix::InverseAffine(const Mat4x4& m)
+{
+	// For M = | A t |, M^-1 = | A^-1 -A^-1*t |
+	//			| 0 1 |			| 0		1		|
+	//	Where A^-1 is the inverse of the upper 3x3 matrix, the transposed cofactors (columns are
+	//	cross products of the rows of A) divided by its determinant.
+	Vec3 c0(m.col[0].x, m.col[0].y, m.col[0].z);
+	Vec3 c1(m.col[1].x, m.col[1].y, m.col[1].z);
+	Vec3 c2(m.col[2].x, m.col[2].y, m.col[2].z);
+
+	Vec3 r0 = vector::Cross(c1, c2);
+	Vec3 r1 = vector::Cross(c2, c0);
+	Vec3 r2 = vector::Cross(c0, c1);
+	float inv_det = 1.0f / vector::Dot(c0, r0);
+	r0 = r0 * inv_det;
+	r1 = r1 * inv_det;
+	r2 = r2 * inv_det;
+
+	// r0, r1 and r2 are the rows of A^-1
+	Vec3 t(m.col[3].x, m.col[3].y, m.col[3].z);
+	return Mat4x4(	Vec4(r0.x, r1.x, r2.x, 0.0f),
+					Vec4(r0.y, r1.y, r2.y, 0.0f),
+					Vec4(r0.z, r1.z, r2.z, 0.0f),
+					Vec4(-vector::Dot(r0, t), -vector::Dot(r1, t), -vector::Dot(r2, t), 1.0f));
+}
+inline Mat4x4 matrix::InverseRigid(const Mat4x4& m)
+{
+	// The rotation is orthonormal, so its inverse is the transpose: M^-1 = | R^T -R^T*t |
+	Vec3 c0(m.col[0].x, m.col[0].y, m.col[0].z);
+	Vec3 c1(m.col[1].x, m.col[1].y, m.col[1].z);
+	Vec3 c2(m.col[2].x, m.col[2].y, m.col[2].z);
+	Vec3 t(m.col[3].x, m.col[3].y, m.col[3].z);
+
+	return Mat4x4(	Vec4(c0.x, c1.x, c2.x, 0.0f),
+					Vec4(c0.y, c1.y, c2.y, 0.0f),
+					Vec4(c0.z, c1.z, c2.z, 0.0f),
+					Vec4(-vector::Dot(c0, t), -vector::Dot(c1, t), -vector::Dot(c2, t), 1.0f));
+}
+inline Mat4x4 matrix::InversePerspective(const Mat4x4& m)
+{
+	// A perspective matrix (See CreatePerspective) has the form:
+	//	a	0	e	0
+	//	0	b	f	0
+	//	0	0	c	d
+	//	0	0	-1	0
+	// Solving for (x, y, z, w) gives the inverse:
+	//	1/a	0	0	e/a
+	//	0	1/b	0	f/b
+	//	0	0	0	-1
+	//	0	0	1/d	c/d
+	assert(m.col[2].w == -1.0f && m.col[3].w == 0.0f);
+
+	float a = m.col[0].x, b = m.col[1].y, c = m.col[2].z, d = m.col[3].z;
+	float e = m.col[2].x, f = m.col[2].y;
+
+	return Mat4x4(	Vec4(1.0f / a, 0.0f, 0.0f, 0.0f),
+					Vec4(0.0f, 1.0f / b, 0.0f, 0.0f),
+					Vec4(0.0f, 0.0f, 0.0f, 1.0f / d),
+					Vec4(e / a, f / b, -1.0f, c / d));
+}
+
+inline Mat4x4 operator*(const Mat4x4& lhs, const Mat4x4& rhs)
+{
+	return matrix::Multiply(lhs, rhs);
+}
+inline Vec4 operator*(const Mat4x4& lhs, const Vec4& rhs)
+{
+	return matrix::Multiply(lhs, rhs);
+}
@@ -0,0 +1,41 @@
+#ifndef __FRAMEWORK_MATRIXBATCH_H__
+#define __FRAMEWORK_MATRIXBATCH_H__
+
+#include "Matrix.h"
+
+/// @brief Transforms of many points or spheres by a single matrix.
+///
+///	Input and output are structure-of-arrays buffers, one array per component, so that four
+///	elements can be processed per SIMD operation (See Simd.h). Any count is allowed, the elements
+///	that don't fill a whole SIMD vector are processed one by one. The arrays need no particular
+///	alignment and the output arrays may be the same as the input arrays (In-place transform), but
+///	they may not overlap in any other way.
+///
+///	The results are exactly the same as calling matrix::Multiply for each element.
+namespace matrix
+{
+	/// @brief Transforms points (w = 1) by an affine matrix.
+	/// @param count Number of points.
+	inline void TransformPoints(const Mat4x4& m, const float* x, const float* y, const float* z, uint32_t count,
+		float* out_x, float* out_y, float* out_z);
+
+	/// @brief Transforms bounding spheres by an affine matrix.
+	///	The radii are scaled by the largest axis scale of the matrix, the transformed spheres always
+	///	enclose the transformed volumes, even if the scaling is non-uniform.
+	/// @param count Number of spheres.
+	inline void TransformSpheres(const Mat4x4& m, const float* x, const float* y, const float* z, const float* radius,
+		uint32_t count, float* out_x, float* out_y, float* out_z, float* out_radius);
+
+	/// @brief Transforms points (w = 1) into clip-space by a (projection) matrix.
+	///	No perspective division is performed, the caller can do that if needed.
+	/// @param count Number of points.
+	inline void ProjectPoints(const Mat4x4& m, const float* x, const float* y, const float* z, uint32_t count,
+		float* out_x, float* out_y, float* out_z, float* out_w);
+
+	/// @return The largest scale along any of the axes of the specified matrix.
+	inline float MaxAxisScale(const Mat4x4& m);
+};
+
+#include "MatrixBatch.inl"
+
+#endif // __FRAMEWORK_MATRIXBATCH_H__
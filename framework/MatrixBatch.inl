@@ -0,0 +1,131 @@
+// Implementation of MatrixBatch.h
+//	The operations are performed in the same order as in matrix::Multiply, x*c0 + y*c1 + z*c2 + c3,
+//	this keeps the results identical to the single-value functions, for the SIMD lanes as well as
+//	for the remaining elements.
+
+namespace matrix_batch_internal
+{
+	/// One row of a matrix, splatted for the SIMD path.
+	struct Row
+	{
+		float m0, m1, m2, m3;
+		simd::float4 v0, v1, v2, v3;
+
+		Row(const Mat4x4& m, int row)
+		{
+			m0 = (&m.col[0].x)[row];
+			m1 = (&m.col[1].x)[row];
+			m2 = (&m.col[2].x)[row];
+			m3 = (&m.col[3].x)[row];
+			v0 = simd::Splat(m0);
+			v1 = simd::Splat(m1);
+			v2 = simd::Splat(m2);
+			v3 = simd::Splat(m3);
+		}
+
+		simd::float4 Transform(simd::float4 x, simd::float4 y, simd::float4 z) const
+		{
+			simd::float4 r = simd::Mul(x, v0);
+			r = simd::MulAdd(y, v1, r);
+			r = simd::MulAdd(z, v2, r);
+			return simd::Add(r, v3);
+		}
+
+		float Transform(float x, float y, float z) const
+		{
+			float r = x * m0;
+			r = y * m1 + r;
+			r = z * m2 + r;
+			return r + m3;
+		}
+	};
+};
+
+inline void matrix::TransformPoints(const Mat4x4& m, const float* x, const float* y, const float* z, uint32_t count,
+	float* out_x, float* out_y, float* out_z)
+{
+	using namespace matrix_batch_internal;
+
+	Row rx(m, 0), ry(m, 1), rz(m, 2);
+
+	uint32_t i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		simd::float4 px = simd::Load(x + i);
+		simd::float4 py = simd::Load(y + i);
+		simd::float4 pz = simd::Load(z + i);
+
+		simd::Store(out_x + i, rx.Transform(px, py, pz));
+		simd::Store(out_y + i, ry.Transform(px, py, pz));
+		simd::Store(out_z + i, rz.Transform(px, py, pz));
+	}
+	for(; i < count; ++i)
+	{
+		float px = x[i], py = y[i], pz = z[i];
+
+		out_x[i] = rx.Transform(px, py, pz);
+		out_y[i] = ry.Transform(px, py, pz);
+		out_z[i] = rz.Transform(px, py, pz);
+	}
+}
+
+inline void matrix::TransformSpheres(const Mat4x4& m, const float* x, const float* y, const float* z, const float* radius,
+	uint32_t count, float* out_x, float* out_y, float* out_z, float* out_radius)
+{
+	TransformPoints(m, x, y, z, count, out_x, out_y, out_z);
+
+	float scale = MaxAxisScale(m);
+	simd::float4 scale4 = simd::Splat(scale);
+
+	uint32_t i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		simd::Store(out_radius + i, simd::Mul(simd::Load(radius + i), scale4));
+	}
+	for(; i < count; ++i)
+	{
+		out_radius[i] = radius[i] * scale;
+	}
+}
+
+inline void matrix::ProjectPoints(const Mat4x4& m, const float* x, const float* y, const float* z, uint32_t count,
+	float* out_x, float* out_y, float* out_z, float* out_w)
+{
+	using namespace matrix_batch_internal;
+
+	Row rx(m, 0), ry(m, 1), rz(m, 2), rw(m, 3);
+
+	uint32_t i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		simd::float4 px = simd::Load(x + i);
+		simd::float4 py = simd::Load(y + i);
+		simd::float4 pz = simd::Load(z + i);
+
+		simd::Store(out_x + i, rx.Transform(px, py, pz));
+		simd::Store(out_y + i, ry.Transform(px, py, pz));
+		simd::Store(out_z + i, rz.Transform(px, py, pz));
+		simd::Store(out_w + i, rw.Transform(px, py, pz));
+	}
+	for(; i < count; ++i)
+	{
+		float px = x[i], py = y[i], pz = z[i];
+
+		out_x[i] = rx.Transform(px, py, pz);
+		out_y[i] = ry.Transform(px, py, pz);
+		out_z[i] = rz.Transform(px, py, pz);
+		out_w[i] = rw.Transform(px, py, pz);
+	}
+}
+
+inline float matrix::MaxAxisScale(const Mat4x4& m)
+{
+	// The length of each of the first three columns is the scale along that axis
+	float sx = m.col[0].x*m.col[0].x + m.col[0].y*m.col[0].y + m.col[0].z*m.col[0].z;
+	float sy = m.col[1].x*m.col[1].x + m.col[1].y*m.col[1].y + m.col[1].z*m.col[1].z;
+	float sz = m.col[2].x*m.col[2].x + m.col[2].y*m.col[2].y + m.col[2].z*m.col[2].z;
+
+	float s = sx > sy ? sx : sy;
+	s = s > sz ? s : sz;
+	return sqrtf(s);
+}
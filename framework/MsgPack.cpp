@@ -0,0 +1,421 @@
+#include "Common.h"
+
+#include "MsgPack.h"
+#include "ConfigValue.h"
+
+#include <string.h>
+
+
+//-------------------------------------------------------------------------------
+
+namespace msgpack_internal
+{
+	// Format bytes [MessagePack specification, "Formats"]
+	enum
+	{
+		POSITIVE_FIXINT_MAX = 0x7f,
+		FIXMAP = 0x80,
+		FIXARRAY = 0x90,
+		FIXSTR = 0xa0,
+		NIL = 0xc0,
+		FALSE_VALUE = 0xc2,
+		TRUE_VALUE = 0xc3,
+		FLOAT32 = 0xca,
+		FLOAT64 = 0xcb,
+		UINT8 = 0xcc,
+		UINT16 = 0xcd,
+		UINT32 = 0xce,
+		UINT64 = 0xcf,
+		INT8 = 0xd0,
+		INT16 = 0xd1,
+		INT32 = 0xd2,
+		INT64 = 0xd3,
+		STR8 = 0xd9,
+		STR16 = 0xda,
+		STR32 = 0xdb,
+		ARRAY16 = 0xdc,
+		ARRAY32 = 0xdd,
+		MAP16 = 0xde,
+		MAP32 = 0xdf,
+		NEGATIVE_FIXINT_MIN = 0xe0
+	};
+
+	/// Writes the format byte followed by the value as a big-endian integer of the specified size.
+	void WriteFormat(uint8_t format, uint64_t value, int bytes, std::stringstream& out)
+	{
+		char buffer[9];
+		buffer[0] = (char)format;
+		for(int i = 0; i < bytes; ++i)
+		{
+			buffer[1 + i] = (char)(value >> (8 * (bytes - 1 - i)));
+		}
+		out.write(buffer, 1 + bytes);
+	}
+
+	/// Writes a header for a type that has a fix-variant (fixstr, fixarray, fixmap) and 16, 32 bit variants.
+	void WriteSizeHeader(uint32_t size, uint8_t fix_format, uint32_t fix_max, uint8_t format16, uint8_t format32, std::stringstream& out)
+	{
+		if(size <= fix_max)
+			WriteFormat((uint8_t)(fix_format | size), 0, 0, out);
+		else if(size <= 0xffff)
+			WriteFormat(format16, size, 2, out);
+		else
+			WriteFormat(format32, size, 4, out);
+	}
+
+	void WriteInt(int64_t value, std::stringstream& out)
+	{
+		if(value >= -32 && value <= POSITIVE_FIXINT_MAX)
+			WriteFormat((uint8_t)value, 0, 0, out); // Positive or negative fixint
+		else if(value >= INT8_MIN && value <= INT8_MAX)
+			WriteFormat(INT8, (uint64_t)value, 1, out);
+		else if(value >= INT16_MIN && value <= INT16_MAX)
+			WriteFormat(INT16, (uint64_t)value, 2, out);
+		else if(value >= INT32_MIN && value <= INT32_MAX)
+			WriteFormat(INT32, (uint64_t)value, 4, out);
+		else
+			WriteFormat(INT64, (uint64_t)value, 8, out);
+	}
+
+	void WriteUInt(uint64_t value, std::stringstream& out)
+	{
+		// Unsigned values never use the fixint format, that way they can be told apart from signed values.
+		if(value <= UINT8_MAX)
+			WriteFormat(UINT8, value, 1, out);
+		else if(value <= UINT16_MAX)
+			WriteFormat(UINT16, value, 2, out);
+		else if(value <= UINT32_MAX)
+			WriteFormat(UINT32, value, 4, out);
+		else
+			WriteFormat(UINT64, value, 8, out);
+	}
+
+	void WriteDouble(double value, std::stringstream& out)
+	{
+		float f = (float)value;
+		if((double)f == value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &f, 4);
+			WriteFormat(FLOAT32, bits, 4, out);
+		}
+		else
+		{
+			uint64_t bits;
+			memcpy(&bits, &value, 8);
+			WriteFormat(FLOAT64, bits, 8, out);
+		}
+	}
+}
+//-------------------------------------------------------------------------------
+msgpack::Reader::Reader()
+{
+	_cur = _end = _begin = 0;
+}
+msgpack::Reader::~Reader()
+{
+}
+//-------------------------------------------------------------------------------
+const std::string& msgpack::Reader::GetErrorMessage()
+{
+	return _error;
+}
+void msgpack::Reader::Error(const char* msg)
+{
+	std::stringstream ss;
+	ss << "(Offset: " << (_cur - _begin) << ") Error: " << msg;
+	_error = ss.str();
+}
+//-------------------------------------------------------------------------------
+bool msgpack::Reader::Read(const char* doc, int64_t length, ConfigValue& root)
+{
+	_cur = _begin = (const uint8_t*)doc;
+	_end = _begin + length;
+	_error = "";
+
+	return ParseValue(root);
+}
+bool msgpack::Reader::ReadUInt(int bytes, uint64_t& value)
+{
+	if(_end - _cur < bytes)
+	{
+		Error("Unexpected end of document");
+		return false;
+	}
+
+	value = 0;
+	for(int i = 0; i < bytes; ++i)
+	{
+		value = (value << 8) | *_cur++;
+	}
+	return true;
+}
+bool msgpack::Reader::ParseString(std::string& str, uint32_t length)
+{
+	if((uint64_t)(_end - _cur) < length)
+	{
+		Error("Unexpected end of document");
+		return false;
+	}
+	str.assign((const char*)_cur, length);
+	_cur += length;
+	return true;
+}
+bool msgpack::Reader::ParseArray(ConfigValue& value, uint32_t size)
+{
+	value.SetEmptyArray();
+	for(uint32_t i = 0; i < size; ++i)
+	{
+		if(!ParseValue(value.Append()))
+			return false;
+	}
+	return true;
+}
+bool msgpack::Reader::ParseObject(ConfigValue& value, uint32_t size)
+{
+	using namespace msgpack_internal;
+
+	value.SetEmptyObject();
+
+	std::string name;
+	for(uint32_t i = 0; i < size; ++i)
+	{
+		// Keys are required to be strings
+		if(_cur == _end)
+		{
+			Error("Unexpected end of document");
+			return false;
+		}
+
+		uint8_t format = *_cur++;
+		uint64_t length = 0;
+		if((format & 0xe0) == FIXSTR)
+		{
+			length = format & 0x1f;
+		}
+		else if(format >= STR8 && format <= STR32)
+		{
+			if(!ReadUInt(1 << (format - STR8), length))
+				return false;
+		}
+		else
+		{
+			Error("Expected string key");
+			return false;
+		}
+
+		if(!ParseString(name, (uint32_t)length))
+			return false;
+
+		if(!ParseValue(value[name.c_str()]))
+			return false;
+	}
+	return true;
+}
+bool msgpack::Reader::ParseValue(ConfigValue& value)
+{
+	using namespace msgpack_internal;
+
+	if(_cur == _end)
+	{
+		Error("Unexpected end of document");
+		return false;
+	}
+
+	uint8_t format = *_cur++;
+	uint64_t n = 0;
+
+	if(format <= POSITIVE_FIXINT_MAX)
+	{
+		value.SetInt((int64_t)format);
+		return true;
+	}
+	if(format >= NEGATIVE_FIXINT_MIN)
+	{
+		value.SetInt((int64_t)(int8_t)format);
+		return true;
+	}
+	if((format & 0xf0) == FIXMAP)
+		return ParseObject(value, format & 0x0f);
+	if((format & 0xf0) == FIXARRAY)
+		return ParseArray(value, format & 0x0f);
+	if((format & 0xe0) == FIXSTR)
+	{
+		std::string str;
+		if(!ParseString(str, format & 0x1f))
+			return false;
+		value.SetString(str.c_str());
+		return true;
+	}
+
+	switch(format)
+	{
+	case NIL:
+		value.SetNull();
+		return true;
+	case FALSE_VALUE:
+		value.SetBool(false);
+		return true;
+	case TRUE_VALUE:
+		value.SetBool(true);
+		return true;
+	case FLOAT32:
+		{
+			if(!ReadUInt(4, n))
+				return false;
+			uint32_t bits = (uint32_t)n;
+			float f;
+			memcpy(&f, &bits, 4);
+			value.SetFloat(f);
+		}
+		return true;
+	case FLOAT64:
+		{
+			if(!ReadUInt(8, n))
+				return false;
+			double d;
+			memcpy(&d, &n, 8);
+			value.SetDouble(d);
+		}
+		return true;
+	case UINT8:
+	case UINT16:
+	case UINT32:
+	case UINT64:
+		if(!ReadUInt(1 << (format - UINT8), n))
+			return false;
+		value.SetUInt(n);
+		return true;
+	case INT8:
+		if(!ReadUInt(1, n))
+			return false;
+		value.SetInt((int64_t)(int8_t)n);
+		return true;
+	case INT16:
+		if(!ReadUInt(2, n))
+			return false;
+		value.SetInt((int64_t)(int16_t)n);
+		return true;
+	case INT32:
+		if(!ReadUInt(4, n))
+			return false;
+		value.SetInt((int64_t)(int32_t)n);
+		return true;
+	case INT64:
+		if(!ReadUInt(8, n))
+			return false;
+		value.SetInt((int64_t)n);
+		return true;
+	case STR8:
+	case STR16:
+	case STR32:
+		{
+			if(!ReadUInt(1 << (format - STR8), n))
+				return false;
+			std::string str;
+			if(!ParseString(str, (uint32_t)n))
+				return false;
+			value.SetString(str.c_str());
+		}
+		return true;
+	case ARRAY16:
+	case ARRAY32:
+		if(!ReadUInt(format == ARRAY16 ? 2 : 4, n))
+			return false;
+		return ParseArray(value, (uint32_t)n);
+	case MAP16:
+	case MAP32:
+		if(!ReadUInt(format == MAP16 ? 2 : 4, n))
+			return false;
+		return ParseObject(value, (uint32_t)n);
+	default:
+		break;
+	};
+
+	// bin and ext types have no ConfigValue counterpart
+	Error("Unsupported type");
+	return false;
+}
+//-------------------------------------------------------------------------------
+msgpack::Writer::Writer()
+{
+}
+msgpack::Writer::~Writer()
+{
+}
+void msgpack::Writer::Write(const ConfigValue& root, std::stringstream& out)
+{
+	WriteValue(root, out);
+}
+void msgpack::Writer::WriteArrayHeader(uint32_t size, std::stringstream& out)
+{
+	using namespace msgpack_internal;
+	WriteSizeHeader(size, FIXARRAY, 0x0f, ARRAY16, ARRAY32, out);
+}
+void msgpack::Writer::WriteObjectHeader(uint32_t size, std::stringstream& out)
+{
+	using namespace msgpack_internal;
+	WriteSizeHeader(size, FIXMAP, 0x0f, MAP16, MAP32, out);
+}
+void msgpack::Writer::WriteString(const char* str, uint32_t length, std::stringstream& out)
+{
+	using namespace msgpack_internal;
+	if(length <= 0x1f)
+		WriteFormat((uint8_t)(FIXSTR | length), 0, 0, out);
+	else if(length <= 0xff)
+		WriteFormat(STR8, length, 1, out);
+	else if(length <= 0xffff)
+		WriteFormat(STR16, length, 2, out);
+	else
+		WriteFormat(STR32, length, 4, out);
+	out.write(str, length);
+}
+void msgpack::Writer::WriteValue(const ConfigValue& node, std::stringstream& out)
+{
+	using namespace msgpack_internal;
+
+	switch(node.Type())
+	{
+	case ConfigValue::NULL_VALUE:
+		WriteFormat(NIL, 0, 0, out);
+		break;
+	case ConfigValue::BOOL:
+		WriteFormat(node.AsBool() ? TRUE_VALUE : FALSE_VALUE, 0, 0, out);
+		break;
+	case ConfigValue::INTEGER:
+		WriteInt(node.AsInt64(), out);
+		break;
+	case ConfigValue::UINTEGER:
+		WriteUInt(node.AsUInt64(), out);
+		break;
+	case ConfigValue::FLOAT:
+		WriteDouble(node.AsDouble(), out);
+		break;
+	case ConfigValue::STRING:
+		WriteString(node.AsString(), node.Size(), out);
+		break;
+	case ConfigValue::ARRAY:
+		{
+			int size = node.Size();
+			WriteArrayHeader(size, out);
+			for(int i = 0; i < size; ++i)
+			{
+				WriteValue(node[i], out);
+			}
+		}
+		break;
+	case ConfigValue::OBJECT:
+		{
+			WriteObjectHeader(node.Size(), out);
+
+			ConfigValue::ConstIterator it, end;
+			it = node.Begin(); end = node.End();
+			for( ; it != end; ++it)
+			{
+				WriteString(it->first.c_str(), (uint32_t)it->first.size(), out);
+				WriteValue(it->second, out);
+			}
+		}
+		break;
+	};
+}
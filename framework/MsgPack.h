@@ -0,0 +1,81 @@
+#ifndef __MSGPACK_H__
+#define __MSGPACK_H__
+
+#include <string>
+#include <sstream>
+
+class ConfigValue;
+
+/// @brief MessagePack (http://msgpack.org) encoding of ConfigValues, a compact binary
+///			alternative to JSON with the same interface as json::Reader and json::Writer.
+///
+///	All ConfigValue types round-trip exactly:
+///	- INTEGER values are always encoded with the signed formats (fixint, int 8-64).
+///	- UINTEGER values are always encoded with the unsigned formats (uint 8-64), never as fixint.
+///	- FLOAT values are encoded as float 32 if that is lossless, otherwise float 64.
+///	- OBJECT keys are encoded as strings.
+namespace msgpack
+{
+	class Reader
+	{
+	public:
+		Reader();
+		~Reader();
+
+		/// Parses a MessagePack document into ConfigValues
+		///	@param doc MessagePack document
+		///	@param root This is going to be the root node
+		///	@return True if the parsing was successful, else false
+		bool Read(const char* doc, int64_t length, ConfigValue& root);
+
+		/// Returns an error message if the last call to Read failed.
+		const std::string& GetErrorMessage();
+
+	private:
+		const uint8_t* _begin;
+		const uint8_t* _cur;
+		const uint8_t* _end;
+
+		std::string _error;
+
+		void Error(const char* msg);
+
+		bool ParseValue(ConfigValue& value);
+		bool ParseArray(ConfigValue& value, uint32_t size);
+		bool ParseObject(ConfigValue& value, uint32_t size);
+		bool ParseString(std::string& str, uint32_t length);
+
+		/// Reads a big-endian unsigned integer of the specified size (1, 2, 4 or 8 bytes).
+		bool ReadUInt(int bytes, uint64_t& value);
+	};
+
+	class Writer
+	{
+	public:
+		Writer();
+		~Writer();
+
+		/// @brief Generates MessagePack from the specified ConfigValue
+		/// @param root Root config node
+		/// @param out The generated document will be appended to this variable
+		void Write(const ConfigValue& root, std::stringstream& out);
+
+		/// @brief Writes the header of an array with the specified number of elements, the elements
+		///			are expected to follow, e.g. written by separate calls to Write. This allows large arrays
+		///			to be generated in separate pieces and then concatenated.
+		static void WriteArrayHeader(uint32_t size, std::stringstream& out);
+
+		/// @brief Writes the header of an object with the specified number of elements, each element is
+		///			expected to follow as a key written by WriteString and then a value.
+		static void WriteObjectHeader(uint32_t size, std::stringstream& out);
+
+		/// @brief Writes a string value.
+		static void WriteString(const char* str, uint32_t length, std::stringstream& out);
+
+	private:
+		void WriteValue(const ConfigValue& node, std::stringstream& out);
+	};
+};
+
+
+#endif // __MSGPACK_H__
@@ -0,0 +1,458 @@
+#include "Common.h"
+
+#include "OcclusionBuffer.h"
+#include "Parallel.h"
+
+#include <algorithm>
+
+namespace occlusion_buffer_internal
+{
+	/// Corners of each face of a box, counter-clockwise seen from the outside (See OcclusionBuffer::ProjectBox).
+	const int box_faces[6][4] =
+	{
+		{ 0, 4, 6, 2 }, // -x
+		{ 1, 3, 7, 5 }, // +x
+		{ 0, 1, 5, 4 }, // -y
+		{ 2, 6, 7, 3 }, // +y
+		{ 0, 2, 3, 1 }, // -z
+		{ 4, 5, 7, 6 } // +z
+	};
+
+	/// Faces with a projected area below this (In pixels) are too thin for their depth function to be reliable,
+	///	the farthest depth of their corners is used instead, which is always a safe (but less precise) choice.
+	const float min_face_area = 0.01f;
+
+	/// Objects are only hidden if they are farther than the occluders by this factor, so that rounding errors
+	///	can't make an object hide behind itself or behind another object at the same depth.
+	const float depth_tolerance = 1.0001f;
+
+	/// Max number of texels TestBox reads from a level before giving up on finer levels.
+	const uint32_t max_test_texels = 64;
+
+	/// Min amount of work for each thread in Finish. Threads are started for every call (See Parallel.h), which
+	///	costs about as much as setting up a few dozen occluders or rasterizing ten thousand pixels (Measured by
+	///	MathTest), so each thread gets several times that and a typical frame stays on the calling thread.
+	const uint32_t rows_per_chunk = 16;
+	const uint32_t occluders_per_chunk = 512;
+	const uint32_t pixels_per_chunk = 65536; // Covered by the bounding rectangles of the occluders
+
+	/// Sorts points by x, then y.
+	struct PointLess
+	{
+		bool operator()(const Vec3& a, const Vec3& b) const
+		{
+			return a.x < b.x || (a.x == b.x && a.y < b.y);
+		}
+	};
+
+	/// @return Twice the signed area of the triangle (a, b, c) in the xy-plane, positive if counter-clockwise.
+	inline float Cross(const Vec3& a, const Vec3& b, const Vec3& c)
+	{
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	/// Convex hull of points in the xy-plane [Andrew's monotone chain].
+	/// @param points Points, reordered by the call.
+	/// @param hull Filled with the corners of the hull, counter-clockwise. Room for count corners is needed.
+	/// @return Number of corners.
+	uint32_t ConvexHull(Vec3* points, uint32_t count, Vec3* hull)
+	{
+		std::sort(points, points + count, PointLess());
+
+		Vec3 chain[16];
+		uint32_t n = 0;
+		for(uint32_t i = 0; i < count; ++i) // Lower chain
+		{
+			while(n >= 2 && Cross(chain[n-2], chain[n-1], points[i]) <= 0.0f)
+				--n;
+			chain[n++] = points[i];
+		}
+		for(uint32_t i = count - 1, lower = n + 1; i-- > 0; ) // Upper chain
+		{
+			while(n >= lower && Cross(chain[n-2], chain[n-1], points[i]) <= 0.0f)
+				--n;
+			chain[n++] = points[i];
+		}
+		--n; // The last point is the first one again
+
+		uint32_t result = std::min(n, count);
+		std::copy(chain, chain + result, hull);
+		return result;
+	}
+
+	/// Offsets a function a*x + b*y + c of pixel indices to give its smallest value within each pixel.
+	inline Vec3 PixelMin(float a, float b, float c)
+	{
+		return Vec3(a, b, c + std::min(a, 0.0f) + std::min(b, 0.0f));
+	}
+};
+
+struct OcclusionBuffer::SetupTask
+{
+	OcclusionBuffer& buffer;
+	SetupTask(OcclusionBuffer& b) : buffer(b) {}
+
+	void operator()(uint32_t , uint32_t begin, uint32_t end)
+	{
+		for(uint32_t i = begin; i < end; ++i)
+			buffer.SetupOccluder(buffer._occluder_boxes[i], buffer._occluders[i]);
+	}
+};
+struct OcclusionBuffer::RasterizeTask
+{
+	OcclusionBuffer& buffer;
+	RasterizeTask(OcclusionBuffer& b) : buffer(b) {}
+
+	void operator()(uint32_t , uint32_t begin, uint32_t end)
+	{
+		buffer.RasterizeRows(begin, end);
+	}
+};
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height)
+{
+	assert(width > 0 && height > 0 && width % 4 == 0);
+
+	_view_projection = matrix::CreateIdentity();
+
+	// Halve the size until a single texel remains
+	for(;;)
+	{
+		Level level;
+		level.width = width;
+		level.height = height;
+		level.depth.resize(width * height, 0.0f);
+		_levels.push_back(level);
+
+		if(width == 1 && height == 1)
+			break;
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+}
+OcclusionBuffer::~OcclusionBuffer()
+{
+}
+//-------------------------------------------------------------------------------
+void OcclusionBuffer::Begin(const Mat4x4& view_projection)
+{
+	_view_projection = view_projection;
+	_occluder_boxes.clear();
+
+	std::fill(_levels[0].depth.begin(), _levels[0].depth.end(), 0.0f);
+}
+void OcclusionBuffer::AddOccluder(const Mat4x4& transform, const Aabb& box)
+{
+	OccluderBox occluder;
+	occluder.transform = transform;
+	occluder.box = box;
+	_occluder_boxes.push_back(occluder);
+}
+void OcclusionBuffer::Finish()
+{
+	using namespace occlusion_buffer_internal;
+
+	uint32_t count = (uint32_t)_occluder_boxes.size();
+	_occluders.resize(count);
+	if(count)
+	{
+		SetupTask setup(*this);
+		parallel::ForEachChunk(count, parallel::ChunkCount(count, occluders_per_chunk), setup);
+
+		// The area of the bounding rectangles is a cheap estimate of the rasterization work
+		uint64_t pixels = 0;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			const Occluder& occluder = _occluders[i];
+			if(occluder.edge_count)
+				pixels += (uint64_t)(occluder.max_x - occluder.min_x) * (uint64_t)(occluder.max_y - occluder.min_y);
+		}
+
+		// Each thread takes its own rows, so no pixel is written by more than one thread
+		uint32_t height = _levels[0].height;
+		uint32_t chunk_count = std::min(parallel::ChunkCount(height, rows_per_chunk),
+			parallel::ChunkCount((uint32_t)std::min(pixels, (uint64_t)UINT32_MAX), pixels_per_chunk));
+		RasterizeTask rasterize(*this);
+		parallel::ForEachChunk(height, chunk_count, rasterize);
+	}
+
+	BuildLevels();
+}
+//-------------------------------------------------------------------------------
+bool OcclusionBuffer::TestBox(const Mat4x4& transform, const Aabb& box) const
+{
+	using namespace occlusion_buffer_internal;
+
+	Vec3 corners[8];
+	if(!ProjectBox(transform, box, corners))
+		return true;
+
+	float min_x = corners[0].x, min_y = corners[0].y, max_x = corners[0].x, max_y = corners[0].y;
+	float nearest = corners[0].z;
+	for(int i = 1; i < 8; ++i)
+	{
+		min_x = std::min(min_x, corners[i].x); max_x = std::max(max_x, corners[i].x);
+		min_y = std::min(min_y, corners[i].y); max_y = std::max(max_y, corners[i].y);
+		nearest = std::max(nearest, corners[i].z);
+	}
+
+	// Every pixel touched by the bounding rectangle, the comparisons are written to also catch NaN
+	const Level& base = _levels[0];
+	if(!(min_x < (float)base.width && max_x > 0.0f && min_y < (float)base.height && max_y > 0.0f))
+		return true;
+
+	uint32_t x0 = (uint32_t)std::max(floorf(min_x), 0.0f), x1 = (uint32_t)std::min(ceilf(max_x), (float)base.width) - 1;
+	uint32_t y0 = (uint32_t)std::max(floorf(min_y), 0.0f), y1 = (uint32_t)std::min(ceilf(max_y), (float)base.height) - 1;
+
+	// Start at the level where the rectangle covers at most 2x2 texels, moving to finer levels while
+	//	the coarser ones can't tell.
+	uint32_t level = 0;
+	while(level + 1 < _levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		++level;
+
+	float depth = nearest * depth_tolerance;
+	for(;;)
+	{
+		const Level& l = _levels[level];
+		bool hidden = true;
+		for(uint32_t y = y0 >> level; y <= (y1 >> level) && hidden; ++y)
+		{
+			const float* row = &l.depth[y * l.width];
+			for(uint32_t x = x0 >> level; x <= (x1 >> level); ++x)
+			{
+				if(!(row[x] > depth))
+				{
+					hidden = false;
+					break;
+				}
+			}
+		}
+		if(hidden)
+			return false;
+
+		if(level == 0)
+			return true;
+		--level;
+
+		uint32_t texels = ((x1 >> level) - (x0 >> level) + 1) * ((y1 >> level) - (y0 >> level) + 1);
+		if(texels > max_test_texels)
+			return true;
+	}
+}
+//-------------------------------------------------------------------------------
+uint32_t OcclusionBuffer::LevelCount() const
+{
+	return (uint32_t)_levels.size();
+}
+uint32_t OcclusionBuffer::Width(uint32_t level) const
+{
+	assert(level < _levels.size());
+	return _levels[level].width;
+}
+uint32_t OcclusionBuffer::Height(uint32_t level) const
+{
+	assert(level < _levels.size());
+	return _levels[level].height;
+}
+float OcclusionBuffer::Depth(uint32_t level, uint32_t x, uint32_t y) const
+{
+	assert(level < _levels.size());
+	const Level& l = _levels[level];
+	assert(x < l.width && y < l.height);
+	return l.depth[y * l.width + x];
+}
+uint32_t OcclusionBuffer::OccluderCount() const
+{
+	return (uint32_t)_occluder_boxes.size();
+}
+//-------------------------------------------------------------------------------
+bool OcclusionBuffer::ProjectBox(const Mat4x4& transform, const Aabb& box, Vec3* screen) const
+{
+	Mat4x4 m = matrix::Multiply(_view_projection, transform);
+	float half_width = 0.5f * _levels[0].width, half_height = 0.5f * _levels[0].height;
+
+	for(int i = 0; i < 8; ++i)
+	{
+		Vec4 corner(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z, 1.0f);
+		Vec4 clip = matrix::Multiply(m, corner);
+
+		// In front of the near plane, written to also catch NaN
+		if(!(clip.z > -clip.w && clip.w > 0.0f))
+			return false;
+
+		float inv_w = 1.0f / clip.w;
+		screen[i] = Vec3((clip.x * inv_w + 1.0f) * half_width, (clip.y * inv_w + 1.0f) * half_height, inv_w);
+	}
+	return true;
+}
+void OcclusionBuffer::SetupOccluder(const OccluderBox& input, Occluder& occluder) const
+{
+	using namespace occlusion_buffer_internal;
+
+	occluder.edge_count = 0;
+	occluder.depth_count = 0;
+
+	Vec3 corners[8];
+	if(!ProjectBox(input.transform, input.box, corners))
+		return;
+
+	// The silhouette of a box is the convex hull of its corners, pixels completely inside it are covered
+	Vec3 points[8], hull[8];
+	std::copy(corners, corners + 8, points);
+	uint32_t hull_count = ConvexHull(points, 8, hull);
+	if(hull_count < 3)
+		return;
+
+	// Only pixels completely inside the bounds of the hull can be covered
+	float min_x = hull[0].x, min_y = hull[0].y, max_x = hull[0].x, max_y = hull[0].y;
+	for(uint32_t i = 1; i < hull_count; ++i)
+	{
+		min_x = std::min(min_x, hull[i].x); max_x = std::max(max_x, hull[i].x);
+		min_y = std::min(min_y, hull[i].y); max_y = std::max(max_y, hull[i].y);
+	}
+	float width = (float)_levels[0].width, height = (float)_levels[0].height;
+	occluder.min_x = (int32_t)std::min(std::max(ceilf(min_x), 0.0f), width);
+	occluder.min_y = (int32_t)std::min(std::max(ceilf(min_y), 0.0f), height);
+	occluder.max_x = (int32_t)std::min(std::max(floorf(max_x), 0.0f), width);
+	occluder.max_y = (int32_t)std::min(std::max(floorf(max_y), 0.0f), height);
+	if(occluder.min_x >= occluder.max_x || occluder.min_y >= occluder.max_y)
+		return;
+
+	// Edge functions are >= 0 on the inside (left side) of the counter-clockwise edges
+	for(uint32_t i = 0; i < hull_count; ++i)
+	{
+		const Vec3& p0 = hull[i];
+		const Vec3& p1 = hull[(i + 1) % hull_count];
+		float a = p0.y - p1.y, b = p1.x - p0.x;
+		occluder.edges[i] = PixelMin(a, b, -(a * p0.x + b * p0.y));
+	}
+
+	// A ray through the box enters it through the front face with the farthest intersection, i.e. the
+	//	smallest 1 / w. Within the silhouette the depth of the box is the smallest depth function of the
+	//	front faces. Front faces are counter-clockwise on the screen, unless the transform mirrors the box.
+	float det = matrix::Determinant(input.transform);
+	for(int f = 0; f < 6; ++f)
+	{
+		const Vec3& p0 = corners[box_faces[f][0]];
+		const Vec3& p1 = corners[box_faces[f][1]];
+		const Vec3& p2 = corners[box_faces[f][2]];
+		const Vec3& p3 = corners[box_faces[f][3]];
+
+		float area012 = Cross(p0, p1, p2), area023 = Cross(p0, p2, p3);
+		float area = 0.5f * (area012 + area023);
+		if(det < 0.0f)
+			area = -area;
+
+		if(area < -min_face_area)
+			continue; // Back face
+
+		if(area < min_face_area)
+		{
+			// Too thin, a constant depth no nearer than any point on the face
+			float farthest = std::min(std::min(p0.z, p1.z), std::min(p2.z, p3.z));
+			occluder.depths[occluder.depth_count++] = Vec3(0.0f, 0.0f, farthest);
+			continue;
+		}
+
+		// Plane through the three corners spanning the larger triangle, solved for the depth: (x, y, z) . n = p0 . n
+		Vec3 n = fabsf(area012) >= fabsf(area023) ? vector::Cross(p1 - p0, p2 - p0) : vector::Cross(p2 - p0, p3 - p0);
+		float a = -n.x / n.z, b = -n.y / n.z;
+		occluder.depths[occluder.depth_count++] = PixelMin(a, b, p0.z - a * p0.x - b * p0.y);
+	}
+	if(occluder.depth_count == 0)
+		return;
+
+	occluder.edge_count = hull_count;
+}
+void OcclusionBuffer::RasterizeRows(uint32_t begin, uint32_t end)
+{
+	Level& base = _levels[0];
+	const simd::float4 zero = simd::Splat(0.0f);
+	const float steps[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+	const simd::float4 step = simd::Load(steps);
+
+	for(size_t i = 0; i < _occluders.size(); ++i)
+	{
+		const Occluder& occluder = _occluders[i];
+		if(occluder.edge_count == 0)
+			continue;
+
+		uint32_t y0 = std::max((uint32_t)occluder.min_y, begin), y1 = std::min((uint32_t)occluder.max_y, end);
+		// Groups of four pixels, the width is a multiple of four so groups never pass the end of a row
+		uint32_t x0 = (uint32_t)occluder.min_x & ~3u, x1 = (uint32_t)occluder.max_x;
+
+		// Functions at the first pixel of a group, and their steps between groups
+		simd::float4 edge_dx[8], edge_step[8], depth_dx[6], depth_step[6];
+		for(uint32_t e = 0; e < occluder.edge_count; ++e)
+		{
+			edge_dx[e] = simd::Mul(simd::Splat(occluder.edges[e].x), step);
+			edge_step[e] = simd::Splat(occluder.edges[e].x * 4.0f);
+		}
+		for(uint32_t d = 0; d < occluder.depth_count; ++d)
+		{
+			depth_dx[d] = simd::Mul(simd::Splat(occluder.depths[d].x), step);
+			depth_step[d] = simd::Splat(occluder.depths[d].x * 4.0f);
+		}
+
+		for(uint32_t y = y0; y < y1; ++y)
+		{
+			simd::float4 edge[8], depth[6];
+			for(uint32_t e = 0; e < occluder.edge_count; ++e)
+			{
+				const Vec3& f = occluder.edges[e];
+				edge[e] = simd::Add(simd::Splat(f.x * x0 + f.y * y + f.z), edge_dx[e]);
+			}
+			for(uint32_t d = 0; d < occluder.depth_count; ++d)
+			{
+				const Vec3& f = occluder.depths[d];
+				depth[d] = simd::Add(simd::Splat(f.x * x0 + f.y * y + f.z), depth_dx[d]);
+			}
+
+			float* row = &base.depth[y * base.width];
+			for(uint32_t x = x0; x < x1; x += 4)
+			{
+				simd::float4 inside = simd::CmpLe(zero, edge[0]);
+				edge[0] = simd::Add(edge[0], edge_step[0]);
+				for(uint32_t e = 1; e < occluder.edge_count; ++e)
+				{
+					inside = simd::And(inside, simd::CmpLe(zero, edge[e]));
+					edge[e] = simd::Add(edge[e], edge_step[e]);
+				}
+
+				simd::float4 farthest = depth[0];
+				depth[0] = simd::Add(depth[0], depth_step[0]);
+				for(uint32_t d = 1; d < occluder.depth_count; ++d)
+				{
+					farthest = simd::Min(farthest, depth[d]);
+					depth[d] = simd::Add(depth[d], depth_step[d]);
+				}
+
+				if(simd::MoveMask(inside) == 0)
+					continue;
+
+				// Keep the nearest occluder in each pixel
+				simd::float4 current = simd::Load(row + x);
+				simd::Store(row + x, simd::Select(inside, simd::Max(current, farthest), current));
+			}
+		}
+	}
+}
+void OcclusionBuffer::BuildLevels()
+{
+	// Each texel gets the farthest (smallest) depth of the texels it covers in the level below
+	for(size_t i = 1; i < _levels.size(); ++i)
+	{
+		const Level& src = _levels[i - 1];
+		Level& dst = _levels[i];
+		for(uint32_t y = 0; y < dst.height; ++y)
+		{
+			const float* row0 = &src.depth[(2*y) * src.width];
+			const float* row1 = &src.depth[std::min(2*y + 1, src.height - 1) * src.width];
+			for(uint32_t x = 0; x < dst.width; ++x)
+			{
+				uint32_t sx0 = 2*x, sx1 = std::min(2*x + 1, src.width - 1);
+				dst.depth[y * dst.width + x] = std::min(std::min(row0[sx0], row0[sx1]), std::min(row1[sx0], row1[sx1]));
+			}
+		}
+	}
+}
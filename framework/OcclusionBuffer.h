@@ -0,0 +1,116 @@
+#ifndef __FRAMEWORK_OCCLUSIONBUFFER_H__
+#define __FRAMEWORK_OCCLUSIONBUFFER_H__
+
+#include "Aabb.h"
+
+/// @brief Low-resolution depth buffer rendered on the CPU, for culling objects hidden behind other objects.
+///
+///	Occluders are boxes that are rasterized conservatively: a pixel is only covered if it's completely
+///	inside the silhouette of the box, and it gets the farthest depth the front of the box has within the
+///	pixel. Objects are then tested by their bounding boxes, an object is hidden if its nearest point is
+///	behind the occluders in every pixel its box covers on the screen. Since neither step can make a
+///	visible object seem hidden, objects are never culled by mistake, only less than they could be.
+///
+///	Depths are stored as 1 / w (Larger is nearer), which is linear in screen-space across any plane and
+///	keeps its precision far from the camera. A hierarchy of levels is built on top of the pixels (Hierarchical
+///	Z), each texel holding the farthest depth of the four texels below it, so that large objects can be
+///	tested against a few texels of a coarser level rather than every pixel they cover.
+///
+///	Every frame: Begin, AddOccluder for each occluder, Finish, then TestBox for each object. Finish sets up
+///	and rasterizes the occluders four pixels per SIMD operation, spread over several threads when there are
+///	enough of them to be worth starting threads for (See Parallel.h).
+class OcclusionBuffer
+{
+public:
+	/// @param width Horizontal resolution, needs to be a multiple of 4.
+	/// @param height Vertical resolution.
+	OcclusionBuffer(uint32_t width, uint32_t height);
+	~OcclusionBuffer();
+
+	/// @brief Clears the buffer and removes all occluders.
+	/// @param view_projection Projection * view of the camera, with a perspective projection (See matrix::CreatePerspective).
+	void Begin(const Mat4x4& view_projection);
+
+	/// @brief Adds an occluder, the box needs to be completely inside the solid object it represents.
+	///	Occluders crossing the near plane are ignored.
+	/// @param transform Affine transform of the box to world-space.
+	/// @param box Box in the space of the transform.
+	void AddOccluder(const Mat4x4& transform, const Aabb& box);
+
+	/// @brief Rasterizes all occluders added since Begin and builds the hierarchy.
+	void Finish();
+
+	/// @brief Tests a box against the occluders, only valid after Finish. Boxes crossing the near plane or
+	///		completely outside the screen are never considered hidden, culling those is left to frustum culling.
+	/// @param transform Affine transform of the box to world-space.
+	/// @param box Box in the space of the transform.
+	/// @return False if the box is completely hidden behind the occluders, true if it may be visible.
+	bool TestBox(const Mat4x4& transform, const Aabb& box) const;
+
+	/// @return Number of levels, including the full resolution level 0.
+	uint32_t LevelCount() const;
+	/// @return Width of the specified level.
+	uint32_t Width(uint32_t level) const;
+	/// @return Height of the specified level.
+	uint32_t Height(uint32_t level) const;
+	/// @return Depth (1 / w) of the specified texel, 0 where nothing is covered. Texel (0, 0) is the bottom left.
+	float Depth(uint32_t level, uint32_t x, uint32_t y) const;
+
+	/// @return Number of occluders added since Begin.
+	uint32_t OccluderCount() const;
+
+private:
+	/// Occluder as passed to AddOccluder.
+	struct OccluderBox
+	{
+		Mat4x4 transform;
+		Aabb box;
+	};
+
+	/// Occluder set up for rasterization. The edge and depth functions are of the form a*x + b*y + c, with x and
+	///	y being pixel indices. They're offset to give their smallest value within each pixel, a pixel is then
+	///	covered if all edge functions are >= 0 and the farthest depth within it is the smallest depth function.
+	struct Occluder
+	{
+		int32_t min_x, min_y, max_x, max_y; // Pixels that may be covered, [min, max)
+		uint32_t edge_count; // 0 if nothing is covered
+		uint32_t depth_count;
+		Vec3 edges[8]; // (a, b, c), silhouette edges
+		Vec3 depths[6]; // (a, b, c), one for each front face
+	};
+
+	/// A level of the hierarchy.
+	struct Level
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<float> depth;
+	};
+
+	/// Parallel tasks for Finish.
+	struct SetupTask;
+	struct RasterizeTask;
+
+	/// Sets up an occluder for rasterization, leaving the edge count at 0 if it can't cover any pixel.
+	void SetupOccluder(const OccluderBox& input, Occluder& occluder) const;
+	/// Rasterizes all occluders into the rows [begin, end) of level 0.
+	void RasterizeRows(uint32_t begin, uint32_t end);
+	/// Builds all levels above level 0.
+	void BuildLevels();
+
+	/// Projects the corners of a box to screen-space.
+	/// @param screen Filled with (x, y, 1 / w) for each corner, corner i has the max x if (i & 1), max y if (i & 2), max z if (i & 4).
+	/// @return False if any corner is on or behind the near plane.
+	bool ProjectBox(const Mat4x4& transform, const Aabb& box, Vec3* screen) const;
+
+	Mat4x4 _view_projection;
+	std::vector<Level> _levels; // Level 0 is the full resolution
+	std::vector<OccluderBox> _occluder_boxes;
+	std::vector<Occluder> _occluders;
+
+	OcclusionBuffer(const OcclusionBuffer&);
+	OcclusionBuffer& operator=(const OcclusionBuffer&);
+};
+
+
+#endif // __FRAMEWORK_OCCLUSIONBUFFER_H__
@@ -0,0 +1,86 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <thread>
+#include <vector>
+
+/// @brief Utilities for spreading work over multiple threads.
+namespace parallel
+{
+	/// @brief Returns the number of hardware threads available, this is always at least 1.
+	uint32_t ThreadCount();
+
+	/// @brief Calculates how many chunks a range should be split into.
+	/// @param count Total number of items in the range.
+	/// @param min_chunk_size Minimum number of items in each chunk, ranges smaller than this are not split.
+	/// @return The number of chunks, at most ThreadCount() and at least 1.
+	uint32_t ChunkCount(uint32_t count, uint32_t min_chunk_size);
+
+	/// @brief Splits the range [0, count) into chunk_count contiguous chunks and invokes
+	///			fn(chunk_index, begin, end) for each of them, each chunk on its own thread.
+	///			The calling thread processes the first chunk and this will not return until all chunks are done.
+	template<typename Function>
+	void ForEachChunk(uint32_t count, uint32_t chunk_count, Function& fn);
+
+};
+
+namespace parallel_internal
+{
+	template<typename Function>
+	struct ChunkTask
+	{
+		Function* fn;
+		uint32_t chunk;
+		uint32_t begin;
+		uint32_t end;
+
+		void operator()() { (*fn)(chunk, begin, end); }
+	};
+};
+
+inline uint32_t parallel::ThreadCount()
+{
+	uint32_t count = std::thread::hardware_concurrency(); // May return 0 if the value is not computable
+	return count > 0 ? count : 1;
+}
+
+inline uint32_t parallel::ChunkCount(uint32_t count, uint32_t min_chunk_size)
+{
+	uint32_t chunk_count = (min_chunk_size > 0) ? count / min_chunk_size : count;
+	if(chunk_count > ThreadCount())
+		chunk_count = ThreadCount();
+	return chunk_count > 0 ? chunk_count : 1;
+}
+
+template<typename Function>
+void parallel::ForEachChunk(uint32_t count, uint32_t chunk_count, Function& fn)
+{
+	if(chunk_count == 0)
+		chunk_count = 1;
+
+	std::vector<parallel_internal::ChunkTask<Function> > tasks(chunk_count);
+	for(uint32_t i = 0; i < chunk_count; ++i)
+	{
+		tasks[i].fn = &fn;
+		tasks[i].chunk = i;
+		tasks[i].begin = (uint32_t)(((uint64_t)count * i) / chunk_count);
+		tasks[i].end = (uint32_t)(((uint64_t)count * (i+1)) / chunk_count);
+	}
+
+	// Spawn a thread for every chunk except the first one, which we process ourself.
+	std::vector<std::thread> threads;
+	threads.reserve(chunk_count - 1);
+	for(uint32_t i = 1; i < chunk_count; ++i)
+	{
+		threads.push_back(std::thread(tasks[i]));
+	}
+
+	tasks[0]();
+
+	for(uint32_t i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+}
+
+#endif // __PARALLEL_H__
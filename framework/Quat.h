@@ -0,0 +1,57 @@
+#ifndef __FRAMEWORK_QUAT_H__
+#define __FRAMEWORK_QUAT_H__
+
+#include "Matrix.h"
+
+/// @brief Quaternion, only unit quaternions represent rotations.
+struct Quat
+{
+	float x, y, z; // Vector part
+	float w; // Scalar part
+
+	Quat() {}
+	MATH_CONSTEXPR Quat(float qx, float qy, float qz, float qw) : x(qx), y(qy), z(qz), w(qw) {}
+};
+
+/// @brief Same as quat::Multiply.
+inline Quat operator*(const Quat& lhs, const Quat& rhs);
+
+namespace quat
+{
+	/// @brief Creates the identity quaternion (No rotation).
+	MATH_CONSTEXPR Quat CreateIdentity();
+
+	/// @brief Creates a rotation around the specified axis.
+	/// @param axis Normalized rotation axis.
+	/// @param angle Angle in radians.
+	inline Quat CreateRotation(const Vec3& axis, float angle);
+
+	/// @brief Creates a rotation from Euler angles, the same rotation as matrix::CreateRotationXYZ.
+	inline Quat CreateRotationXYZ(float head, float pitch, float roll);
+
+	/// @brief Multiplies two quaternions, the result rotates by rhs first and then by lhs (Same as for matrices).
+	inline Quat Multiply(const Quat& lhs, const Quat& rhs);
+
+	/// @brief Calculates the conjugate, for unit quaternions this is the inverse rotation.
+	MATH_CONSTEXPR Quat Conjugate(const Quat& q);
+
+	/// @brief Calculates the dot product of the two quaternions.
+	MATH_CONSTEXPR float Dot(const Quat& lhs, const Quat& rhs);
+
+	/// @brief Normalizes the specified quaternion.
+	inline void Normalize(Quat& q);
+
+	/// @brief Spherical linear interpolation between two rotations, always along the shortest path.
+	/// @param t Interpolation factor in [0, 1], 0 gives from and 1 gives to.
+	inline Quat Slerp(const Quat& from, const Quat& to, float t);
+
+	/// @brief Rotates a vector by the specified unit quaternion.
+	inline Vec3 Rotate(const Quat& q, const Vec3& v);
+
+	/// @brief Creates a rotation matrix from the specified unit quaternion.
+	inline Mat4x4 ToMatrix(const Quat& q);
+};
+
+#include "Quat.inl"
+
+#endif // __FRAMEWORK_QUAT_H__
@@ -0,0 +1,116 @@
+// Implementation of Quat.h
+
+#include <math.h>
+
+MATH_CONSTEXPR Quat quat::CreateIdentity()
+{
+	return Quat(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline Quat quat::CreateRotation(const Vec3& axis, float angle)
+{
+	// q = (sin(angle/2) * axis, cos(angle/2)) [Real-time Rendering, 4.39, page 76]
+	float s = sinf(angle * 0.5f);
+	return Quat(axis.x * s, axis.y * s, axis.z * s, cosf(angle * 0.5f));
+}
+
+inline Quat quat::CreateRotationXYZ(float head, float pitch, float roll)
+{
+	// Same order as the matrix version, q = qx(pitch) * qy(head) * qz(roll),
+	//	expanded to avoid the two quaternion multiplications.
+	float sx = sinf(pitch * 0.5f), cx = cosf(pitch * 0.5f);
+	float sy = sinf(head * 0.5f), cy = cosf(head * 0.5f);
+	float sz = sinf(roll * 0.5f), cz = cosf(roll * 0.5f);
+
+	return Quat(sx*cy*cz + cx*sy*sz,
+				cx*sy*cz - sx*cy*sz,
+				cx*cy*sz + sx*sy*cz,
+				cx*cy*cz - sx*sy*sz);
+}
+
+inline Quat quat::Multiply(const Quat& lhs, const Quat& rhs)
+{
+	// Multiplication [Real-time Rendering, 4.30, page 73]
+	//	q * r = (qv x rv + rw*qv + qw*rv, qw*rw - qv.rv)
+	return Quat(lhs.y*rhs.z - lhs.z*rhs.y + rhs.w*lhs.x + lhs.w*rhs.x,
+				lhs.z*rhs.x - lhs.x*rhs.z + rhs.w*lhs.y + lhs.w*rhs.y,
+				lhs.x*rhs.y - lhs.y*rhs.x + rhs.w*lhs.z + lhs.w*rhs.z,
+				lhs.w*rhs.w - lhs.x*rhs.x - lhs.y*rhs.y - lhs.z*rhs.z);
+}
+
+MATH_CONSTEXPR Quat quat::Conjugate(const Quat& q)
+{
+	return Quat(-q.x, -q.y, -q.z, q.w);
+}
+
+MATH_CONSTEXPR float quat::Dot(const Quat& lhs, const Quat& rhs)
+{
+	return lhs.x*rhs.x + lhs.y*rhs.y + lhs.z*rhs.z + lhs.w*rhs.w;
+}
+
+inline void quat::Normalize(Quat& q)
+{
+	float inv_length = 1.0f / sqrtf(Dot(q, q));
+	q.x *= inv_length;
+	q.y *= inv_length;
+	q.z *= inv_length;
+	q.w *= inv_length;
+}
+
+inline Quat quat::Slerp(const Quat& from, const Quat& to, float t)
+{
+	// q and -q represent the same rotation, flip one of them to take the shortest path
+	Quat target = to;
+	float cos_phi = Dot(from, to);
+	if(cos_phi < 0.0f)
+	{
+		target = Quat(-to.x, -to.y, -to.z, -to.w);
+		cos_phi = -cos_phi;
+	}
+
+	float a, b;
+	if(cos_phi > 0.9995f)
+	{
+		// Nearly the same rotation, sin(phi) gets too small so fall back to a linear interpolation
+		a = 1.0f - t;
+		b = t;
+	}
+	else
+	{
+		// slerp(q, r, t) = sin(phi(1-t))/sin(phi) * q + sin(phi*t)/sin(phi) * r [Real-time Rendering, 4.53, page 78]
+		float phi = acosf(cos_phi);
+		float inv_sin_phi = 1.0f / sinf(phi);
+		a = sinf(phi * (1.0f - t)) * inv_sin_phi;
+		b = sinf(phi * t) * inv_sin_phi;
+	}
+
+	Quat result(a*from.x + b*target.x, a*from.y + b*target.y, a*from.z + b*target.z, a*from.w + b*target.w);
+	Normalize(result);
+	return result;
+}
+
+inline Vec3 quat::Rotate(const Quat& q, const Vec3& v)
+{
+	// v' = v + 2w(qv x v) + 2(qv x (qv x v))
+	Vec3 qv(q.x, q.y, q.z);
+	Vec3 t = vector::Cross(qv, v) * 2.0f;
+	return v + t * q.w + vector::Cross(qv, t);
+}
+
+inline Mat4x4 quat::ToMatrix(const Quat& q)
+{
+	// Quaternion to matrix [Real-time Rendering, 4.46, page 76]
+	float xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+	float xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+	float wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+
+	return Mat4x4(	Vec4(1.0f - 2.0f*(yy + zz), 2.0f*(xy + wz), 2.0f*(xz - wy), 0.0f),
+					Vec4(2.0f*(xy - wz), 1.0f - 2.0f*(xx + zz), 2.0f*(yz + wx), 0.0f),
+					Vec4(2.0f*(xz + wy), 2.0f*(yz - wx), 1.0f - 2.0f*(xx + yy), 0.0f),
+					Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+inline Quat operator*(const Quat& lhs, const Quat& rhs)
+{
+	return quat::Multiply(lhs, rhs);
+}
@@ -15,6 +15,67 @@ bool RaySphereIntersect(const Vec3& origin, const Vec3& ray, const Vec3& center,
 	return (bb_c >= 0);
 }
 
+bool RaySphereIntersect(const Vec3& origin, const Vec3& ray, const Vec3& center, float radius, float& distance)
+{
+	// Ray/Sphere intersection [Real-Time Rendering 16.6]
+	//	The intersections are at t = -b +- sqrt(b^2 - c), as ray is normalized. b^2 - c is calculated as
+	//	r^2 - |origin_center - b*ray|^2 (The squared distance from the center to the ray) instead, b^2 and c
+	//	are both large for distant spheres and their difference loses all precision.
+
+	Vec3 origin_center = vector::Subtract(origin, center);
+	float b = vector::Dot(ray, origin_center);
+	float c = vector::Dot(origin_center, origin_center) - radius*radius;
+
+	if(c <= 0.0f)
+	{
+		// The origin is inside the sphere
+		distance = 0.0f;
+		return true;
+	}
+	if(b > 0.0f)
+		return false; // The sphere is behind the origin
+
+	Vec3 closest = vector::Subtract(origin_center, Vec3(ray.x * b, ray.y * b, ray.z * b));
+	float bb_c = radius*radius - vector::Dot(closest, closest);
+	if(bb_c < 0.0f)
+		return false;
+
+	distance = -b - sqrtf(bb_c);
+	return true;
+}
+
+bool RayTriangleIntersect(const Vec3& origin, const Vec3& ray, const Vec3& v0, const Vec3& v1, const Vec3& v2, float& distance)
+{
+	// Ray/Triangle intersection [Real-Time Rendering 16.8]
+	//	Solves origin + t*ray = (1-u-v)*v0 + u*v1 + v*v2 by Cramer's rule.
+
+	Vec3 e1 = vector::Subtract(v1, v0);
+	Vec3 e2 = vector::Subtract(v2, v0);
+	Vec3 q = vector::Cross(ray, e2);
+
+	float det = vector::Dot(e1, q);
+	if(det == 0.0f)
+		return false; // Parallel to the triangle, or a degenerate triangle
+	float inv_det = 1.0f / det;
+
+	Vec3 s = vector::Subtract(origin, v0);
+	float u = vector::Dot(s, q) * inv_det;
+	if(u < 0.0f || u > 1.0f)
+		return false;
+
+	Vec3 r = vector::Cross(s, e1);
+	float v = vector::Dot(ray, r) * inv_det;
+	if(v < 0.0f || u + v > 1.0f)
+		return false;
+
+	float t = vector::Dot(e2, r) * inv_det;
+	if(t < 0.0f)
+		return false;
+
+	distance = t;
+	return true;
+}
+
 Vec3 RayPlaneIntersect(const Vec3& origin, const Vec3& ray, const Vec3& normal, float d)
 {
 	float t = -((vector::Dot(origin, normal) + d) / vector::Dot(ray, normal));
@@ -9,6 +9,24 @@
 /// @return True if the ray intersects, false if not.
 bool RaySphereIntersect(const Vec3& origin, const Vec3& ray, const Vec3& center, float radius);
 
+/// Checks if a ray intersects with a sphere and calculates the distance to the intersection.
+/// @param origin The origin of the ray.
+/// @param ray Normalized direction of the ray.
+/// @param center Center of the sphere.
+/// @param radius Sphere radius.
+/// @param distance Distance from the origin to the first intersection, 0 if the origin is inside the sphere.
+/// @return True if the ray intersects in front of the origin, false if not.
+bool RaySphereIntersect(const Vec3& origin, const Vec3& ray, const Vec3& center, float radius, float& distance);
+
+/// Checks if a ray intersects with a triangle, both sides of the triangle are considered.
+///	Uses the Moller-Trumbore algorithm [Real-Time Rendering 16.8].
+/// @param origin The origin of the ray.
+/// @param ray Direction of the ray, doesn't have to be normalized but distance is in units of its length.
+/// @param v0, v1, v2 Triangle vertices.
+/// @param distance Distance from the origin to the intersection.
+/// @return True if the ray intersects in front of the origin, false if not (Or if the triangle is degenerate).
+bool RayTriangleIntersect(const Vec3& origin, const Vec3& ray, const Vec3& v0, const Vec3& v1, const Vec3& v2, float& distance);
+
 /// Calculates the intersection point (if any) between a ray and a plane.
 /// @param origin The origin of the ray.
 /// @param ray Vector specifying the direction of the ray.
@@ -0,0 +1,40 @@
+#ifndef __FRAMEWORK_RAYBATCH_H__
+#define __FRAMEWORK_RAYBATCH_H__
+
+#include "Aabb.h"
+#include "Ray.h"
+
+/// @brief Intersection tests of a single ray against many spheres or boxes.
+///
+///	Input is structure-of-arrays buffers, one array per component, so that four elements can be
+///	tested per SIMD operation (See Simd.h). Any count is allowed and the arrays need no particular
+///	alignment, the same as for MatrixBatch.h.
+///
+///	Hits are returned as a bit mask, element i is hit if bit (i % 32) of hits[i / 32] is set (See
+///	RayBatchHit). The caller provides (count + 31) / 32 words, all of them are overwritten. Distances
+///	are written for every element, but only the ones for elements that were hit are meaningful.
+///
+///	The results are exactly the same as calling RaySphereIntersect and aabb::RayIntersect for each element.
+
+/// @brief Tests a ray against spheres, see RaySphereIntersect.
+/// @param ray Normalized direction of the ray.
+/// @param distances Distance to the first intersection of each sphere, 0 if the origin is inside the sphere.
+/// @return Number of spheres hit.
+inline uint32_t RaySpheresIntersect(const Vec3& origin, const Vec3& ray, const float* x, const float* y, const float* z,
+	const float* radius, uint32_t count, uint32_t* hits, float* distances);
+
+/// @brief Tests a ray against boxes, see aabb::RayIntersect.
+/// @param inv_direction 1 / ray direction for each axis, infinite for axes the ray is parallel to.
+/// @param max_distance Only intersections closer than this are reported.
+/// @param distances Distance to where the ray enters each box, 0 if the origin is inside the box.
+/// @return Number of boxes hit.
+inline uint32_t RayBoxesIntersect(const Vec3& origin, const Vec3& inv_direction, const float* min_x, const float* min_y,
+	const float* min_z, const float* max_x, const float* max_y, const float* max_z, uint32_t count, float max_distance,
+	uint32_t* hits, float* distances);
+
+/// @return True if element i is set in a hit mask from RaySpheresIntersect or RayBoxesIntersect.
+inline bool RayBatchHit(const uint32_t* hits, uint32_t i);
+
+#include "RayBatch.inl"
+
+#endif // __FRAMEWORK_RAYBATCH_H__
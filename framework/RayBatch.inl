@@ -0,0 +1,113 @@
+// Implementation of RayBatch.h
+//	The SIMD paths perform the same operations in the same order as the single-element functions,
+//	which handle the remaining elements. Comparisons are written so that NaN gives the same result
+//	as in the single-element functions, and std::min(a, b) is simd::Min(b, a) (See Simd.h).
+
+namespace ray_batch_internal
+{
+	/// Number of bits set in each 4-bit mask
+	const uint32_t hit_count[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+	/// Sets the hit bits of four (or less) elements starting at element i, words are cleared when first written.
+	inline void SetHits(uint32_t* hits, uint32_t i, uint32_t mask)
+	{
+		uint32_t shift = i % 32;
+		if(shift == 0)
+			hits[i / 32] = 0;
+		hits[i / 32] |= mask << shift;
+	}
+};
+
+inline uint32_t RaySpheresIntersect(const Vec3& origin, const Vec3& ray, const float* x, const float* y, const float* z,
+	const float* radius, uint32_t count, uint32_t* hits, float* distances)
+{
+	using namespace ray_batch_internal;
+
+	simd::float4 ox = simd::Splat(origin.x), oy = simd::Splat(origin.y), oz = simd::Splat(origin.z);
+	simd::float4 rx = simd::Splat(ray.x), ry = simd::Splat(ray.y), rz = simd::Splat(ray.z);
+	simd::float4 zero = simd::Splat(0.0f);
+
+	uint32_t hit_total = 0;
+	uint32_t i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		simd::float4 r = simd::Load(radius + i);
+		simd::float4 rr = simd::Mul(r, r);
+
+		simd::float4 ocx = simd::Sub(ox, simd::Load(x + i));
+		simd::float4 ocy = simd::Sub(oy, simd::Load(y + i));
+		simd::float4 ocz = simd::Sub(oz, simd::Load(z + i));
+
+		simd::float4 b = simd::Add(simd::Add(simd::Mul(rx, ocx), simd::Mul(ry, ocy)), simd::Mul(rz, ocz));
+		simd::float4 c = simd::Sub(simd::Add(simd::Add(simd::Mul(ocx, ocx), simd::Mul(ocy, ocy)), simd::Mul(ocz, ocz)), rr);
+
+		simd::float4 cx = simd::Sub(ocx, simd::Mul(rx, b));
+		simd::float4 cy = simd::Sub(ocy, simd::Mul(ry, b));
+		simd::float4 cz = simd::Sub(ocz, simd::Mul(rz, b));
+		simd::float4 bb_c = simd::Sub(rr, simd::Add(simd::Add(simd::Mul(cx, cx), simd::Mul(cy, cy)), simd::Mul(cz, cz)));
+
+		// Inside, or not behind the origin and not missing the sphere
+		simd::float4 inside = simd::CmpLe(c, zero);
+		simd::float4 rejected = simd::Or(simd::CmpLt(zero, b), simd::CmpLt(bb_c, zero));
+		uint32_t mask = (uint32_t)(simd::MoveMask(inside) | (~simd::MoveMask(rejected) & 0xf));
+
+		simd::float4 distance = simd::Sub(simd::Negate(b), simd::Sqrt(bb_c));
+		simd::Store(distances + i, simd::Select(inside, zero, distance));
+
+		SetHits(hits, i, mask);
+		hit_total += hit_count[mask];
+	}
+	for(; i < count; ++i)
+	{
+		// RaySphereIntersect leaves the distance untouched on a miss, it's written anyway like the SIMD path
+		float distance = 0.0f;
+		bool hit = RaySphereIntersect(origin, ray, Vec3(x[i], y[i], z[i]), radius[i], distance);
+		distances[i] = distance;
+		SetHits(hits, i, hit ? 1 : 0);
+		hit_total += hit ? 1 : 0;
+	}
+	return hit_total;
+}
+
+inline uint32_t RayBoxesIntersect(const Vec3& origin, const Vec3& inv_direction, const float* min_x, const float* min_y,
+	const float* min_z, const float* max_x, const float* max_y, const float* max_z, uint32_t count, float max_distance,
+	uint32_t* hits, float* distances)
+{
+	using namespace ray_batch_internal;
+
+	simd::float4 ox = simd::Splat(origin.x), oy = simd::Splat(origin.y), oz = simd::Splat(origin.z);
+	simd::float4 ix = simd::Splat(inv_direction.x), iy = simd::Splat(inv_direction.y), iz = simd::Splat(inv_direction.z);
+	simd::float4 zero = simd::Splat(0.0f);
+	simd::float4 max_t = simd::Splat(max_distance);
+
+	uint32_t hit_total = 0;
+	uint32_t i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		simd::float4 tx0 = simd::Mul(simd::Sub(simd::Load(min_x + i), ox), ix), tx1 = simd::Mul(simd::Sub(simd::Load(max_x + i), ox), ix);
+		simd::float4 ty0 = simd::Mul(simd::Sub(simd::Load(min_y + i), oy), iy), ty1 = simd::Mul(simd::Sub(simd::Load(max_y + i), oy), iy);
+		simd::float4 tz0 = simd::Mul(simd::Sub(simd::Load(min_z + i), oz), iz), tz1 = simd::Mul(simd::Sub(simd::Load(max_z + i), oz), iz);
+
+		simd::float4 tmin = simd::Max(simd::Max(zero, simd::Min(tz1, tz0)), simd::Max(simd::Min(ty1, ty0), simd::Min(tx1, tx0)));
+		simd::float4 tmax = simd::Min(simd::Min(max_t, simd::Max(tz1, tz0)), simd::Min(simd::Max(ty1, ty0), simd::Max(tx1, tx0)));
+
+		uint32_t mask = (uint32_t)simd::MoveMask(simd::CmpLe(tmin, tmax));
+		simd::Store(distances + i, tmin);
+
+		SetHits(hits, i, mask);
+		hit_total += hit_count[mask];
+	}
+	for(; i < count; ++i)
+	{
+		Aabb box(Vec3(min_x[i], min_y[i], min_z[i]), Vec3(max_x[i], max_y[i], max_z[i]));
+		bool hit = aabb::RayIntersect(box, origin, inv_direction, max_distance, distances[i]);
+		SetHits(hits, i, hit ? 1 : 0);
+		hit_total += hit ? 1 : 0;
+	}
+	return hit_total;
+}
+
+inline bool RayBatchHit(const uint32_t* hits, uint32_t i)
+{
+	return ((hits[i / 32] >> (i % 32)) & 1) != 0;
+}
@@ -0,0 +1,305 @@
+#ifndef __REFLECTION_H__
+#define __REFLECTION_H__
+
+#include "ConfigValue.h"
+
+#include <string.h>
+#include <string>
+
+/// @brief Compile-time field descriptors used to generate readers and writers for plain structs.
+///
+///	A struct is described by specializing reflection::Schema, listing its fields in order:
+///
+///		template<> struct reflection::Schema<TransformRecord>
+///		{
+///			static const reflection::Layout layout = reflection::LAYOUT_OBJECT;
+///
+///			template<typename Visitor> static void Visit(Visitor& v)
+///			{
+///				v.Field("rotation", &TransformRecord::rotation);
+///				v.Field("position", &TransformRecord::position);
+///				v.Field("scale", &TransformRecord::scale);
+///			}
+///		};
+///
+///	Each backend is a visitor that gets called once per field with a member pointer, so all field
+///	accesses are resolved at compile time. Fields are either primitives (float, int32_t, uint32_t, bool)
+///	or other described structs. Adding a field to a schema is all that is needed to persist it.
+///
+///	Backends:
+///	- DOM: Reads and writes ConfigValues (and thereby JSON and MessagePack). Structs with LAYOUT_OBJECT
+///		are represented as objects keyed by field name, LAYOUT_ARRAY as arrays of the fields in order (e.g. Vec3).
+///	- Binary: Tightly packed little-endian fields in order, independent of host byte order and padding.
+namespace reflection
+{
+	enum Layout
+	{
+		LAYOUT_OBJECT,
+		LAYOUT_ARRAY
+	};
+
+	/// Specialized for each described struct, see above.
+	template<typename T> struct Schema;
+
+	template<> struct Schema<Vec3>
+	{
+		static const Layout layout = LAYOUT_ARRAY;
+
+		template<typename Visitor> static void Visit(Visitor& v)
+		{
+			v.Field("x", &Vec3::x);
+			v.Field("y", &Vec3::y);
+			v.Field("z", &Vec3::z);
+		}
+	};
+
+	template<> struct Schema<Vec4>
+	{
+		static const Layout layout = LAYOUT_ARRAY;
+
+		template<typename Visitor> static void Visit(Visitor& v)
+		{
+			v.Field("x", &Vec4::x);
+			v.Field("y", &Vec4::y);
+			v.Field("z", &Vec4::z);
+			v.Field("w", &Vec4::w);
+		}
+	};
+
+	//-------------------------------------------------------------------------------
+	// DOM backend
+
+	inline void WriteDom(float value, ConfigValue& node) { node.SetFloat(value); }
+	inline void WriteDom(int32_t value, ConfigValue& node) { node.SetInt(value); }
+	inline void WriteDom(uint32_t value, ConfigValue& node) { node.SetUInt(value); }
+	inline void WriteDom(bool value, ConfigValue& node) { node.SetBool(value); }
+
+	/// Primitives are only read if the node has a compatible type, otherwise the value is left untouched.
+	inline void ReadDom(const ConfigValue& node, float& value) { if(node.IsNumber()) value = node.AsFloat(); }
+	inline void ReadDom(const ConfigValue& node, int32_t& value) { if(node.IsNumber()) value = node.AsInt(); }
+	inline void ReadDom(const ConfigValue& node, uint32_t& value) { if(node.IsNumber()) value = node.AsUInt(); }
+	inline void ReadDom(const ConfigValue& node, bool& value) { if(node.IsBool()) value = node.AsBool(); }
+
+	template<typename T> void WriteDom(const T& value, ConfigValue& node);
+	template<typename T> void ReadDom(const ConfigValue& node, T& value);
+
+	/// Writes only the fields of value that differ from base, reading the result with ReadDom on top of
+	///	a copy of base gives back value. Only for structs with LAYOUT_OBJECT.
+	template<typename T> void WriteDomDelta(const T& value, const T& base, ConfigValue& node);
+
+	//-------------------------------------------------------------------------------
+	// Binary backend
+
+	inline void WriteBinary(uint32_t value, std::string& out)
+	{
+		char bytes[4] = { (char)value, (char)(value >> 8), (char)(value >> 16), (char)(value >> 24) };
+		out.append(bytes, 4);
+	}
+	inline void WriteBinary(int32_t value, std::string& out) { WriteBinary((uint32_t)value, out); }
+	inline void WriteBinary(float value, std::string& out)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, 4);
+		WriteBinary(bits, out);
+	}
+	inline void WriteBinary(bool value, std::string& out) { out.append(1, value ? 1 : 0); }
+
+	inline void ReadBinary(const char*& src, uint32_t& value)
+	{
+		const uint8_t* p = (const uint8_t*)src;
+		value = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		src += 4;
+	}
+	inline void ReadBinary(const char*& src, int32_t& value) { uint32_t u; ReadBinary(src, u); value = (int32_t)u; }
+	inline void ReadBinary(const char*& src, float& value) { uint32_t u; ReadBinary(src, u); memcpy(&value, &u, 4); }
+	inline void ReadBinary(const char*& src, bool& value) { value = (*src++ != 0); }
+
+	inline size_t BinarySize(const float*) { return 4; }
+	inline size_t BinarySize(const int32_t*) { return 4; }
+	inline size_t BinarySize(const uint32_t*) { return 4; }
+	inline size_t BinarySize(const bool*) { return 1; }
+
+	template<typename T> void WriteBinary(const T& value, std::string& out);
+
+	/// Reads a value from src, which needs to hold at least BinarySize<T>() bytes. src is advanced past the value.
+	template<typename T> void ReadBinary(const char*& src, T& value);
+
+	/// @return Size of T in the binary representation.
+	template<typename T> size_t BinarySize(const T* = 0);
+
+	/// @return Number of fields in the schema for T.
+	template<typename T> uint32_t FieldCount();
+};
+
+
+namespace reflection_internal
+{
+	template<typename T>
+	inline bool IsArrayLayout()
+	{
+		return reflection::Schema<T>::layout == reflection::LAYOUT_ARRAY;
+	}
+
+	template<typename T>
+	struct DomWriter
+	{
+		const T& value;
+		ConfigValue& node;
+
+		DomWriter(const T& v, ConfigValue& n) : value(v), node(n) {}
+
+		template<typename M> void Field(const char* name, M T::*member)
+		{
+			if(IsArrayLayout<T>())
+				reflection::WriteDom(value.*member, node.Append());
+			else
+				reflection::WriteDom(value.*member, node[name]);
+		}
+	};
+
+	template<typename T>
+	struct DomDeltaWriter
+	{
+		const T& value;
+		const T& base;
+		ConfigValue& node;
+
+		DomDeltaWriter(const T& v, const T& b, ConfigValue& n) : value(v), base(b), node(n) {}
+
+		template<typename M> void Field(const char* name, M T::*member)
+		{
+			// Fields are compared bitwise, described structs have no padding
+			if(memcmp(&(value.*member), &(base.*member), sizeof(M)) != 0)
+				reflection::WriteDom(value.*member, node[name]);
+		}
+	};
+
+	template<typename T>
+	struct DomReader
+	{
+		const ConfigValue& node;
+		T& value;
+		int index;
+
+		DomReader(const ConfigValue& n, T& v) : node(n), value(v), index(0) {}
+
+		template<typename M> void Field(const char* name, M T::*member)
+		{
+			if(IsArrayLayout<T>())
+				reflection::ReadDom(node[index++], value.*member);
+			else
+				reflection::ReadDom(node[name], value.*member);
+		}
+	};
+
+	template<typename T>
+	struct BinaryWriter
+	{
+		const T& value;
+		std::string& out;
+
+		BinaryWriter(const T& v, std::string& o) : value(v), out(o) {}
+
+		template<typename M> void Field(const char* , M T::*member)
+		{
+			reflection::WriteBinary(value.*member, out);
+		}
+	};
+
+	template<typename T>
+	struct BinaryReader
+	{
+		const char*& src;
+		T& value;
+
+		BinaryReader(const char*& s, T& v) : src(s), value(v) {}
+
+		template<typename M> void Field(const char* , M T::*member)
+		{
+			reflection::ReadBinary(src, value.*member);
+		}
+	};
+
+	template<typename T>
+	struct SizeCounter
+	{
+		size_t size;
+		uint32_t count;
+
+		SizeCounter() : size(0), count(0) {}
+
+		template<typename M> void Field(const char* , M T::*)
+		{
+			size += reflection::BinarySize((const M*)0);
+			++count;
+		}
+	};
+};
+
+
+template<typename T>
+void reflection::WriteDom(const T& value, ConfigValue& node)
+{
+	// Objects are merged into any existing object, that way multiple structs can share a node
+	if(reflection_internal::IsArrayLayout<T>())
+		node.SetEmptyArray();
+	else if(!node.IsObject())
+		node.SetEmptyObject();
+
+	reflection_internal::DomWriter<T> writer(value, node);
+	Schema<T>::Visit(writer);
+}
+template<typename T>
+void reflection::WriteDomDelta(const T& value, const T& base, ConfigValue& node)
+{
+	assert(!reflection_internal::IsArrayLayout<T>());
+	if(!node.IsObject())
+		node.SetEmptyObject();
+
+	reflection_internal::DomDeltaWriter<T> writer(value, base, node);
+	Schema<T>::Visit(writer);
+}
+template<typename T>
+void reflection::ReadDom(const ConfigValue& node, T& value)
+{
+	// Nodes of the wrong type, or arrays that are too short, leave the value untouched
+	if(reflection_internal::IsArrayLayout<T>())
+	{
+		if(!node.IsArray() || (uint32_t)node.Size() < FieldCount<T>())
+			return;
+	}
+	else if(!node.IsObject())
+		return;
+
+	reflection_internal::DomReader<T> reader(node, value);
+	Schema<T>::Visit(reader);
+}
+template<typename T>
+void reflection::WriteBinary(const T& value, std::string& out)
+{
+	reflection_internal::BinaryWriter<T> writer(value, out);
+	Schema<T>::Visit(writer);
+}
+template<typename T>
+void reflection::ReadBinary(const char*& src, T& value)
+{
+	reflection_internal::BinaryReader<T> reader(src, value);
+	Schema<T>::Visit(reader);
+}
+template<typename T>
+size_t reflection::BinarySize(const T*)
+{
+	reflection_internal::SizeCounter<T> counter;
+	Schema<T>::Visit(counter);
+	return counter.size;
+}
+template<typename T>
+uint32_t reflection::FieldCount()
+{
+	reflection_internal::SizeCounter<T> counter;
+	Schema<T>::Visit(counter);
+	return counter.count;
+}
+
+
+#endif // __REFLECTION_H__
@@ -0,0 +1,218 @@
+#ifndef __FRAMEWORK_SIMD_H__
+#define __FRAMEWORK_SIMD_H__
+
+/// @brief Minimal 4-wide float vector abstraction used by the math code.
+///
+///	The backend is selected at compile time:
+///	- SSE : x86/x64 (Always available on x64, /arch:SSE or later on 32bit MSVC)
+///	- NEON : ARM with NEON
+///	- Scalar : Anything else, or if MATH_NO_SIMD is defined.
+///	Vectors are loaded from and stored to plain float arrays without any alignment requirements,
+///	that way Vec4 and Mat4x4 keep their layout and can be passed by value on every compiler.
+///
+///	Comparisons return masks with all bits of a lane set where the comparison is true, masks are
+///	combined with And/Or/AndNot and used with Select or MoveMask. Min and Max behave like SSE on all
+///	backends, Min(a, b) is a < b ? a : b, so the second operand is returned if either is NaN.
+#if !defined(MATH_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+	#define MATH_SIMD_SSE
+	#include <xmmintrin.h>
+#elif !defined(MATH_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+	#define MATH_SIMD_NEON
+	#include <arm_neon.h>
+#else
+	#define MATH_SIMD_SCALAR
+	#include <string.h>
+#endif
+
+namespace simd
+{
+#if defined(MATH_SIMD_SSE)
+	typedef __m128 float4;
+
+	inline float4 Load(const float* src) { return _mm_loadu_ps(src); }
+	inline void Store(float* dst, float4 v) { _mm_storeu_ps(dst, v); }
+	inline float4 Splat(float value) { return _mm_set1_ps(value); }
+	inline float4 Add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+	inline float4 Sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+	inline float4 Mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+	/// @return a*b + c
+	inline float4 MulAdd(float4 a, float4 b, float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline float4 Min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+	inline float4 Max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+	inline float4 Sqrt(float4 v) { return _mm_sqrt_ps(v); }
+	inline float4 Negate(float4 v) { return _mm_xor_ps(v, _mm_set1_ps(-0.0f)); }
+
+	inline float4 CmpLt(float4 a, float4 b) { return _mm_cmplt_ps(a, b); }
+	inline float4 CmpLe(float4 a, float4 b) { return _mm_cmple_ps(a, b); }
+	inline float4 And(float4 a, float4 b) { return _mm_and_ps(a, b); }
+	inline float4 Or(float4 a, float4 b) { return _mm_or_ps(a, b); }
+	/// @return a & ~b
+	inline float4 AndNot(float4 a, float4 b) { return _mm_andnot_ps(b, a); }
+	/// @return a where mask is set, b elsewhere
+	inline float4 Select(float4 mask, float4 a, float4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	/// @return The sign bit of each lane of mask, lane 0 in bit 0
+	inline int MoveMask(float4 mask) { return _mm_movemask_ps(mask); }
+
+	inline void Transpose(float4& r0, float4& r1, float4& r2, float4& r3)
+	{
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	}
+
+#elif defined(MATH_SIMD_NEON)
+	typedef float32x4_t float4;
+
+	inline float4 Load(const float* src) { return vld1q_f32(src); }
+	inline void Store(float* dst, float4 v) { vst1q_f32(dst, v); }
+	inline float4 Splat(float value) { return vdupq_n_f32(value); }
+	inline float4 Add(float4 a, float4 b) { return vaddq_f32(a, b); }
+	inline float4 Sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+	inline float4 Mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+	inline float4 MulAdd(float4 a, float4 b, float4 c) { return vmlaq_f32(c, a, b); }
+	// vminq_f32/vmaxq_f32 return NaN if either operand is NaN, unlike SSE
+	inline float4 Min(float4 a, float4 b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+	inline float4 Max(float4 a, float4 b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+	inline float4 Sqrt(float4 v)
+	{
+	#if defined(__aarch64__)
+		return vsqrtq_f32(v);
+	#else
+		// No vector square root on ARMv7, the estimate isn't exact
+		float r[4];
+		vst1q_f32(r, v);
+		r[0] = sqrtf(r[0]); r[1] = sqrtf(r[1]); r[2] = sqrtf(r[2]); r[3] = sqrtf(r[3]);
+		return vld1q_f32(r);
+	#endif
+	}
+	inline float4 Negate(float4 v) { return vnegq_f32(v); }
+
+	inline float4 CmpLt(float4 a, float4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+	inline float4 CmpLe(float4 a, float4 b) { return vreinterpretq_f32_u32(vcleq_f32(a, b)); }
+	inline float4 And(float4 a, float4 b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+	inline float4 Or(float4 a, float4 b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+	inline float4 AndNot(float4 a, float4 b) { return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+	inline float4 Select(float4 mask, float4 a, float4 b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+	inline int MoveMask(float4 mask)
+	{
+		uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(mask), 31);
+		return (int)(vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) | (vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3));
+	}
+
+	inline void Transpose(float4& r0, float4& r1, float4& r2, float4& r3)
+	{
+		// Transpose the 2x2 blocks, then swap the off-diagonal blocks
+		float32x4x2_t t01 = vtrnq_f32(r0, r1);
+		float32x4x2_t t23 = vtrnq_f32(r2, r3);
+		r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+		r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+		r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+		r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+	}
+
+#else
+	struct float4
+	{
+		float v[4];
+	};
+
+	inline float4 Load(const float* src) { float4 r = { { src[0], src[1], src[2], src[3] } }; return r; }
+	inline void Store(float* dst, float4 v) { dst[0] = v.v[0]; dst[1] = v.v[1]; dst[2] = v.v[2]; dst[3] = v.v[3]; }
+	inline float4 Splat(float value) { float4 r = { { value, value, value, value } }; return r; }
+	inline float4 Add(float4 a, float4 b) { float4 r = { { a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3] } }; return r; }
+	inline float4 Sub(float4 a, float4 b) { float4 r = { { a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], a.v[3]-b.v[3] } }; return r; }
+	inline float4 Mul(float4 a, float4 b) { float4 r = { { a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3] } }; return r; }
+	inline float4 MulAdd(float4 a, float4 b, float4 c) { return Add(Mul(a, b), c); }
+	inline float4 Min(float4 a, float4 b)
+	{
+		float4 r = { { a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1],
+			a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3] } };
+		return r;
+	}
+	inline float4 Max(float4 a, float4 b)
+	{
+		float4 r = { { a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1],
+			a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3] } };
+		return r;
+	}
+	inline float4 Sqrt(float4 v) { float4 r = { { sqrtf(v.v[0]), sqrtf(v.v[1]), sqrtf(v.v[2]), sqrtf(v.v[3]) } }; return r; }
+	inline float4 Negate(float4 v) { float4 r = { { -v.v[0], -v.v[1], -v.v[2], -v.v[3] } }; return r; }
+
+	/// Masks are stored as floats with the same bits as the SSE masks
+	inline float MaskLane(bool set)
+	{
+		uint32_t bits = set ? 0xffffffff : 0;
+		float lane;
+		memcpy(&lane, &bits, sizeof(float));
+		return lane;
+	}
+	inline uint32_t LaneBits(float lane)
+	{
+		uint32_t bits;
+		memcpy(&bits, &lane, sizeof(float));
+		return bits;
+	}
+	inline float4 CmpLt(float4 a, float4 b)
+	{
+		float4 r = { { MaskLane(a.v[0] < b.v[0]), MaskLane(a.v[1] < b.v[1]), MaskLane(a.v[2] < b.v[2]), MaskLane(a.v[3] < b.v[3]) } };
+		return r;
+	}
+	inline float4 CmpLe(float4 a, float4 b)
+	{
+		float4 r = { { MaskLane(a.v[0] <= b.v[0]), MaskLane(a.v[1] <= b.v[1]), MaskLane(a.v[2] <= b.v[2]), MaskLane(a.v[3] <= b.v[3]) } };
+		return r;
+	}
+	inline float4 And(float4 a, float4 b)
+	{
+		float4 r;
+		for(int i = 0; i < 4; ++i)
+		{
+			uint32_t bits = LaneBits(a.v[i]) & LaneBits(b.v[i]);
+			memcpy(&r.v[i], &bits, sizeof(float));
+		}
+		return r;
+	}
+	inline float4 Or(float4 a, float4 b)
+	{
+		float4 r;
+		for(int i = 0; i < 4; ++i)
+		{
+			uint32_t bits = LaneBits(a.v[i]) | LaneBits(b.v[i]);
+			memcpy(&r.v[i], &bits, sizeof(float));
+		}
+		return r;
+	}
+	inline float4 AndNot(float4 a, float4 b)
+	{
+		float4 r;
+		for(int i = 0; i < 4; ++i)
+		{
+			uint32_t bits = LaneBits(a.v[i]) & ~LaneBits(b.v[i]);
+			memcpy(&r.v[i], &bits, sizeof(float));
+		}
+		return r;
+	}
+	inline float4 Select(float4 mask, float4 a, float4 b)
+	{
+		float4 r = { { LaneBits(mask.v[0]) ? a.v[0] : b.v[0], LaneBits(mask.v[1]) ? a.v[1] : b.v[1],
+			LaneBits(mask.v[2]) ? a.v[2] : b.v[2], LaneBits(mask.v[3]) ? a.v[3] : b.v[3] } };
+		return r;
+	}
+	inline int MoveMask(float4 mask)
+	{
+		return (int)((LaneBits(mask.v[0]) >> 31) | ((LaneBits(mask.v[1]) >> 31) << 1) |
+			((LaneBits(mask.v[2]) >> 31) << 2) | ((LaneBits(mask.v[3]) >> 31) << 3));
+	}
+
+	inline void Transpose(float4& r0, float4& r1, float4& r2, float4& r3)
+	{
+		float4 t0 = { { r0.v[0], r1.v[0], r2.v[0], r3.v[0] } };
+		float4 t1 = { { r0.v[1], r1.v[1], r2.v[1], r3.v[1] } };
+		float4 t2 = { { r0.v[2], r1.v[2], r2.v[2], r3.v[2] } };
+		float4 t3 = { { r0.v[3], r1.v[3], r2.v[3], r3.v[3] } };
+		r0 = t0; r1 = t1; r2 = t2; r3 = t3;
+	}
+
+#endif
+};
+
+
+#endif // __FRAMEWORK_SIMD_H__
@@ -0,0 +1,288 @@
+#include "Common.h"
+
+#include "SpatialHash.h"
+
+#include <algorithm>
+
+namespace spatial_hash_internal
+{
+	/// Cell coordinates are clamped to this, positions further out than this many cells share the outermost cells.
+	const float max_cell_coord = 1073741824.0f; // 2^30
+
+	int32_t CellCoord(float value)
+	{
+		float cell = floorf(value);
+		if(!(cell > -max_cell_coord))
+			return -(int32_t)max_cell_coord;
+		if(cell > max_cell_coord)
+			return (int32_t)max_cell_coord;
+		return (int32_t)cell;
+	}
+};
+
+SpatialHash::SpatialHash(float cell_size)
+	: _free_list(NULL_PROXY),
+	_size(0),
+	_cell_size(cell_size),
+	_inv_cell_size(1.0f / cell_size)
+{
+	assert(cell_size > 0.0f);
+}
+SpatialHash::~SpatialHash()
+{
+}
+//-------------------------------------------------------------------------------
+uint32_t SpatialHash::Insert(const Vec3& position, float radius, void* user_data)
+{
+	assert(user_data);
+
+	uint32_t proxy = _free_list;
+	if(proxy != NULL_PROXY)
+	{
+		_free_list = _objects[proxy].next;
+	}
+	else
+	{
+		proxy = (uint32_t)_objects.size();
+		_objects.push_back(Object());
+	}
+
+	Object& object = _objects[proxy];
+	object.x = position.x;
+	object.z = position.z;
+	object.radius = radius;
+	object.user_data = user_data;
+	object.next = NULL_PROXY;
+
+	Link(proxy);
+	++_size;
+	return proxy;
+}
+void SpatialHash::Remove(uint32_t proxy)
+{
+	assert(proxy < _objects.size() && _objects[proxy].user_data);
+
+	Unlink(proxy);
+
+	Object& object = _objects[proxy];
+	object.user_data = NULL;
+	object.next = _free_list;
+	_free_list = proxy;
+	--_size;
+}
+bool SpatialHash::Update(uint32_t proxy, const Vec3& position, float radius)
+{
+	assert(proxy < _objects.size() && _objects[proxy].user_data);
+
+	Object& object = _objects[proxy];
+	CellRange cells = RangeOf(position.x - radius, position.z - radius, position.x + radius, position.z + radius);
+	bool moved = cells.min_x != object.cells.min_x || cells.min_z != object.cells.min_z ||
+		cells.max_x != object.cells.max_x || cells.max_z != object.cells.max_z;
+
+	if(moved)
+		Unlink(proxy);
+
+	object.x = position.x;
+	object.z = position.z;
+	object.radius = radius;
+
+	if(moved)
+		Link(proxy);
+	return moved;
+}
+void SpatialHash::Clear()
+{
+	_cells.clear();
+	_objects.clear();
+	_oversized.clear();
+	_free_list = NULL_PROXY;
+	_size = 0;
+}
+//-------------------------------------------------------------------------------
+void* SpatialHash::UserData(uint32_t proxy) const
+{
+	assert(proxy < _objects.size());
+	return _objects[proxy].user_data;
+}
+uint32_t SpatialHash::Size() const
+{
+	return _size;
+}
+//-------------------------------------------------------------------------------
+void SpatialHash::QueryNearest(const Vec3& position, uint32_t k, std::vector<void*>& results) const
+{
+	results.clear();
+	if(!_size || !k)
+		return;
+
+	std::vector<Candidate> nearest;
+	nearest.reserve(k + 1);
+
+	for(size_t i = 0; i < _oversized.size(); ++i)
+	{
+		const Object& object = _objects[_oversized[i]];
+		float dx = object.x - position.x, dz = object.z - position.z;
+
+		Candidate candidate = { dx*dx + dz*dz, _oversized[i] };
+		nearest.push_back(candidate);
+		std::push_heap(nearest.begin(), nearest.end());
+		if(nearest.size() > k)
+		{
+			std::pop_heap(nearest.begin(), nearest.end());
+			nearest.pop_back();
+		}
+	}
+
+	// Search rings of cells around the cell of the position, growing outwards. Any object not found
+	//	after ring r lies outside the block of cells searched, so the search is done once k objects
+	//	have been found within the distance from the position to the edge of the block.
+	CellRange center = RangeOf(position.x, position.z, position.x, position.z);
+	for(int32_t r = 0; ; ++r)
+	{
+		CellRange block = { center.min_x - r, center.min_z - r, center.max_x + r, center.max_z + r };
+		CellRange inner = { center.min_x - r + 1, center.min_z - r + 1, center.max_x + r - 1, center.max_z + r - 1 };
+		const CellRange* searched = r ? &inner : NULL;
+
+		uint64_t block_size = (uint64_t)(2*r + 1) * (uint64_t)(2*r + 1);
+		if(r > 0 && block_size > _cells.size())
+		{
+			// The block has grown larger than the number of cells in use, finish by going through all of them
+			CellRange all = { INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX };
+			for(CellMap::const_iterator cell = _cells.begin(); cell != _cells.end(); ++cell)
+			{
+				int32_t x = (int32_t)(uint32_t)(cell->first >> 32);
+				int32_t z = (int32_t)(uint32_t)cell->first;
+				GatherNearest(x, z, cell->second, all, searched, position.x, position.z, k, nearest);
+			}
+			break;
+		}
+
+		for(int32_t x = block.min_x; x <= block.max_x; ++x)
+		{
+			// Top and bottom rows, then the columns in between
+			CellMap::const_iterator cell = _cells.find(CellKey(x, block.min_z));
+			if(cell != _cells.end())
+				GatherNearest(x, block.min_z, cell->second, block, searched, position.x, position.z, k, nearest);
+
+			if(r == 0)
+				continue;
+
+			cell = _cells.find(CellKey(x, block.max_z));
+			if(cell != _cells.end())
+				GatherNearest(x, block.max_z, cell->second, block, searched, position.x, position.z, k, nearest);
+		}
+		for(int32_t z = block.min_z + 1; z < block.max_z; ++z)
+		{
+			CellMap::const_iterator cell = _cells.find(CellKey(block.min_x, z));
+			if(cell != _cells.end())
+				GatherNearest(block.min_x, z, cell->second, block, searched, position.x, position.z, k, nearest);
+
+			cell = _cells.find(CellKey(block.max_x, z));
+			if(cell != _cells.end())
+				GatherNearest(block.max_x, z, cell->second, block, searched, position.x, position.z, k, nearest);
+		}
+
+		if(nearest.size() == k)
+		{
+			float edge = std::min(std::min(position.x - block.min_x * _cell_size, (block.max_x + 1) * _cell_size - position.x),
+				std::min(position.z - block.min_z * _cell_size, (block.max_z + 1) * _cell_size - position.z));
+			if(nearest.front().distance_sq <= edge * edge)
+				break;
+		}
+	}
+
+	std::sort_heap(nearest.begin(), nearest.end());
+	results.reserve(nearest.size());
+	for(size_t i = 0; i < nearest.size(); ++i)
+		results.push_back(_objects[nearest[i].proxy].user_data);
+}
+//-------------------------------------------------------------------------------
+uint64_t SpatialHash::CellKey(int32_t x, int32_t z)
+{
+	return ((uint64_t)(uint32_t)x << 32) | (uint64_t)(uint32_t)z;
+}
+SpatialHash::CellRange SpatialHash::RangeOf(float min_x, float min_z, float max_x, float max_z) const
+{
+	using namespace spatial_hash_internal;
+
+	CellRange range;
+	range.min_x = CellCoord(min_x * _inv_cell_size);
+	range.min_z = CellCoord(min_z * _inv_cell_size);
+	range.max_x = CellCoord(max_x * _inv_cell_size);
+	range.max_z = CellCoord(max_z * _inv_cell_size);
+	return range;
+}
+void SpatialHash::Link(uint32_t proxy)
+{
+	Object& object = _objects[proxy];
+	object.cells = RangeOf(object.x - object.radius, object.z - object.radius, object.x + object.radius, object.z + object.radius);
+
+	// Compared as 64-bit, the range may span the whole 32-bit range
+	object.oversized = (int64_t)object.cells.max_x - object.cells.min_x >= MAX_CELL_SPAN ||
+		(int64_t)object.cells.max_z - object.cells.min_z >= MAX_CELL_SPAN;
+	if(object.oversized)
+	{
+		_oversized.push_back(proxy);
+		return;
+	}
+
+	for(int32_t z = object.cells.min_z; z <= object.cells.max_z; ++z)
+	{
+		for(int32_t x = object.cells.min_x; x <= object.cells.max_x; ++x)
+		{
+			_cells[CellKey(x, z)].push_back(proxy);
+		}
+	}
+}
+void SpatialHash::Unlink(uint32_t proxy)
+{
+	Object& object = _objects[proxy];
+	if(object.oversized)
+	{
+		_oversized.erase(std::find(_oversized.begin(), _oversized.end(), proxy));
+		return;
+	}
+
+	for(int32_t z = object.cells.min_z; z <= object.cells.max_z; ++z)
+	{
+		for(int32_t x = object.cells.min_x; x <= object.cells.max_x; ++x)
+		{
+			CellMap::iterator cell = _cells.find(CellKey(x, z));
+			assert(cell != _cells.end());
+
+			// Order within a cell doesn't matter, swap with the last one
+			std::vector<uint32_t>& proxies = cell->second;
+			std::vector<uint32_t>::iterator it = std::find(proxies.begin(), proxies.end(), proxy);
+			assert(it != proxies.end());
+			*it = proxies.back();
+			proxies.pop_back();
+
+			if(proxies.empty())
+				_cells.erase(cell);
+		}
+	}
+}
+void SpatialHash::GatherNearest(int32_t x, int32_t z, const std::vector<uint32_t>& proxies, const CellRange& block, const CellRange* inner,
+	float px, float pz, uint32_t k, std::vector<Candidate>& nearest) const
+{
+	for(size_t i = 0; i < proxies.size(); ++i)
+	{
+		const Object& object = _objects[proxies[i]];
+		if(inner && object.cells.Overlaps(*inner))
+			continue;
+		if(x != std::max(object.cells.min_x, block.min_x) || z != std::max(object.cells.min_z, block.min_z))
+			continue;
+
+		float dx = object.x - px, dz = object.z - pz;
+		Candidate candidate = { dx*dx + dz*dz, proxies[i] };
+		if(nearest.size() == k)
+		{
+			if(!(candidate < nearest.front()))
+				continue;
+			std::pop_heap(nearest.begin(), nearest.end());
+			nearest.pop_back();
+		}
+		nearest.push_back(candidate);
+		std::push_heap(nearest.begin(), nearest.end());
+	}
+}
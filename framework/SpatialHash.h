@@ -0,0 +1,246 @@
+#ifndef __FRAMEWORK_SPATIALHASH_H__
+#define __FRAMEWORK_SPATIALHASH_H__
+
+#include <unordered_map>
+
+/// @brief Uniform grid of square cells on the XZ-plane, for neighborhood queries.
+///
+///	Every object is a circle on the XZ-plane (The y-coordinate is ignored) holding a user pointer. An
+///	object is stored in every cell its bounding square overlaps, only the cells holding objects are
+///	kept, in a hash map. Queries only visit the cells overlapping the queried area, so their cost is
+///	proportional to the number of objects nearby rather than the number of objects in total, as long
+///	as the cell size is in the order of the object sizes. Objects spanning more than MAX_CELL_SPAN cells
+///	on either axis are kept in a separate list that every query checks.
+class SpatialHash
+{
+public:
+	enum { NULL_PROXY = 0xffffffff };
+
+	/// Objects spanning more cells than this on either axis are not stored in the cells.
+	enum { MAX_CELL_SPAN = 16 };
+
+	/// @param cell_size Size of the cells, preferably about the size of the queried areas.
+	SpatialHash(float cell_size);
+	~SpatialHash();
+
+	/// @brief Inserts an object.
+	/// @return Proxy identifying the object, stays valid until the object is removed.
+	uint32_t Insert(const Vec3& position, float radius, void* user_data);
+
+	/// @brief Removes an object.
+	void Remove(uint32_t proxy);
+
+	/// @brief Moves or resizes an object.
+	/// @return True if the object moved to other cells, false if it only moved within its cells.
+	bool Update(uint32_t proxy, const Vec3& position, float radius);
+
+	/// @brief Removes all objects.
+	void Clear();
+
+	/// @return The user pointer of the specified proxy.
+	void* UserData(uint32_t proxy) const;
+
+	/// @brief Finds all objects whose circles overlap the specified circle.
+	/// @param callback Called as callback(user_data) once for every object found, returns false to stop the query.
+	template<typename Callback>
+	void QueryRadius(const Vec3& center, float radius, Callback& callback) const;
+
+	/// @brief Finds all objects whose bounding squares overlap the specified rectangle.
+	/// @param min, max Corners of the rectangle, with x and z in Vec2::x and Vec2::y.
+	/// @param callback Called as callback(user_data) once for every object found, returns false to stop the query.
+	template<typename Callback>
+	void QueryRect(const Vec2& min, const Vec2& max, Callback& callback) const;
+
+	/// @brief Finds the objects with centers nearest to the specified position.
+	/// @param k Max number of objects to find.
+	/// @param results Filled with the user pointers of the objects found, nearest first.
+	void QueryNearest(const Vec3& position, uint32_t k, std::vector<void*>& results) const;
+
+	/// @return Number of objects.
+	uint32_t Size() const;
+
+private:
+	struct CellRange
+	{
+		int32_t min_x, min_z;
+		int32_t max_x, max_z;
+
+		bool Overlaps(const CellRange& other) const
+		{
+			return min_x <= other.max_x && other.min_x <= max_x && min_z <= other.max_z && other.min_z <= max_z;
+		}
+	};
+
+	struct Object
+	{
+		float x, z;
+		float radius;
+		CellRange cells; // Cells the object is stored in, unless oversized
+		bool oversized; // Kept in _oversized rather than in the cells
+		void* user_data; // NULL for free objects
+		uint32_t next; // Next object in the free list for free objects
+	};
+
+	/// Object found by QueryNearest, kept in a max-heap on the distance.
+	struct Candidate
+	{
+		float distance_sq;
+		uint32_t proxy;
+
+		bool operator<(const Candidate& other) const { return distance_sq < other.distance_sq; }
+	};
+
+	typedef std::unordered_map<uint64_t, std::vector<uint32_t> > CellMap;
+
+	static uint64_t CellKey(int32_t x, int32_t z);
+
+	/// @return The cells overlapped by the square [min_x, max_x] x [min_z, max_z].
+	CellRange RangeOf(float min_x, float min_z, float max_x, float max_z) const;
+
+	void Link(uint32_t proxy);
+	void Unlink(uint32_t proxy);
+
+	/// Adds the objects of a cell to the k nearest found by QueryNearest. Objects are only added from
+	///	their first cell within block, and not at all if they overlap inner (Already searched).
+	void GatherNearest(int32_t x, int32_t z, const std::vector<uint32_t>& proxies, const CellRange& block, const CellRange* inner,
+		float px, float pz, uint32_t k, std::vector<Candidate>& nearest) const;
+
+	/// Visits every object whose stored cells overlap range, each object once.
+	/// @param callback Called as callback(object), returns false to stop.
+	template<typename Callback>
+	void Visit(const CellRange& range, Callback& callback) const;
+	/// Visits the objects of a single cell for Visit.
+	/// @return False if the callback stopped the visit.
+	template<typename Callback>
+	bool VisitCell(int32_t x, int32_t z, const std::vector<uint32_t>& proxies, const CellRange& range, Callback& callback) const;
+
+	CellMap _cells; // Cell key => Objects in the cell
+	std::vector<Object> _objects;
+	std::vector<uint32_t> _oversized; // Objects not stored in the cells
+	uint32_t _free_list;
+	uint32_t _size;
+	float _cell_size;
+	float _inv_cell_size;
+
+	SpatialHash(const SpatialHash&);
+	SpatialHash& operator=(const SpatialHash&);
+};
+
+template<typename Callback>
+void SpatialHash::Visit(const CellRange& range, Callback& callback) const
+{
+	for(size_t i = 0; i < _oversized.size(); ++i)
+	{
+		if(!callback(_objects[_oversized[i]]))
+			return;
+	}
+
+	// Ranges larger than the number of cells in use are cheaper to handle by going through the cells in use
+	uint64_t range_size = (uint64_t)((int64_t)range.max_x - range.min_x + 1) * (uint64_t)((int64_t)range.max_z - range.min_z + 1);
+	if(range_size > _cells.size())
+	{
+		for(CellMap::const_iterator cell = _cells.begin(); cell != _cells.end(); ++cell)
+		{
+			int32_t x = (int32_t)(uint32_t)(cell->first >> 32);
+			int32_t z = (int32_t)(uint32_t)cell->first;
+			if(x < range.min_x || range.max_x < x || z < range.min_z || range.max_z < z)
+				continue;
+
+			if(!VisitCell(x, z, cell->second, range, callback))
+				return;
+		}
+		return;
+	}
+
+	for(int32_t z = range.min_z; z <= range.max_z; ++z)
+	{
+		for(int32_t x = range.min_x; x <= range.max_x; ++x)
+		{
+			CellMap::const_iterator cell = _cells.find(CellKey(x, z));
+			if(cell == _cells.end())
+				continue;
+
+			if(!VisitCell(x, z, cell->second, range, callback))
+				return;
+		}
+	}
+}
+
+template<typename Callback>
+bool SpatialHash::VisitCell(int32_t x, int32_t z, const std::vector<uint32_t>& proxies, const CellRange& range, Callback& callback) const
+{
+	for(size_t i = 0; i < proxies.size(); ++i)
+	{
+		// Objects in several cells are only visited from the first of their cells within the range
+		const Object& object = _objects[proxies[i]];
+		if(x != std::max(object.cells.min_x, range.min_x) || z != std::max(object.cells.min_z, range.min_z))
+			continue;
+
+		if(!callback(object))
+			return false;
+	}
+	return true;
+}
+
+namespace spatial_hash_internal
+{
+	template<typename Callback>
+	struct RadiusFilter
+	{
+		float x, z, radius;
+		Callback& callback;
+
+		RadiusFilter(float cx, float cz, float r, Callback& c) : x(cx), z(cz), radius(r), callback(c) {}
+
+		template<typename Object>
+		bool operator()(const Object& object)
+		{
+			float dx = object.x - x, dz = object.z - z;
+			float r = object.radius + radius;
+			if(dx*dx + dz*dz > r*r)
+				return true;
+			return callback(object.user_data);
+		}
+	};
+
+	template<typename Callback>
+	struct RectFilter
+	{
+		Vec2 min, max;
+		Callback& callback;
+
+		RectFilter(const Vec2& rmin, const Vec2& rmax, Callback& c) : min(rmin), max(rmax), callback(c) {}
+
+		template<typename Object>
+		bool operator()(const Object& object)
+		{
+			if(object.x + object.radius < min.x || max.x < object.x - object.radius ||
+				object.z + object.radius < min.y || max.y < object.z - object.radius)
+				return true;
+			return callback(object.user_data);
+		}
+	};
+};
+
+template<typename Callback>
+void SpatialHash::QueryRadius(const Vec3& center, float radius, Callback& callback) const
+{
+	if(!_size)
+		return;
+
+	spatial_hash_internal::RadiusFilter<Callback> filter(center.x, center.z, radius, callback);
+	Visit(RangeOf(center.x - radius, center.z - radius, center.x + radius, center.z + radius), filter);
+}
+
+template<typename Callback>
+void SpatialHash::QueryRect(const Vec2& min, const Vec2& max, Callback& callback) const
+{
+	if(!_size)
+		return;
+
+	spatial_hash_internal::RectFilter<Callback> filter(min, max, callback);
+	Visit(RangeOf(min.x, min.y, max.x, max.y), filter);
+}
+
+
+#endif // __FRAMEWORK_SPATIALHASH_H__
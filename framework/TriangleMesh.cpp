@@ -0,0 +1,234 @@
+#include "Common.h"
+
+#include "TriangleMesh.h"
+#include "Ray.h"
+
+#include <algorithm>
+
+namespace triangle_mesh_internal
+{
+	inline float Component(const Vec3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	/// Orders triangles (By index) along an axis by their centroids.
+	struct CentroidLess
+	{
+		const std::vector<Vec3>& centroids;
+		int axis;
+
+		CentroidLess(const std::vector<Vec3>& c, int a) : centroids(c), axis(a) {}
+
+		bool operator()(uint32_t a, uint32_t b) const
+		{
+			return Component(centroids[a], axis) < Component(centroids[b], axis);
+		}
+	};
+
+	Aabb TriangleBounds(const Vec3* v)
+	{
+		return Aabb(Vec3(std::min(std::min(v[0].x, v[1].x), v[2].x), std::min(std::min(v[0].y, v[1].y), v[2].y), std::min(std::min(v[0].z, v[1].z), v[2].z)),
+					Vec3(std::max(std::max(v[0].x, v[1].x), v[2].x), std::max(std::max(v[0].y, v[1].y), v[2].y), std::max(std::max(v[0].z, v[1].z), v[2].z)));
+	}
+};
+
+TriangleMesh::TriangleMesh(const float* vertex_data, uint32_t vertex_stride, uint32_t vertex_count, const uint16_t* indices, uint32_t index_count)
+	: _bounds(Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, 0.0f))
+{
+	uint32_t triangle_count = (indices ? index_count : vertex_count) / 3;
+
+	// Gather the vertices of every triangle, keeping only the ones that can be hit
+	std::vector<Vec3> vertices;
+	std::vector<Vec3> centroids;
+	vertices.reserve(triangle_count * 3);
+	for(uint32_t t = 0; t < triangle_count; ++t)
+	{
+		Vec3 v[3];
+		for(uint32_t i = 0; i < 3; ++i)
+		{
+			uint32_t vertex = indices ? indices[t*3 + i] : t*3 + i;
+			assert(vertex < vertex_count);
+
+			const float* position = vertex_data + vertex * vertex_stride;
+			v[i] = Vec3(position[0], position[1], position[2]);
+		}
+
+		Vec3 normal = vector::Cross(vector::Subtract(v[1], v[0]), vector::Subtract(v[2], v[0]));
+		if(vector::Dot(normal, normal) == 0.0f)
+			continue;
+
+		vertices.push_back(v[0]);
+		vertices.push_back(v[1]);
+		vertices.push_back(v[2]);
+		centroids.push_back((v[0] + v[1] + v[2]) * (1.0f / 3.0f));
+		_triangles.push_back(t);
+	}
+
+	if(_triangles.empty())
+		return;
+
+	// Build orders _triangles by position in the tree, it refers to the gathered triangles until the end
+	std::vector<uint32_t> original_indices;
+	original_indices.swap(_triangles);
+	for(uint32_t i = 0; i < (uint32_t)original_indices.size(); ++i)
+		_triangles.push_back(i);
+
+	_vertices.swap(vertices);
+	_nodes.reserve(2 * (_triangles.size() / MAX_LEAF_SIZE + 1));
+	_nodes.resize(1);
+	Build(0, 0, (uint32_t)_triangles.size(), centroids);
+	_bounds = _nodes[0].bounds;
+
+	// Store the vertices in the order of the leaves so that a leaf is a contiguous range
+	vertices.resize(_vertices.size());
+	for(uint32_t i = 0; i < (uint32_t)_triangles.size(); ++i)
+	{
+		uint32_t t = _triangles[i];
+		vertices[i*3] = _vertices[t*3];
+		vertices[i*3 + 1] = _vertices[t*3 + 1];
+		vertices[i*3 + 2] = _vertices[t*3 + 2];
+		_triangles[i] = original_indices[t];
+	}
+	_vertices.swap(vertices);
+}
+TriangleMesh::~TriangleMesh()
+{
+}
+//-------------------------------------------------------------------------------
+void TriangleMesh::Build(uint32_t node, uint32_t first, uint32_t count, const std::vector<Vec3>& centroids)
+{
+	using namespace triangle_mesh_internal;
+
+	Aabb bounds = TriangleBounds(&_vertices[_triangles[first] * 3]);
+	Aabb centroid_bounds(centroids[_triangles[first]], centroids[_triangles[first]]);
+	for(uint32_t i = first + 1; i < first + count; ++i)
+	{
+		bounds = aabb::Merge(bounds, TriangleBounds(&_vertices[_triangles[i] * 3]));
+		centroid_bounds = aabb::Merge(centroid_bounds, Aabb(centroids[_triangles[i]], centroids[_triangles[i]]));
+	}
+	_nodes[node].bounds = bounds;
+
+	if(count <= MAX_LEAF_SIZE)
+	{
+		_nodes[node].first = first;
+		_nodes[node].count = count;
+		return;
+	}
+
+	// Median split along the axis where the centroids are spread the most
+	Vec3 extent = centroid_bounds.max - centroid_bounds.min;
+	int axis = 0;
+	if(extent.y > extent.x)
+		axis = 1;
+	if(extent.z > Component(extent, axis))
+		axis = 2;
+
+	uint32_t half = count / 2;
+	std::nth_element(_triangles.begin() + first, _triangles.begin() + first + half, _triangles.begin() + first + count,
+		CentroidLess(centroids, axis));
+
+	uint32_t children = (uint32_t)_nodes.size();
+	_nodes.resize(children + 2);
+	_nodes[node].first = children;
+	_nodes[node].count = 0;
+
+	Build(children, first, half, centroids);
+	Build(children + 1, first + half, count - half, centroids);
+}
+//-------------------------------------------------------------------------------
+bool TriangleMesh::RayCast(const Vec3& origin, const Vec3& direction, float max_distance, RayHit& hit) const
+{
+	if(_nodes.empty())
+		return false;
+
+	// Division by zero gives infinity, which the slab test handles
+	Vec3 inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	// Same traversal as AabbTree::RayCast, nearer child first and the other one saved with its distance
+	struct Entry
+	{
+		uint32_t node;
+		float distance;
+	};
+	Entry stack[MAX_STACK_SIZE];
+	uint32_t stack_size = 0;
+
+	float distance;
+	if(!aabb::RayIntersect(_nodes[0].bounds, origin, inv_direction, max_distance, distance))
+		return false;
+
+	stack[stack_size].node = 0;
+	stack[stack_size].distance = distance;
+	++stack_size;
+
+	uint32_t nearest = 0xffffffff;
+	while(stack_size)
+	{
+		--stack_size;
+		if(stack[stack_size].distance > max_distance)
+			continue;
+
+		const Node* node = &_nodes[stack[stack_size].node];
+		while(node)
+		{
+			if(node->count)
+			{
+				for(uint32_t i = node->first; i < node->first + node->count; ++i)
+				{
+					const Vec3* v = &_vertices[i*3];
+					if(RayTriangleIntersect(origin, direction, v[0], v[1], v[2], distance) && distance < max_distance)
+					{
+						max_distance = distance;
+						nearest = i;
+					}
+				}
+				break;
+			}
+
+			float distance1, distance2;
+			bool hit1 = aabb::RayIntersect(_nodes[node->first].bounds, origin, inv_direction, max_distance, distance1);
+			bool hit2 = aabb::RayIntersect(_nodes[node->first + 1].bounds, origin, inv_direction, max_distance, distance2);
+
+			if(hit1 && hit2)
+			{
+				uint32_t near_child = node->first, far_child = node->first + 1;
+				if(distance2 < distance1)
+				{
+					std::swap(near_child, far_child);
+					std::swap(distance1, distance2);
+				}
+
+				assert(stack_size < MAX_STACK_SIZE);
+				stack[stack_size].node = far_child;
+				stack[stack_size].distance = distance2;
+				++stack_size;
+
+				node = &_nodes[near_child];
+			}
+			else if(hit1)
+				node = &_nodes[node->first];
+			else if(hit2)
+				node = &_nodes[node->first + 1];
+			else
+				node = NULL;
+		}
+	}
+
+	if(nearest == 0xffffffff)
+		return false;
+
+	hit.distance = max_distance;
+	hit.triangle = _triangles[nearest];
+	hit.point = origin + direction * max_distance;
+	return true;
+}
+//-------------------------------------------------------------------------------
+const Aabb& TriangleMesh::Bounds() const
+{
+	return _bounds;
+}
+uint32_t TriangleMesh::TriangleCount() const
+{
+	return (uint32_t)_triangles.size();
+}
@@ -0,0 +1,71 @@
+#ifndef __FRAMEWORK_TRIANGLEMESH_H__
+#define __FRAMEWORK_TRIANGLEMESH_H__
+
+#include "Aabb.h"
+
+/// @brief CPU-side copy of the triangles of a mesh, used for precise ray casts against it.
+///
+///	The triangles are kept in a small static bounding volume hierarchy built once when the mesh is
+///	created, so ray casts only test the few triangles near the ray. Degenerate triangles (e.g. at the
+///	poles of a sphere) can never be hit and are left out, triangle indices still refer to the original
+///	triangles of the mesh.
+class TriangleMesh
+{
+public:
+	/// Result of a ray cast.
+	struct RayHit
+	{
+		float distance; // Distance along the ray, in units of the length of the ray direction
+		uint32_t triangle; // Index of the triangle hit, i.e. the triangle made up of vertices [3*triangle, 3*triangle+3) or indices
+		Vec3 point; // Point hit, in the space of the mesh
+	};
+
+	/// @param vertex_data Vertex data, each vertex starting with the position (Px, Py, Pz).
+	/// @param vertex_stride Number of floats per vertex in vertex_data.
+	/// @param vertex_count Number of vertices in vertex_data.
+	/// @param indices Triangle list indices, NULL if every three vertices form a triangle.
+	/// @param index_count Number of indices, ignored if indices is NULL.
+	TriangleMesh(const float* vertex_data, uint32_t vertex_stride, uint32_t vertex_count, const uint16_t* indices, uint32_t index_count);
+	~TriangleMesh();
+
+	/// @brief Finds the nearest intersection between a ray and the triangles of the mesh, both sides
+	///		of the triangles are considered (See RayTriangleIntersect).
+	/// @param direction Direction of the ray, doesn't have to be normalized but distances are in units of its length.
+	/// @param max_distance Only intersections closer than this are reported.
+	/// @return True if a triangle was hit, false if not.
+	bool RayCast(const Vec3& origin, const Vec3& direction, float max_distance, RayHit& hit) const;
+
+	/// @return Bounding box of all triangles.
+	const Aabb& Bounds() const;
+
+	/// @return Number of triangles kept, not counting the ones left out.
+	uint32_t TriangleCount() const;
+
+private:
+	struct Node
+	{
+		Aabb bounds;
+		uint32_t first; // First triangle for leaves, first of the two (adjacent) children otherwise
+		uint32_t count; // Number of triangles for leaves, 0 otherwise
+	};
+
+	/// Max number of triangles in a leaf.
+	enum { MAX_LEAF_SIZE = 4 };
+	/// Max depth of the traversal stack, median splits keep the height at about log2(triangles / MAX_LEAF_SIZE).
+	enum { MAX_STACK_SIZE = 64 };
+
+	/// Builds the subtree of the specified node over the triangles [first, first + count) of _triangles.
+	void Build(uint32_t node, uint32_t first, uint32_t count, const std::vector<Vec3>& centroids);
+
+	std::vector<Vec3> _vertices; // Three vertices per triangle, ordered by the leaves
+	std::vector<uint32_t> _triangles; // Original index of each triangle
+	std::vector<Node> _nodes; // The root is the first node
+
+	Aabb _bounds;
+
+	TriangleMesh(const TriangleMesh&);
+	TriangleMesh& operator=(const TriangleMesh&);
+};
+
+
+#endif // __FRAMEWORK_TRIANGLEMESH_H__
@@ -1,12 +1,20 @@
 #ifndef __FRAMEWORK_VECTOR_H__
 #define __FRAMEWORK_VECTOR_H__
 
+// constexpr is only supported from Visual Studio 2015 (and C++11 on other compilers), older versions get plain
+//	inline functions. MATH_HAS_CONSTEXPR tells whether the math types can be used in constant expressions.
+#if (defined(_MSC_VER) && _MSC_VER < 1900) || (!defined(_MSC_VER) && __cplusplus < 201103L)
+	#define MATH_CONSTEXPR inline
+#else
+	#define MATH_CONSTEXPR constexpr
+	#define MATH_HAS_CONSTEXPR
+#endif
 
 /// @brief Two-dimensional vector.
 struct Vec2
 {
-	Vec2() : x(0.0f), y(0.0f) {}
-	Vec2(float _x, float _y) : x(_x), y(_y) {} 
+	MATH_CONSTEXPR Vec2() : x(0.0f), y(0.0f) {}
+	MATH_CONSTEXPR Vec2(float _x, float _y) : x(_x), y(_y) {} 
 
 	float x, y;
 };
@@ -14,8 +22,8 @@ struct Vec2
 /// @brief Three-dimensional vector.
 struct Vec3
 {
-	Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
-	Vec3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {} 
+	MATH_CONSTEXPR Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+	MATH_CONSTEXPR Vec3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {} 
 
 	float x, y, z;
 };
@@ -23,41 +31,68 @@ struct Vec3
 /// @brief Four-dimensional vector.
 struct Vec4
 {
-	Vec4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
-	Vec4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {} 
+	MATH_CONSTEXPR Vec4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+	MATH_CONSTEXPR Vec4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {} 
 
 	float x, y, z, w;
 };
 
+// Component-wise arithmetic, multiplication and division with a scalar.
+MATH_CONSTEXPR Vec2 operator+(const Vec2& lhs, const Vec2& rhs);
+MATH_CONSTEXPR Vec2 operator-(const Vec2& lhs, const Vec2& rhs);
+MATH_CONSTEXPR Vec2 operator-(const Vec2& v);
+MATH_CONSTEXPR Vec2 operator*(const Vec2& lhs, float rhs);
+MATH_CONSTEXPR Vec2 operator*(float lhs, const Vec2& rhs);
+MATH_CONSTEXPR Vec2 operator/(const Vec2& lhs, float rhs);
+
+MATH_CONSTEXPR Vec3 operator+(const Vec3& lhs, const Vec3& rhs);
+MATH_CONSTEXPR Vec3 operator-(const Vec3& lhs, const Vec3& rhs);
+MATH_CONSTEXPR Vec3 operator-(const Vec3& v);
+MATH_CONSTEXPR Vec3 operator*(const Vec3& lhs, float rhs);
+MATH_CONSTEXPR Vec3 operator*(float lhs, const Vec3& rhs);
+MATH_CONSTEXPR Vec3 operator/(const Vec3& lhs, float rhs);
+inline Vec3& operator+=(Vec3& lhs, const Vec3& rhs);
+inline Vec3& operator-=(Vec3& lhs, const Vec3& rhs);
+inline Vec3& operator*=(Vec3& lhs, float rhs);
+
+MATH_CONSTEXPR Vec4 operator+(const Vec4& lhs, const Vec4& rhs);
+MATH_CONSTEXPR Vec4 operator-(const Vec4& lhs, const Vec4& rhs);
+MATH_CONSTEXPR Vec4 operator-(const Vec4& v);
+MATH_CONSTEXPR Vec4 operator*(const Vec4& lhs, float rhs);
+MATH_CONSTEXPR Vec4 operator*(float lhs, const Vec4& rhs);
+MATH_CONSTEXPR Vec4 operator/(const Vec4& lhs, float rhs);
+
 namespace vector
 {
 	/// @brief Normalizes the specified vector.
-	void Normalize(Vec3& vector);
+	inline void Normalize(Vec3& vector);
 	
 	/// @brief Normalizes the specified vector.
-	void Normalize(Vec4& vector);
+	inline void Normalize(Vec4& vector);
 
 	/// @brief Returns the length of the specified vector.
-	float Length(const Vec3& vector);
+	inline float Length(const Vec3& vector);
 
 	/// @brief Returns the length of the specified vector.
-	float Length(const Vec2& vector);
+	inline float Length(const Vec2& vector);
 	
 	/// @brief Calculates the cross product of the two vectors.
-	Vec3 Cross(const Vec3& lhs, const Vec3& rhs);
+	MATH_CONSTEXPR Vec3 Cross(const Vec3& lhs, const Vec3& rhs);
 	
 	/// @brief Calculates the dot product of the two vectors.
-	float Dot(const Vec3& lhs, const Vec3& rhs);
+	MATH_CONSTEXPR float Dot(const Vec3& lhs, const Vec3& rhs);
 	
 	/// @brief Adds two vectors.
-	Vec3 Add(const Vec3& lhs, const Vec3& rhs);
+	MATH_CONSTEXPR Vec3 Add(const Vec3& lhs, const Vec3& rhs);
 
 	/// @brief Subtracts two vectors in the specified order.
-	Vec3 Subtract(const Vec3& lhs, const Vec3& rhs);
+	MATH_CONSTEXPR Vec3 Subtract(const Vec3& lhs, const Vec3& rhs);
 
 	/// @brief Subtracts two vectors in the specified order.
-	Vec2 Subtract(const Vec2& lhs, const Vec2& rhs);
+	MATH_CONSTEXPR Vec2 Subtract(const Vec2& lhs, const Vec2& rhs);
 };
 
+#include "Vector.inl"
+
 
 #endif // __FRAMEWORK_VECTOR_H__
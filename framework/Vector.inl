@@ -0,0 +1,162 @@
+// Implementation of Vector.h, everything is inline so that calls can be optimized across the library boundary.
+
+#include <math.h>
+
+MATH_CONSTEXPR Vec2 operator+(const Vec2& lhs, const Vec2& rhs)
+{
+	return Vec2(lhs.x + rhs.x, lhs.y + rhs.y);
+}
+MATH_CONSTEXPR Vec2 operator-(const Vec2& lhs, const Vec2& rhs)
+{
+	return Vec2(lhs.x - rhs.x, lhs.y - rhs.y);
+}
+MATH_CONSTEXPR Vec2 operator-(const Vec2& v)
+{
+	return Vec2(-v.x, -v.y);
+}
+MATH_CONSTEXPR Vec2 operator*(const Vec2& lhs, float rhs)
+{
+	return Vec2(lhs.x * rhs, lhs.y * rhs);
+}
+MATH_CONSTEXPR Vec2 operator*(float lhs, const Vec2& rhs)
+{
+	return Vec2(lhs * rhs.x, lhs * rhs.y);
+}
+MATH_CONSTEXPR Vec2 operator/(const Vec2& lhs, float rhs)
+{
+	return Vec2(lhs.x / rhs, lhs.y / rhs);
+}
+//-------------------------------------------------------------------------------
+MATH_CONSTEXPR Vec3 operator+(const Vec3& lhs, const Vec3& rhs)
+{
+	// Addition: [Real-Time Rendering, A.2, page 890]
+	//	U + V = (	Ux + Vx
+	//				Uy + Vy
+	//				Uz + Vz ... )
+
+	return Vec3(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z);
+}
+MATH_CONSTEXPR Vec3 operator-(const Vec3& lhs, const Vec3& rhs)
+{
+	return Vec3(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z);
+}
+MATH_CONSTEXPR Vec3 operator-(const Vec3& v)
+{
+	return Vec3(-v.x, -v.y, -v.z);
+}
+MATH_CONSTEXPR Vec3 operator*(const Vec3& lhs, float rhs)
+{
+	return Vec3(lhs.x * rhs, lhs.y * rhs, lhs.z * rhs);
+}
+MATH_CONSTEXPR Vec3 operator*(float lhs, const Vec3& rhs)
+{
+	return Vec3(lhs * rhs.x, lhs * rhs.y, lhs * rhs.z);
+}
+MATH_CONSTEXPR Vec3 operator/(const Vec3& lhs, float rhs)
+{
+	return Vec3(lhs.x / rhs, lhs.y / rhs, lhs.z / rhs);
+}
+inline Vec3& operator+=(Vec3& lhs, const Vec3& rhs)
+{
+	lhs.x += rhs.x; lhs.y += rhs.y; lhs.z += rhs.z;
+	return lhs;
+}
+inline Vec3& operator-=(Vec3& lhs, const Vec3& rhs)
+{
+	lhs.x -= rhs.x; lhs.y -= rhs.y; lhs.z -= rhs.z;
+	return lhs;
+}
+inline Vec3& operator*=(Vec3& lhs, float rhs)
+{
+	lhs.x *= rhs; lhs.y *= rhs; lhs.z *= rhs;
+	return lhs;
+}
+//-------------------------------------------------------------------------------
+MATH_CONSTEXPR Vec4 operator+(const Vec4& lhs, const Vec4& rhs)
+{
+	return Vec4(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z, lhs.w + rhs.w);
+}
+MATH_CONSTEXPR Vec4 operator-(const Vec4& lhs, const Vec4& rhs)
+{
+	return Vec4(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z, lhs.w - rhs.w);
+}
+MATH_CONSTEXPR Vec4 operator-(const Vec4& v)
+{
+	return Vec4(-v.x, -v.y, -v.z, -v.w);
+}
+MATH_CONSTEXPR Vec4 operator*(const Vec4& lhs, float rhs)
+{
+	return Vec4(lhs.x * rhs, lhs.y * rhs, lhs.z * rhs, lhs.w * rhs);
+}
+MATH_CONSTEXPR Vec4 operator*(float lhs, const Vec4& rhs)
+{
+	return Vec4(lhs * rhs.x, lhs * rhs.y, lhs * rhs.z, lhs * rhs.w);
+}
+MATH_CONSTEXPR Vec4 operator/(const Vec4& lhs, float rhs)
+{
+	return Vec4(lhs.x / rhs, lhs.y / rhs, lhs.z / rhs, lhs.w / rhs);
+}
+//-------------------------------------------------------------------------------
+inline void vector::Normalize(Vec3& vector)
+{
+	// Normalization: [Real-Time Rendering, A.19, page 894]
+	//	N(p) = (1 / ||p||) * p
+
+	float inv_length = 1.0f / sqrtf(vector.x*vector.x + vector.y*vector.y + vector.z*vector.z); // ||p|| 
+	vector.x *= inv_length;
+	vector.y *= inv_length;
+	vector.z *= inv_length;
+}
+	
+inline void vector::Normalize(Vec4& vector)
+{
+	// Normalization: [Real-Time Rendering, A.19, page 894]
+	//	N(p) = (1 / ||p||) * p
+
+	float inv_length = 1.0f / sqrtf(vector.x*vector.x + vector.y*vector.y + vector.z*vector.z + vector.w*vector.w); // ||p|| 
+	vector.x *= inv_length;
+	vector.y *= inv_length;
+	vector.z *= inv_length;
+	vector.w *= inv_length;
+}
+
+inline float vector::Length(const Vec3& vector)
+{
+	return sqrtf(vector.x*vector.x + vector.y*vector.y + vector.z*vector.z);
+}
+
+inline float vector::Length(const Vec2& vector)
+{
+	return sqrtf(vector.x*vector.x + vector.y*vector.y);
+}
+
+MATH_CONSTEXPR Vec3 vector::Cross(const Vec3& lhs, const Vec3& rhs)
+{
+	// Cross product: [Real-Time Rendering, A.19, page 896]
+	//	U x V = (Uy*Vz)i + (Uz*Vx)j + (Ux*Vy)k - (Uz*Vy)i - (Ux*Vz)j - (Uy*Vx)k
+
+	return Vec3( lhs.y*rhs.z - lhs.z*rhs.y, lhs.z*rhs.x - lhs.x*rhs.z, lhs.x*rhs.y - lhs.y*rhs.x ); 
+}
+	
+MATH_CONSTEXPR float vector::Dot(const Vec3& lhs, const Vec3& rhs)
+{
+	// Dot product: [Real-Time Rendering, A.8, page 891]
+	//	U dot V = Ux * Vx + Uy * Vy + Uz * Vz + ... 
+
+	return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z; 
+}
+
+MATH_CONSTEXPR Vec3 vector::Add(const Vec3& lhs, const Vec3& rhs)
+{
+	return lhs + rhs;
+}
+
+MATH_CONSTEXPR Vec3 vector::Subtract(const Vec3& lhs, const Vec3& rhs)
+{
+	return lhs - rhs;
+}
+
+MATH_CONSTEXPR Vec2 vector::Subtract(const Vec2& lhs, const Vec2& rhs)
+{
+	return lhs - rhs;
+}
@@ -2,11 +2,21 @@
 #include "App.h"
 #include "Scene.h"
 #include "ColorPicker.h"
+#include "SceneSaver.h"
+#include "SceneLoader.h"
+#include "SceneStreamer.h"
+#include "SceneGenerator.h"
 
 #include <framework/RenderDevice.h>
 #include <framework/Ray.h>
+#include <framework/FileSystem.h>
 
 #define SCENE_FILE_NAME "scene.json"
+#define SCENE_CELLS_FILE_NAME "scene.cells" // Index of a scene streamed in cells, used instead of SCENE_FILE_NAME if found
+#define WINDOW_TITLE "OpenGL - Lab 2"
+
+// Maximum time in seconds spent every frame on creating entities while loading a scene
+#define SCENE_LOAD_TIME_BUDGET 0.008f
 
 static const char* vertex_shader_src = " \
 	#version 150 \n\
@@ -94,7 +104,7 @@ static const char* fragment_shader_src = " \
 	}";
 
 
-Lab2App::Lab2App() : _camera_angle(0.0f), _primitive_factory(NULL), _color_picker(NULL)
+Lab2App::Lab2App() : _camera_angle(0.0f), _primitive_factory(NULL), _scene_saver(NULL), _scene_loader(NULL), _scene_streamer(NULL), _scene_watcher(NULL), _scene_modified(false), _load_percent(-1), _color_picker(NULL)
 {
 }
 Lab2App::~Lab2App()
@@ -109,7 +119,7 @@ bool Lab2App::Initialize()
 	if(!InitializeSDL(win_width, win_height))
 		return false;
 
-	SetWindowTitle("OpenGL - Lab 2");
+	SetWindowTitle(WINDOW_TITLE);
 	_render_device->SetClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
 	glEnable(GL_CULL_FACE); // Enable face culling
@@ -121,9 +131,7 @@ bool Lab2App::Initialize()
 
 	// Camera setup
 	// Set the perspective, 45 degrees FOV, aspect ratio to match viewport, z range: [1.0, 1000.0]
-	_camera.projection_matrix = matrix::CreatePerspective(30.0f*(float)MATH_PI/180.0f, (float)win_width/(float)win_height, 1.0f, 1000.0f);
-	_camera.position = Vec3(0.0f, 0.0f, 0.0f);
-	_camera.direction = Vec3(0.0f, 0.0f, -1.0f);
+	_camera.SetProjection(matrix::CreatePerspective(30.0f*(float)MATH_PI/180.0f, (float)win_width/(float)win_height, 1.0f, 1000.0f));
 
 	_primitive_factory = new PrimitiveFactory(_render_device);
 	
@@ -137,12 +145,36 @@ bool Lab2App::Initialize()
 	_scene = new Scene(default_material, _primitive_factory);
 
 	// Try loading a scene
-	if(!_scene->LoadScene(SCENE_FILE_NAME))
+	_scene_loader = new SceneLoader(_scene);
+	_scene_streamer = new SceneStreamer(_scene);
+
+	// Load the scene in the background if there is one
+	FILE* scene_file = fopen(SCENE_FILE_NAME, "rb");
+	if(_scene_streamer->Open(SCENE_CELLS_FILE_NAME))
+	{
+		// Cells are loaded around the camera as it moves
+		if(scene_file)
+			fclose(scene_file);
+	}
+	else if(scene_file)
+	{
+		fclose(scene_file);
+		_scene_loader->Load(SCENE_FILE_NAME);
+	}
+	else
 	{
 		// If no scene was loaded setup a small test scene
-		_scene->CreateEntity(Entity::ET_PYRAMID)->position = Vec3(2.5f, 0.0f, -2.5f);
-		_scene->CreateEntity(Entity::ET_CUBE)->position = Vec3(-2.5f, 0.0f, -2.5f);
-		_scene->CreateEntity(Entity::ET_SPHERE)->position = Vec3(0.0f, 0.0f, -3.0f);
+		Entity* entity = _scene->CreateEntity(Entity::ET_PYRAMID);
+		entity->position = Vec3(2.5f, 0.0f, -2.5f);
+		_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
+
+		entity = _scene->CreateEntity(Entity::ET_CUBE);
+		entity->position = Vec3(-2.5f, 0.0f, -2.5f);
+		_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
+
+		entity = _scene->CreateEntity(Entity::ET_SPHERE);
+		entity->position = Vec3(0.0f, 0.0f, -3.0f);
+		_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
 
 		Light* light = (Light*)_scene->CreateEntity(Entity::ET_LIGHT);
 
@@ -151,10 +183,19 @@ bool Lab2App::Initialize()
 		light->diffuse = Color(1.0f, 1.0f, 1.0f, 1.0f);
 		light->position = Vec3(0.0f, 0.0f, 2.0f);
 		light->radius = 25.0f;
+		_scene->NotifyEntityChanged(light, Scene::CHANGE_TRANSFORM | Scene::CHANGE_LIGHT);
 
 		_scene->SaveScene(SCENE_FILE_NAME);
 	}
 
+	_scene_saver = new SceneSaver();
+	_scene_saver->SetCallback(OnSceneSaved, this);
+
+	// Reload the scene whenever it's modified by another tool
+	_scene_watcher = new file_system::FileWatcher();
+	if(!_scene_streamer->IsOpen())
+		_scene_watcher->Watch(SCENE_FILE_NAME);
+
 	_color_picker = new ColorPicker(_render_device, _viewport);
 
 	return true;
@@ -164,8 +205,23 @@ void Lab2App::Shutdown()
 	delete _color_picker;
 	_color_picker = NULL;
 
-	// Save scene before shutting down.
-	_scene->SaveScene(SCENE_FILE_NAME);
+	// Save any changes before shutting down, after any saves still in progress. A scene still
+	//	loading has to be completed first, otherwise saving it would lose the remaining entities.
+	_scene_loader->Finish();
+	delete _scene_loader;
+	_scene_loader = NULL;
+
+	_scene_saver->Wait();
+	if(_scene_streamer->IsOpen())
+		_scene_streamer->Save();
+	else
+		_scene->SaveChanges(SCENE_FILE_NAME);
+	delete _scene_saver;
+	_scene_saver = NULL;
+	delete _scene_streamer;
+	_scene_streamer = NULL;
+	delete _scene_watcher;
+	_scene_watcher = NULL;
 
 	_render_device->ReleaseShader(_default_shader);
 	_default_shader = -1;
@@ -180,19 +236,37 @@ void Lab2App::Shutdown()
 }
 void Lab2App::Render(float )
 {
+	// Report any saves completed since the last frame
+	_scene_saver->Update();
+
+	// Changes made while loading are picked up once the load is complete
+	if(_scene_watcher->Poll())
+		_scene_modified = true;
+	if(_scene_modified && !_scene_loader->Loading() && !_scene_saver->Busy())
+	{
+		_scene_modified = false;
+		_scene_loader->Reload(SCENE_FILE_NAME);
+	}
+
+	UpdateLoading();
+
+	// Stream cells around the camera, using the camera position from the previous frame
+	_scene_streamer->Update(_camera.position, SCENE_LOAD_TIME_BUDGET);
+
 	glViewport(_viewport.x, _viewport.y, _viewport.width, _viewport.height);
 
-	_camera.position = Vec3(35.0f*sinf(_camera_angle), 15.0f, 35.0f*cosf(_camera_angle));
-	_camera.direction = vector::Subtract(Vec3(0.0f, 0.0f, 0.0f), _camera.position);
-	vector::Normalize(_camera.direction);
+	Vec3 camera_position = Vec3(35.0f*sinf(_camera_angle), 15.0f, 35.0f*cosf(_camera_angle));
+	Vec3 camera_direction = vector::Subtract(Vec3(0.0f, 0.0f, 0.0f), camera_position);
+	vector::Normalize(camera_direction);
+	_camera.SetView(camera_position, camera_direction);
 
 	_matrix_stack.Push();
 
 	// Setup camera transforms
 	_matrix_stack.SetProjectionMatrix(_camera.projection_matrix);
-	_matrix_stack.SetViewMatrix(matrix::LookAt(_camera.position, vector::Add(_camera.position, _camera.direction), Vec3(0.0f, 1.0f, 0.0f)));
+	_matrix_stack.SetViewMatrix(_camera.view_matrix);
 
-	_scene->Render(*_render_device, _matrix_stack);
+	_scene->Render(*_render_device, _matrix_stack, _camera);
 	
 	_matrix_stack.Pop();
 
@@ -210,7 +284,10 @@ void Lab2App::OnEvent(SDL_Event* evt)
 		{
 			// If the color picker is active, let it process mouse input.
 			if(_color_picker->Visible() && _color_picker->OnMouseEvent(Vec2((float)evt->button.x, _viewport.height - (float)evt->button.y)))
+			{
+				_scene->NotifyEntityChanged(_selection.entity, Scene::CHANGE_MATERIAL | Scene::CHANGE_LIGHT);
 				break;
+			}
 
 			// Normalize mouse position ([-1.0, 1.0])
 			Vec2 mouse_position = Vec2(	2.0f * (float)evt->button.x / (float)_viewport.width - 1.0f,
@@ -251,16 +328,22 @@ void Lab2App::OnEvent(SDL_Event* evt)
 		break;
 	case SDL_MOUSEMOTION:
 		{
+			// Normalize mouse position ([-1.0, 1.0])
+			Vec2 mouse_position = Vec2(	2.0f * (float)evt->motion.x / (float)_viewport.width - 1.0f,
+										1.0f - (2.0f * (float)evt->motion.y / (float)_viewport.height)); // Flip y-axis as OpenGL has y=0 at the bottom.
+
+			// Highlight the entity under the mouse, but not while one is being manipulated
+			if(_selection.mode == Selection::IDLE)
+				_scene->HoverEntity(mouse_position, _camera);
+			else
+				_scene->ClearHover();
+
 			if(key_states[SDL_SCANCODE_V])
 			{
 				_camera_angle += evt->motion.xrel * 0.01f;
 			}
 			else if(_selection.entity)
 			{
-				// Normalize mouse position ([-1.0, 1.0])
-				Vec2 mouse_position = Vec2(	2.0f * (float)evt->motion.x / (float)_viewport.width - 1.0f,
-											1.0f - (2.0f * (float)evt->motion.y / (float)_viewport.height)); // Flip y-axis as OpenGL has y=0 at the bottom.
-
 				if(_selection.mode == Selection::MOVE)
 				{
 					MoveEntity(_selection.entity, mouse_position, (key_states[SDL_SCANCODE_LCTRL] != 0), _selection.offset);
@@ -277,7 +360,8 @@ void Lab2App::OnEvent(SDL_Event* evt)
 				else if(_color_picker->Visible() && evt->motion.state & SDL_BUTTON(1))
 				{
 					// Flip height as SDL goes from top to bottom while the rest of our system goes bottom to top.
-					_color_picker->OnMouseEvent(Vec2((float)evt->motion.x, _viewport.height - (float)evt->motion.y));
+					if(_color_picker->OnMouseEvent(Vec2((float)evt->motion.x, _viewport.height - (float)evt->motion.y)))
+						_scene->NotifyEntityChanged(_selection.entity, Scene::CHANGE_MATERIAL | Scene::CHANGE_LIGHT);
 				}
 			}
 		}
@@ -301,37 +385,75 @@ void Lab2App::OnEvent(SDL_Event* evt)
 				break;
 			case SDL_SCANCODE_F1:
 				{
-					_scene->SaveScene(SCENE_FILE_NAME);
+					if(_scene_streamer->IsOpen())
+					{
+						_scene_streamer->Save();
+					}
+					else
+					{
+						// Saved in the background to avoid stalling the frame on large scenes
+						_scene_loader->Finish();
+						_scene->SaveChangesAsync(SCENE_FILE_NAME, *_scene_saver);
+					}
 				}
 				break;
 			case SDL_SCANCODE_F2:
 				{
-					UnselectEntity(); // Unselect the current entity, as it may not exist in the loaded world.
-					_scene->LoadScene(SCENE_FILE_NAME);
+					if(_selection.entity)
+						UnselectEntity(); // Unselect the current entity, as it may not exist in the loaded world.
+					_scene_saver->Wait(); // Make sure the file is complete before loading it
+					if(_scene_streamer->IsOpen())
+						_scene_streamer->Open(SCENE_CELLS_FILE_NAME);
+					else
+						_scene_loader->Load(SCENE_FILE_NAME);
+				}
+				break;
+			case SDL_SCANCODE_F3:
+				{
+					_scene->SetOcclusionCulling(!_scene->OcclusionCulling());
+				}
+				break;
+			case SDL_SCANCODE_F4:
+				{
+					// Cells are owned by the streamer, a generated scene would be mixed into them
+					if(_scene_streamer->IsOpen())
+						break;
+
+					if(_selection.entity)
+						UnselectEntity();
+					_scene_loader->Finish(); // A load in progress would otherwise keep adding to the generated scene
+
+					scene_generator::Params params;
+					params.seed = SDL_GetTicks();
+					_scene->GenerateScene(params);
 				}
 				break;
 			case SDL_SCANCODE_1:
 				{
 					Entity* entity = _scene->CreateEntity(Entity::ET_PYRAMID);
 					entity->position = world_position;
+					_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
 				}
 				break;
 			case SDL_SCANCODE_2:
 				{
 					Entity* entity = _scene->CreateEntity(Entity::ET_CUBE);
 					entity->position = world_position;
+					_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
 				}
 				break;
 			case SDL_SCANCODE_3:
 				{
 					Entity* entity = _scene->CreateEntity(Entity::ET_SPHERE);
 					entity->position = world_position;
+					_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
 				}
 				break;
 			case SDL_SCANCODE_4:
 				{
 					Entity* entity = _scene->CreateEntity(Entity::ET_LIGHT);
 					entity->position = world_position;
+					_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
 				}
 				break;
 			case SDL_SCANCODE_DELETE:
@@ -372,22 +494,13 @@ void Lab2App::MoveEntity(Entity* entity, const Vec2& mouse_position, bool y_axis
 		//	We do this by casting a ray from the mouse position against a plane that is fixed on the y-axis.
 		//	The intersection point will then be the new position for the object.
 
-		Vec4 ray_clip = Vec4(mouse_position.x, mouse_position.y, -1.0f, 1.0f); 
-
-		// Transform ray into view-space
-		Vec4 ray_view = matrix::Multiply(matrix::Inverse(_camera.projection_matrix), ray_clip);
-		ray_view = Vec4(ray_view.x, ray_view.y, -1.0f, 0.0f);
-
-		// Transform ray into world-space
-		Mat4x4 view = matrix::LookAt(_camera.position, vector::Add(_camera.position, _camera.direction), Vec3(0.0f, 1.0f, 0.0f)); // Build the view matrix
-		Vec4 ray_world = matrix::Multiply(matrix::Inverse(view), ray_view);
-		vector::Normalize(ray_world);
+		Vec3 ray = _camera.PickRay(mouse_position);
 
 		Vec3 plane_normal = vector::Subtract(Vec3(0, 0, 0), _camera.direction);
 		plane_normal.y = 0.0f; // Fix the plane on the y-axis
 
 		// We add an offset to the plane to make sure we're actually moving the object relative to it's previous position and not relative to (0, 0, 0).
-		Vec3 intersection = RayPlaneIntersect(_camera.position, Vec3(ray_world.x, ray_world.y, ray_world.z), plane_normal, -vector::Dot(entity->position, plane_normal)); 
+		Vec3 intersection = RayPlaneIntersect(_camera.position, ray, plane_normal, -vector::Dot(entity->position, plane_normal)); 
 		// We add the saved offset to avoid any popping effect caused by the user not clicking in the absolute middle of the object.
 		entity->position = intersection;
 	}
@@ -400,6 +513,7 @@ void Lab2App::MoveEntity(Entity* entity, const Vec2& mouse_position, bool y_axis
 		// We add the saved offset to avoid any popping effect caused by the user not clicking in the absolute middle of the object.
 		entity->position = vector::Add(world_position, offset);
 	}
+	_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
 }
 
 void Lab2App::ScaleEntity(Entity* entity, const Vec2& mouse_position, bool y_axis)
@@ -431,22 +545,13 @@ void Lab2App::ScaleEntity(Entity* entity, const Vec2& mouse_position, bool y_axi
 			//	We do this by casting a ray from the mouse position against a plane that is fixed on the y-axis.
 			//	The intersection point will then be the new position for the object.
 
-			Vec4 ray_clip = Vec4(mouse_position.x, mouse_position.y, -1.0f, 1.0f); 
-
-			// Transform ray into view-space
-			Vec4 ray_view = matrix::Multiply(matrix::Inverse(_camera.projection_matrix), ray_clip);
-			ray_view = Vec4(ray_view.x, ray_view.y, -1.0f, 0.0f);
-
-			// Transform ray into world-space
-			Mat4x4 view = matrix::LookAt(_camera.position, vector::Add(_camera.position, _camera.direction), Vec3(0.0f, 1.0f, 0.0f)); // Build the view matrix
-			Vec4 ray_world = matrix::Multiply(matrix::Inverse(view), ray_view);
-			vector::Normalize(ray_world);
+			Vec3 ray = _camera.PickRay(mouse_position);
 
 			Vec3 plane_normal = vector::Subtract(Vec3(0, 0, 0), _camera.direction);
 			plane_normal.y = 0.0f; // Fix the plane on the y-axis
 
 			// We add an offset to the plane to make sure we're actually moving the object relative to it's previous position and not relative to (0, 0, 0).
-			Vec3 intersection = RayPlaneIntersect(_camera.position, Vec3(ray_world.x, ray_world.y, ray_world.z), plane_normal, -vector::Dot(entity->position, plane_normal)); 
+			Vec3 intersection = RayPlaneIntersect(_camera.position, ray, plane_normal, -vector::Dot(entity->position, plane_normal)); 
 			Vec3 d = vector::Subtract(entity->position, intersection);
 
 			entity->scale.y = fabs(d.y);
@@ -462,6 +567,7 @@ void Lab2App::ScaleEntity(Entity* entity, const Vec2& mouse_position, bool y_axi
 			entity->scale = Vec3(fabs(d.x), entity->scale.y, fabs(d.z));
 		}
 	}
+	_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM | Scene::CHANGE_LIGHT);
 }
 
 void Lab2App::RotateEntity(Entity* entity, const Vec2& mouse_position)
@@ -470,6 +576,7 @@ void Lab2App::RotateEntity(Entity* entity, const Vec2& mouse_position)
 	Vec3 delta = vector::Subtract(world_position, entity->position);
 	entity->rotation.x = delta.x;
 	entity->rotation.y = delta.z;
+	_scene->NotifyEntityChanged(entity, Scene::CHANGE_TRANSFORM);
 }
 
 void Lab2App::SelectEntity(Entity* entity, const Vec2& mouse_position)
@@ -505,3 +612,52 @@ void Lab2App::UnselectEntity()
 	_selection.entity->selected = false;
 	_selection.entity = NULL;
 }
+void Lab2App::UpdateLoading()
+{
+	if(!_scene_loader->Loading())
+		return;
+
+	// Reloads are applied in one go and keep the selected entity
+	if(_scene_loader->Reloading())
+	{
+		_scene_loader->Update(SCENE_LOAD_TIME_BUDGET);
+		return;
+	}
+
+	// The scene is cleared once parsing is done, so nothing may refer to the current entities
+	if(_scene_loader->GetState() == SceneLoader::PARSING && _selection.entity)
+		UnselectEntity();
+
+	_scene_loader->Update(SCENE_LOAD_TIME_BUDGET);
+
+	// Show the progress in the window title
+	int percent = _scene_loader->Loading() ? (int)(_scene_loader->Progress() * 100.0f) : -1;
+	if(percent != _load_percent)
+	{
+		_load_percent = percent;
+		if(percent != -1)
+		{
+			char title[64];
+			sprintf(title, "%s - Loading %d%%", WINDOW_TITLE, percent);
+			SetWindowTitle(title);
+		}
+		else
+		{
+			SetWindowTitle(WINDOW_TITLE);
+		}
+	}
+}
+void Lab2App::OnSceneSaved(const char* filename, bool result, void* user_data)
+{
+	Lab2App* app = (Lab2App*)user_data;
+
+	// Our own saves are not modifications that need to be reloaded
+	app->_scene_watcher->Poll();
+	app->_scene_modified = false;
+
+	if(!result)
+	{
+		debug::Printf("Failed to save scene '%s'.\n", filename);
+		app->_scene->AsyncSaveFailed();
+	}
+}
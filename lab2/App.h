@@ -5,6 +5,7 @@
 
 #include "MatrixStack.h"
 #include "Material.h"
+#include "Camera.h"
 
 struct Viewport
 {
@@ -12,16 +13,17 @@ struct Viewport
 	int width, height;
 };
 
-struct Camera
-{
-	Mat4x4 projection_matrix;
-	Vec3 position;
-	Vec3 direction; // Which direction the camera is looking
-};
-
 class Scene;
 class PrimitiveFactory;
 class ColorPicker;
+class SceneSaver;
+class SceneLoader;
+class SceneStreamer;
+
+namespace file_system
+{
+	class FileWatcher;
+};
 struct Entity;
 
 class Lab2App : public App
@@ -58,6 +60,12 @@ protected:
 	/// @brief Called when the user wants to unselect the current entity.
 	void UnselectEntity();
 
+	/// @brief Integrates entities of the scene being loaded, if any.
+	void UpdateLoading();
+
+	/// @brief Callback for when the scene saver has completed a save.
+	static void OnSceneSaved(const char* filename, bool result, void* user_data);
+
 private:
 	struct Selection
 	{
@@ -85,6 +93,12 @@ private:
 
 	PrimitiveFactory* _primitive_factory;
 	Scene* _scene;
+	SceneSaver* _scene_saver; // Saves the scene in the background
+	SceneLoader* _scene_loader; // Loads the scene in the background
+	SceneStreamer* _scene_streamer; // Streams the scene in cells around the camera, if it's stored as cells
+	file_system::FileWatcher* _scene_watcher; // Detects modifications of the scene file by other tools
+	bool _scene_modified; // The scene file has been modified and needs to be reloaded
+	int _load_percent; // Loading progress shown in the window title, -1 if not loading
 
 	int _default_shader;
 
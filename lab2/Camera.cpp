@@ -0,0 +1,49 @@
+#include <framework/Common.h>
+
+#include "Camera.h"
+
+
+Camera::Camera()
+	: position(0.0f, 0.0f, 0.0f),
+	direction(0.0f, 0.0f, -1.0f)
+{
+	projection_matrix = inverse_projection_matrix = matrix::CreateIdentity();
+	view_matrix = matrix::LookAt(position, vector::Add(position, direction), Vec3(0.0f, 1.0f, 0.0f));
+	inverse_view_matrix = matrix::InverseRigid(view_matrix);
+	frustum = frustum::FromMatrix(matrix::Multiply(projection_matrix, view_matrix));
+}
+void Camera::SetProjection(const Mat4x4& projection)
+{
+	projection_matrix = projection;
+	inverse_projection_matrix = matrix::InversePerspective(projection);
+	frustum = frustum::FromMatrix(matrix::Multiply(projection_matrix, view_matrix));
+}
+void Camera::SetView(const Vec3& new_position, const Vec3& new_direction)
+{
+	if(new_position.x == position.x && new_position.y == position.y && new_position.z == position.z &&
+		new_direction.x == direction.x && new_direction.y == direction.y && new_direction.z == direction.z)
+		return;
+
+	position = new_position;
+	direction = new_direction;
+
+	view_matrix = matrix::LookAt(position, vector::Add(position, direction), Vec3(0.0f, 1.0f, 0.0f));
+	// The view matrix only rotates and translates
+	inverse_view_matrix = matrix::InverseRigid(view_matrix);
+	frustum = frustum::FromMatrix(matrix::Multiply(projection_matrix, view_matrix));
+}
+Vec3 Camera::PickRay(const Vec2& mouse_position) const
+{
+	// Ray in clip-space
+	Vec4 ray_clip = Vec4(mouse_position.x, mouse_position.y, -1.0f, 1.0f);
+
+	// Transform ray into view-space
+	Vec4 ray_view = matrix::Multiply(inverse_projection_matrix, ray_clip);
+	ray_view = Vec4(ray_view.x, ray_view.y, -1.0f, 0.0f);
+
+	// Transform ray into world-space
+	Vec4 ray_world = matrix::Multiply(inverse_view_matrix, ray_view);
+	Vec3 ray(ray_world.x, ray_world.y, ray_world.z);
+	vector::Normalize(ray);
+	return ray;
+}
@@ -0,0 +1,40 @@
+#ifndef __CAMERA_H__
+#define __CAMERA_H__
+
+#include <framework/Frustum.h>
+
+/// @brief Camera with cached view, inverse matrices and view frustum.
+///
+///	The matrices derived from the camera are only recalculated when the camera actually changes,
+///	picking and dragging reuse them instead of rebuilding the view matrix and running general
+///	inverses for every mouse event. Always change the camera through SetProjection and SetView to
+///	keep the cached matrices in sync.
+struct Camera
+{
+	Mat4x4 projection_matrix;
+	Vec3 position;
+	Vec3 direction; // Which direction the camera is looking
+
+	Mat4x4 view_matrix;
+	Mat4x4 inverse_view_matrix;
+	Mat4x4 inverse_projection_matrix;
+
+	Frustum frustum; // World-space view frustum, for culling
+
+	Camera();
+
+	/// @brief Sets the projection, which needs to be a perspective projection (See matrix::CreatePerspective).
+	void SetProjection(const Mat4x4& projection);
+
+	/// @brief Places the camera, the view matrices are only recalculated if the position or direction changed.
+	/// @param direction Normalized view direction.
+	void SetView(const Vec3& position, const Vec3& direction);
+
+	/// @brief Calculates the direction of a ray from the camera position through the specified position on the screen.
+	/// @param mouse_position Position in normalized device coordinates.
+	/// @return The normalized ray direction in world-space.
+	Vec3 PickRay(const Vec2& mouse_position) const;
+};
+
+
+#endif // __CAMERA_H__
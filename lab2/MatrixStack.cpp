@@ -57,6 +57,14 @@ void MatrixStack::Rotate3f(float head, float pitch, float roll)
 	current_state.model_matrix = matrix::Multiply(current_state.model_matrix, rotation_matrix);
 	_state_dirty = true;
 }
+void MatrixStack::Rotate(const Quat& rotation)
+{
+	Mat4x4 rotation_matrix = quat::ToMatrix(rotation);
+
+	State& current_state = _states.top();
+	current_state.model_matrix = matrix::Multiply(current_state.model_matrix, rotation_matrix);
+	_state_dirty = true;
+}
 void MatrixStack::Scale3f(const Vec3& scale)
 {
 	Mat4x4 scale_matrix = matrix::CreateScaling(scale);
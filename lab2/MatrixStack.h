@@ -23,6 +23,7 @@ public:
 
 	void Translate3f(const Vec3& translation);
 	void Rotate3f(float head, float pitch, float roll);
+	void Rotate(const Quat& rotation);
 	void Scale3f(const Vec3& scale);
 
 	/// Applies the current matrices to the pipeline, this assumes that a shader with 
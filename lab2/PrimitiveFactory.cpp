@@ -91,6 +91,7 @@ Primitive PrimitiveFactory::CreatePyramid(const Vec3& size)
 	primitive.draw_call.index_buffer = -1; // Specify that we don't want to use an index buffer
 	
 	primitive.bounding_radius = sqrtf(half_size.x * half_size.x + half_size.y * half_size.y + half_size.z * half_size.z);
+	primitive.mesh = new TriangleMesh(vertex_data, 6, primitive.draw_call.vertex_count, NULL, 0);
 
 	return primitive;
 }
@@ -221,6 +222,7 @@ Primitive PrimitiveFactory::CreateCube(const Vec3& size)
 	primitive.draw_call.index_buffer = -1; // Specify that we don't want to use an index buffer
 	
 	primitive.bounding_radius = sqrtf(half_size.x * half_size.x + half_size.y * half_size.y + half_size.z * half_size.z);
+	primitive.mesh = new TriangleMesh(vertex_data, 6, primitive.draw_call.vertex_count, NULL, 0);
 
 	return primitive;
 }
@@ -282,6 +284,7 @@ Primitive PrimitiveFactory::CreateSphere(float radius)
 	primitive.draw_call.index_buffer = _render_device->CreateIndexBuffer(primitive.draw_call.vertex_array_object, primitive.draw_call.index_count, index_data);
 	
 	primitive.bounding_radius = radius;
+	primitive.mesh = new TriangleMesh(vertex_data, 6, primitive.draw_call.vertex_count, index_data, primitive.draw_call.index_count);
 
 	return primitive;
 }
@@ -323,6 +326,7 @@ Primitive PrimitiveFactory::CreatePlane(const Vec2& size)
 	primitive.draw_call.index_buffer = -1; // Specify that we don't want to use an index buffer
 
 	primitive.bounding_radius = sqrtf(half_size.x * half_size.x + half_size.y * half_size.y);
+	primitive.mesh = new TriangleMesh(vertex_data, 6, primitive.draw_call.vertex_count, NULL, 0);
 
 	return primitive;
 }
@@ -335,4 +339,7 @@ void PrimitiveFactory::DestroyPrimitive(Primitive& primitive)
 		_render_device->ReleaseHardwareBuffer(primitive.draw_call.index_buffer);
 
 	_render_device->ReleaseVertexArrayObject(primitive.draw_call.vertex_array_object);
+
+	delete primitive.mesh;
+	primitive.mesh = NULL;
 }
@@ -4,12 +4,16 @@
 #include "Material.h"
 
 #include <framework/RenderDevice.h>
+#include <framework/TriangleMesh.h>
 
 /// @brief Struct representing a primitive that can be rendered.
 struct Primitive
 {
 	DrawCall draw_call;
 	float bounding_radius; // Bounding sphere used for intersection testing.
+	TriangleMesh* mesh; // CPU-side copy of the triangles, used for precise picking.
+
+	Primitive() : bounding_radius(0.0f), mesh(NULL) {}
 };
 
 
@@ -1,22 +1,189 @@
 #include <framework/Common.h>
 
 #include "Scene.h"
-#include "App.h"
+#include "Camera.h"
 #include "MatrixStack.h"
+#include "SceneFile.h"
+#include "SceneJournal.h"
+#include "SceneSaver.h"
+#include "SceneGenerator.h"
 
 #include <framework/RenderDevice.h>
 #include <framework/Ray.h>
-#include <framework/Json.h>
-#include <framework/ConfigValue.h>
 
 #include <algorithm>
+#include <float.h>
+#include <set>
 #include <sstream>
-#include <fstream>
+#include <string.h>
+
+namespace scene_internal
+{
+	/// The journal is compacted into a full save once it holds more entries than this, or more entries than there are entities.
+	const uint32_t journal_compact_min_entries = 1024;
+
+	/// Assigns a value, comparing the bytes rather than the values to treat NaN as any other value.
+	/// @return True if the value was changed.
+	template<typename T>
+	bool Assign(T& dst, const T& src)
+	{
+		if(memcmp(&dst, &src, sizeof(T)) == 0)
+			return false;
+		dst = src;
+		return true;
+	}
+
+	/// Entities are kept in the bounding volume tree with this margin, moving an entity less than this
+	///	only requires a check against its current node.
+	const float bounds_margin = 0.5f;
+
+	/// Ray cast callback for AabbTree, finds the entity with the nearest intersection.
+	///	The bounding sphere is tested first, the triangles of the primitive only if the sphere is nearer
+	///	than the nearest hit found so far.
+	struct NearestHit
+	{
+		Vec3 origin;
+		Vec3 ray;
+		Scene::PickResult result;
+
+		NearestHit(const Vec3& o, const Vec3& r) : origin(o), ray(r)
+		{
+			result.entity = NULL;
+		}
+
+		float operator()(void* user_data, float max_distance)
+		{
+			Entity* candidate = (Entity*)user_data;
+
+			// Entities flattened by a zero scale have no volume to hit, and no inverse scale to move the ray by
+			if(candidate->scale.x == 0.0f || candidate->scale.y == 0.0f || candidate->scale.z == 0.0f)
+				return max_distance;
+
+			float radius = Scene::EntityRadius(candidate);
+
+			float distance;
+			if(!RaySphereIntersect(origin, ray, candidate->position, radius, distance) || distance >= max_distance)
+				return max_distance;
+
+			const TriangleMesh* mesh = candidate->primitive.mesh;
+			if(!mesh)
+			{
+				// Nothing more precise than the bounding sphere
+				result.entity = candidate;
+				result.distance = distance;
+				result.triangle = 0;
+				result.point = origin + ray * distance;
+				return distance;
+			}
+
+			// The ray is moved into object space rather than moving every triangle into world space, undoing
+			//	the translation, scaling and rotation of RenderEntity in reverse order. The direction isn't
+			//	renormalized, that way distances along it are the same in both spaces.
+			Quat inv_orientation = quat::Conjugate(candidate->Orientation());
+			Vec3 inv_scale(1.0f / candidate->scale.x, 1.0f / candidate->scale.y, 1.0f / candidate->scale.z);
+
+			Vec3 local_origin = origin - candidate->position;
+			local_origin = quat::Rotate(inv_orientation, Vec3(local_origin.x * inv_scale.x, local_origin.y * inv_scale.y, local_origin.z * inv_scale.z));
+			Vec3 local_ray = quat::Rotate(inv_orientation, Vec3(ray.x * inv_scale.x, ray.y * inv_scale.y, ray.z * inv_scale.z));
+
+			TriangleMesh::RayHit hit;
+			if(!mesh->RayCast(local_origin, local_ray, max_distance, hit))
+				return max_distance;
+
+			result.entity = candidate;
+			result.distance = hit.distance;
+			result.triangle = hit.triangle;
+			result.point = origin + ray * hit.distance;
+			return hit.distance;
+		}
+	};
+
+	/// Cell size of the spatial hash, about the size of a light (See Light::radius).
+	const float spatial_cell_size = 8.0f;
+
+	/// Query callback for SpatialHash, collects all entities found.
+	struct CollectEntities
+	{
+		std::vector<Entity*>& entities;
+
+		CollectEntities(std::vector<Entity*>& e) : entities(e) {}
+
+		bool operator()(void* user_data)
+		{
+			entities.push_back((Entity*)user_data);
+			return true;
+		}
+	};
+
+	/// Frustum query callback for AabbTree. Entities with tree bounds completely inside the frustum are visible,
+	///	the bounding spheres of the rest are collected for a batched test (See frustum::CullSpheres).
+	struct CollectVisible
+	{
+		std::vector<Entity*>& visible;
+		std::vector<Entity*> candidates;
+		std::vector<float> x, y, z, radius;
+
+		CollectVisible(std::vector<Entity*>& v) : visible(v) {}
+
+		bool operator()(void* user_data, bool inside)
+		{
+			Entity* entity = (Entity*)user_data;
+			if(inside)
+			{
+				visible.push_back(entity);
+				return true;
+			}
+
+			candidates.push_back(entity);
+			x.push_back(entity->position.x);
+			y.push_back(entity->position.y);
+			z.push_back(entity->position.z);
+			radius.push_back(Scene::EntityRadius(entity));
+			return true;
+		}
+	};
+
+	/// Resolution of the occlusion buffer (See Scene::CullOccludedEntities), the width needs to be a multiple of 4.
+	const uint32_t occlusion_buffer_width = 256;
+	const uint32_t occlusion_buffer_height = 128;
+
+	/// Cubes are only used as occluders if their bounding radius is at least this large relative to their distance
+	///	from the camera, smaller cubes cost about as much to rasterize as they save.
+	const float min_occluder_size = 0.05f;
+
+	/// Predicate for finding entities within a set.
+	struct IsInSet
+	{
+		const std::set<Entity*>& _set;
+
+		IsInSet(const std::set<Entity*>& set) : _set(set) {}
+
+		bool operator() (Entity* entity) const
+		{
+			return _set.find(entity) != _set.end();
+		}
+	};
+};
 
 Scene::Scene(const Material& material, PrimitiveFactory* factory) 
-	: _primitive_factory(factory),
-	_material_template(material)
+	: _hovered_entity(NULL),
+	_tree(scene_internal::bounds_margin),
+	_spatial_hash(scene_internal::spatial_cell_size),
+	_occlusion_buffer(scene_internal::occlusion_buffer_width, scene_internal::occlusion_buffer_height),
+	_occlusion_culling(true),
+	_primitive_factory(factory),
+	_material_template(material),
+	_next_entity_id(1),
+	_journal_entry_count(0),
+	_journal_invalid(false),
+	_generation(0)
 {
+	// All entities of the same type share the same primitive
+	_primitives[Entity::ET_PYRAMID] = _primitive_factory->CreatePyramid(Vec3(1.0f, 1.0f, 1.0f));
+	_primitives[Entity::ET_CUBE] = _primitive_factory->CreateCube(Vec3(1.0f, 1.0f, 1.0f));
+	_primitives[Entity::ET_SPHERE] = _primitive_factory->CreateSphere(0.5f);
+	_primitives[Entity::ET_LIGHT] = _primitive_factory->CreateSphere(0.25f);
+
 	// Create a floor
 	_floor_entity = new Entity;
 	_floor_entity->primitive = _primitive_factory->CreatePlane(Vec2(25.0f, 25.0f));
@@ -31,73 +198,143 @@ Scene::~Scene()
 	// Destroy remaning entities
 	DestroyAllEntities();
 	// Destroy the floor
+	_primitive_factory->DestroyPrimitive(_floor_entity->primitive);
 	delete _floor_entity;
 	_floor_entity = NULL;
+
+	for(int i = 0; i <= Entity::ET_LIGHT; ++i)
+	{
+		_primitive_factory->DestroyPrimitive(_primitives[i]);
+	}
 }
 
-struct EntityDepthSort
+bool Scene::Pick(const Vec2& mouse_position, const Camera& camera, PickResult& result)
 {
-	const Camera& _camera;
+	Vec3 ray = camera.PickRay(mouse_position);
 
-	EntityDepthSort(const Camera& camera) : _camera(camera) {}
+	// The tree visits entities front to back and skips anything behind the nearest hit found so far
+	scene_internal::NearestHit hit(camera.position, ray);
+	_tree.RayCast(camera.position, ray, FLT_MAX, hit);
+	if(!hit.result.entity)
+		return false;
+
+	result = hit.result;
+	return true;
+}
+Entity* Scene::SelectEntity(const Vec2& mouse_position, const Camera& camera)
+{
+	PickResult result;
+	if(!Pick(mouse_position, camera, result))
+		return NULL;
 
-	bool operator() (Entity* ent1, Entity* ent2) 
+	return result.entity;
+}
+void Scene::HoverEntity(const Vec2& mouse_position, const Camera& camera)
+{
+	PickResult result;
+	_hovered_entity = Pick(mouse_position, camera, result) ? result.entity : NULL;
+}
+void Scene::ClearHover()
+{
+	_hovered_entity = NULL;
+}
+void Scene::EntitiesInRadius(const Vec3& center, float radius, std::vector<Entity*>& entities) const
+{
+	entities.clear();
+	scene_internal::CollectEntities collect(entities);
+	_spatial_hash.QueryRadius(center, radius, collect);
+}
+void Scene::EntitiesInRect(const Vec2& min, const Vec2& max, std::vector<Entity*>& entities) const
+{
+	entities.clear();
+	scene_internal::CollectEntities collect(entities);
+	_spatial_hash.QueryRect(min, max, collect);
+}
+void Scene::NearestEntities(const Vec3& position, uint32_t count, std::vector<Entity*>& entities) const
+{
+	std::vector<void*> nearest;
+	_spatial_hash.QueryNearest(position, count, nearest);
+
+	entities.clear();
+	for(size_t i = 0; i < nearest.size(); ++i)
+		entities.push_back((Entity*)nearest[i]);
+}
+void Scene::VisibleEntities(const Camera& camera, std::vector<Entity*>& entities) const
+{
+	entities.clear();
+	scene_internal::CollectVisible collect(entities);
+	_tree.QueryFrustum(camera.frustum, collect);
+
+	uint32_t count = (uint32_t)collect.candidates.size();
+	if(!count)
+		return;
+
+	std::vector<uint32_t> visible(count);
+	uint32_t visible_count = frustum::CullSpheres(camera.frustum, &collect.x[0], &collect.y[0], &collect.z[0], &collect.radius[0],
+		count, &visible[0]);
+	for(uint32_t i = 0; i < visible_count; ++i)
+		entities.push_back(collect.candidates[visible[i]]);
+}
+void Scene::CullOccludedEntities(const Camera& camera, std::vector<Entity*>& entities)
+{
+	using namespace scene_internal;
+
+	_occlusion_buffer.Begin(matrix::Multiply(camera.projection_matrix, camera.view_matrix));
+
+	// Only cubes are used as occluders, as the bounding box of a cube is the cube itself. The bounding
+	//	boxes of the other primitives extend outside of them, which would hide things that are visible.
+	for(size_t i = 0; i < entities.size(); ++i)
 	{
-		float d1 = vector::Length(vector::Subtract(ent1->position, _camera.position));
-		float d2 = vector::Length(vector::Subtract(ent2->position, _camera.position));
-		
-		return (d1 < d2);
+		Entity* entity = entities[i];
+		if(entity->type != Entity::ET_CUBE || entity->material.shader == -1 || !entity->primitive.mesh)
+			continue;
+
+		float radius = EntityRadius(entity);
+		if(radius < min_occluder_size * vector::Length(entity->position - camera.position))
+			continue;
+
+		_occlusion_buffer.AddOccluder(EntityTransform(entity), entity->primitive.mesh->Bounds());
 	}
-};
+	if(!_occlusion_buffer.OccluderCount())
+		return;
 
-Entity* Scene::SelectEntity(const Vec2& mouse_position, const Camera& camera)
-{
-	// Make sure entities are sorted by depth, this way the select will always chose the closest possible entity.
-	std::sort(_entities.begin(), _entities.end(), EntityDepthSort(camera));
-
-	// Ray in clip-space
-	Vec4 ray_clip = Vec4(mouse_position.x, mouse_position.y, -1.0f, 1.0f); 
-	
-	// Transform ray into view-space
-	Vec4 ray_view = matrix::Multiply(matrix::Inverse(camera.projection_matrix), ray_clip);
-	ray_view = Vec4(ray_view.x, ray_view.y, -1.0f, 0.0f);
-
-	// Transform ray into world-space
-	Mat4x4 view = matrix::LookAt(camera.position, vector::Add(camera.position, camera.direction), Vec3(0.0f, 1.0f, 0.0f)); // Build the view matrix
-	
-	Vec4 ray_world = matrix::Multiply(matrix::Inverse(view), ray_view);
-	vector::Normalize(ray_world);
-	
-	for(std::vector<Entity*>::iterator it = _entities.begin(); 
-		it != _entities.end(); ++it)
+	_occlusion_buffer.Finish();
+
+	std::vector<Entity*>::iterator dst = entities.begin();
+	for(std::vector<Entity*>::iterator it = entities.begin(); it != entities.end(); ++it)
 	{
-		float radius = std::max(std::max((*it)->scale.x, (*it)->scale.y), (*it)->scale.z) * (*it)->primitive.bounding_radius; // Scale bounding radius
-		if(RaySphereIntersect(camera.position, Vec3(ray_world.x, ray_world.y, ray_world.z), (*it)->position, radius))
-		{
-			return (*it);
-		}
+		Entity* entity = *it;
+		bool visible;
+		if(entity->primitive.mesh)
+			visible = _occlusion_buffer.TestBox(EntityTransform(entity), entity->primitive.mesh->Bounds());
+		else
+			visible = _occlusion_buffer.TestBox(matrix::CreateIdentity(), EntityBounds(entity));
+
+		if(visible)
+			*dst++ = entity;
 	}
-	return NULL;
+	entities.erase(dst, entities.end());
+}
+void Scene::SetOcclusionCulling(bool enabled)
+{
+	_occlusion_culling = enabled;
+}
+bool Scene::OcclusionCulling() const
+{
+	return _occlusion_culling;
 }
 Vec3 Scene::ToWorld(const Vec2& mouse_position, const Camera& camera, float height)
 {
-	// Ray in clip-space
-	Vec4 ray_clip = Vec4(mouse_position.x, mouse_position.y, -1.0f, 1.0f); 
-	
-	// Transform ray into view-space
-	Vec4 ray_view = matrix::Multiply(matrix::Inverse(camera.projection_matrix), ray_clip);
-	ray_view = Vec4(ray_view.x, ray_view.y, -1.0f, 0.0f);
+	Vec3 ray = camera.PickRay(mouse_position);
 
-	// Transform ray into world-space
-	Mat4x4 view = matrix::LookAt(camera.position, vector::Add(camera.position, camera.direction), Vec3(0.0f, 1.0f, 0.0f)); // Build the view matrix
-	
-	Vec4 ray_world = matrix::Multiply(matrix::Inverse(view), ray_view);
-	vector::Normalize(ray_world);
-
-	return RayPlaneIntersect(camera.position, Vec3(ray_world.x, ray_world.y, ray_world.z), Vec3(0.0f, 1.0f, 0.0f), -height);
+	return RayPlaneIntersect(camera.position, ray, Vec3(0.0f, 1.0f, 0.0f), -height);
 }
 
 Entity* Scene::CreateEntity(Entity::EntityType type)
+{
+	return CreateEntity(type, _next_entity_id++);
+}
+Entity* Scene::CreateEntity(Entity::EntityType type, uint32_t id)
 {
 	Entity* entity = NULL;
 	if(type == Entity::ET_LIGHT)
@@ -110,32 +347,16 @@ Entity* Scene::CreateEntity(Entity::EntityType type)
 		entity = new Entity;
 	}
 	entity->type = type;
+	entity->id = id;
 
-	switch(type)
-	{
-	case Entity::ET_PYRAMID:
-		{
-			entity->primitive = _primitive_factory->CreatePyramid(Vec3(1.0f, 1.0f, 1.0f));
-		}
-		break;
-	case Entity::ET_CUBE:
-		{
-			entity->primitive = _primitive_factory->CreateCube(Vec3(1.0f, 1.0f, 1.0f));
-		}
-		break;
-	case Entity::ET_SPHERE:
-		{
-			entity->primitive = _primitive_factory->CreateSphere(0.5f);
-		}
-		break;
-	case Entity::ET_LIGHT:
-		{
-			entity->primitive = _primitive_factory->CreateSphere(0.25f);
-		}
-		break;
-	default:
-		assert(false);
-	};
+	if(id >= _next_entity_id)
+		_next_entity_id = id + 1;
+
+	_pending_changes[id].entity = entity;
+	_pending_changes[id].changes = CHANGE_CREATED;
+
+	assert(type >= Entity::ET_PYRAMID && type <= Entity::ET_LIGHT);
+	entity->primitive = _primitives[type];
 
 	entity->position = Vec3(0.0f, 0.0f, 0.0f);
 	entity->rotation = Vec3(0.0f, 0.0f, 0.0f);
@@ -143,6 +364,8 @@ Entity* Scene::CreateEntity(Entity::EntityType type)
 	entity->material = _material_template;
 
 	_entities.push_back(entity);
+	entity->tree_proxy = _tree.Insert(EntityBounds(entity), entity);
+	entity->hash_proxy = _spatial_hash.Insert(entity->position, EntityRadius(entity), entity);
 
 	if(type == Entity::ET_LIGHT)
 	{
@@ -177,6 +400,18 @@ Entity* Scene::CreateEntity(Entity::EntityType type)
 }
 void Scene::DestroyEntity(Entity* entity)
 {
+	// Entities that were never saved can be forgotten about completely
+	PendingChange& change = _pending_changes[entity->id];
+	if(change.changes & CHANGE_CREATED)
+	{
+		_pending_changes.erase(entity->id);
+	}
+	else
+	{
+		change.entity = NULL;
+		change.changes = CHANGE_DESTROYED;
+	}
+
 	if(entity->type == Entity::ET_LIGHT)
 	{
 		std::vector<Light*>::iterator it = std::find(_lights.begin(), _lights.end(), entity);
@@ -184,9 +419,14 @@ void Scene::DestroyEntity(Entity* entity)
 			_lights.erase(it);
 	}
 
+	if(entity == _hovered_entity)
+		_hovered_entity = NULL;
+
 	std::vector<Entity*>::iterator it = std::find(_entities.begin(), _entities.end(), entity);
 	if(it != _entities.end())
 	{
+		_tree.Remove(entity->tree_proxy);
+		_spatial_hash.Remove(entity->hash_proxy);
 		delete (*it);
 		_entities.erase(it);
 	}
@@ -196,23 +436,67 @@ void Scene::DestroyEntity(Entity* entity)
 void Scene::DestroyAllEntities()
 {
 	_lights.clear();
+	_hovered_entity = NULL;
 
 	for(std::vector<Entity*>::iterator it = _entities.begin(); 
 		it != _entities.end(); ++it)
 	{
+		PendingChange& change = _pending_changes[(*it)->id];
+		if(change.changes & CHANGE_CREATED)
+		{
+			_pending_changes.erase((*it)->id);
+		}
+		else
+		{
+			change.entity = NULL;
+			change.changes = CHANGE_DESTROYED;
+		}
+
 		delete (*it);
 	}
 	_entities.clear();
+	_tree.Clear();
+	_spatial_hash.Clear();
+}
+void Scene::NotifyEntityChanged(Entity* entity, uint32_t changes)
+{
+	PendingChange& change = _pending_changes[entity->id];
+	change.entity = entity;
+	change.changes |= changes;
+
+	if(changes & CHANGE_TRANSFORM)
+		UpdateBounds(entity);
+}
+float Scene::EntityRadius(const Entity* entity)
+{
+	return std::max(std::max(entity->scale.x, entity->scale.y), entity->scale.z) * entity->primitive.bounding_radius;
+}
+Aabb Scene::EntityBounds(const Entity* entity) const
+{
+	return aabb::FromSphere(entity->position, EntityRadius(entity));
+}
+void Scene::UpdateBounds(Entity* entity)
+{
+	_tree.Update(entity->tree_proxy, EntityBounds(entity));
+	_spatial_hash.Update(entity->hash_proxy, entity->position, EntityRadius(entity));
+}
+Mat4x4 Scene::EntityTransform(Entity* entity) const
+{
+	return matrix::Multiply(matrix::CreateTranslation(entity->position),
+		matrix::Multiply(matrix::CreateScaling(entity->scale), quat::ToMatrix(entity->Orientation())));
 }
 
-void Scene::Render(RenderDevice& device, MatrixStack& matrix_stack)
+void Scene::Render(RenderDevice& device, MatrixStack& matrix_stack, const Camera& camera)
 {
 	// Render floor
 	RenderEntity(device, matrix_stack, _floor_entity);
 
-	// Render the rest of the entities
-	for(std::vector<Entity*>::iterator it = _entities.begin(); 
-		it != _entities.end(); ++it)
+	// Render the rest of the entities, skipping the ones outside the view or hidden behind others
+	VisibleEntities(camera, _visible_entities);
+	if(_occlusion_culling)
+		CullOccludedEntities(camera, _visible_entities);
+	for(std::vector<Entity*>::iterator it = _visible_entities.begin(); 
+		it != _visible_entities.end(); ++it)
 	{
 		RenderEntity(device, matrix_stack, *it);
 	}
@@ -226,6 +510,12 @@ void Scene::BindMaterialUniforms(RenderDevice& device, Entity* entity)
 		// Change the color of the entity to mark it as selected.
 		device.SetUniform4f("material.ambient",  Vec4(0.75f, 0.0f, 0.0f, 1.0f));
 	}
+	else if(entity == _hovered_entity)
+	{
+		// Brighten the entity under the mouse slightly
+		device.SetUniform4f("material.ambient",  Vec4(	entity->material.ambient.r + 0.25f, entity->material.ambient.g + 0.25f, 
+													entity->material.ambient.b + 0.25f, entity->material.ambient.a));
+	}
 	else
 	{
 		device.SetUniform4f("material.ambient",  Vec4(	entity->material.ambient.r, entity->material.ambient.g, 
@@ -294,7 +584,7 @@ void Scene::RenderEntity(RenderDevice& device, MatrixStack& matrix_stack, Entity
 		// Transform object
 		matrix_stack.Translate3f(entity->position);
 		matrix_stack.Scale3f(entity->scale);
-		matrix_stack.Rotate3f(entity->rotation.x, entity->rotation.y, entity->rotation.z);
+		matrix_stack.Rotate(entity->Orientation()); // Cached, no trigonometry unless the rotation has changed
 
 		// Apply transformations to pipeline
 		matrix_stack.Apply(device);
@@ -307,204 +597,396 @@ void Scene::RenderEntity(RenderDevice& device, MatrixStack& matrix_stack, Entity
 }
 bool Scene::LoadScene(const char* filename)
 {
-	// Clear previous scene first
-	DestroyAllEntities();
+	SceneData data;
+	if(!scene_file::Load(filename, data))
+	{
+		// Clear previous scene anyway
+		DestroyAllEntities();
+		_pending_changes.clear();
+		_next_entity_id = 1;
+		return false;
+	}
+
+	// Apply any changes saved after the last full save
+	uint32_t entry_count = 0;
+	bool journal_valid = SceneJournal::Replay(SceneJournal::JournalFilename(filename).c_str(), data, entry_count);
+	data.AssignIds();
+
+	BeginIntegrate(data, entry_count, journal_valid);
+	Integrate(data);
+
+	// Changes appended after a broken journal entry would never be replayed, so start over with a full save
+	if(!journal_valid)
+		SaveScene(filename);
+
+	return true;
+}
+bool Scene::SaveScene(const char* filename)
+{
+	SceneData data;
+	Snapshot(data);
+	data.generation = SceneJournal::NewGeneration();
+
+	if(!scene_file::Save(filename, data))
+		return false;
+
+	// The snapshot includes everything in the journal. A journal that can't be removed is never replayed as its
+	//	generation no longer matches, but it can't be appended to either, so the next save is a full save again.
+	_generation = data.generation;
+	_pending_changes.clear();
+	_journal_entry_count = 0;
+	_journal_invalid = !SceneJournal::Remove(SceneJournal::JournalFilename(filename).c_str());
+	return true;
+}
+bool Scene::SaveChanges(const char* filename)
+{
+	if(_pending_changes.empty() && !_journal_invalid)
+		return true;
+
+	if(JournalNeedsCompaction())
+		return SaveScene(filename);
+
+	SceneJournal journal;
+	CollectChanges(journal);
+
+	uint32_t entry_count = journal.PendingCount();
+	if(!journal.Append(SceneJournal::JournalFilename(filename).c_str(), _generation))
+		return false;
+
+	_pending_changes.clear();
+	_journal_entry_count += entry_count;
+	return true;
+}
+void Scene::GenerateScene(const scene_generator::Params& params)
+{
+	scene_generator::Params scene_params = params;
+	scene_params.light_count = std::min(params.light_count, (uint32_t)MAX_LIGHT_COUNT);
 
-	std::ifstream ifs;
-	ifs.open(filename, std::ifstream::in);
+	SceneData data;
+	scene_generator::Generate(scene_params, data);
 
-	if(ifs.is_open())
+	// None of the generated entities are saved, an invalid journal makes sure the next save includes them all
+	BeginIntegrate(data, 0, false);
+	Integrate(data);
+}
+void Scene::SaveSceneAsync(const char* filename, SceneSaver& saver)
+{
+	// Only the snapshot is taken here, everything else happens on the saver thread
+	SceneData data;
+	Snapshot(data);
+	data.generation = SceneJournal::NewGeneration();
+	_generation = data.generation;
+	saver.SaveSnapshot(filename, data);
+
+	_pending_changes.clear();
+	_journal_entry_count = 0;
+	_journal_invalid = false;
+}
+void Scene::SaveChangesAsync(const char* filename, SceneSaver& saver)
+{
+	if(_pending_changes.empty() && !_journal_invalid)
+		return;
+
+	if(JournalNeedsCompaction())
 	{
-		// Read complete file into memory
-		ifs.seekg(0, ifs.end);
-		int length = (int)ifs.tellg();
-		ifs.seekg(0, ifs.beg);
+		SaveSceneAsync(filename, saver);
+		return;
+	}
 
-		std::string buffer;
-		buffer.resize(length);
-		ifs.read(&buffer[0], length);
-		ifs.close();
+	SceneJournal journal;
+	CollectChanges(journal);
+	saver.AppendJournal(filename, journal, _generation);
+
+	_pending_changes.clear();
+	_journal_entry_count += journal.PendingCount();
+}
+void Scene::AsyncSaveFailed()
+{
+	// The changes in the failed save are no longer pending, only a full save is guaranteed to include them
+	_journal_invalid = true;
+}
+bool Scene::JournalNeedsCompaction() const
+{
+	if(_journal_invalid)
+		return true;
 
-		ConfigValue scene;
+	uint32_t compact_limit = std::max(scene_internal::journal_compact_min_entries, (uint32_t)_entities.size());
+	return (_journal_entry_count + _pending_changes.size() > compact_limit);
+}
+void Scene::CollectChanges(SceneJournal& journal) const
+{
+	for(std::map<uint32_t, PendingChange>::const_iterator it = _pending_changes.begin();
+		it != _pending_changes.end(); ++it)
+	{
+		uint32_t id = it->first;
+		const PendingChange& change = it->second;
+		if(change.changes & CHANGE_DESTROYED)
+		{
+			journal.EntityDestroyed(id);
+			continue;
+		}
 
-		// Read scene from json
-		json::Reader reader;
-		reader.Read(buffer.c_str(), length, scene);
+		EntityRecord entity_record;
+		TransformRecord transform;
+		MaterialRecord material;
+		LightRecord light;
+		SnapshotEntity(change.entity, entity_record, transform, material, light);
 
-		// Parse scene
-		ConfigValue& entities = scene["entities"];
-		if(entities.IsArray())
+		if(change.changes & CHANGE_CREATED)
 		{
-			for(uint32_t i = 0; i < entities.Size(); ++i)
-			{
-				ConfigValue& entity_node = entities[i];
-				Entity::EntityType type = (Entity::EntityType)entity_node["type"].AsInt();
+			journal.EntityCreated(id, entity_record, transform, material, light);
+			continue;
+		}
+		if(change.changes & CHANGE_TRANSFORM)
+			journal.TransformChanged(id, transform);
+		if(change.changes & CHANGE_MATERIAL)
+			journal.MaterialChanged(id, material);
+		if((change.changes & CHANGE_LIGHT) && entity_record.light != EntityRecord::NO_LIGHT)
+			journal.LightChanged(id, light);
+	}
+}
+void Scene::Snapshot(SceneData& data) const
+{
+	Snapshot(_entities, data);
+}
+void Scene::Snapshot(const std::vector<Entity*>& entities, SceneData& data) const
+{
+	uint32_t count = (uint32_t)entities.size();
 
-				Entity* entity = CreateEntity(type);
+	data.Clear();
+	data.ids.resize(count);
+	data.entities.resize(count);
+	data.transforms.resize(count);
+	data.materials.resize(count);
 
-				// Transform
-				
-				entity->rotation.x = entity_node["rotation"][0].AsFloat();
-				entity->rotation.y = entity_node["rotation"][1].AsFloat();
-				entity->rotation.z = entity_node["rotation"][2].AsFloat();
-		
-				entity->position.x = entity_node["position"][0].AsFloat();
-				entity->position.y = entity_node["position"][1].AsFloat();
-				entity->position.z = entity_node["position"][2].AsFloat();
-		
-				entity->scale.x = entity_node["scale"][0].AsFloat();
-				entity->scale.y = entity_node["scale"][1].AsFloat();
-				entity->scale.z = entity_node["scale"][2].AsFloat();
-
-				// Material
-				entity->material = _material_template;
-
-				ConfigValue& material = entity_node["material"];
-				if(material.IsObject())
-				{
-					entity->material.ambient.r = material["ambient"][0].AsFloat();
-					entity->material.ambient.g = material["ambient"][1].AsFloat();
-					entity->material.ambient.b = material["ambient"][2].AsFloat();
-					entity->material.ambient.a = material["ambient"][3].AsFloat();
-		
-					entity->material.specular.r = material["specular"][0].AsFloat();
-					entity->material.specular.g = material["specular"][1].AsFloat();
-					entity->material.specular.b = material["specular"][2].AsFloat();
-					entity->material.specular.a = material["specular"][3].AsFloat();
-					
-					entity->material.diffuse.r = material["diffuse"][0].AsFloat();
-					entity->material.diffuse.g = material["diffuse"][1].AsFloat();
-					entity->material.diffuse.b = material["diffuse"][2].AsFloat();
-					entity->material.diffuse.a = material["diffuse"][3].AsFloat();
-				}
-
-				if(type == Entity::ET_LIGHT)
-				{
-					Light* light = (Light*)entity;
-
-					// Light paramters
-					ConfigValue& light_node = entity_node["light"];
-					if(light_node.IsObject())
-					{
-						light->ambient.r = light_node["ambient"][0].AsFloat();
-						light->ambient.g = light_node["ambient"][1].AsFloat();
-						light->ambient.b = light_node["ambient"][2].AsFloat();
-						light->ambient.a = light_node["ambient"][3].AsFloat();
-		
-						light->specular.r = light_node["specular"][0].AsFloat();
-						light->specular.g = light_node["specular"][1].AsFloat();
-						light->specular.b = light_node["specular"][2].AsFloat();
-						light->specular.a = light_node["specular"][3].AsFloat();
-					
-						light->diffuse.r = light_node["diffuse"][0].AsFloat();
-						light->diffuse.g = light_node["diffuse"][1].AsFloat();
-						light->diffuse.b = light_node["diffuse"][2].AsFloat();
-						light->diffuse.a = light_node["diffuse"][3].AsFloat();
-					
-						light->radius = light_node["radius"].AsFloat();
-					}
-
-				}
-				
-			}
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		const Entity* entity = entities[i];
+		data.ids[i] = entity->id;
+
+		LightRecord light;
+		SnapshotEntity(entity, data.entities[i], data.transforms[i], data.materials[i], light);
+
+		if(data.entities[i].light != EntityRecord::NO_LIGHT)
+		{
+			data.entities[i].light = (uint32_t)data.lights.size();
+			data.lights.push_back(light);
 		}
+	}
+}
+void Scene::SnapshotEntity(const Entity* entity, EntityRecord& entity_record, TransformRecord& transform,
+	MaterialRecord& material, LightRecord& light) const
+{
+	entity_record.type = entity->type;
+	entity_record.flags = EntityRecord::HAS_MATERIAL;
+	entity_record.light = EntityRecord::NO_LIGHT;
 
-		return true;
+	transform.rotation = entity->rotation;
+	transform.position = entity->position;
+	transform.scale = entity->scale;
+
+	material.ambient = entity->material.ambient;
+	material.specular = entity->material.specular;
+	material.diffuse = entity->material.diffuse;
+
+	if(entity->type == Entity::ET_LIGHT)
+	{
+		const Light* l = (const Light*)entity;
+
+		light.ambient = l->ambient;
+		light.diffuse = l->diffuse;
+		light.specular = l->specular;
+		light.radius = l->radius;
+
+		entity_record.light = 0; // Index is assigned by the caller
 	}
-	else
+}
+void Scene::BeginIntegrate(const SceneData& data, uint32_t journal_entry_count, bool journal_valid)
+{
+	// Clear previous scene first
+	DestroyAllEntities();
+	_pending_changes.clear();
+
+	// New entities created while integrating must not collide with the loaded ones
+	_next_entity_id = 1;
+	for(uint32_t i = 0; i < data.ids.size(); ++i)
 	{
-		debug::Printf("Scene: No file with the name '%s' found.\n", filename);
-		return false;
+		if(data.ids[i] >= _next_entity_id)
+			_next_entity_id = data.ids[i] + 1;
 	}
+	if(data.ids.empty())
+		_next_entity_id = data.Size() + 1;
+
+	_journal_entry_count = journal_entry_count;
+	_journal_invalid = !journal_valid;
+	_generation = data.generation;
 }
-void Scene::SaveScene(const char* filename)
+void Scene::Integrate(const SceneData& data)
 {
-	ConfigValue scene;
-	scene.SetEmptyObject();
+	Integrate(data, 0, data.Size());
+}
+void Scene::Integrate(const SceneData& data, uint32_t begin, uint32_t end)
+{
+	for(uint32_t i = begin; i < end; ++i)
+	{
+		const EntityRecord& entity_record = data.entities[i];
+		if(entity_record.type > Entity::ET_LIGHT)
+		{
+			debug::Printf("Scene: Skipping entity with unknown type (%d).\n", entity_record.type);
+			continue;
+		}
+		if(entity_record.type == Entity::ET_LIGHT && _lights.size() >= MAX_LIGHT_COUNT)
+		{
+			debug::Printf("Scene: Skipping light, the scene is limited to %d lights.\n", MAX_LIGHT_COUNT);
+			continue;
+		}
 
-	ConfigValue& entities = scene["entities"];
-	entities.SetEmptyArray();
+		// Entities without stored IDs get the same IDs as SceneData::AssignIds would give them
+		uint32_t id = data.ids.empty() ? i + 1 : data.ids[i];
+		Entity* entity = CreateEntity((Entity::EntityType)entity_record.type, id);
 
-	// Fill a ConfigValue with a representation of our scene
-	for(std::vector<Entity*>::iterator it = _entities.begin(); 
-		it != _entities.end(); ++it)
+		// The entity is already in the saved scene
+		_pending_changes.erase(id);
+
+		entity->material = _material_template;
+		ApplyRecords(entity, data, i);
+		UpdateBounds(entity);
+	}
+}
+bool Scene::ApplyRecords(Entity* entity, const SceneData& data, uint32_t index)
+{
+	using scene_internal::Assign;
+
+	const EntityRecord& entity_record = data.entities[index];
+	bool changed = false;
+
+	// Transform
+	const TransformRecord& transform = data.transforms[index];
+	changed |= Assign(entity->rotation, transform.rotation);
+	changed |= Assign(entity->position, transform.position);
+	changed |= Assign(entity->scale, transform.scale);
+
+	// Material
+	const MaterialRecord* material = &data.materials[index];
+	MaterialRecord material_template;
+	if(!(entity_record.flags & EntityRecord::HAS_MATERIAL))
 	{
-		ConfigValue& entity = entities.Append();
-		entity.SetEmptyObject();
-		entity["type"].SetInt((*it)->type);
+		material_template.ambient = _material_template.ambient;
+		material_template.specular = _material_template.specular;
+		material_template.diffuse = _material_template.diffuse;
+		material = &material_template;
+	}
+	changed |= Assign(entity->material.ambient, material->ambient);
+	changed |= Assign(entity->material.specular, material->specular);
+	changed |= Assign(entity->material.diffuse, material->diffuse);
 
-		entity["rotation"].SetEmptyArray();
-		entity["rotation"].Append().SetFloat((*it)->rotation.x);
-		entity["rotation"].Append().SetFloat((*it)->rotation.y);
-		entity["rotation"].Append().SetFloat((*it)->rotation.z);
-		
-		entity["position"].SetEmptyArray();
-		entity["position"].Append().SetFloat((*it)->position.x);
-		entity["position"].Append().SetFloat((*it)->position.y);
-		entity["position"].Append().SetFloat((*it)->position.z);
-		
-		entity["scale"].SetEmptyArray();
-		entity["scale"].Append().SetFloat((*it)->scale.x);
-		entity["scale"].Append().SetFloat((*it)->scale.y);
-		entity["scale"].Append().SetFloat((*it)->scale.z);
-
-		entity["material"].SetEmptyObject();
-		entity["material"]["ambient"].SetEmptyArray();
-		entity["material"]["ambient"].Append().SetFloat((*it)->material.ambient.r);
-		entity["material"]["ambient"].Append().SetFloat((*it)->material.ambient.g);
-		entity["material"]["ambient"].Append().SetFloat((*it)->material.ambient.b);
-		entity["material"]["ambient"].Append().SetFloat((*it)->material.ambient.a);
-		
-		entity["material"]["specular"].SetEmptyArray();
-		entity["material"]["specular"].Append().SetFloat((*it)->material.specular.r);
-		entity["material"]["specular"].Append().SetFloat((*it)->material.specular.g);
-		entity["material"]["specular"].Append().SetFloat((*it)->material.specular.b);
-		entity["material"]["specular"].Append().SetFloat((*it)->material.specular.a);
-
-		entity["material"]["diffuse"].SetEmptyArray();
-		entity["material"]["diffuse"].Append().SetFloat((*it)->material.diffuse.r);
-		entity["material"]["diffuse"].Append().SetFloat((*it)->material.diffuse.g);
-		entity["material"]["diffuse"].Append().SetFloat((*it)->material.diffuse.b);
-		entity["material"]["diffuse"].Append().SetFloat((*it)->material.diffuse.a);
-
-		if((*it)->type == Entity::ET_LIGHT)
-		{
-			Light* light = (Light*)(*it);
-
-			// Additional light parameters
-			entity["light"].SetEmptyObject();
-			entity["light"]["ambient"].SetEmptyArray();
-			entity["light"]["ambient"].Append().SetFloat(light->ambient.r);
-			entity["light"]["ambient"].Append().SetFloat(light->ambient.g);
-			entity["light"]["ambient"].Append().SetFloat(light->ambient.b);
-			entity["light"]["ambient"].Append().SetFloat(light->ambient.a);
-		
-			entity["light"]["specular"].SetEmptyArray();
-			entity["light"]["specular"].Append().SetFloat(light->specular.r);
-			entity["light"]["specular"].Append().SetFloat(light->specular.g);
-			entity["light"]["specular"].Append().SetFloat(light->specular.b);
-			entity["light"]["specular"].Append().SetFloat(light->specular.a);
+	// Light paramters
+	if(entity->type == Entity::ET_LIGHT && entity_record.light != EntityRecord::NO_LIGHT)
+	{
+		Light* light = (Light*)entity;
 
-			entity["light"]["diffuse"].SetEmptyArray();
-			entity["light"]["diffuse"].Append().SetFloat(light->diffuse.r);
-			entity["light"]["diffuse"].Append().SetFloat(light->diffuse.g);
-			entity["light"]["diffuse"].Append().SetFloat(light->diffuse.b);
-			entity["light"]["diffuse"].Append().SetFloat(light->diffuse.a);
+		const LightRecord& light_record = data.lights[entity_record.light];
+		changed |= Assign(light->ambient, light_record.ambient);
+		changed |= Assign(light->diffuse, light_record.diffuse);
+		changed |= Assign(light->specular, light_record.specular);
+		changed |= Assign(light->radius, light_record.radius);
+	}
+	return changed;
+}
+void Scene::Reconcile(const SceneData& data, ReconcileResult& result)
+{
+	result.created = result.updated = result.destroyed = 0;
+
+	// Changes not yet saved now build on the reloaded snapshot
+	_generation = data.generation;
 
-			entity["light"]["radius"].SetFloat(light->radius);
+	std::map<uint32_t, uint32_t> indices; // ID => Index in data
+	for(uint32_t i = 0; i < data.Size(); ++i)
+	{
+		indices[data.ids.empty() ? i + 1 : data.ids[i]] = i;
+	}
+	std::vector<bool> matched(data.Size(), false);
 
+	std::vector<Entity*> removed;
+	for(std::vector<Entity*>::iterator it = _entities.begin(); it != _entities.end(); ++it)
+	{
+		Entity* entity = *it;
+		std::map<uint32_t, uint32_t>::iterator index = indices.find(entity->id);
+
+		// Unsaved changes and the selected entity are left as they are, local edits win over the file
+		if(entity->selected || _pending_changes.find(entity->id) != _pending_changes.end())
+		{
+			if(index != indices.end())
+				matched[index->second] = true;
+			continue;
+		}
+
+		// Entities that changed type are recreated
+		if(index == indices.end() || data.entities[index->second].type != (uint32_t)entity->type)
+		{
+			removed.push_back(entity);
+			continue;
+		}
+
+		matched[index->second] = true;
+		if(ApplyRecords(entity, data, index->second))
+		{
+			UpdateBounds(entity);
+			++result.updated;
 		}
 	}
 
-	std::stringstream ss;
+	UnloadEntities(removed);
+	result.destroyed = (uint32_t)removed.size();
 
-	// Convert to JSON
-	json::Writer writer;
-	writer.Write(scene, ss, true);
+	for(uint32_t i = 0; i < data.Size(); ++i)
+	{
+		// Entities destroyed but not yet saved stay destroyed
+		uint32_t id = data.ids.empty() ? i + 1 : data.ids[i];
+		if(matched[i] || _pending_changes.find(id) != _pending_changes.end())
+			continue;
 
-	// Write to file
-	std::ofstream ofs;
-	ofs.open(filename, std::ofstream::out);
-	ofs << ss.str();
-	ofs.close();
+		Integrate(data, i, i + 1);
+		++result.created;
+	}
+}
+void Scene::UnloadEntities(const std::vector<Entity*>& entities)
+{
+	std::set<Entity*> unload(entities.begin(), entities.end());
+
+	// Remove all in a single pass rather than searching for every entity
+	std::vector<Entity*>::iterator end = std::remove_if(_entities.begin(), _entities.end(), scene_internal::IsInSet(unload));
+	_entities.erase(end, _entities.end());
+
+	std::vector<Light*>::iterator lights_end = std::remove_if(_lights.begin(), _lights.end(), scene_internal::IsInSet(unload));
+	_lights.erase(lights_end, _lights.end());
+
+	for(std::set<Entity*>::iterator it = unload.begin(); it != unload.end(); ++it)
+	{
+		if(*it == _hovered_entity)
+			_hovered_entity = NULL;
+
+		// Any changes are kept wherever the entity was unloaded to
+		_pending_changes.erase((*it)->id);
+		_tree.Remove((*it)->tree_proxy);
+		_spatial_hash.Remove((*it)->hash_proxy);
+		delete (*it);
+	}
+}
+const std::vector<Entity*>& Scene::Entities() const
+{
+	return _entities;
+}
+uint32_t Scene::LightCount() const
+{
+	return (uint32_t)_lights.size();
+}
+void Scene::ReserveEntityIds(uint32_t next_id)
+{
+	if(next_id > _next_entity_id)
+		_next_entity_id = next_id;
+}
+uint32_t Scene::NextEntityId() const
+{
+	return _next_entity_id;
 }
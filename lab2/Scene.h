@@ -3,6 +3,10 @@
 
 #include "PrimitiveFactory.h"
 
+#include <framework/AabbTree.h>
+#include <framework/OcclusionBuffer.h>
+#include <framework/SpatialHash.h>
+
 /// @brief Represents an object in the scene.
 struct Entity
 {
@@ -14,6 +18,7 @@ struct Entity
 		ET_LIGHT
 	};
 	EntityType type;
+	uint32_t id; // Stable ID, unique within the scene and persisted with it.
 
 	Primitive primitive;
 	Material material;
@@ -26,7 +31,26 @@ struct Entity
 
 	bool selected; // Specifies if this entity is currently selected.
 
-	Entity() : rotation(0.0f, 0.0f, 0.0f), position(0.0f, 0.0f, 0.0f), scale(1.0f, 1.0f, 1.0f), selected(false) {}
+	uint32_t tree_proxy; // Proxy in the bounding volume tree of the scene, see Scene::UpdateBounds
+	uint32_t hash_proxy; // Proxy in the spatial hash of the scene, see Scene::UpdateBounds
+
+	Entity() : id(0), rotation(0.0f, 0.0f, 0.0f), position(0.0f, 0.0f, 0.0f), scale(1.0f, 1.0f, 1.0f), selected(false),
+		tree_proxy(AabbTree::NULL_NODE), hash_proxy(SpatialHash::NULL_PROXY), _orientation(quat::CreateIdentity()), _orientation_rotation(0.0f, 0.0f, 0.0f) {}
+
+	/// @return The rotation as a quaternion, only recalculated if rotation has changed since the last call.
+	const Quat& Orientation()
+	{
+		if(rotation.x != _orientation_rotation.x || rotation.y != _orientation_rotation.y || rotation.z != _orientation_rotation.z)
+		{
+			_orientation = quat::CreateRotationXYZ(rotation.x, rotation.y, rotation.z);
+			_orientation_rotation = rotation;
+		}
+		return _orientation;
+	}
+
+private:
+	Quat _orientation; // Cached rotation, see Orientation()
+	Vec3 _orientation_rotation; // The rotation that _orientation was calculated from
 };
 
 /// Point-light
@@ -41,22 +65,90 @@ struct Light : public Entity
 
 
 struct Camera;
+struct SceneData;
+struct EntityRecord;
+struct TransformRecord;
+struct MaterialRecord;
+struct LightRecord;
 class RenderDevice;
 class MatrixStack;
+class SceneJournal;
+class SceneSaver;
+
+namespace scene_generator
+{
+	struct Params;
+};
 
 class Scene
 {
 public:
 	enum { MAX_LIGHT_COUNT = 16 };
 
+	/// Flags for NotifyEntityChanged
+	enum ChangeFlags
+	{
+		CHANGE_TRANSFORM = 1,
+		CHANGE_MATERIAL = 2,
+		CHANGE_LIGHT = 4 // Light parameters, only valid for lights
+	};
+
 	/// @param material Material template that will be used by all new entities.
 	Scene(const Material& material, PrimitiveFactory* factory);
 	~Scene();
 
-	/// @brief Tries to select an entity at the specified mouse position.
+	/// Result from Pick.
+	struct PickResult
+	{
+		Entity* entity; // Entity hit
+		float distance; // Distance from the camera to the point hit
+		uint32_t triangle; // Triangle hit within the primitive of the entity (See TriangleMesh::RayHit)
+		Vec3 point; // Point hit, in world space
+	};
+	/// @brief Finds the nearest entity at the specified mouse position. Candidates are found by their bounds
+	///		and then tested against the actual triangles of their primitive, so only entities visible under
+	///		the mouse are hit. Not const, as it updates the cached orientations of the entities tested (See Entity::Orientation).
+	///		Entities with a zero scale on any axis are never hit.
+	/// @return True if an entity was hit, false if not.
+	bool Pick(const Vec2& mouse_position, const Camera& camera, PickResult& result);
+
+	/// @brief Tries to select an entity at the specified mouse position, picking the nearest entity hit (See Pick).
 	/// @return The entity selected or NULL if no entity was found.
 	Entity* SelectEntity(const Vec2& mouse_position, const Camera& camera);
 
+	/// @brief Highlights the entity at the specified mouse position, if any. Cheap enough to call on every mouse move.
+	void HoverEntity(const Vec2& mouse_position, const Camera& camera);
+	/// @brief Removes the highlight set by HoverEntity.
+	void ClearHover();
+
+	/// @return Radius of the bounding sphere of the entity, the bounding radius of its primitive scaled by its largest scale.
+	static float EntityRadius(const Entity* entity);
+
+	/// @brief Finds all entities with bounding spheres within the specified distance from center on the XZ-plane.
+	void EntitiesInRadius(const Vec3& center, float radius, std::vector<Entity*>& entities) const;
+	/// @brief Finds all entities with bounding spheres overlapping the specified rectangle on the XZ-plane.
+	/// @param min, max Corners of the rectangle, with x and z in Vec2::x and Vec2::y.
+	void EntitiesInRect(const Vec2& min, const Vec2& max, std::vector<Entity*>& entities) const;
+	/// @brief Finds the entities nearest to the specified position on the XZ-plane, measured to their positions.
+	/// @param count Max number of entities to find.
+	/// @param entities Filled with the entities found, nearest first.
+	void NearestEntities(const Vec3& position, uint32_t count, std::vector<Entity*>& entities) const;
+
+	/// @brief Finds all entities with bounding spheres at least partly inside the view frustum of the camera,
+	///		the floor is not included. Entities are found through the bounding volume tree, so the cost
+	///		depends on the number of entities near the frustum rather than the number in the scene.
+	void VisibleEntities(const Camera& camera, std::vector<Entity*>& entities) const;
+	/// @brief Removes the entities hidden behind other entities from the specified set of visible entities
+	///		(See VisibleEntities). The cubes that are large on the screen are rendered into a low-resolution
+	///		depth buffer on the CPU (See OcclusionBuffer), and the bounding boxes of all entities are tested
+	///		against it. Entities are only removed if they're certainly hidden.
+	void CullOccludedEntities(const Camera& camera, std::vector<Entity*>& entities);
+
+	/// @brief Enables or disables occlusion culling when rendering (See CullOccludedEntities), enabled by default.
+	void SetOcclusionCulling(bool enabled);
+	/// @return True if occlusion culling is enabled.
+	bool OcclusionCulling() const;
+
 	/// @brief Converts the specified mouse position to world coordinates.
 	/// @param height Height above the ground.
 	Vec3 ToWorld(const Vec2& mouse_position, const Camera& camera, float height);
@@ -70,14 +162,78 @@ public:
 	/// @brief Destroys all entities in the scene.
 	void DestroyAllEntities();
 
-	/// @brief Renders the scene with the specified device.
-	void Render(RenderDevice& device, MatrixStack& matrix_stack);
+	/// @brief Renders the entities visible from the camera (See VisibleEntities and CullOccludedEntities) with the specified device.
+	void Render(RenderDevice& device, MatrixStack& matrix_stack, const Camera& camera);
 	
-	/// Loads the scene from a file.
+	/// @brief Notifies the scene that the specified entity has been modified, changes that aren't
+	///			notified are not included by SaveChanges. Transform changes also need to be notified
+	///			for picking to see them.
+	/// @param changes Combination of ChangeFlags
+	void NotifyEntityChanged(Entity* entity, uint32_t changes);
+
+	/// Loads the scene from a file, the file format is picked from the file extension (See scene_file).
+	///	Any changes in the journal for the file are replayed on top of it (See SceneJournal).
 	/// @return True if a scene was loaded, false if not.
 	bool LoadScene(const char* filename);
-	/// Saves the scene to a file.
-	void SaveScene(const char* filename);
+	/// Saves the complete scene to a file, the file format is picked from the file extension (See scene_file).
+	///	This replaces the journal for the file.
+	/// @return True if the scene was saved, false if not.
+	bool SaveScene(const char* filename);
+	/// Appends all changes made since the scene was loaded or saved to the journal for the specified scene file.
+	///	Once the journal has grown large it's compacted by saving the complete scene instead.
+	/// @return True if the changes were saved, false if not.
+	bool SaveChanges(const char* filename);
+	/// Replaces the scene with a generated one (See scene_generator), the light count is limited to MAX_LIGHT_COUNT.
+	///	The next save will save the complete scene.
+	void GenerateScene(const scene_generator::Params& params);
+
+	/// Same as SaveScene, but only the snapshot is taken on the calling thread, serialization and writing
+	///	is left to the specified saver. The result is reported through the callback of the saver.
+	void SaveSceneAsync(const char* filename, SceneSaver& saver);
+	/// Same as SaveChanges, but the journal is written by the specified saver (See SaveSceneAsync).
+	void SaveChangesAsync(const char* filename, SceneSaver& saver);
+	/// Notifies the scene that an asynchronous save failed, the next save will then save the complete scene.
+	void AsyncSaveFailed();
+
+	/// Fills the specified records with the current state of all entities in the scene.
+	void Snapshot(SceneData& data) const;
+	/// Fills the specified records with the current state of the specified entities.
+	void Snapshot(const std::vector<Entity*>& entities, SceneData& data) const;
+	/// Clears the scene and prepares it for integrating the specified scene data.
+	/// @param journal_entry_count Number of journal entries replayed on the data.
+	/// @param journal_valid False if the journal was invalid, the next save will then save the complete scene.
+	void BeginIntegrate(const SceneData& data, uint32_t journal_entry_count, bool journal_valid);
+	/// Creates entities for all records in the specified scene data. The entities are considered as saved,
+	///	i.e. they are not included by SaveChanges unless modified.
+	void Integrate(const SceneData& data);
+	/// Creates entities for the records in the range [begin, end), see Integrate. Loading a scene in batches
+	///	allows it to be rendered while loading (See SceneLoader).
+	void Integrate(const SceneData& data, uint32_t begin, uint32_t end);
+	/// Counts from Reconcile.
+	struct ReconcileResult
+	{
+		uint32_t created;
+		uint32_t updated;
+		uint32_t destroyed;
+	};
+	/// Updates the scene to match the specified scene data, matching entities by their IDs. Only fields that
+	///	differ are changed, and entities are only created or destroyed if they were added or removed (or changed
+	///	type). Used for reloading a scene that has been modified by someone else. Entities with unsaved changes
+	///	and the selected entity keep their current state.
+	void Reconcile(const SceneData& data, ReconcileResult& result);
+	/// Removes the specified entities from the scene without recording them as destroyed, used when entities
+	///	are unloaded to be kept elsewhere rather than deleted (See SceneStreamer).
+	void UnloadEntities(const std::vector<Entity*>& entities);
+
+	/// @return All entities currently in the scene.
+	const std::vector<Entity*>& Entities() const;
+	/// @return Number of lights currently in the scene.
+	uint32_t LightCount() const;
+
+	/// Makes sure new entities get IDs no lower than the specified ID, used when parts of the scene are not loaded.
+	void ReserveEntityIds(uint32_t next_id);
+	/// @return The ID the next created entity will get.
+	uint32_t NextEntityId() const;
 
 private:
 	/// Binds material specific shader uniforms.
@@ -87,14 +243,68 @@ private:
 
 	void RenderEntity(RenderDevice& device, MatrixStack& matrix_stack, Entity* entity); 
 
+	Entity* CreateEntity(Entity::EntityType type, uint32_t id);
+
+	/// Bounding box of the bounding sphere of the entity.
+	Aabb EntityBounds(const Entity* entity) const;
+	/// Transform from the space of the primitive of the entity to world-space, the same as applied by RenderEntity.
+	Mat4x4 EntityTransform(Entity* entity) const;
+	/// Updates the bounds of the entity in the bounding volume tree and the spatial hash, needs to be
+	///	called whenever the position or scale of the entity has changed.
+	void UpdateBounds(Entity* entity);
+
+	/// Sets the transform, material and light parameters of an entity from the specified records.
+	/// @return True if anything was changed.
+	bool ApplyRecords(Entity* entity, const SceneData& data, uint32_t index);
+
+	/// Converts an entity into records, light is only filled for lights.
+	void SnapshotEntity(const Entity* entity, EntityRecord& entity_record, TransformRecord& transform,
+		MaterialRecord& material, LightRecord& light) const;
+
+	/// @return True if the pending changes should be saved as a complete scene rather than appended to the journal.
+	bool JournalNeedsCompaction() const;
+	/// Adds journal entries for all pending changes.
+	void CollectChanges(SceneJournal& journal) const;
+
+	enum
+	{
+		// Changes tracked in addition to ChangeFlags
+		CHANGE_CREATED = 8,
+		CHANGE_DESTROYED = 16
+	};
+
+	/// An entity with changes that hasn't been saved yet.
+	struct PendingChange
+	{
+		Entity* entity; // NULL if destroyed
+		uint32_t changes;
+
+		PendingChange() : entity(NULL), changes(0) {}
+	};
+
 	std::vector<Entity*> _entities;
 	Entity* _floor_entity;
 
 	std::vector<Light*> _lights;
+	std::vector<Entity*> _visible_entities; // Entities rendered in the last frame, kept to reuse the memory
+
+	Entity* _hovered_entity; // Entity highlighted by HoverEntity, NULL if none
+
+	AabbTree _tree; // Bounding volume tree of all entities (Except the floor), used for picking and culling
+	SpatialHash _spatial_hash; // All entities (Except the floor) on the XZ-plane, used for neighborhood queries
+	OcclusionBuffer _occlusion_buffer; // Used by CullOccludedEntities
+	bool _occlusion_culling; // See SetOcclusionCulling
 
 	PrimitiveFactory* _primitive_factory;
+	Primitive _primitives[Entity::ET_LIGHT + 1]; // Primitive shared by all entities of each type
 	Material _material_template; // Template material which will be used for all new entities.
 
+	uint32_t _next_entity_id;
+	std::map<uint32_t, PendingChange> _pending_changes; // Entity ID => Changes not yet saved
+	uint32_t _journal_entry_count; // Number of entries in the journal since the last full save
+	bool _journal_invalid; // The journal may be missing changes, e.g. after a failed save
+	uint32_t _generation; // Generation of the last snapshot loaded or saved, which the journal builds on
+
 };
 
 
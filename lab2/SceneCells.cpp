@@ -0,0 +1,146 @@
+#include <framework/Common.h>
+
+#include "SceneCells.h"
+
+#include <framework/ConfigValue.h>
+#include <framework/Json.h>
+#include <framework/FileSystem.h>
+
+#include <sstream>
+#include <stdio.h>
+
+
+scene_cells::CellCoord scene_cells::CellAt(const Vec3& position, float cell_size)
+{
+	return CellCoord((int32_t)floorf(position.x / cell_size), (int32_t)floorf(position.z / cell_size));
+}
+float scene_cells::DistanceToCell(const Vec3& position, const CellCoord& cell, float cell_size)
+{
+	float min_x = cell.x * cell_size;
+	float min_z = cell.z * cell_size;
+
+	// Distance to the closest point, 0 on the axes where the position is within the cell
+	float dx = std::max(std::max(min_x - position.x, position.x - (min_x + cell_size)), 0.0f);
+	float dz = std::max(std::max(min_z - position.z, position.z - (min_z + cell_size)), 0.0f);
+	return sqrtf(dx*dx + dz*dz);
+}
+std::string scene_cells::CellFilename(const char* index_filename, const CellCoord& cell)
+{
+	char suffix[32];
+	sprintf(suffix, ".%d_%d.bin", cell.x, cell.z);
+	return std::string(index_filename) + suffix;
+}
+//-------------------------------------------------------------------------------
+bool scene_cells::ReadIndex(const char* filename, Index& index)
+{
+	file_system::MappedFile file;
+	if(!file.Open(filename))
+		return false;
+
+	ConfigValue root;
+	json::Reader reader;
+	if(!reader.Read(file.Data(), file.Size(), root))
+	{
+		debug::Printf("Scene: Failed to parse cell index '%s': %s\n", filename, reader.GetErrorMessage().c_str());
+		return false;
+	}
+
+	if(!root.IsObject() || !root["cell_size"].IsNumber() || !root["cells"].IsArray() || root["cell_size"].AsFloat() <= 0.0f)
+	{
+		debug::Printf("Scene: '%s' is not a valid cell index.\n", filename);
+		return false;
+	}
+
+	index.cell_size = root["cell_size"].AsFloat();
+	index.next_id = root["next_id"].IsNumber() ? root["next_id"].AsUInt() : 1;
+	index.cells.clear();
+
+	ConfigValue& cells = root["cells"];
+	for(uint32_t i = 0; i < cells.Size(); ++i)
+	{
+		ConfigValue& cell = cells[i];
+		if(!cell.IsArray() || cell.Size() < 3 || !cell[0].IsNumber() || !cell[1].IsNumber() || !cell[2].IsNumber())
+		{
+			debug::Printf("Scene: Skipping invalid cell in '%s'.\n", filename);
+			continue;
+		}
+		index.cells[CellCoord(cell[0].AsInt(), cell[1].AsInt())] = cell[2].AsUInt();
+	}
+	return true;
+}
+bool scene_cells::WriteIndex(const char* filename, const Index& index)
+{
+	ConfigValue root;
+	root.SetEmptyObject();
+	root["cell_size"].SetFloat(index.cell_size);
+	root["next_id"].SetUInt(index.next_id);
+
+	ConfigValue& cells = root["cells"];
+	cells.SetEmptyArray();
+	for(std::map<CellCoord, uint32_t>::const_iterator it = index.cells.begin();
+		it != index.cells.end(); ++it)
+	{
+		ConfigValue& cell = cells.Append();
+		cell.SetEmptyArray();
+		cell.Append().SetInt(it->first.x);
+		cell.Append().SetInt(it->first.z);
+		cell.Append().SetUInt(it->second);
+	}
+
+	std::stringstream ss;
+	json::Writer writer;
+	writer.Write(root, ss, true);
+
+	std::string out = ss.str();
+	if(!file_system::WriteFileAtomic(filename, out.data(), out.size()))
+	{
+		debug::Printf("Scene: Failed to write cell index '%s'.\n", filename);
+		return false;
+	}
+	return true;
+}
+//-------------------------------------------------------------------------------
+bool scene_cells::Save(const char* index_filename, const SceneData& data, float cell_size)
+{
+	assert(cell_size > 0.0f);
+
+	std::map<CellCoord, SceneData> cells;
+	for(uint32_t i = 0; i < data.Size(); ++i)
+	{
+		CopyEntity(data, i, cells[CellAt(data.transforms[i].position, cell_size)]);
+	}
+
+	Index index;
+	index.cell_size = cell_size;
+	for(std::map<CellCoord, SceneData>::iterator it = cells.begin(); it != cells.end(); ++it)
+	{
+		if(!scene_file::Save(CellFilename(index_filename, it->first).c_str(), it->second))
+			return false;
+
+		index.cells[it->first] = it->second.Size();
+	}
+
+	// Entities without IDs get the same IDs as SceneData::AssignIds would give them
+	index.next_id = data.Size() + 1;
+	for(uint32_t i = 0; i < data.ids.size(); ++i)
+	{
+		index.next_id = std::max(index.next_id, data.ids[i] + 1);
+	}
+
+	// The index is written last, so an interrupted save never refers to missing cells
+	return WriteIndex(index_filename, index);
+}
+void scene_cells::CopyEntity(const SceneData& src, uint32_t index, SceneData& dst)
+{
+	dst.ids.push_back(src.ids.empty() ? index + 1 : src.ids[index]);
+
+	EntityRecord entity = src.entities[index];
+	if(entity.light != EntityRecord::NO_LIGHT)
+	{
+		dst.lights.push_back(src.lights[entity.light]);
+		entity.light = (uint32_t)dst.lights.size() - 1;
+	}
+	dst.entities.push_back(entity);
+	dst.transforms.push_back(src.transforms[index]);
+	dst.materials.push_back(src.materials[index]);
+}
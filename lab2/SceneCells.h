@@ -0,0 +1,72 @@
+#ifndef __SCENECELLS_H__
+#define __SCENECELLS_H__
+
+#include "SceneFile.h"
+
+#include <string>
+
+/// @brief Scenes partitioned into spatial cells, allowing parts of a scene to be loaded separately.
+///
+///	The scene is divided into square cells on the XZ-plane (The plane the editor works on, see
+///	Scene::ToWorld), every entity belongs to the cell containing its position. A cell scene consists of:
+///		Index		: "<name>", a JSON document with the cell size, the next free entity ID and all
+///					  cells that hold entities.
+///		Cell files	: "<name>.<x>_<z>.bin", a binary scene (See scene_file) for every cell in the index.
+///	Entity IDs are unique for the whole scene, not only within a cell.
+namespace scene_cells
+{
+	/// @brief Coordinate of a cell, cell (x, z) covers [x*size, (x+1)*size) on the x-axis, same for z.
+	struct CellCoord
+	{
+		int32_t x, z;
+
+		CellCoord() : x(0), z(0) {}
+		CellCoord(int32_t cx, int32_t cz) : x(cx), z(cz) {}
+
+		bool operator<(const CellCoord& other) const
+		{
+			return (x < other.x) || (x == other.x && z < other.z);
+		}
+		bool operator==(const CellCoord& other) const
+		{
+			return x == other.x && z == other.z;
+		}
+	};
+
+	struct Index
+	{
+		float cell_size;
+		uint32_t next_id; // All entity IDs in the scene are lower than this
+		std::map<CellCoord, uint32_t> cells; // Cell => Number of entities in the cell
+
+		Index() : cell_size(32.0f), next_id(1) {}
+	};
+
+	/// @return The cell containing the specified position.
+	CellCoord CellAt(const Vec3& position, float cell_size);
+
+	/// @return Distance on the XZ-plane from the specified position to the closest point within the cell.
+	float DistanceToCell(const Vec3& position, const CellCoord& cell, float cell_size);
+
+	/// @return File name of the specified cell of a cell scene.
+	std::string CellFilename(const char* index_filename, const CellCoord& cell);
+
+	/// @brief Reads the index of a cell scene.
+	/// @return True if successful, false if not.
+	bool ReadIndex(const char* filename, Index& index);
+
+	/// @brief Writes the index of a cell scene.
+	/// @return True if successful, false if not.
+	bool WriteIndex(const char* filename, const Index& index);
+
+	/// @brief Splits a scene into cells and saves it as a cell scene, replacing all cells in the index.
+	///	Cell files from a previous save that are no longer in the index are left as they are.
+	/// @return True if successful, false if not.
+	bool Save(const char* index_filename, const SceneData& data, float cell_size);
+
+	/// @brief Copies the specified entity, including its ID and light, and appends it to another scene.
+	void CopyEntity(const SceneData& src, uint32_t index, SceneData& dst);
+};
+
+
+#endif // __SCENECELLS_H__
@@ -0,0 +1,1115 @@
+#include <framework/Common.h>
+
+#include "SceneFile.h"
+#include "SceneSchema.h"
+
+#include <framework/Json.h>
+#include <framework/MsgPack.h>
+#include <framework/ConfigValue.h>
+#include <framework/Parallel.h>
+#include <framework/Compression.h>
+#include <framework/FileSystem.h>
+
+#include <string.h>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+
+namespace scene_file_internal
+{
+	/// Minimum number of entities in each save chunk, smaller scenes are not worth spreading over multiple threads.
+	const uint32_t save_chunk_min_size = 512;
+
+	const uint32_t binary_magic = 0x4e424353; // "SCBN"
+	const uint32_t binary_version = 1;
+	const uint32_t section_alignment = 16;
+
+	enum SectionId
+	{
+		SECTION_ENTITIES = 1,
+		SECTION_TRANSFORMS = 2,
+		SECTION_MATERIALS = 3,
+		SECTION_LIGHTS = 4,
+		SECTION_IDS = 5,
+		SECTION_GENERATION = 6
+	};
+
+	struct BinaryHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t section_count;
+		uint32_t reserved;
+	};
+
+	struct BinarySection
+	{
+		uint32_t id; // SectionId
+		uint32_t record_size; // Size of a single record in bytes
+		uint32_t count; // Number of records
+		uint32_t reserved;
+		uint64_t offset; // Offset in bytes from the start of the file
+	};
+
+	static_assert(sizeof(EntityRecord) == 12, "EntityRecord must be tightly packed");
+	static_assert(sizeof(TransformRecord) == 36, "TransformRecord must be tightly packed");
+	static_assert(sizeof(MaterialRecord) == 48, "MaterialRecord must be tightly packed");
+	static_assert(sizeof(LightRecord) == 52, "LightRecord must be tightly packed");
+	static_assert(sizeof(BinarySection) == 24, "BinarySection must be tightly packed");
+
+	bool IsLittleEndian()
+	{
+		uint32_t value = 1;
+		return (*(uint8_t*)&value) == 1;
+	}
+
+	/// Swaps the byte order of an array of 32bit words, used for the header and section table.
+	void SwapWords(void* data, size_t size)
+	{
+		uint8_t* bytes = (uint8_t*)data;
+		for(size_t i = 0; i + 4 <= size; i += 4)
+		{
+			std::swap(bytes[i], bytes[i+3]);
+			std::swap(bytes[i+1], bytes[i+2]);
+		}
+	}
+
+	/// Appends a value to the output buffer, in little-endian order.
+	template<typename T>
+	void WriteLE(std::string& out, const T* values, size_t count)
+	{
+		size_t offset = out.size();
+		out.append((const char*)values, sizeof(T)*count);
+		if(!IsLittleEndian())
+			SwapWords(&out[offset], sizeof(T)*count);
+	}
+
+	/// Appends an array of records to the output buffer in the binary representation.
+	template<typename T>
+	void WriteRecords(std::string& out, const std::vector<T>& records)
+	{
+		if(records.empty())
+			return;
+
+		if(IsLittleEndian())
+		{
+			// Records are tightly packed, so in memory they already match the binary representation
+			out.append((const char*)&records[0], sizeof(T)*records.size());
+		}
+		else
+		{
+			for(size_t i = 0; i < records.size(); ++i)
+			{
+				reflection::WriteBinary(records[i], out);
+			}
+		}
+	}
+
+	/// Reads a section of records into the specified array.
+	template<typename T>
+	bool ReadSection(const char* buffer, int64_t length, const BinarySection& section, std::vector<T>& records)
+	{
+		if(section.record_size < reflection::BinarySize((const T*)0) || section.offset > (uint64_t)length ||
+			(uint64_t)section.count * section.record_size > (uint64_t)length - section.offset)
+			return false;
+
+		records.resize(section.count);
+		if(section.count == 0)
+			return true;
+
+		const char* src = buffer + section.offset;
+		if(IsLittleEndian() && section.record_size == sizeof(T))
+		{
+			// Records match our layout, so the whole section can be copied at once.
+			memcpy(&records[0], src, sizeof(T)*section.count);
+		}
+		else
+		{
+			// Records are either from a newer version of the format (with additional fields at the end
+			//	that we skip) or we're on a big-endian machine, read them field by field.
+			for(uint32_t i = 0; i < section.count; ++i)
+			{
+				const char* record = src + (size_t)i * section.record_size;
+				reflection::ReadBinary(record, records[i]);
+			}
+		}
+		return true;
+	}
+
+	enum { NO_REF = 0xffffffff };
+
+	/// Defaults shared by entities in a JSON or MessagePack document, entities referencing a prototype
+	///	only store the fields that differ from it.
+	struct Prototype
+	{
+		uint32_t type;
+		Vec3 rotation;
+		Vec3 scale;
+		uint32_t material; // Index in the material table, NO_REF if the material template is used
+		bool has_light;
+		LightRecord light;
+
+		Prototype() : type(0), rotation(0.0f, 0.0f, 0.0f), scale(1.0f, 1.0f, 1.0f), material(NO_REF), has_light(false)
+		{
+			light.radius = 0.0f;
+		}
+	};
+
+	/// Material and prototype tables of a document.
+	struct DocumentTables
+	{
+		std::vector<MaterialRecord> materials; // Materials shared by multiple entities or used by a prototype
+		std::vector<Prototype> prototypes; // One for each entity type in the scene
+		std::map<uint32_t, uint32_t> prototype_by_type; // Entity type => Prototype index
+		std::vector<uint32_t> material_refs; // Material table index for each entity, NO_REF if not in the table
+
+		bool Empty() const { return prototypes.empty(); }
+	};
+
+	/// Hashing and comparison of whole records, used for finding identical records.
+	template<typename T>
+	struct RecordHash
+	{
+		size_t operator()(const T& record) const
+		{
+			// FNV-1a
+			const uint8_t* bytes = (const uint8_t*)&record;
+			uint32_t hash = 2166136261u;
+			for(size_t i = 0; i < sizeof(T); ++i)
+			{
+				hash = (hash ^ bytes[i]) * 16777619u;
+			}
+			return hash;
+		}
+	};
+	template<typename T>
+	struct RecordEqual
+	{
+		bool operator()(const T& a, const T& b) const
+		{
+			return memcmp(&a, &b, sizeof(T)) == 0;
+		}
+	};
+
+	struct FirstLess
+	{
+		template<typename T>
+		bool operator()(const T& a, const T& b) const
+		{
+			return a.first < b.first;
+		}
+	};
+
+	/// Counts occurrences of records, finding the most frequent one. Ties go to the record seen first.
+	template<typename T>
+	class RecordCounter
+	{
+	public:
+		struct Count
+		{
+			uint32_t count;
+			uint32_t first; // Index of the first occurrence
+			uint32_t ref; // Table index assigned by the user
+		};
+		typedef std::unordered_map<T, Count, RecordHash<T>, RecordEqual<T> > CountMap;
+
+		Count& Add(const T& record, uint32_t index)
+		{
+			typename CountMap::iterator it = _counts.find(record);
+			if(it == _counts.end())
+			{
+				Count count = { 0, index, NO_REF };
+				it = _counts.insert(std::make_pair(record, count)).first;
+			}
+			it->second.count++;
+			return it->second;
+		}
+		Count& Find(const T& record)
+		{
+			return _counts.find(record)->second;
+		}
+
+		/// @return False if no records were added.
+		bool MostFrequent(T& record) const
+		{
+			const typename CountMap::value_type* best = NULL;
+			for(typename CountMap::const_iterator it = _counts.begin(); it != _counts.end(); ++it)
+			{
+				if(!best || it->second.count > best->second.count ||
+					(it->second.count == best->second.count && it->second.first < best->second.first))
+					best = &(*it);
+			}
+			if(best)
+				record = best->first;
+			return best != NULL;
+		}
+
+		CountMap& Counts() { return _counts; }
+
+	private:
+		CountMap _counts;
+	};
+
+	/// Picks a prototype for each entity type from the most common values among its entities, and collects
+	///	all materials shared by more than one entity into the material table.
+	void BuildTables(const SceneData& data, DocumentTables& tables)
+	{
+		typedef RecordCounter<MaterialRecord> MaterialCounter;
+
+		struct TypeCounters
+		{
+			RecordCounter<Vec3> rotations;
+			RecordCounter<Vec3> scales;
+			RecordCounter<LightRecord> lights;
+			uint32_t count;
+			uint32_t light_count;
+			uint32_t material_count; // Number of entities with materials
+			uint32_t best_material; // Entity with the most common material among the entities of this type
+
+			TypeCounters() : count(0), light_count(0), material_count(0), best_material(NO_REF) {}
+		};
+
+		uint32_t count = data.Size();
+
+		MaterialCounter materials;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			if(data.entities[i].flags & EntityRecord::HAS_MATERIAL)
+				materials.Add(data.materials[i], i);
+		}
+
+		std::map<uint32_t, TypeCounters> types;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			const EntityRecord& entity = data.entities[i];
+			TypeCounters& counters = types[entity.type];
+			counters.count++;
+			counters.rotations.Add(data.transforms[i].rotation, i);
+			counters.scales.Add(data.transforms[i].scale, i);
+
+			if(entity.light != EntityRecord::NO_LIGHT)
+			{
+				counters.lights.Add(data.lights[entity.light], i);
+				counters.light_count++;
+			}
+
+			if(entity.flags & EntityRecord::HAS_MATERIAL)
+			{
+				counters.material_count++;
+				if(counters.best_material == NO_REF ||
+					materials.Find(data.materials[i]).count > materials.Find(data.materials[counters.best_material]).count)
+					counters.best_material = i;
+			}
+		}
+
+		// Prototypes only get a material or light if most entities of the type have one
+		std::vector<uint32_t> prototype_materials; // Entity holding the material of each prototype
+		for(std::map<uint32_t, TypeCounters>::iterator it = types.begin(); it != types.end(); ++it)
+		{
+			TypeCounters& counters = it->second;
+
+			Prototype prototype;
+			prototype.type = it->first;
+			counters.rotations.MostFrequent(prototype.rotation);
+			counters.scales.MostFrequent(prototype.scale);
+			if(counters.light_count * 2 > counters.count)
+				prototype.has_light = counters.lights.MostFrequent(prototype.light);
+
+			uint32_t material = NO_REF;
+			if(counters.material_count * 2 > counters.count)
+				material = counters.best_material;
+
+			tables.prototype_by_type[prototype.type] = (uint32_t)tables.prototypes.size();
+			tables.prototypes.push_back(prototype);
+			prototype_materials.push_back(material);
+		}
+
+		// The table holds all materials used more than once, plus the materials of the prototypes.
+		//	Materials are ordered by first use, which keeps the output deterministic.
+		std::vector<std::pair<uint32_t, MaterialRecord> > shared;
+		for(MaterialCounter::CountMap::iterator it = materials.Counts().begin(); it != materials.Counts().end(); ++it)
+		{
+			if(it->second.count > 1)
+				shared.push_back(std::make_pair(it->second.first, it->first));
+		}
+		for(uint32_t i = 0; i < prototype_materials.size(); ++i)
+		{
+			if(prototype_materials[i] == NO_REF)
+				continue;
+
+			const MaterialRecord& material = data.materials[prototype_materials[i]];
+			if(materials.Find(material).count == 1)
+				shared.push_back(std::make_pair(prototype_materials[i], material));
+		}
+		std::sort(shared.begin(), shared.end(), FirstLess());
+
+		tables.materials.resize(shared.size());
+		for(uint32_t i = 0; i < shared.size(); ++i)
+		{
+			tables.materials[i] = shared[i].second;
+			materials.Find(shared[i].second).ref = i;
+		}
+		for(uint32_t i = 0; i < prototype_materials.size(); ++i)
+		{
+			if(prototype_materials[i] != NO_REF)
+				tables.prototypes[i].material = materials.Find(data.materials[prototype_materials[i]]).ref;
+		}
+
+		tables.material_refs.resize(count, NO_REF);
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			if(data.entities[i].flags & EntityRecord::HAS_MATERIAL)
+				tables.material_refs[i] = materials.Find(data.materials[i]).ref;
+		}
+	}
+
+	/// Fills a ConfigValue with a representation of the specified entity, any fields matching the
+	///	prototype for the entity type are left out.
+	void WriteEntity(const SceneData& data, const DocumentTables& tables, uint32_t index, ConfigValue& node)
+	{
+		const EntityRecord& entity = data.entities[index];
+		const TransformRecord& transform = data.transforms[index];
+
+		uint32_t prototype_index = tables.prototype_by_type.find(entity.type)->second;
+		const Prototype& prototype = tables.prototypes[prototype_index];
+
+		node.SetEmptyObject();
+		node["prototype"].SetUInt(prototype_index);
+		if(!data.ids.empty())
+			node["id"].SetUInt(data.ids[index]);
+
+		reflection::WriteDom(transform.position, node["position"]);
+		if(memcmp(&transform.rotation, &prototype.rotation, sizeof(Vec3)) != 0)
+			reflection::WriteDom(transform.rotation, node["rotation"]);
+		if(memcmp(&transform.scale, &prototype.scale, sizeof(Vec3)) != 0)
+			reflection::WriteDom(transform.scale, node["scale"]);
+
+		// Materials are either a reference to the table, or the fields differing from the prototype material.
+		//	false means the entity uses the material template even though its prototype has a material.
+		if(entity.flags & EntityRecord::HAS_MATERIAL)
+		{
+			uint32_t ref = tables.material_refs[index];
+			if(ref == NO_REF)
+			{
+				MaterialRecord base;
+				if(prototype.material != NO_REF)
+					base = tables.materials[prototype.material];
+				reflection::WriteDomDelta(data.materials[index], base, node["material"]);
+			}
+			else if(ref != prototype.material)
+			{
+				node["material"].SetUInt(ref);
+			}
+		}
+		else if(prototype.material != NO_REF)
+		{
+			node["material"].SetBool(false);
+		}
+
+		// Additional light parameters, same as for materials
+		if(entity.light != EntityRecord::NO_LIGHT)
+		{
+			const LightRecord& light = data.lights[entity.light];
+			if(!prototype.has_light)
+				reflection::WriteDom(light, node["light"]);
+			else if(memcmp(&light, &prototype.light, sizeof(LightRecord)) != 0)
+				reflection::WriteDomDelta(light, prototype.light, node["light"]);
+		}
+		else if(prototype.has_light)
+		{
+			node["light"].SetBool(false);
+		}
+	}
+
+	/// Fills ConfigValues with the material and prototype tables.
+	void WriteTables(const DocumentTables& tables, ConfigValue& materials, ConfigValue& prototypes)
+	{
+		materials.SetEmptyArray();
+		for(uint32_t i = 0; i < tables.materials.size(); ++i)
+		{
+			reflection::WriteDom(tables.materials[i], materials.Append());
+		}
+
+		prototypes.SetEmptyArray();
+		for(uint32_t i = 0; i < tables.prototypes.size(); ++i)
+		{
+			const Prototype& prototype = tables.prototypes[i];
+
+			ConfigValue& node = prototypes.Append();
+			node.SetEmptyObject();
+			node["type"].SetUInt(prototype.type);
+			reflection::WriteDom(prototype.rotation, node["rotation"]);
+			reflection::WriteDom(prototype.scale, node["scale"]);
+			if(prototype.material != NO_REF)
+				node["material"].SetUInt(prototype.material);
+			if(prototype.has_light)
+				reflection::WriteDom(prototype.light, node["light"]);
+		}
+	}
+
+	/// Formats a contiguous range of entities into its own buffer, the buffers for all chunks
+	///	can then be concatenated into a document identical to one written in a single pass.
+	struct SaveChunkTask
+	{
+		const SceneData& data;
+		const DocumentTables& tables;
+		std::vector<std::string>& chunks;
+
+		SaveChunkTask(const SceneData& d, const DocumentTables& t, std::vector<std::string>& c) : data(d), tables(t), chunks(c) {}
+
+		void operator()(uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			std::stringstream ss;
+			json::Writer writer;
+
+			for(uint32_t i = begin; i < end; ++i)
+			{
+				ConfigValue node;
+				WriteEntity(data, tables, i, node);
+
+				// Entities are elements of the "entities" array, which sits at indent level 1 in the document
+				writer.WriteElement(node, i, 2, ss, true);
+			}
+			chunks[chunk] = ss.str();
+		}
+	};
+
+	/// Generates the JSON document in pieces, the document is the concatenation of all pieces in order.
+	///	The document envelope follows the layout json::Writer uses for { "entities": [ ... ], "materials": [ ... ], "prototypes": [ ... ] }
+	void WriteJsonPieces(const SceneData& data, std::vector<std::string>& pieces)
+	{
+		DocumentTables tables;
+		BuildTables(data, tables);
+
+		// Format the entities in chunks spread over multiple threads
+		uint32_t chunk_count = parallel::ChunkCount(data.Size(), save_chunk_min_size);
+
+		pieces.resize(chunk_count + 2);
+		pieces[0] = "{\n\t\"entities\": [";
+		pieces[chunk_count + 1] = "\n\t]\n}\n";
+
+		if(!tables.Empty() || data.generation)
+		{
+			// The generation and tables follow the entities, keys are in the same order as in any other object written by json::Writer
+			ConfigValue root;
+			root.SetEmptyObject();
+			if(data.generation)
+				root["generation"].SetUInt(data.generation);
+			if(!tables.Empty())
+				WriteTables(tables, root["materials"], root["prototypes"]);
+
+			std::stringstream ss;
+			json::Writer writer;
+			writer.Write(root, ss, true);
+
+			// Skip the opening brace, the rest continues the envelope
+			pieces[chunk_count + 1] = "\n\t]," + ss.str().substr(1);
+		}
+
+		std::vector<std::string> chunks(chunk_count);
+		SaveChunkTask task(data, tables, chunks);
+		parallel::ForEachChunk(data.Size(), chunk_count, task);
+
+		for(uint32_t i = 0; i < chunk_count; ++i)
+		{
+			pieces[i+1].swap(chunks[i]);
+		}
+	}
+
+	/// Same as SaveChunkTask but for the MessagePack format, each entity is a separate element
+	///	which means the chunks can be concatenated directly after the array header.
+	struct MsgPackSaveChunkTask
+	{
+		const SceneData& data;
+		const DocumentTables& tables;
+		std::vector<std::string>& chunks;
+
+		MsgPackSaveChunkTask(const SceneData& d, const DocumentTables& t, std::vector<std::string>& c) : data(d), tables(t), chunks(c) {}
+
+		void operator()(uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			std::stringstream ss;
+			msgpack::Writer writer;
+
+			for(uint32_t i = begin; i < end; ++i)
+			{
+				ConfigValue node;
+				WriteEntity(data, tables, i, node);
+				writer.Write(node, ss);
+			}
+			chunks[chunk] = ss.str();
+		}
+	};
+
+	/// Generates the MessagePack document in pieces, equivalent to the JSON document.
+	void WriteMsgPackPieces(const SceneData& data, std::vector<std::string>& pieces)
+	{
+		DocumentTables tables;
+		BuildTables(data, tables);
+
+		uint32_t chunk_count = parallel::ChunkCount(data.Size(), save_chunk_min_size);
+
+		std::stringstream header;
+		msgpack::Writer::WriteObjectHeader(1 + (data.generation ? 1 : 0) + (tables.Empty() ? 0 : 2), header);
+		msgpack::Writer::WriteString("entities", 8, header);
+		msgpack::Writer::WriteArrayHeader(data.Size(), header);
+
+		pieces.resize(chunk_count + 2);
+		pieces[0] = header.str();
+
+		std::stringstream ss;
+		msgpack::Writer writer;
+		if(data.generation)
+		{
+			ConfigValue generation;
+			generation.SetUInt(data.generation);
+
+			msgpack::Writer::WriteString("generation", 10, ss);
+			writer.Write(generation, ss);
+		}
+		if(!tables.Empty())
+		{
+			ConfigValue materials, prototypes;
+			WriteTables(tables, materials, prototypes);
+
+			msgpack::Writer::WriteString("materials", 9, ss);
+			writer.Write(materials, ss);
+			msgpack::Writer::WriteString("prototypes", 10, ss);
+			writer.Write(prototypes, ss);
+		}
+		pieces[chunk_count + 1] = ss.str();
+
+		std::vector<std::string> chunks(chunk_count);
+		MsgPackSaveChunkTask task(data, tables, chunks);
+		parallel::ForEachChunk(data.Size(), chunk_count, task);
+
+		for(uint32_t i = 0; i < chunk_count; ++i)
+		{
+			pieces[i+1].swap(chunks[i]);
+		}
+	}
+
+	/// Reads the material and prototype tables of a document, tables are optional.
+	void ReadTables(const ConfigValue& scene, DocumentTables& tables)
+	{
+		const ConfigValue& materials = scene["materials"];
+		if(materials.IsArray())
+		{
+			tables.materials.resize(materials.Size());
+			for(uint32_t i = 0; i < tables.materials.size(); ++i)
+			{
+				reflection::ReadDom(materials[i], tables.materials[i]);
+			}
+		}
+
+		const ConfigValue& prototypes = scene["prototypes"];
+		if(prototypes.IsArray())
+		{
+			tables.prototypes.resize(prototypes.Size());
+			for(uint32_t i = 0; i < tables.prototypes.size(); ++i)
+			{
+				const ConfigValue& node = prototypes[i];
+				Prototype& prototype = tables.prototypes[i];
+
+				reflection::ReadDom(node["type"], prototype.type);
+				reflection::ReadDom(node["rotation"], prototype.rotation);
+				reflection::ReadDom(node["scale"], prototype.scale);
+
+				const ConfigValue& material = node["material"];
+				if(material.IsNumber() && material.AsUInt() < tables.materials.size())
+					prototype.material = material.AsUInt();
+
+				if(node["light"].IsObject())
+				{
+					reflection::ReadDom(node["light"], prototype.light);
+					prototype.has_light = true;
+				}
+			}
+		}
+	}
+
+	/// Builds records from a parsed scene document, shared by the JSON and MessagePack readers.
+	///	Entities either hold all their fields or reference a prototype and the material table (See WriteEntity),
+	///	references are resolved into complete records.
+	void ReadDocument(const ConfigValue& scene, SceneData& data)
+	{
+		const ConfigValue& generation = scene["generation"];
+		if(generation.IsNumber())
+			data.generation = generation.AsUInt();
+
+		const ConfigValue& entities = scene["entities"];
+		if(!entities.IsArray())
+			return; // Empty scene
+
+		DocumentTables tables;
+		ReadTables(scene, tables);
+
+		const Prototype no_prototype;
+
+		uint32_t count = entities.Size();
+		data.ids.resize(count);
+		data.entities.resize(count);
+		data.transforms.resize(count);
+		data.materials.resize(count);
+
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			const ConfigValue& entity_node = entities[i];
+
+			const Prototype* prototype = &no_prototype;
+			const ConfigValue& prototype_node = entity_node["prototype"];
+			if(prototype_node.IsNumber() && prototype_node.AsUInt() < tables.prototypes.size())
+				prototype = &tables.prototypes[prototype_node.AsUInt()];
+
+			EntityRecord& entity = data.entities[i];
+			entity.type = prototype->type;
+			reflection::ReadDom(entity_node["type"], entity.type);
+
+			// IDs are only kept if all entities have one
+			const ConfigValue& id_node = entity_node["id"];
+			if(id_node.IsNumber() && !data.ids.empty())
+				data.ids[i] = id_node.AsUInt();
+			else
+				data.ids.clear();
+			entity.flags = 0;
+			entity.light = EntityRecord::NO_LIGHT;
+
+			// Transform
+			TransformRecord& transform = data.transforms[i];
+			transform.rotation = prototype->rotation;
+			transform.position = Vec3(0.0f, 0.0f, 0.0f);
+			transform.scale = prototype->scale;
+			reflection::ReadDom(entity_node, transform);
+
+			// Material
+			MaterialRecord& material = data.materials[i];
+			if(prototype->material != NO_REF)
+			{
+				material = tables.materials[prototype->material];
+				entity.flags |= EntityRecord::HAS_MATERIAL;
+			}
+
+			const ConfigValue& material_node = entity_node["material"];
+			if(material_node.IsNumber() && material_node.AsUInt() < tables.materials.size())
+			{
+				material = tables.materials[material_node.AsUInt()];
+				entity.flags |= EntityRecord::HAS_MATERIAL;
+			}
+			else if(material_node.IsObject())
+			{
+				reflection::ReadDom(material_node, material);
+				entity.flags |= EntityRecord::HAS_MATERIAL;
+			}
+			else if(material_node.IsBool() && !material_node.AsBool())
+			{
+				material = MaterialRecord();
+				entity.flags &= ~EntityRecord::HAS_MATERIAL;
+			}
+
+			// Light paramters
+			const ConfigValue& light_node = entity_node["light"];
+			bool has_light = prototype->has_light;
+			if(light_node.IsObject())
+				has_light = true;
+			else if(light_node.IsBool() && !light_node.AsBool())
+				has_light = false;
+
+			if(has_light)
+			{
+				LightRecord light = prototype->light;
+				reflection::ReadDom(light_node, light);
+
+				entity.light = (uint32_t)data.lights.size();
+				data.lights.push_back(light);
+			}
+		}
+	}
+};
+
+//-------------------------------------------------------------------------------
+void SceneData::Clear()
+{
+	ids.clear();
+	entities.clear();
+	transforms.clear();
+	materials.clear();
+	lights.clear();
+	generation = 0;
+}
+void SceneData::Swap(SceneData& other)
+{
+	ids.swap(other.ids);
+	entities.swap(other.entities);
+	transforms.swap(other.transforms);
+	materials.swap(other.materials);
+	lights.swap(other.lights);
+	std::swap(generation, other.generation);
+}
+void SceneData::AssignIds()
+{
+	if(!ids.empty())
+		return;
+
+	ids.resize(entities.size());
+	for(uint32_t i = 0; i < ids.size(); ++i)
+	{
+		ids[i] = i + 1;
+	}
+}
+uint32_t SceneData::Size() const
+{
+	return (uint32_t)entities.size();
+}
+//-------------------------------------------------------------------------------
+scene_file::Format scene_file::FormatFromFilename(const char* filename)
+{
+	std::string name = filename;
+	if(IsCompressedFilename(filename))
+		name.resize(name.size() - 3); // Format is decided by the extension before ".lz"
+
+	size_t ext = name.rfind('.');
+	if(ext != std::string::npos && name.compare(ext, std::string::npos, ".bin") == 0)
+		return FORMAT_BINARY;
+	if(ext != std::string::npos && name.compare(ext, std::string::npos, ".msgpack") == 0)
+		return FORMAT_MSGPACK;
+
+	return FORMAT_JSON;
+}
+bool scene_file::IsCompressedFilename(const char* filename)
+{
+	size_t length = strlen(filename);
+	return length >= 3 && strcmp(filename + length - 3, ".lz") == 0;
+}
+bool scene_file::Load(const char* filename, SceneData& data)
+{
+	file_system::MappedFile file;
+	if(!file.Open(filename))
+	{
+		debug::Printf("Scene: No file with the name '%s' found.\n", filename);
+		return false;
+	}
+
+	// Uncompressed files are parsed directly out of the mapping
+	const char* doc = file.Data();
+	size_t length = file.Size();
+
+	std::string buffer;
+	if(compression::IsCompressed(doc, length))
+	{
+		if(!compression::Decompress(doc, length, buffer))
+		{
+			debug::Printf("Scene: Failed to decompress scene file '%s'.\n", filename);
+			return false;
+		}
+		file.Close();
+
+		doc = buffer.data();
+		length = buffer.size();
+	}
+
+	bool result = false;
+	switch(FormatFromFilename(filename))
+	{
+	case FORMAT_BINARY:
+		result = ReadBinary(doc, length, data);
+		break;
+	case FORMAT_MSGPACK:
+		result = ReadMsgPack(doc, length, data);
+		break;
+	default:
+		result = ReadJson(doc, length, data);
+		break;
+	};
+
+	if(!result)
+		debug::Printf("Scene: Failed to read scene file '%s'.\n", filename);
+	return result;
+}
+bool scene_file::Save(const char* filename, const SceneData& data)
+{
+	// The scene is written to a temporary file that replaces the old file once complete,
+	//	that way a crash while saving never leaves a broken scene file behind.
+	file_system::FileWriter writer;
+	if(!writer.Open(filename, file_system::FileWriter::ATOMIC))
+	{
+		debug::Printf("Scene: Failed to open '%s' for writing.\n", filename);
+		return false;
+	}
+
+	Format format = FormatFromFilename(filename);
+	if(IsCompressedFilename(filename))
+	{
+		std::string out;
+		if(format == FORMAT_BINARY)
+			WriteBinary(data, out);
+		else if(format == FORMAT_MSGPACK)
+			WriteMsgPack(data, out);
+		else
+			WriteJson(data, out);
+
+		std::string compressed;
+		compression::Compress(out.data(), out.size(), compressed);
+		writer.Write(compressed.data(), compressed.size());
+	}
+	else if(format == FORMAT_BINARY)
+	{
+		std::string out;
+		WriteBinary(data, out);
+		writer.Write(out.data(), out.size());
+	}
+	else
+	{
+		// Write the pieces in order rather than concatenating them first
+		std::vector<std::string> pieces;
+		if(format == FORMAT_MSGPACK)
+			scene_file_internal::WriteMsgPackPieces(data, pieces);
+		else
+			scene_file_internal::WriteJsonPieces(data, pieces);
+
+		for(size_t i = 0; i < pieces.size(); ++i)
+		{
+			writer.Write(pieces[i].data(), pieces[i].size());
+		}
+	}
+
+	if(!writer.Commit())
+	{
+		debug::Printf("Scene: Failed to write '%s'.\n", filename);
+		return false;
+	}
+	return true;
+}
+bool scene_file::Convert(const char* src_filename, const char* dst_filename)
+{
+	SceneData data;
+	if(!Load(src_filename, data))
+		return false;
+
+	return Save(dst_filename, data);
+}
+//-------------------------------------------------------------------------------
+bool scene_file::ReadJson(const char* doc, int64_t length, SceneData& data)
+{
+	data.Clear();
+
+	ConfigValue scene;
+
+	// Read scene from json
+	json::Reader reader;
+	if(!reader.Read(doc, length, scene))
+	{
+		debug::Printf("Scene: %s\n", reader.GetErrorMessage().c_str());
+		return false;
+	}
+
+	scene_file_internal::ReadDocument(scene, data);
+	return true;
+}
+void scene_file::WriteJson(const SceneData& data, std::string& out)
+{
+	std::vector<std::string> pieces;
+	scene_file_internal::WriteJsonPieces(data, pieces);
+
+	out.clear();
+	for(size_t i = 0; i < pieces.size(); ++i)
+	{
+		out += pieces[i];
+	}
+}
+//-------------------------------------------------------------------------------
+bool scene_file::ReadMsgPack(const char* doc, int64_t length, SceneData& data)
+{
+	data.Clear();
+
+	ConfigValue scene;
+
+	msgpack::Reader reader;
+	if(!reader.Read(doc, length, scene))
+	{
+		debug::Printf("Scene: %s\n", reader.GetErrorMessage().c_str());
+		return false;
+	}
+
+	scene_file_internal::ReadDocument(scene, data);
+	return true;
+}
+void scene_file::WriteMsgPack(const SceneData& data, std::string& out)
+{
+	std::vector<std::string> pieces;
+	scene_file_internal::WriteMsgPackPieces(data, pieces);
+
+	out.clear();
+	for(size_t i = 0; i < pieces.size(); ++i)
+	{
+		out += pieces[i];
+	}
+}
+//-------------------------------------------------------------------------------
+bool scene_file::ReadBinary(const char* buffer, int64_t length, SceneData& data)
+{
+	using namespace scene_file_internal;
+
+	data.Clear();
+
+	if(length < (int64_t)sizeof(BinaryHeader))
+		return false;
+
+	BinaryHeader header;
+	memcpy(&header, buffer, sizeof(header));
+	if(!IsLittleEndian())
+		SwapWords(&header, sizeof(header));
+
+	if(header.magic != binary_magic)
+	{
+		debug::Printf("Scene: Not a binary scene file.\n");
+		return false;
+	}
+	if(header.version > binary_version)
+	{
+		debug::Printf("Scene: Unsupported binary scene version (%d).\n", header.version);
+		return false;
+	}
+	if((uint64_t)sizeof(BinaryHeader) + (uint64_t)header.section_count * sizeof(BinarySection) > (uint64_t)length)
+		return false;
+
+	const char* section_table = buffer + sizeof(BinaryHeader);
+	for(uint32_t i = 0; i < header.section_count; ++i)
+	{
+		uint32_t words[6];
+		memcpy(words, section_table + i * sizeof(BinarySection), sizeof(words));
+		if(!IsLittleEndian())
+			SwapWords(words, sizeof(words));
+
+		// The 64bit offset is stored as two words, low word first
+		BinarySection section;
+		section.id = words[0];
+		section.record_size = words[1];
+		section.count = words[2];
+		section.reserved = words[3];
+		section.offset = (uint64_t)words[4] | ((uint64_t)words[5] << 32);
+
+		bool result = true;
+		switch(section.id)
+		{
+		case SECTION_ENTITIES:
+			result = ReadSection(buffer, length, section, data.entities);
+			break;
+		case SECTION_TRANSFORMS:
+			result = ReadSection(buffer, length, section, data.transforms);
+			break;
+		case SECTION_MATERIALS:
+			result = ReadSection(buffer, length, section, data.materials);
+			break;
+		case SECTION_LIGHTS:
+			result = ReadSection(buffer, length, section, data.lights);
+			break;
+		case SECTION_IDS:
+			result = ReadSection(buffer, length, section, data.ids);
+			break;
+		case SECTION_GENERATION:
+			{
+				std::vector<uint32_t> generation;
+				result = ReadSection(buffer, length, section, generation) && generation.size() == 1;
+				if(result)
+					data.generation = generation[0];
+			}
+			break;
+		default:
+			break; // Unknown sections are skipped
+		};
+
+		if(!result)
+		{
+			debug::Printf("Scene: Invalid section in binary scene file.\n");
+			data.Clear();
+			return false;
+		}
+	}
+
+	// Validate that the parallel arrays matches up
+	uint32_t count = data.Size();
+	if(data.transforms.size() != count || data.materials.size() != count || (!data.ids.empty() && data.ids.size() != count))
+	{
+		data.Clear();
+		return false;
+	}
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		if(data.entities[i].light != EntityRecord::NO_LIGHT && data.entities[i].light >= data.lights.size())
+		{
+			data.Clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+void scene_file::WriteBinary(const SceneData& data, std::string& out)
+{
+	using namespace scene_file_internal;
+
+	const uint32_t section_count = 6;
+	std::vector<uint32_t> generation(1, data.generation);
+
+	BinarySection sections[section_count];
+	memset(sections, 0, sizeof(sections));
+	sections[0].id = SECTION_ENTITIES;		sections[0].record_size = sizeof(EntityRecord);		sections[0].count = (uint32_t)data.entities.size();
+	sections[1].id = SECTION_TRANSFORMS;	sections[1].record_size = sizeof(TransformRecord);	sections[1].count = (uint32_t)data.transforms.size();
+	sections[2].id = SECTION_MATERIALS;		sections[2].record_size = sizeof(MaterialRecord);	sections[2].count = (uint32_t)data.materials.size();
+	sections[3].id = SECTION_LIGHTS;		sections[3].record_size = sizeof(LightRecord);		sections[3].count = (uint32_t)data.lights.size();
+	sections[4].id = SECTION_IDS;			sections[4].record_size = sizeof(uint32_t);			sections[4].count = (uint32_t)data.ids.size();
+	sections[5].id = SECTION_GENERATION;	sections[5].record_size = sizeof(uint32_t);			sections[5].count = 1;
+
+	// Calculate section offsets
+	uint64_t offset = sizeof(BinaryHeader) + sizeof(sections);
+	for(uint32_t i = 0; i < section_count; ++i)
+	{
+		offset = (offset + section_alignment - 1) & ~(uint64_t)(section_alignment - 1);
+		sections[i].offset = offset;
+		offset += (uint64_t)sections[i].record_size * sections[i].count;
+	}
+
+	out.clear();
+	out.reserve((size_t)offset);
+
+	BinaryHeader header;
+	header.magic = binary_magic;
+	header.version = binary_version;
+	header.section_count = section_count;
+	header.reserved = 0;
+	WriteLE(out, &header, 1);
+
+	for(uint32_t i = 0; i < section_count; ++i)
+	{
+		uint32_t words[6] = { sections[i].id, sections[i].record_size, sections[i].count, 0,
+			(uint32_t)(sections[i].offset & 0xffffffff), (uint32_t)(sections[i].offset >> 32) };
+		WriteLE(out, words, 6);
+	}
+
+	for(uint32_t i = 0; i < section_count; ++i)
+	{
+		out.resize((size_t)sections[i].offset, '\0'); // Padding
+
+		switch(sections[i].id)
+		{
+		case SECTION_ENTITIES:
+			WriteRecords(out, data.entities);
+			break;
+		case SECTION_TRANSFORMS:
+			WriteRecords(out, data.transforms);
+			break;
+		case SECTION_MATERIALS:
+			WriteRecords(out, data.materials);
+			break;
+		case SECTION_LIGHTS:
+			WriteRecords(out, data.lights);
+			break;
+		case SECTION_IDS:
+			WriteRecords(out, data.ids);
+			break;
+		case SECTION_GENERATION:
+			WriteRecords(out, generation);
+			break;
+		};
+	}
+}
@@ -0,0 +1,146 @@
+#ifndef __SCENEFILE_H__
+#define __SCENEFILE_H__
+
+#include "Material.h"
+
+#include <string>
+
+/// @brief Compact per-entity records, this is the representation used when loading, saving
+///			and converting scenes. None of the records reference any render resources.
+///			The records are laid out exactly as they are stored in the binary scene format.
+struct EntityRecord
+{
+	enum Flags
+	{
+		HAS_MATERIAL = 1 // Material record is valid, otherwise the material template should be used.
+	};
+	enum { NO_LIGHT = 0xffffffff };
+
+	uint32_t type; // Entity::EntityType
+	uint32_t flags;
+	uint32_t light; // Index of the light record for this entity, NO_LIGHT if none.
+};
+
+struct TransformRecord
+{
+	Vec3 rotation; // Head, pitch, roll
+	Vec3 position;
+	Vec3 scale;
+};
+
+struct MaterialRecord
+{
+	Color ambient;
+	Color specular;
+	Color diffuse;
+};
+
+struct LightRecord
+{
+	Color ambient;
+	Color diffuse;
+	Color specular;
+	float radius;
+};
+
+/// @brief A complete scene as parallel arrays of records.
+///	entities, transforms and materials all have one record per entity.
+struct SceneData
+{
+	std::vector<uint32_t> ids; // Stable entity IDs, either empty or one per entity.
+	std::vector<EntityRecord> entities;
+	std::vector<TransformRecord> transforms;
+	std::vector<MaterialRecord> materials;
+	std::vector<LightRecord> lights;
+
+	/// Identifies the snapshot, a journal is only replayed on the snapshot it was written for (See SceneJournal).
+	///	0 for scenes without a journal and scenes saved before generations were introduced.
+	uint32_t generation;
+
+	SceneData() : generation(0) {}
+
+	void Clear();
+
+	/// @brief Exchanges the records with another scene, without copying them.
+	void Swap(SceneData& other);
+
+	/// @brief Assigns IDs to all entities (1, 2, 3, ...) if the data has none.
+	void AssignIds();
+
+	/// @return Number of entities in the scene.
+	uint32_t Size() const;
+};
+
+/// @brief Reading and writing of scene files.
+///
+///	Three formats are supported, which one is used is decided by the file extension:
+///	- ".bin" : Binary format, see below.
+///	- ".msgpack" : MessagePack encoding of the JSON document (See msgpack).
+///	- Anything else : JSON.
+///	Any format can be compressed (See compression) by adding ".lz" to the file name, e.g. "scene.bin.lz".
+///	Compressed files are recognized when loading regardless of their name.
+///
+///	The JSON document (and MessagePack equivalent):
+///		"entities"		: One object per entity, either holding all fields or referencing a prototype.
+///		"generation"	: SceneData::generation, left out if 0.
+///		"materials"		: Table of materials shared by multiple entities.
+///		"prototypes"	: Default type, rotation, scale, material and light for each entity type in the scene.
+///	Entities referencing a prototype only store the fields that differ from it. "material" is either an index
+///	in the material table or an object with the fields differing from the prototype material, false if the
+///	entity uses the material template. "light" is the same, minus the table. Both tables are optional.
+///
+///	The binary format (all values little-endian):
+///		Header			: magic, version, section count
+///		Section table	: One entry per section; id, record size, record count, offset from the start of the file.
+///		Sections		: Tightly packed arrays of records (EntityRecord, TransformRecord, etc), 16 byte aligned.
+///						  The generation is stored as a section with a single record.
+///	Readers accept records larger than they know of (newer versions appending fields), which allows the
+///	format to be extended without breaking older files.
+namespace scene_file
+{
+	enum Format
+	{
+		FORMAT_JSON,
+		FORMAT_BINARY,
+		FORMAT_MSGPACK
+	};
+
+	/// @brief Picks the file format based on the extension of the specified file name.
+	Format FormatFromFilename(const char* filename);
+
+	/// @return True if the specified file name ends with ".lz", meaning the file should be compressed.
+	bool IsCompressedFilename(const char* filename);
+
+	/// @brief Loads a scene from a file, the format is decided by the file extension.
+	/// @return True if the scene was loaded successfully, false if not.
+	bool Load(const char* filename, SceneData& data);
+
+	/// @brief Saves a scene to a file, the format is decided by the file extension.
+	/// @return True if the scene was saved successfully, false if not.
+	bool Save(const char* filename, const SceneData& data);
+
+	/// @brief Converts a scene file from one format to another, the formats are decided by the file extensions.
+	/// @return True if the conversion was successful, false if not.
+	bool Convert(const char* src_filename, const char* dst_filename);
+
+	/// @brief Parses a JSON scene document.
+	bool ReadJson(const char* doc, int64_t length, SceneData& data);
+
+	/// @brief Generates a JSON scene document.
+	void WriteJson(const SceneData& data, std::string& out);
+
+	/// @brief Parses a MessagePack scene document.
+	bool ReadMsgPack(const char* doc, int64_t length, SceneData& data);
+
+	/// @brief Generates a MessagePack scene document.
+	void WriteMsgPack(const SceneData& data, std::string& out);
+
+	/// @brief Reads a binary scene.
+	bool ReadBinary(const char* buffer, int64_t length, SceneData& data);
+
+	/// @brief Generates a binary scene.
+	void WriteBinary(const SceneData& data, std::string& out);
+};
+
+
+#endif // __SCENEFILE_H__
@@ -0,0 +1,161 @@
+#include <framework/Common.h>
+
+#include "SceneGenerator.h"
+#include "Scene.h"
+
+#include <string.h>
+
+
+namespace scene_generator_internal
+{
+	/// Xorshift generator, rand() is avoided as its sequence differs between platforms.
+	class Random
+	{
+	public:
+		Random(uint32_t seed) : _state(seed ? seed : 0x9e3779b9)
+		{
+			// Mix the seed so that nearby seeds give unrelated sequences
+			for(int i = 0; i < 8; ++i)
+				Next();
+		}
+
+		uint32_t Next()
+		{
+			_state ^= _state << 13;
+			_state ^= _state >> 17;
+			_state ^= _state << 5;
+			return _state;
+		}
+
+		/// @return Value in [0, 1)
+		float NextFloat()
+		{
+			return (Next() >> 8) * (1.0f / 16777216.0f);
+		}
+
+		/// @return Value in [min, max)
+		float NextFloat(float min, float max)
+		{
+			return min + (max - min) * NextFloat();
+		}
+
+		/// @return Same distribution as the (rand() % 255) / 255 used for the colors of new entities
+		float NextColor()
+		{
+			return (Next() % 255) / 255.0f;
+		}
+
+	private:
+		uint32_t _state;
+	};
+
+	/// Picks a position on the XZ-plane according to the layout.
+	Vec3 NextPosition(const scene_generator::Params& params, const std::vector<Vec3>& clusters, Random& random)
+	{
+		using namespace scene_generator;
+
+		switch(params.layout)
+		{
+		case LAYOUT_CLUSTERED:
+			{
+				const Vec3& center = clusters[random.Next() % clusters.size()];
+
+				// Uniform within a disc around the cluster center
+				float angle = random.NextFloat(0.0f, (float)MATH_TWO_PI);
+				float distance = params.cluster_radius * sqrtf(random.NextFloat());
+				return Vec3(center.x + cosf(angle) * distance, 0.0f, center.z + sinf(angle) * distance);
+			}
+		case LAYOUT_OVERLAPPING:
+			// Tiny offsets keep the entities from being exactly identical
+			return Vec3(random.NextFloat(-0.01f, 0.01f), 0.0f, random.NextFloat(-0.01f, 0.01f));
+		default:
+			return Vec3(random.NextFloat(-params.extent, params.extent), 0.0f, random.NextFloat(-params.extent, params.extent));
+		};
+	}
+};
+
+void scene_generator::Generate(const Params& params, SceneData& data)
+{
+	using namespace scene_generator_internal;
+
+	data.Clear();
+
+	Random random(params.seed);
+
+	std::vector<Vec3> clusters;
+	if(params.layout == LAYOUT_CLUSTERED)
+	{
+		uint32_t cluster_count = std::max(params.cluster_count, 1u);
+		for(uint32_t i = 0; i < cluster_count; ++i)
+		{
+			clusters.push_back(Vec3(random.NextFloat(-params.extent, params.extent), 0.0f,
+				random.NextFloat(-params.extent, params.extent)));
+		}
+	}
+
+	uint32_t light_count = std::min(params.light_count, params.entity_count);
+
+	data.entities.resize(params.entity_count);
+	data.transforms.resize(params.entity_count);
+	data.materials.resize(params.entity_count);
+	for(uint32_t i = 0; i < params.entity_count; ++i)
+	{
+		EntityRecord& entity = data.entities[i];
+		TransformRecord& transform = data.transforms[i];
+		MaterialRecord& material = data.materials[i];
+
+		entity.flags = EntityRecord::HAS_MATERIAL;
+		entity.light = EntityRecord::NO_LIGHT;
+
+		transform.position = NextPosition(params, clusters, random);
+		transform.rotation = Vec3(0.0f, 0.0f, 0.0f);
+		transform.scale = Vec3(1.0f, 1.0f, 1.0f);
+
+		// Colors are set up the same way as for entities created by Scene::CreateEntity
+		if(i < light_count)
+		{
+			entity.type = Entity::ET_LIGHT;
+			transform.position.y = 2.0f;
+
+			material.ambient = Color(1.0f, 1.0f, 1.0f, 1.0f);
+			material.diffuse = Color(1.0f, 1.0f, 1.0f, 1.0f);
+			material.specular = Color(0.5f, 0.5f, 0.5f, 1.0f);
+
+			LightRecord light;
+			light.ambient = Color(0.0f, 0.0f, 0.0f);
+			light.diffuse = Color(random.NextColor(), random.NextColor(), random.NextColor());
+			light.specular = Color(0.25f, 0.25f, 0.25f);
+			light.radius = 7.5f;
+
+			entity.light = (uint32_t)data.lights.size();
+			data.lights.push_back(light);
+		}
+		else
+		{
+			entity.type = Entity::ET_PYRAMID + random.Next() % 3;
+
+			float scale = random.NextFloat(0.5f, 2.0f);
+			transform.rotation.x = random.NextFloat(0.0f, (float)MATH_TWO_PI);
+			transform.scale = Vec3(scale, scale, scale);
+
+			material.ambient = Color(0.0f, 0.0f, 0.0f, 1.0f);
+			material.diffuse = Color(random.NextColor(), random.NextColor(), random.NextColor());
+			material.specular = material.diffuse;
+		}
+	}
+
+	data.AssignIds();
+}
+bool scene_generator::LayoutFromName(const char* name, Layout& layout)
+{
+	if(strcmp(name, "uniform") == 0)
+		layout = LAYOUT_UNIFORM;
+	else if(strcmp(name, "clustered") == 0)
+		layout = LAYOUT_CLUSTERED;
+	else if(strcmp(name, "overlapping") == 0)
+		layout = LAYOUT_OVERLAPPING;
+	else
+		return false;
+
+	return true;
+}
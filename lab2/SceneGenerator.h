@@ -0,0 +1,43 @@
+#ifndef __SCENEGENERATOR_H__
+#define __SCENEGENERATOR_H__
+
+#include "SceneFile.h"
+
+/// @brief Generates large scenes for testing loading, picking and rendering at scale.
+///
+///	Generation is deterministic, the same parameters (including the seed) always give the same scene.
+///	Entities are placed on the XZ-plane (See Scene::ToWorld) with a mix of all entity types, the first
+///	light_count entities are lights.
+namespace scene_generator
+{
+	enum Layout
+	{
+		LAYOUT_UNIFORM, // Spread evenly over the whole area
+		LAYOUT_CLUSTERED, // Grouped in clusters at random positions within the area
+		LAYOUT_OVERLAPPING // All entities on top of each other at the center, the worst case for picking and culling
+	};
+
+	struct Params
+	{
+		uint32_t seed;
+		uint32_t entity_count; // Total number of entities, including lights
+		uint32_t light_count; // Number of lights, should not exceed Scene::MAX_LIGHT_COUNT
+		Layout layout;
+		float extent; // Entities are placed within [-extent, extent] on both axes
+		uint32_t cluster_count; // Number of clusters for LAYOUT_CLUSTERED
+		float cluster_radius;
+
+		Params() : seed(1), entity_count(1000), light_count(4), layout(LAYOUT_UNIFORM), extent(100.0f),
+			cluster_count(16), cluster_radius(10.0f) {}
+	};
+
+	/// @brief Generates a scene, any previous contents of data are replaced.
+	void Generate(const Params& params, SceneData& data);
+
+	/// @brief Looks up a layout by its name ("uniform", "clustered" or "overlapping").
+	/// @return True if the name is valid, false if not.
+	bool LayoutFromName(const char* name, Layout& layout);
+};
+
+
+#endif // __SCENEGENERATOR_H__
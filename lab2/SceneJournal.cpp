@@ -0,0 +1,458 @@
+#include <framework/Common.h>
+
+#include "SceneJournal.h"
+#include "SceneSchema.h"
+
+#include <framework/FileSystem.h>
+
+#include <errno.h>
+#include <random>
+#include <stdio.h>
+
+
+namespace scene_journal_internal
+{
+	const uint32_t journal_magic = 0x4c4a4353; // "SCJL"
+	const uint32_t journal_version = 2;
+
+	const size_t header_size_v1 = 8; // Version 1 had no generation
+	const size_t header_size = 12;
+	const size_t entry_header_size = 16;
+
+	/// FNV-1a, used to detect entries that were only partially written.
+	uint32_t Checksum(const char* data, size_t size, uint32_t hash = 2166136261u)
+	{
+		for(size_t i = 0; i < size; ++i)
+		{
+			hash ^= (uint8_t)data[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	uint32_t ReadWord(const char* p)
+	{
+		const char* src = p;
+		uint32_t value;
+		reflection::ReadBinary(src, value);
+		return value;
+	}
+
+	/// Reads the header of a journal.
+	/// @param size Set to the size of the header.
+	/// @return False if the data doesn't start with a valid header.
+	bool ReadHeader(const char* data, size_t length, size_t& size, uint32_t& generation)
+	{
+		if(length < header_size_v1 || ReadWord(data) != journal_magic || ReadWord(data + 4) > journal_version)
+			return false;
+
+		size = header_size_v1;
+		generation = 0;
+		if(ReadWord(data + 4) >= 2)
+		{
+			if(length < header_size)
+				return false;
+			size = header_size;
+			generation = ReadWord(data + 8);
+		}
+		return true;
+	}
+
+	/// Reads a record from the payload of an entry, advancing the payload.
+	template<typename T>
+	bool ReadRecord(const char*& payload, const char* payload_end, T& record)
+	{
+		if((size_t)(payload_end - payload) < reflection::BinarySize((const T*)0))
+			return false;
+
+		reflection::ReadBinary(payload, record);
+		return true;
+	}
+
+	/// Applies journal entries to a scene, entities are looked up by their IDs.
+	struct Replayer
+	{
+		SceneData& data;
+		std::map<uint32_t, uint32_t> indices; // ID => Index in data
+		std::vector<bool> removed;
+
+		Replayer(SceneData& d) : data(d)
+		{
+			data.AssignIds();
+			for(uint32_t i = 0; i < data.Size(); ++i)
+			{
+				indices[data.ids[i]] = i;
+			}
+			removed.resize(data.Size(), false);
+		}
+
+		/// @return Index of the entity with the specified ID, or -1 if none.
+		int Find(uint32_t id)
+		{
+			std::map<uint32_t, uint32_t>::iterator it = indices.find(id);
+			if(it == indices.end() || removed[it->second])
+				return -1;
+			return (int)it->second;
+		}
+
+		void SetLight(uint32_t index, const LightRecord& light)
+		{
+			EntityRecord& entity = data.entities[index];
+			if(entity.light == EntityRecord::NO_LIGHT)
+			{
+				entity.light = (uint32_t)data.lights.size();
+				data.lights.push_back(light);
+			}
+			else
+			{
+				data.lights[entity.light] = light;
+			}
+		}
+
+		bool Apply(uint32_t type, uint32_t id, const char* payload, const char* payload_end)
+		{
+			switch(type)
+			{
+			case SceneJournal::ENTRY_CREATED:
+				{
+					EntityRecord entity;
+					TransformRecord transform;
+					MaterialRecord material;
+					if(!ReadRecord(payload, payload_end, entity) ||
+						!ReadRecord(payload, payload_end, transform) ||
+						!ReadRecord(payload, payload_end, material))
+						return false;
+
+					LightRecord light;
+					bool has_light = (entity.light != EntityRecord::NO_LIGHT);
+					if(has_light && !ReadRecord(payload, payload_end, light))
+						return false;
+					entity.light = EntityRecord::NO_LIGHT;
+
+					// Creating an entity that already exists replaces it
+					std::map<uint32_t, uint32_t>::iterator it = indices.find(id);
+					uint32_t index;
+					if(it != indices.end())
+					{
+						index = it->second;
+						removed[index] = false;
+					}
+					else
+					{
+						index = data.Size();
+						data.ids.push_back(id);
+						data.entities.push_back(entity);
+						data.transforms.push_back(transform);
+						data.materials.push_back(material);
+						removed.push_back(false);
+						indices[id] = index;
+					}
+					data.entities[index].type = entity.type;
+					data.entities[index].flags = entity.flags;
+					data.transforms[index] = transform;
+					data.materials[index] = material;
+
+					if(has_light)
+						SetLight(index, light);
+					else
+						data.entities[index].light = EntityRecord::NO_LIGHT;
+				}
+				break;
+			case SceneJournal::ENTRY_DESTROYED:
+				{
+					int index = Find(id);
+					if(index != -1)
+						removed[index] = true;
+				}
+				break;
+			case SceneJournal::ENTRY_TRANSFORM:
+				{
+					TransformRecord transform;
+					if(!ReadRecord(payload, payload_end, transform))
+						return false;
+
+					int index = Find(id);
+					if(index != -1)
+						data.transforms[index] = transform;
+				}
+				break;
+			case SceneJournal::ENTRY_MATERIAL:
+				{
+					MaterialRecord material;
+					if(!ReadRecord(payload, payload_end, material))
+						return false;
+
+					int index = Find(id);
+					if(index != -1)
+					{
+						data.materials[index] = material;
+						data.entities[index].flags |= EntityRecord::HAS_MATERIAL;
+					}
+				}
+				break;
+			case SceneJournal::ENTRY_LIGHT:
+				{
+					LightRecord light;
+					if(!ReadRecord(payload, payload_end, light))
+						return false;
+
+					int index = Find(id);
+					if(index != -1)
+						SetLight(index, light);
+				}
+				break;
+			default:
+				break; // Unknown entries are skipped
+			};
+			return true;
+		}
+
+		/// Removes destroyed entities and any lights no longer referenced, keeping the order of the rest.
+		void Finish()
+		{
+			SceneData result;
+			for(uint32_t i = 0; i < data.Size(); ++i)
+			{
+				if(removed[i])
+					continue;
+
+				EntityRecord entity = data.entities[i];
+				if(entity.light != EntityRecord::NO_LIGHT)
+				{
+					result.lights.push_back(data.lights[entity.light]);
+					entity.light = (uint32_t)result.lights.size() - 1;
+				}
+
+				result.ids.push_back(data.ids[i]);
+				result.entities.push_back(entity);
+				result.transforms.push_back(data.transforms[i]);
+				result.materials.push_back(data.materials[i]);
+			}
+
+			std::swap(data.ids, result.ids);
+			std::swap(data.entities, result.entities);
+			std::swap(data.transforms, result.transforms);
+			std::swap(data.materials, result.materials);
+			std::swap(data.lights, result.lights);
+		}
+	};
+};
+
+//-------------------------------------------------------------------------------
+SceneJournal::SceneJournal() : _pending_count(0)
+{
+}
+SceneJournal::~SceneJournal()
+{
+}
+//-------------------------------------------------------------------------------
+void SceneJournal::EntityCreated(uint32_t id, const EntityRecord& entity, const TransformRecord& transform,
+	const MaterialRecord& material, const LightRecord& light)
+{
+	std::string payload;
+	reflection::WriteBinary(entity, payload);
+	reflection::WriteBinary(transform, payload);
+	reflection::WriteBinary(material, payload);
+	if(entity.light != EntityRecord::NO_LIGHT)
+		reflection::WriteBinary(light, payload);
+
+	AddEntry(ENTRY_CREATED, id, payload);
+}
+void SceneJournal::EntityDestroyed(uint32_t id)
+{
+	AddEntry(ENTRY_DESTROYED, id, std::string());
+}
+void SceneJournal::TransformChanged(uint32_t id, const TransformRecord& transform)
+{
+	std::string payload;
+	reflection::WriteBinary(transform, payload);
+	AddEntry(ENTRY_TRANSFORM, id, payload);
+}
+void SceneJournal::MaterialChanged(uint32_t id, const MaterialRecord& material)
+{
+	std::string payload;
+	reflection::WriteBinary(material, payload);
+	AddEntry(ENTRY_MATERIAL, id, payload);
+}
+void SceneJournal::LightChanged(uint32_t id, const LightRecord& light)
+{
+	std::string payload;
+	reflection::WriteBinary(light, payload);
+	AddEntry(ENTRY_LIGHT, id, payload);
+}
+void SceneJournal::AddEntry(uint32_t type, uint32_t id, const std::string& payload)
+{
+	using namespace scene_journal_internal;
+
+	size_t offset = _entries.size();
+	reflection::WriteBinary(type, _entries);
+	reflection::WriteBinary(id, _entries);
+	reflection::WriteBinary((uint32_t)payload.size(), _entries);
+
+	// Checksum covers the header fields before it and the payload
+	uint32_t checksum = Checksum(_entries.data() + offset, 12);
+	checksum = Checksum(payload.data(), payload.size(), checksum);
+	reflection::WriteBinary(checksum, _entries);
+
+	_entries += payload;
+	++_pending_count;
+}
+uint32_t SceneJournal::PendingCount() const
+{
+	return _pending_count;
+}
+void SceneJournal::Clear()
+{
+	std::string().swap(_entries);
+	_pending_count = 0;
+}
+//-------------------------------------------------------------------------------
+bool SceneJournal::Append(const char* filename, uint32_t generation)
+{
+	using namespace scene_journal_internal;
+
+	if(_pending_count == 0)
+		return true;
+
+	// A new journal starts with the header, an existing one needs to build on the same snapshot. A journal of
+	//	another generation is either left behind by a full save or still belongs to the snapshot on disk (e.g.
+	//	if the full save failed), so it can neither be appended to nor replaced.
+	bool exists = false;
+	{
+		file_system::MappedFile file;
+		size_t size;
+		uint32_t file_generation;
+		exists = file.Open(filename) && ReadHeader(file.Data(), file.Size(), size, file_generation);
+		if(exists && file_generation != generation)
+		{
+			debug::Printf("Scene: Journal '%s' belongs to another snapshot of the scene.\n", filename);
+			return false;
+		}
+	}
+
+	file_system::FileWriter writer;
+	if(!writer.Open(filename, exists ? file_system::FileWriter::APPEND : 0))
+	{
+		debug::Printf("Scene: Failed to open journal '%s'.\n", filename);
+		return false;
+	}
+
+	if(!exists)
+	{
+		std::string header;
+		reflection::WriteBinary(journal_magic, header);
+		reflection::WriteBinary(journal_version, header);
+		reflection::WriteBinary(generation, header);
+		writer.Write(header.data(), header.size());
+	}
+	writer.Write(_entries.data(), _entries.size());
+
+	if(!writer.Commit())
+	{
+		debug::Printf("Scene: Failed to write journal '%s'.\n", filename);
+		return false;
+	}
+
+	_entries.clear();
+	_pending_count = 0;
+	return true;
+}
+bool SceneJournal::Replay(const char* filename, SceneData& data, uint32_t& entry_count)
+{
+	using namespace scene_journal_internal;
+
+	entry_count = 0;
+
+	file_system::MappedFile file;
+	if(!file.Open(filename) || file.Size() == 0)
+		return true; // No journal
+
+	const char* cur = file.Data();
+	const char* end = cur + file.Size();
+
+	size_t size;
+	uint32_t generation;
+	if(!ReadHeader(cur, file.Size(), size, generation))
+	{
+		debug::Printf("Scene: '%s' is not a valid scene journal.\n", filename);
+		return false;
+	}
+	if(generation != data.generation)
+	{
+		debug::Printf("Scene: Journal '%s' belongs to another snapshot of the scene, it was ignored.\n", filename);
+		return false;
+	}
+	cur += size;
+
+	// Reason for stopping before the end of the file, NULL if every entry was applied
+	const char* problem = NULL;
+
+	Replayer replayer(data);
+	while(cur != end)
+	{
+		if((size_t)(end - cur) < entry_header_size)
+		{
+			problem = "ends with an incomplete entry";
+			break;
+		}
+
+		uint32_t type = ReadWord(cur);
+		uint32_t id = ReadWord(cur + 4);
+		uint32_t size = ReadWord(cur + 8);
+		uint32_t checksum = ReadWord(cur + 12);
+
+		const char* payload = cur + entry_header_size;
+		if(size > (size_t)(end - payload))
+		{
+			problem = "ends with an incomplete entry";
+			break;
+		}
+		if(checksum != Checksum(payload, size, Checksum(cur, 12)))
+		{
+			// The last entry may have been cut short by a crash while appending, anything before it was complete
+			problem = payload + size == end ? "ends with an incomplete entry" : "is corrupt (Checksum mismatch)";
+			break;
+		}
+		if(!replayer.Apply(type, id, payload, payload + size))
+		{
+			problem = "is corrupt (Invalid entry)";
+			break;
+		}
+
+		cur = payload + size;
+		++entry_count;
+	}
+	replayer.Finish();
+
+	if(problem)
+	{
+		debug::Printf("Scene: Journal '%s' %s, %u entries were applied and the remaining %u bytes were dropped.\n",
+			filename, problem, entry_count, (uint32_t)(end - cur));
+		return false;
+	}
+	return true;
+}
+bool SceneJournal::Remove(const char* filename)
+{
+	if(remove(filename) == 0 || errno == ENOENT)
+		return true;
+
+	debug::Printf("Scene: Failed to remove journal '%s'.\n", filename);
+	return false;
+}
+uint32_t SceneJournal::NewGeneration()
+{
+	static std::random_device device;
+
+	uint32_t generation;
+	do
+	{
+		generation = device();
+	}
+	while(generation == 0);
+	return generation;
+}
+std::string SceneJournal::JournalFilename(const char* scene_filename)
+{
+	return std::string(scene_filename) + ".journal";
+}
@@ -0,0 +1,83 @@
+#ifndef __SCENEJOURNAL_H__
+#define __SCENEJOURNAL_H__
+
+#include "SceneFile.h"
+
+#include <string>
+
+/// @brief Append-only log of changes made to a scene since it was last saved in full.
+///
+///	Saving only the changes makes the cost of a save proportional to the number of edits rather than
+///	the size of the scene. The journal for a scene file is stored next to it, as "<scene file>.journal".
+///	Loading a scene means loading the full snapshot and then replaying the journal on top of it.
+///
+///	File format (all values little-endian):
+///		Header	: magic, version, generation (Since version 2)
+///		Entries	: type, entity ID, payload size, checksum, payload (Records in the binary format, see reflection)
+///	Every entry holds the complete new state of whatever it changes, rather than a delta. The generation ties
+///	the journal to the snapshot it builds on (See SceneData::generation). Every full save gets a new generation,
+///	so a journal left behind by a full save (e.g. after a crash before it was removed) no longer matches and is
+///	never replayed on top of the newer snapshot. Journals from version 1 have generation 0.
+///	An entry with a checksum mismatch or that is cut short ends the replay, everything before it is kept.
+class SceneJournal
+{
+public:
+	enum EntryType
+	{
+		ENTRY_CREATED = 1, // Payload: EntityRecord, TransformRecord, MaterialRecord and LightRecord for lights
+		ENTRY_DESTROYED = 2, // No payload
+		ENTRY_TRANSFORM = 3, // Payload: TransformRecord
+		ENTRY_MATERIAL = 4, // Payload: MaterialRecord
+		ENTRY_LIGHT = 5 // Payload: LightRecord
+	};
+
+	SceneJournal();
+	~SceneJournal();
+
+	/// @brief Adds an entry for a new entity, light is only used if entity.light is not NO_LIGHT.
+	void EntityCreated(uint32_t id, const EntityRecord& entity, const TransformRecord& transform,
+		const MaterialRecord& material, const LightRecord& light);
+	void EntityDestroyed(uint32_t id);
+	void TransformChanged(uint32_t id, const TransformRecord& transform);
+	void MaterialChanged(uint32_t id, const MaterialRecord& material);
+	void LightChanged(uint32_t id, const LightRecord& light);
+
+	/// @return Number of entries added since the last call to Append.
+	uint32_t PendingCount() const;
+
+	/// @brief Removes all added entries and releases their memory.
+	void Clear();
+
+	/// @brief Appends all added entries to the specified journal file, the file is created if it doesn't exist.
+	/// @param generation Generation of the snapshot the entries build on.
+	/// @return True if successful, false if not. The entries are kept on failure. Appending to a journal of another
+	///			generation fails, the scene needs to be saved in full instead.
+	bool Append(const char* filename, uint32_t generation);
+
+	/// @brief Replays a journal file on the specified scene data. A missing journal is treated as an empty journal.
+	/// @param entry_count Set to the number of entries replayed.
+	/// @return False if the file is not a valid journal, if it was written for another generation than the scene
+	///			data (Nothing is replayed), or if it ends with an incomplete entry or holds a corrupt one (The entries
+	///			before it are still replayed, the rest is dropped). Either way the scene should be saved in full, as
+	///			the journal can't be appended to.
+	static bool Replay(const char* filename, SceneData& data, uint32_t& entry_count);
+
+	/// @brief Removes the specified journal, e.g. after the scene has been saved in full.
+	/// @return True if the journal was removed or didn't exist, false if not.
+	static bool Remove(const char* filename);
+
+	/// @return A new snapshot generation, never 0.
+	static uint32_t NewGeneration();
+
+	/// @return The journal file name for the specified scene file.
+	static std::string JournalFilename(const char* scene_filename);
+
+private:
+	std::string _entries; // Entries waiting to be appended to the file
+	uint32_t _pending_count;
+
+	void AddEntry(uint32_t type, uint32_t id, const std::string& payload);
+};
+
+
+#endif // __SCENEJOURNAL_H__
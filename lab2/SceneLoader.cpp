@@ -0,0 +1,199 @@
+#include <framework/Common.h>
+
+#include "SceneLoader.h"
+#include "SceneJournal.h"
+#include "Scene.h"
+
+#include <chrono>
+
+
+namespace scene_loader_internal
+{
+	/// Number of entities integrated between checks of the time budget.
+	const uint32_t integrate_batch_size = 256;
+
+	typedef std::chrono::high_resolution_clock Clock;
+};
+
+SceneLoader::SceneLoader(Scene* scene)
+	: _scene(scene),
+	_job(NULL),
+	_integrated(0),
+	_state(IDLE)
+{
+}
+SceneLoader::~SceneLoader()
+{
+	JoinWorker();
+	delete _job;
+	_job = NULL;
+}
+//-------------------------------------------------------------------------------
+void SceneLoader::Load(const char* filename)
+{
+	Start(filename, false);
+}
+void SceneLoader::Reload(const char* filename)
+{
+	Start(filename, true);
+}
+void SceneLoader::Start(const char* filename, bool reload)
+{
+	// Abandon any load in progress, a parse can't be interrupted so we have to wait for it
+	JoinWorker();
+	delete _job;
+	_data.Clear();
+	_integrated = 0;
+
+	_job = new Job;
+	_job->filename = filename;
+	_job->journal_entry_count = 0;
+	_job->journal_valid = true;
+	_job->reload = reload;
+	_job->result = false;
+	_job->done = false;
+
+	_state = PARSING;
+	_thread = std::thread(&SceneLoader::Parse, _job, &_mutex);
+}
+void SceneLoader::Update(float time_budget)
+{
+	if(_state == PARSING && !BeginIntegrate())
+		return;
+
+	if(_state == INTEGRATING)
+		Integrate(time_budget);
+}
+bool SceneLoader::Finish()
+{
+	if(_state == IDLE)
+		return false;
+
+	if(_state == PARSING)
+	{
+		JoinWorker();
+		if(!BeginIntegrate())
+			return false;
+	}
+
+	Integrate(-1.0f);
+	return true;
+}
+//-------------------------------------------------------------------------------
+SceneLoader::State SceneLoader::GetState() const
+{
+	return _state;
+}
+bool SceneLoader::Loading() const
+{
+	return _state != IDLE;
+}
+bool SceneLoader::Reloading() const
+{
+	return _state == PARSING && _job->reload;
+}
+float SceneLoader::Progress() const
+{
+	if(_state == IDLE)
+		return 1.0f;
+	if(_state == PARSING || _data.Size() == 0)
+		return 0.0f;
+
+	return (float)_integrated / (float)_data.Size();
+}
+uint32_t SceneLoader::IntegratedCount() const
+{
+	return _integrated;
+}
+uint32_t SceneLoader::TotalCount() const
+{
+	return _data.Size();
+}
+//-------------------------------------------------------------------------------
+bool SceneLoader::BeginIntegrate()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(!_job->done)
+			return false; // Still parsing
+	}
+	JoinWorker();
+
+	Job* job = _job;
+	_job = NULL;
+
+	if(!job->result)
+	{
+		debug::Printf("Scene: Failed to load '%s'.\n", job->filename.c_str());
+		delete job;
+		_state = IDLE;
+		return false;
+	}
+
+	if(job->reload)
+	{
+		Scene::ReconcileResult result;
+		_scene->Reconcile(job->data, result);
+		debug::Printf("Scene: Reloaded '%s', %d created, %d updated and %d destroyed.\n", job->filename.c_str(),
+			result.created, result.updated, result.destroyed);
+		delete job;
+
+		_state = IDLE;
+		return true;
+	}
+
+	// Swap rather than copy, the records may be large
+	_data.Swap(job->data);
+	_integrated = 0;
+
+	_scene->BeginIntegrate(_data, job->journal_entry_count, job->journal_valid);
+	delete job;
+
+	_state = INTEGRATING;
+	return true;
+}
+void SceneLoader::Integrate(float time_budget)
+{
+	using namespace scene_loader_internal;
+
+	Clock::time_point start = Clock::now();
+	uint32_t count = _data.Size();
+	while(_integrated < count)
+	{
+		uint32_t end = std::min(_integrated + integrate_batch_size, count);
+		_scene->Integrate(_data, _integrated, end);
+		_integrated = end;
+
+		if(time_budget >= 0.0f &&
+			std::chrono::duration<float>(Clock::now() - start).count() >= time_budget)
+			break;
+	}
+
+	if(_integrated == count)
+	{
+		_data.Clear();
+		_integrated = 0;
+		_state = IDLE;
+	}
+}
+//-------------------------------------------------------------------------------
+void SceneLoader::JoinWorker()
+{
+	if(_thread.joinable())
+		_thread.join();
+}
+void SceneLoader::Parse(Job* job, std::mutex* mutex)
+{
+	bool result = scene_file::Load(job->filename.c_str(), job->data);
+	if(result)
+	{
+		// Apply any changes saved after the last full save
+		job->journal_valid = SceneJournal::Replay(SceneJournal::JournalFilename(job->filename.c_str()).c_str(),
+			job->data, job->journal_entry_count);
+		job->data.AssignIds();
+	}
+
+	std::lock_guard<std::mutex> lock(*mutex);
+	job->result = result;
+	job->done = true;
+}
@@ -0,0 +1,105 @@
+#ifndef __SCENELOADER_H__
+#define __SCENELOADER_H__
+
+#include "SceneFile.h"
+
+#include <thread>
+#include <mutex>
+
+class Scene;
+
+/// @brief Loads scenes without stalling the main thread.
+///
+///	Loading is split into two stages:
+///		Parsing		: Reading the file and replaying its journal, done on a worker thread. The scene keeps
+///					  its current entities during this stage.
+///		Integrating	: Creating entities from the parsed records, done on the main thread by Update. The
+///					  scene is cleared when this stage begins and entities are then created in batches,
+///					  limited by a time budget for every frame. The scene can be rendered and edited while
+///					  the remaining entities stream in.
+///
+///	The scene must not be saved while loading, as the snapshot would miss any entities not yet integrated,
+///	call Finish before saving.
+class SceneLoader
+{
+public:
+	enum State
+	{
+		IDLE,
+		PARSING,
+		INTEGRATING
+	};
+
+	SceneLoader(Scene* scene);
+	/// Waits for the worker thread, any load in progress is abandoned.
+	~SceneLoader();
+
+	/// @brief Starts loading the specified scene file. Any load already in progress is abandoned.
+	void Load(const char* filename);
+
+	/// @brief Starts reloading the specified scene file, e.g. after it has been modified by another tool. Rather than
+	///			replacing the scene, the differences are applied once parsed (See Scene::Reconcile), which is done
+	///			in a single update. Any load already in progress is abandoned.
+	void Reload(const char* filename);
+
+	/// @brief Integrates parsed entities into the scene, expected to be called once every frame.
+	/// @param time_budget Maximum time in seconds to spend on integrating entities.
+	void Update(float time_budget);
+
+	/// @brief Completes the load in progress, if any, blocking until the scene is fully loaded.
+	/// @return True if a scene was loaded, false if not or if the load failed.
+	bool Finish();
+
+	State GetState() const;
+	/// @return True if a load is in progress.
+	bool Loading() const;
+	/// @return True if the load in progress is a reload.
+	bool Reloading() const;
+
+	/// @return Loading progress, in the range [0, 1]. The parsing stage reports 0 as its duration is unknown.
+	float Progress() const;
+
+	/// @return Number of entities integrated and the total number of entities in the scene being loaded.
+	uint32_t IntegratedCount() const;
+	uint32_t TotalCount() const;
+
+private:
+	/// Result of the parsing stage.
+	struct Job
+	{
+		std::string filename;
+		SceneData data;
+		uint32_t journal_entry_count;
+		bool journal_valid;
+		bool reload; // Reconcile rather than integrate
+		bool result;
+		bool done;
+	};
+
+	Scene* _scene;
+
+	std::thread _thread;
+	std::mutex _mutex;
+	Job* _job; // Job currently being parsed, owned by the worker until done is set
+
+	SceneData _data; // Records being integrated
+	uint32_t _integrated;
+	State _state;
+
+	/// Starts the integration stage if the parsing stage is done, a reload is applied directly.
+	/// @return False if the parsing stage failed.
+	bool BeginIntegrate();
+	/// Integrates entities until the time budget is spent, a negative budget integrates everything.
+	void Integrate(float time_budget);
+
+	/// Starts the parsing stage.
+	void Start(const char* filename, bool reload);
+	void JoinWorker();
+	static void Parse(Job* job, std::mutex* mutex);
+
+	SceneLoader(const SceneLoader&);
+	SceneLoader& operator=(const SceneLoader&);
+};
+
+
+#endif // __SCENELOADER_H__
@@ -0,0 +1,144 @@
+#include <framework/Common.h>
+
+#include "SceneSaver.h"
+
+
+SceneSaver::SceneSaver()
+	: _callback(NULL),
+	_user_data(NULL),
+	_stop(false)
+{
+}
+SceneSaver::~SceneSaver()
+{
+	Wait();
+
+	if(_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_job_added.notify_one();
+		_thread.join();
+	}
+}
+void SceneSaver::SetCallback(Callback callback, void* user_data)
+{
+	_callback = callback;
+	_user_data = user_data;
+}
+//-------------------------------------------------------------------------------
+void SceneSaver::SaveSnapshot(const char* filename, SceneData& data)
+{
+	Job* job = new Job;
+	job->type = Job::SNAPSHOT;
+	job->filename = filename;
+	job->result = false;
+
+	// Swap rather than copy, the snapshot may be large
+	job->data.Swap(data);
+	job->generation = job->data.generation;
+	data.Clear();
+
+	Submit(job);
+}
+void SceneSaver::AppendJournal(const char* filename, const SceneJournal& journal, uint32_t generation)
+{
+	Job* job = new Job;
+	job->type = Job::JOURNAL;
+	job->filename = filename;
+	job->journal = journal;
+	job->generation = generation;
+	job->result = false;
+
+	Submit(job);
+}
+void SceneSaver::Submit(Job* job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.push_back(job);
+	}
+
+	// The worker is started on the first job
+	if(!_thread.joinable())
+		_thread = std::thread(&SceneSaver::Run, this);
+
+	_job_added.notify_one();
+}
+//-------------------------------------------------------------------------------
+void SceneSaver::Update()
+{
+	std::vector<Job*> completed;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		completed.swap(_completed);
+	}
+
+	for(size_t i = 0; i < completed.size(); ++i)
+	{
+		if(_callback)
+			_callback(completed[i]->filename.c_str(), completed[i]->result, _user_data);
+		delete completed[i];
+	}
+}
+void SceneSaver::Wait()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while(!_queue.empty())
+			_job_completed.wait(lock);
+	}
+	Update();
+}
+bool SceneSaver::Busy()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return !_queue.empty();
+}
+//-------------------------------------------------------------------------------
+void SceneSaver::Run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(true)
+	{
+		while(_queue.empty() && !_stop)
+			_job_added.wait(lock);
+
+		if(_queue.empty())
+			break; // Stopped
+
+		// The job is left in the queue while executing, that way Busy and Wait see it as pending.
+		Job* job = _queue.front();
+
+		lock.unlock();
+		Execute(job);
+		lock.lock();
+
+		_queue.pop_front();
+		_completed.push_back(job);
+		_job_completed.notify_all();
+	}
+}
+void SceneSaver::Execute(Job* job)
+{
+	if(job->type == Job::SNAPSHOT)
+	{
+		job->result = scene_file::Save(job->filename.c_str(), job->data);
+
+		// The snapshot includes everything in the journal. A journal that is left behind is never replayed, but
+		//	it's reported as a failure so that the next save is a full save which retries removing it.
+		if(job->result)
+			job->result = SceneJournal::Remove(SceneJournal::JournalFilename(job->filename.c_str()).c_str());
+	}
+	else
+	{
+		job->result = job->journal.Append(SceneJournal::JournalFilename(job->filename.c_str()).c_str(), job->generation);
+	}
+
+	// Release the memory on the worker rather than in Update, clearing the records alone would keep their
+	//	capacity until the job is deleted
+	SceneData().Swap(job->data);
+	job->journal.Clear();
+}
@@ -0,0 +1,86 @@
+#ifndef __SCENESAVER_H__
+#define __SCENESAVER_H__
+
+#include "SceneFile.h"
+#include "SceneJournal.h"
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// @brief Writes scene snapshots and journals on a background thread.
+///
+///	The caller hands over a snapshot of compact records (See Scene::Snapshot), so the only work left on
+///	the main thread is copying the entity state. Serialization, compression and the file writes all happen
+///	on the worker thread. Jobs are executed one at a time in the order they were submitted, that way a
+///	journal append can never overtake the snapshot it builds on.
+///
+///	Completion is reported through a callback, which is invoked on the thread calling Update or Wait.
+class SceneSaver
+{
+public:
+	/// @param result True if the job was successful, false if not.
+	typedef void (*Callback)(const char* filename, bool result, void* user_data);
+
+	SceneSaver();
+	/// Waits for all submitted jobs before returning.
+	~SceneSaver();
+
+	/// @brief Sets the function called once for every completed job.
+	void SetCallback(Callback callback, void* user_data);
+
+	/// @brief Saves a complete scene and removes its journal, data is taken over by the saver and left empty.
+	void SaveSnapshot(const char* filename, SceneData& data);
+
+	/// @brief Appends the entries of the specified journal to the journal of the scene file.
+	/// @param generation Generation of the snapshot the entries build on (See SceneJournal::Append).
+	void AppendJournal(const char* filename, const SceneJournal& journal, uint32_t generation);
+
+	/// @brief Invokes the callback for all jobs completed since the last call, expected to be called once every frame.
+	void Update();
+
+	/// @brief Blocks until all submitted jobs are complete and then invokes the callback for them.
+	void Wait();
+
+	/// @return True if there are jobs that are not yet completed.
+	bool Busy();
+
+private:
+	struct Job
+	{
+		enum Type
+		{
+			SNAPSHOT,
+			JOURNAL
+		};
+		Type type;
+		std::string filename;
+		SceneData data;
+		SceneJournal journal;
+		uint32_t generation; // Generation of the journal
+		bool result;
+	};
+
+	Callback _callback;
+	void* _user_data;
+
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _job_added;
+	std::condition_variable _job_completed;
+
+	std::deque<Job*> _queue; // Jobs waiting to be executed, the first job is the one currently executing
+	std::vector<Job*> _completed; // Jobs waiting for their callback
+	bool _stop;
+
+	void Submit(Job* job);
+	void Run();
+	static void Execute(Job* job);
+
+	SceneSaver(const SceneSaver&);
+	SceneSaver& operator=(const SceneSaver&);
+};
+
+
+#endif // __SCENESAVER_H__
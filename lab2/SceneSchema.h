@@ -0,0 +1,78 @@
+#ifndef __SCENESCHEMA_H__
+#define __SCENESCHEMA_H__
+
+#include "SceneFile.h"
+
+#include <framework/Reflection.h>
+
+/// @brief Field descriptors for the scene records (See reflection::Schema).
+///	The field names are the keys used in the JSON and MessagePack scene documents, and the field
+///	order is the order used in the binary scene format.
+namespace reflection
+{
+	template<> struct Schema<Color>
+	{
+		static const Layout layout = LAYOUT_ARRAY;
+
+		template<typename Visitor> static void Visit(Visitor& v)
+		{
+			v.Field("r", &Color::r);
+			v.Field("g", &Color::g);
+			v.Field("b", &Color::b);
+			v.Field("a", &Color::a);
+		}
+	};
+
+	template<> struct Schema<EntityRecord>
+	{
+		static const Layout layout = LAYOUT_OBJECT;
+
+		template<typename Visitor> static void Visit(Visitor& v)
+		{
+			v.Field("type", &EntityRecord::type);
+			v.Field("flags", &EntityRecord::flags);
+			v.Field("light", &EntityRecord::light);
+		}
+	};
+
+	/// Entity transform, stored directly in the entity node.
+	template<> struct Schema<TransformRecord>
+	{
+		static const Layout layout = LAYOUT_OBJECT;
+
+		template<typename Visitor> static void Visit(Visitor& v)
+		{
+			v.Field("rotation", &TransformRecord::rotation);
+			v.Field("position", &TransformRecord::position);
+			v.Field("scale", &TransformRecord::scale);
+		}
+	};
+
+	template<> struct Schema<MaterialRecord>
+	{
+		static const Layout layout = LAYOUT_OBJECT;
+
+		template<typename Visitor> static void Visit(Visitor& v)
+		{
+			v.Field("ambient", &MaterialRecord::ambient);
+			v.Field("specular", &MaterialRecord::specular);
+			v.Field("diffuse", &MaterialRecord::diffuse);
+		}
+	};
+
+	template<> struct Schema<LightRecord>
+	{
+		static const Layout layout = LAYOUT_OBJECT;
+
+		template<typename Visitor> static void Visit(Visitor& v)
+		{
+			v.Field("ambient", &LightRecord::ambient);
+			v.Field("diffuse", &LightRecord::diffuse);
+			v.Field("specular", &LightRecord::specular);
+			v.Field("radius", &LightRecord::radius);
+		}
+	};
+};
+
+
+#endif // __SCENESCHEMA_H__
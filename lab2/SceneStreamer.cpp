@@ -0,0 +1,538 @@
+#include <framework/Common.h>
+
+#include "SceneStreamer.h"
+#include "Scene.h"
+
+#include <chrono>
+#include <stdio.h>
+
+
+namespace scene_streamer_internal
+{
+	/// Number of entities integrated between checks of the time budget.
+	const uint32_t integrate_batch_size = 256;
+
+	typedef std::chrono::high_resolution_clock Clock;
+};
+
+SceneStreamer::SceneStreamer(Scene* scene)
+	: _scene(scene),
+	_open(false),
+	_load_radius(64.0f),
+	_evict_radius(96.0f),
+	_position(0.0f, 0.0f, 0.0f),
+	_stop(false)
+{
+}
+SceneStreamer::~SceneStreamer()
+{
+	Wait();
+
+	if(_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_job_added.notify_one();
+		_thread.join();
+	}
+
+	for(size_t i = 0; i < _completed.size(); ++i)
+	{
+		delete _completed[i];
+	}
+	for(size_t i = 0; i < _integrations.size(); ++i)
+	{
+		delete _integrations[i];
+	}
+}
+//-------------------------------------------------------------------------------
+bool SceneStreamer::Open(const char* index_filename)
+{
+	// Finish anything left from a previously opened scene
+	Wait();
+	ProcessCompleted();
+	for(size_t i = 0; i < _integrations.size(); ++i)
+	{
+		delete _integrations[i];
+	}
+	_integrations.clear();
+	_cells.clear();
+	_open = false;
+
+	_index = scene_cells::Index();
+	if(!scene_cells::ReadIndex(index_filename, _index))
+		return false;
+
+	_filename = index_filename;
+	_open = true;
+
+	// Clear the scene, new entities must not collide with the IDs of cells not yet loaded
+	_scene->BeginIntegrate(SceneData(), 0, true);
+	_scene->ReserveEntityIds(_index.next_id);
+	return true;
+}
+bool SceneStreamer::IsOpen() const
+{
+	return _open;
+}
+bool SceneStreamer::Save()
+{
+	if(!_open)
+		return false;
+
+	// Cells can't be saved while partially loaded
+	Wait();
+	bool result = ProcessCompleted();
+	Integrate(-1.0f);
+
+	std::map<scene_cells::CellCoord, std::vector<Entity*> > entities;
+	EntitiesByCell(entities);
+
+	for(std::map<scene_cells::CellCoord, Cell>::iterator it = _cells.begin(); it != _cells.end(); ++it)
+	{
+		if(it->second.state != CELL_LOADED)
+			continue;
+		it->second.evict_failed = false; // Evicting is tried again once saved
+
+		// Also covers cells where all entities have been removed
+		SceneData data;
+		SnapshotCell(entities[it->first], &it->second.held, data);
+		WriteCell(it->first, data, false);
+	}
+
+	// Entities moved into cells that aren't loaded are appended to those cells, and unloaded as the cell
+	//	file then holds them. They're put back if the append fails. The same goes for cells that failed to
+	//	load, the append fails as well unless the file has become readable since.
+	for(std::map<scene_cells::CellCoord, std::vector<Entity*> >::iterator it = entities.begin(); it != entities.end(); ++it)
+	{
+		std::map<scene_cells::CellCoord, Cell>::iterator cell = _cells.find(it->first);
+		if(it->second.empty() || (cell != _cells.end() && cell->second.state != CELL_FAILED))
+			continue;
+
+		std::vector<Entity*> moved;
+		for(size_t i = 0; i < it->second.size(); ++i)
+		{
+			if(!it->second[i]->selected)
+				moved.push_back(it->second[i]);
+		}
+		if(moved.empty())
+			continue;
+
+		Job* job = new Job;
+		job->type = Job::APPEND;
+		job->coord = it->first;
+		job->filename = scene_cells::CellFilename(_filename.c_str(), it->first);
+		job->unloaded = true;
+		job->result = false;
+		SnapshotCell(moved, NULL, job->data);
+		_index.cells[it->first] += (uint32_t)moved.size();
+		Submit(job);
+
+		_scene->UnloadEntities(moved);
+	}
+
+	// The index is written once the appends are done, cells with failed appends are then no longer counted
+	Wait();
+	if(!ProcessCompleted())
+		result = false;
+
+	WriteIndex();
+
+	Wait();
+	if(!ProcessCompleted())
+		result = false;
+	return result;
+}
+void SceneStreamer::SetRadius(float load_radius, float evict_radius)
+{
+	assert(evict_radius >= load_radius);
+	_load_radius = load_radius;
+	_evict_radius = evict_radius;
+}
+void SceneStreamer::Update(const Vec3& position, float time_budget)
+{
+	if(!_open)
+		return;
+
+	_position = position;
+	ProcessCompleted();
+	RequestCells(position);
+	Integrate(time_budget);
+
+	// Evicting a cell means going through all entities, so only one cell is evicted every update
+	for(std::map<scene_cells::CellCoord, Cell>::iterator it = _cells.begin(); it != _cells.end(); ++it)
+	{
+		if(scene_cells::DistanceToCell(position, it->first, _index.cell_size) <= _evict_radius)
+			continue;
+
+		if(it->second.state == CELL_LOADED && !it->second.evict_failed)
+		{
+			Evict(it->first);
+			break;
+		}
+		if(it->second.state == CELL_FAILED)
+		{
+			// Nothing to save, allows loading to be retried once we're back
+			_cells.erase(it);
+			break;
+		}
+	}
+}
+uint32_t SceneStreamer::LoadedCellCount() const
+{
+	uint32_t count = 0;
+	for(std::map<scene_cells::CellCoord, Cell>::const_iterator it = _cells.begin(); it != _cells.end(); ++it)
+	{
+		if(it->second.state == CELL_LOADED)
+			++count;
+	}
+	return count;
+}
+uint32_t SceneStreamer::PendingCellCount() const
+{
+	uint32_t count = 0;
+	for(std::map<scene_cells::CellCoord, Cell>::const_iterator it = _cells.begin(); it != _cells.end(); ++it)
+	{
+		if(it->second.state == CELL_LOADING || it->second.state == CELL_INTEGRATING)
+			++count;
+	}
+	return count;
+}
+//-------------------------------------------------------------------------------
+bool SceneStreamer::ProcessCompleted()
+{
+	std::vector<Job*> completed;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		completed.swap(_completed);
+	}
+
+	bool result = true;
+	for(size_t i = 0; i < completed.size(); ++i)
+	{
+		Job* job = completed[i];
+		if(job->type == Job::LOAD)
+		{
+			std::map<scene_cells::CellCoord, Cell>::iterator it = _cells.find(job->coord);
+			if(it != _cells.end() && it->second.state == CELL_LOADING)
+			{
+				if(scene_cells::DistanceToCell(_position, job->coord, _index.cell_size) > _evict_radius)
+				{
+					// We've moved away while it was loading, nothing has changed so it can just be dropped
+					_cells.erase(it);
+				}
+				else if(job->result)
+				{
+					Integration* integration = new Integration;
+					integration->coord = job->coord;
+					integration->integrated = 0;
+					integration->data.Swap(job->data);
+					_integrations.push_back(integration);
+
+					it->second.state = CELL_INTEGRATING;
+				}
+				else
+				{
+					it->second.state = CELL_FAILED;
+				}
+			}
+		}
+		else if(!job->result)
+		{
+			debug::Printf("Scene: Failed to write '%s'.\n", job->filename.c_str());
+			if(job->unloaded)
+				Restore(job);
+			result = false;
+		}
+		else if(job->type == Job::APPEND)
+		{
+			// The file of a cell that failed to load was readable after all, loading it is retried to bring
+			//	back the entities just appended
+			std::map<scene_cells::CellCoord, Cell>::iterator it = _cells.find(job->coord);
+			if(it != _cells.end() && it->second.state == CELL_FAILED)
+				_cells.erase(it);
+		}
+		delete job;
+	}
+	return result;
+}
+void SceneStreamer::Restore(Job* job)
+{
+	if(job->type == Job::APPEND)
+	{
+		// The cell isn't loaded, the entities stay in the scene until the next Save same as before. Appends
+		//	only happen within Save, so there's room for any lights among them.
+		uint32_t& count = _index.cells[job->coord];
+		count -= job->data.Size();
+		if(count == 0)
+			_index.cells.erase(job->coord);
+
+		_scene->Integrate(job->data);
+		return;
+	}
+
+	// An evicted cell, the file still holds what it did before the write so the cell is integrated from the
+	//	records of the job instead. Any load requested since is ignored, as the cell is no longer loading.
+	Cell& cell = _cells[job->coord];
+	cell.state = CELL_INTEGRATING;
+	cell.held.Clear();
+	cell.evict_failed = true; // Not evicted again every update while writing keeps failing
+
+	Integration* integration = new Integration;
+	integration->coord = job->coord;
+	integration->integrated = 0;
+	integration->data.Swap(job->data);
+	_integrations.push_back(integration);
+}
+void SceneStreamer::RequestCells(const Vec3& position)
+{
+	float cell_size = _index.cell_size;
+	scene_cells::CellCoord min = scene_cells::CellAt(vector::Subtract(position, Vec3(_load_radius, 0.0f, _load_radius)), cell_size);
+	scene_cells::CellCoord max = scene_cells::CellAt(vector::Add(position, Vec3(_load_radius, 0.0f, _load_radius)), cell_size);
+
+	for(int32_t z = min.z; z <= max.z; ++z)
+	{
+		for(int32_t x = min.x; x <= max.x; ++x)
+		{
+			scene_cells::CellCoord coord(x, z);
+			if(scene_cells::DistanceToCell(position, coord, cell_size) > _load_radius)
+				continue;
+
+			std::map<scene_cells::CellCoord, Cell>::iterator it = _cells.find(coord);
+			if(it != _cells.end())
+			{
+				// Back within range, a failed eviction is tried again once we leave
+				it->second.evict_failed = false;
+				continue;
+			}
+
+			Cell& cell = _cells[coord];
+			if(_index.cells.find(coord) == _index.cells.end())
+			{
+				// Nothing stored for this cell, but it's now loaded so that any new entities are saved with it
+				cell.state = CELL_LOADED;
+				continue;
+			}
+
+			cell.state = CELL_LOADING;
+
+			Job* job = new Job;
+			job->type = Job::LOAD;
+			job->coord = coord;
+			job->filename = scene_cells::CellFilename(_filename.c_str(), coord);
+			job->unloaded = false;
+			job->result = false;
+			Submit(job);
+		}
+	}
+}
+void SceneStreamer::Integrate(float time_budget)
+{
+	using namespace scene_streamer_internal;
+
+	Clock::time_point start = Clock::now();
+	while(!_integrations.empty())
+	{
+		Integration* integration = _integrations.front();
+		Cell& cell = _cells[integration->coord];
+
+		uint32_t end = std::min(integration->integrated + integrate_batch_size, integration->data.Size());
+		for(uint32_t i = integration->integrated; i < end; ++i)
+		{
+			// Lights that don't fit are held on to, rather than lost the next time the cell is saved
+			if(integration->data.entities[i].type == Entity::ET_LIGHT && _scene->LightCount() >= Scene::MAX_LIGHT_COUNT)
+				scene_cells::CopyEntity(integration->data, i, cell.held);
+			else
+				_scene->Integrate(integration->data, i, i + 1);
+		}
+		integration->integrated = end;
+
+		if(integration->integrated == integration->data.Size())
+		{
+			cell.state = CELL_LOADED;
+			_integrations.pop_front();
+			delete integration;
+		}
+
+		if(time_budget >= 0.0f &&
+			std::chrono::duration<float>(Clock::now() - start).count() >= time_budget)
+			break;
+	}
+}
+void SceneStreamer::Evict(const scene_cells::CellCoord& coord)
+{
+	Cell& cell = _cells[coord];
+
+	// The selected entity is kept, it's saved with whichever cell it's in once unselected
+	std::vector<Entity*> entities;
+	const std::vector<Entity*>& all = _scene->Entities();
+	for(size_t i = 0; i < all.size(); ++i)
+	{
+		if(!all[i]->selected && scene_cells::CellAt(all[i]->position, _index.cell_size) == coord)
+			entities.push_back(all[i]);
+	}
+
+	SceneData data;
+	SnapshotCell(entities, &cell.held, data);
+	_scene->UnloadEntities(entities);
+	_cells.erase(coord);
+
+	// Put back by ProcessCompleted if the write fails
+	WriteCell(coord, data, true);
+}
+//-------------------------------------------------------------------------------
+void SceneStreamer::EntitiesByCell(std::map<scene_cells::CellCoord, std::vector<Entity*> >& cells) const
+{
+	const std::vector<Entity*>& all = _scene->Entities();
+	for(size_t i = 0; i < all.size(); ++i)
+	{
+		cells[scene_cells::CellAt(all[i]->position, _index.cell_size)].push_back(all[i]);
+	}
+}
+void SceneStreamer::SnapshotCell(const std::vector<Entity*>& entities, const SceneData* held, SceneData& data) const
+{
+	_scene->Snapshot(entities, data);
+	if(held)
+	{
+		for(uint32_t i = 0; i < held->Size(); ++i)
+		{
+			scene_cells::CopyEntity(*held, i, data);
+		}
+	}
+}
+void SceneStreamer::WriteCell(const scene_cells::CellCoord& coord, SceneData& data, bool unloaded)
+{
+	bool existed = _index.cells.find(coord) != _index.cells.end();
+	if(!existed && data.Size() == 0)
+		return;
+
+	Job* job = new Job;
+	job->type = Job::WRITE;
+	job->coord = coord;
+	job->filename = scene_cells::CellFilename(_filename.c_str(), coord);
+	job->unloaded = unloaded;
+	job->result = false;
+	job->data.Swap(data);
+
+	if(job->data.Size() != 0)
+		_index.cells[coord] = job->data.Size();
+	else
+		_index.cells.erase(coord);
+
+	Submit(job);
+
+	// The index only needs to be written when the set of cells changes
+	if(existed != (job->data.Size() != 0))
+		WriteIndex();
+}
+void SceneStreamer::WriteIndex()
+{
+	_index.next_id = std::max(_index.next_id, _scene->NextEntityId());
+
+	Job* job = new Job;
+	job->type = Job::INDEX;
+	job->filename = _filename;
+	job->index = _index;
+	job->unloaded = false;
+	job->result = false;
+	Submit(job);
+}
+//-------------------------------------------------------------------------------
+void SceneStreamer::Submit(Job* job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.push_back(job);
+	}
+
+	// The worker is started on the first job
+	if(!_thread.joinable())
+		_thread = std::thread(&SceneStreamer::Run, this);
+
+	_job_added.notify_one();
+}
+void SceneStreamer::Wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(!_queue.empty())
+		_job_completed.wait(lock);
+}
+void SceneStreamer::Run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(true)
+	{
+		while(_queue.empty() && !_stop)
+			_job_added.wait(lock);
+
+		if(_queue.empty())
+			break; // Stopped
+
+		// Jobs are executed in order, so a cell is never read while an earlier write to it is pending
+		Job* job = _queue.front();
+
+		lock.unlock();
+		Execute(job);
+		lock.lock();
+
+		_queue.pop_front();
+		_completed.push_back(job);
+		_job_completed.notify_all();
+	}
+}
+void SceneStreamer::Execute(Job* job)
+{
+	switch(job->type)
+	{
+	case Job::LOAD:
+		{
+			job->result = scene_file::Load(job->filename.c_str(), job->data);
+			job->data.AssignIds();
+		}
+		break;
+	case Job::WRITE:
+		{
+			if(job->data.Size() != 0)
+			{
+				job->result = scene_file::Save(job->filename.c_str(), job->data);
+			}
+			else
+			{
+				remove(job->filename.c_str());
+				job->result = true;
+			}
+		}
+		break;
+	case Job::APPEND:
+		{
+			SceneData data;
+			FILE* f = fopen(job->filename.c_str(), "rb");
+			if(f)
+			{
+				fclose(f);
+				// Never replace a cell we failed to read
+				if(!scene_file::Load(job->filename.c_str(), data))
+					break;
+				data.AssignIds();
+			}
+
+			for(uint32_t i = 0; i < job->data.Size(); ++i)
+			{
+				scene_cells::CopyEntity(job->data, i, data);
+			}
+			job->result = scene_file::Save(job->filename.c_str(), data);
+		}
+		break;
+	case Job::INDEX:
+		{
+			job->result = scene_cells::WriteIndex(job->filename.c_str(), job->index);
+		}
+		break;
+	};
+
+	// Release the memory on the worker rather than when the job is deleted, unless needed to put the entities back
+	if(job->type != Job::LOAD && (job->result || !job->unloaded))
+		SceneData().Swap(job->data);
+}
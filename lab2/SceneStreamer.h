@@ -0,0 +1,155 @@
+#ifndef __SCENESTREAMER_H__
+#define __SCENESTREAMER_H__
+
+#include "SceneCells.h"
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Scene;
+struct Entity;
+
+/// @brief Streams the cells of a cell scene (See scene_cells) in and out of a scene around a position.
+///
+///	Cells within the load radius are loaded and cells outside the evict radius are saved and unloaded.
+///	The gap between the two radii avoids cells being loaded and evicted over and over when moving
+///	back and forth along a cell border. Reading and writing cell files happens on a worker thread,
+///	while creating entities is done by Update under a time budget, same as for SceneLoader.
+///
+///	Entities belong to the cell containing their current position, so entities moved by the user are
+///	saved with the cell they were moved to. Entities moved to a cell that isn't loaded (Or failed to
+///	load) stay in the scene until the next Save, which appends them to the file of that cell.
+///
+///	Entities are unloaded as soon as they're handed to the worker for writing. If the write fails they're
+///	put back into the scene, so nothing is lost until the file actually holds it. A cell that failed to be
+///	written when evicted stays loaded until it's back within the load radius or saved, rather than being
+///	written again on every update.
+class SceneStreamer
+{
+public:
+	SceneStreamer(Scene* scene);
+	/// Waits for all file operations in progress, nothing is saved.
+	~SceneStreamer();
+
+	/// @brief Opens a cell scene, all entities currently in the scene are removed.
+	/// @return True if successful, false if the index couldn't be read.
+	bool Open(const char* index_filename);
+
+	/// @return True if a cell scene is open.
+	bool IsOpen() const;
+
+	/// @brief Saves all loaded cells and the index, blocking until everything is written.
+	///	Any cells still loading are completed first.
+	/// @return True if successful, false if not.
+	bool Save();
+
+	/// @brief Specifies the radii on the XZ-plane used for streaming, evict_radius should be the larger.
+	void SetRadius(float load_radius, float evict_radius);
+
+	/// @brief Loads and evicts cells around the specified position, expected to be called once every frame.
+	/// @param time_budget Maximum time in seconds to spend on creating entities.
+	void Update(const Vec3& position, float time_budget);
+
+	/// @return Number of cells that are loaded and number of cells still being loaded.
+	uint32_t LoadedCellCount() const;
+	uint32_t PendingCellCount() const;
+
+private:
+	enum CellState
+	{
+		CELL_LOADING, // Cell file is being read
+		CELL_INTEGRATING, // Waiting for or in the process of creating entities
+		CELL_LOADED,
+		CELL_FAILED // Cell file couldn't be read, the cell is never written to avoid losing its contents
+	};
+
+	struct Cell
+	{
+		CellState state;
+		SceneData held; // Records that couldn't be added to the scene (Lights beyond the light limit)
+		bool evict_failed; // Writing the cell failed when evicting it, it's kept loaded until back within the load radius or saved
+
+		Cell() : state(CELL_LOADING), evict_failed(false) {}
+	};
+
+	struct Job
+	{
+		enum Type
+		{
+			LOAD, // Reads the cell file into data
+			WRITE, // Replaces the cell file with data, removing the file if empty
+			APPEND, // Appends data to the cell file
+			INDEX // Writes the index
+		};
+		Type type;
+		scene_cells::CellCoord coord;
+		std::string filename;
+		SceneData data;
+		scene_cells::Index index;
+		bool unloaded; // The entities in data were unloaded from the scene, they're put back if the job fails
+		bool result;
+	};
+
+	/// Cell waiting to be integrated into the scene.
+	struct Integration
+	{
+		scene_cells::CellCoord coord;
+		SceneData data;
+		uint32_t integrated;
+	};
+
+	Scene* _scene;
+	std::string _filename;
+	scene_cells::Index _index;
+	bool _open;
+
+	float _load_radius;
+	float _evict_radius;
+	Vec3 _position; // Position from the last update
+
+	std::map<scene_cells::CellCoord, Cell> _cells; // Cells that are loaded or in the process of loading
+	std::deque<Integration*> _integrations;
+
+	// Worker
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _job_added;
+	std::condition_variable _job_completed;
+	std::deque<Job*> _queue; // Jobs waiting to be executed, the first job is the one currently executing
+	std::vector<Job*> _completed;
+	bool _stop;
+
+	/// Handles the results of completed jobs, entities unloaded by failed jobs are put back into the scene.
+	/// @return False if any write failed.
+	bool ProcessCompleted();
+	/// Puts the entities of a failed WRITE or APPEND job back into the scene.
+	void Restore(Job* job);
+	/// Starts loading any cells within the load radius.
+	void RequestCells(const Vec3& position);
+	/// Creates entities for loaded cells until the time budget is spent, a negative budget integrates everything.
+	void Integrate(float time_budget);
+	/// Saves and unloads the specified cell.
+	void Evict(const scene_cells::CellCoord& coord);
+
+	/// Groups all entities in the scene by the cell containing them.
+	void EntitiesByCell(std::map<scene_cells::CellCoord, std::vector<Entity*> >& cells) const;
+	/// Snapshot of the specified entities, including any records held for the cell.
+	void SnapshotCell(const std::vector<Entity*>& entities, const SceneData* held, SceneData& data) const;
+	/// @param unloaded The entities in data have been unloaded from the scene (See Job::unloaded).
+	void WriteCell(const scene_cells::CellCoord& coord, SceneData& data, bool unloaded);
+	void WriteIndex();
+
+	void Submit(Job* job);
+	/// Blocks until all submitted jobs are complete.
+	void Wait();
+	void Run();
+	static void Execute(Job* job);
+
+	SceneStreamer(const SceneStreamer&);
+	SceneStreamer& operator=(const SceneStreamer&);
+};
+
+
+#endif // __SCENESTREAMER_H__
@@ -0,0 +1,1565 @@
+#include <framework/Common.h>
+#include <framework/Frustum.h>
+#include <framework/MatrixBatch.h>
+#include <framework/OcclusionBuffer.h>
+#include <framework/Parallel.h>
+#include <framework/RayBatch.h>
+#include <framework/SpatialHash.h>
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+/// Accuracy tests and microbenchmarks for the math library (Vector, Matrix, Quat, MatrixBatch, RayBatch and Frustum)
+///	and the occlusion culling built on it (OcclusionBuffer), as well as the neighborhood queries of SpatialHash.
+///
+///	The accuracy tests compare every function against a double precision reference on randomized
+///	input. The error is measured in ULPs (Units in the last place) of the largest element of the
+///	reference result, e.g. an error of 1 for a rotation matrix means an error of about 1.2e-7.
+///	Measuring against the largest element rather than each element by itself keeps elements that
+///	should be (close to) zero from reporting huge relative errors. Sums of products (Matrix-vector
+///	products, cross products) can cancel out to small results, those are measured against the
+///	magnitude of the summed terms instead. The batch transforms, ray tests and frustum culling are
+///	required to match the single-value functions exactly.
+///
+///	Occlusion culling may keep hidden objects but must never cull visible ones, it's tested by casting
+///	rays against the occluders: through the pixels of the occlusion buffer, and towards points on the
+///	objects reported as hidden.
+///
+///	The SpatialHash queries are compared against going through every object, while objects are moved,
+///	removed and inserted again, with both dense and sparse objects and objects too large for the cells.
+///
+///	The benchmarks report the average time per operation over large batches of randomized input.
+///
+///	The exit code is 0 if all tests pass and 1 if any fails, run it before and after any change to
+///	the math library.
+
+namespace mathtest_internal
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	/// Same xorshift generator as the scene generator, the input is the same on all platforms.
+	class Random
+	{
+	public:
+		Random(uint32_t seed) : _state(seed ? seed : 0x9e3779b9)
+		{
+			for(int i = 0; i < 8; ++i)
+				Next();
+		}
+
+		uint32_t Next()
+		{
+			_state ^= _state << 13;
+			_state ^= _state >> 17;
+			_state ^= _state << 5;
+			return _state;
+		}
+
+		/// @return Value in [min, max)
+		float NextFloat(float min, float max)
+		{
+			return min + (max - min) * ((Next() >> 8) * (1.0f / 16777216.0f));
+		}
+
+		Vec3 NextVec3(float min, float max)
+		{
+			float x = NextFloat(min, max);
+			float y = NextFloat(min, max);
+			float z = NextFloat(min, max);
+			return Vec3(x, y, z);
+		}
+
+		/// @return Random matrix with all elements in [-1, 1)
+		Mat4x4 NextMatrix()
+		{
+			Mat4x4 m;
+			for(int i = 0; i < 16; ++i)
+				(&m.col[0].x)[i] = NextFloat(-1.0f, 1.0f);
+			return m;
+		}
+
+		/// @return Random rotation and translation
+		Mat4x4 NextRigid()
+		{
+			float head = NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			float pitch = NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			float roll = NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			Vec3 translation = NextVec3(-100.0f, 100.0f);
+			return matrix::Multiply(matrix::CreateTranslation(translation), matrix::CreateRotationXYZ(head, pitch, roll));
+		}
+
+		/// @return Random entity transform, translation * scale * rotation
+		Mat4x4 NextAffine()
+		{
+			Vec3 scale = NextVec3(0.5f, 2.0f);
+			Mat4x4 rigid = NextRigid();
+			Mat4x4 translation = matrix::CreateTranslation(Vec3(rigid.col[3].x, rigid.col[3].y, rigid.col[3].z));
+			rigid.col[3] = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			return matrix::Multiply(translation, matrix::Multiply(matrix::CreateScaling(scale), rigid));
+		}
+
+		/// @return Random perspective projection
+		Mat4x4 NextPerspective()
+		{
+			float fovy = NextFloat(0.2f, 2.5f);
+			float aspect = NextFloat(0.5f, 2.5f);
+			float znear = NextFloat(0.1f, 10.0f);
+			float zfar = znear + NextFloat(10.0f, 1000.0f);
+			return matrix::CreatePerspective(fovy, aspect, znear, zfar);
+		}
+
+	private:
+		uint32_t _state;
+	};
+
+	//-------------------------------------------------------------------------------
+	// Double precision reference
+
+	/// Column-major, same layout as Mat4x4.
+	struct DMat4x4
+	{
+		double m[16];
+
+		double& At(int row, int col) { return m[col*4 + row]; }
+		double At(int row, int col) const { return m[col*4 + row]; }
+	};
+
+	DMat4x4 ToDouble(const Mat4x4& m)
+	{
+		DMat4x4 result;
+		for(int i = 0; i < 16; ++i)
+			result.m[i] = (&m.col[0].x)[i];
+		return result;
+	}
+
+	DMat4x4 RefMultiply(const DMat4x4& lhs, const DMat4x4& rhs)
+	{
+		DMat4x4 result;
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				double sum = 0.0;
+				for(int k = 0; k < 4; ++k)
+					sum += lhs.At(r, k) * rhs.At(k, c);
+				result.At(r, c) = sum;
+			}
+		}
+		return result;
+	}
+
+	/// Gauss-Jordan elimination with partial pivoting.
+	DMat4x4 RefInverse(const DMat4x4& m)
+	{
+		DMat4x4 a = m;
+		DMat4x4 result;
+		for(int i = 0; i < 16; ++i)
+			result.m[i] = (i % 5 == 0) ? 1.0 : 0.0;
+
+		for(int c = 0; c < 4; ++c)
+		{
+			int pivot = c;
+			for(int r = c + 1; r < 4; ++r)
+			{
+				if(fabs(a.At(r, c)) > fabs(a.At(pivot, c)))
+					pivot = r;
+			}
+			for(int k = 0; k < 4; ++k)
+			{
+				std::swap(a.At(c, k), a.At(pivot, k));
+				std::swap(result.At(c, k), result.At(pivot, k));
+			}
+
+			double inv_pivot = 1.0 / a.At(c, c);
+			for(int k = 0; k < 4; ++k)
+			{
+				a.At(c, k) *= inv_pivot;
+				result.At(c, k) *= inv_pivot;
+			}
+			for(int r = 0; r < 4; ++r)
+			{
+				if(r == c)
+					continue;
+
+				double factor = a.At(r, c);
+				for(int k = 0; k < 4; ++k)
+				{
+					a.At(r, k) -= factor * a.At(c, k);
+					result.At(r, k) -= factor * result.At(c, k);
+				}
+			}
+		}
+		return result;
+	}
+
+	DMat4x4 RefRotationXYZ(double head, double pitch, double roll)
+	{
+		DMat4x4 rx = ToDouble(matrix::CreateIdentity());
+		DMat4x4 ry = rx;
+		DMat4x4 rz = rx;
+
+		rx.At(1, 1) = cos(pitch); rx.At(1, 2) = -sin(pitch);
+		rx.At(2, 1) = sin(pitch); rx.At(2, 2) = cos(pitch);
+
+		ry.At(0, 0) = cos(head); ry.At(0, 2) = sin(head);
+		ry.At(2, 0) = -sin(head); ry.At(2, 2) = cos(head);
+
+		rz.At(0, 0) = cos(roll); rz.At(0, 1) = -sin(roll);
+		rz.At(1, 0) = sin(roll); rz.At(1, 1) = cos(roll);
+
+		return RefMultiply(rx, RefMultiply(ry, rz));
+	}
+
+	DMat4x4 RefLookAt(const Vec3& eye, const Vec3& at, const Vec3& up)
+	{
+		double f[3] = { (double)at.x - eye.x, (double)at.y - eye.y, (double)at.z - eye.z };
+		double length = sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
+		f[0] /= length; f[1] /= length; f[2] /= length;
+
+		double s[3] = { f[1]*up.z - f[2]*up.y, f[2]*up.x - f[0]*up.z, f[0]*up.y - f[1]*up.x };
+		length = sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
+		s[0] /= length; s[1] /= length; s[2] /= length;
+
+		double u[3] = { s[1]*f[2] - s[2]*f[1], s[2]*f[0] - s[0]*f[2], s[0]*f[1] - s[1]*f[0] };
+
+		DMat4x4 result = ToDouble(matrix::CreateIdentity());
+		for(int i = 0; i < 3; ++i)
+		{
+			result.At(0, i) = s[i];
+			result.At(1, i) = u[i];
+			result.At(2, i) = -f[i];
+		}
+		result.At(0, 3) = -(s[0]*eye.x + s[1]*eye.y + s[2]*eye.z);
+		result.At(1, 3) = -(u[0]*eye.x + u[1]*eye.y + u[2]*eye.z);
+		result.At(2, 3) = f[0]*eye.x + f[1]*eye.y + f[2]*eye.z;
+		return result;
+	}
+
+	//-------------------------------------------------------------------------------
+	// Error measurement
+
+	/// @return The size of one float ULP at the magnitude of the specified value.
+	double FloatUlp(double value)
+	{
+		value = fabs(value);
+		if(value < 1e-30)
+			value = 1e-30;
+		return ldexp(1.0, ilogb(value) - 23);
+	}
+
+	/// @return Error of values compared to reference, in ULPs of the largest reference element.
+	/// @param magnitude Optional, sum of the magnitudes of the terms of each element, used instead of
+	///		the reference if larger.
+	double UlpError(const float* values, const double* reference, int count, const double* magnitude = NULL)
+	{
+		double scale = 0.0;
+		for(int i = 0; i < count; ++i)
+		{
+			scale = std::max(scale, fabs(reference[i]));
+			if(magnitude)
+				scale = std::max(scale, fabs(magnitude[i]));
+		}
+
+		double ulp = FloatUlp(scale);
+		double error = 0.0;
+		for(int i = 0; i < count; ++i)
+			error = std::max(error, fabs(values[i] - reference[i]) / ulp);
+		return error;
+	}
+
+	double UlpError(const Mat4x4& m, const DMat4x4& reference)
+	{
+		return UlpError(&m.col[0].x, reference.m, 16);
+	}
+
+	DMat4x4 Abs(const DMat4x4& m)
+	{
+		DMat4x4 result;
+		for(int i = 0; i < 16; ++i)
+			result.m[i] = fabs(m.m[i]);
+		return result;
+	}
+
+	//-------------------------------------------------------------------------------
+	// Accuracy tests
+
+	/// Accumulates the results of all tests.
+	class TestReport
+	{
+	public:
+		TestReport() : _failed(0) {}
+
+		/// Reports the max error of a test, the test fails if it's above the bound.
+		void Result(const char* name, double max_error, double bound)
+		{
+			bool passed = max_error <= bound;
+			printf("  %-40s %10.2f ULP  (bound %6.1f)  %s\n", name, max_error, bound, passed ? "ok" : "FAILED");
+			if(!passed)
+				++_failed;
+		}
+
+		/// Reports a test that requires exact results.
+		void Exact(const char* name, uint32_t mismatches, uint32_t total)
+		{
+			bool passed = mismatches == 0;
+			printf("  %-40s %10d of %d differ          %s\n", name, mismatches, total, passed ? "ok" : "FAILED");
+			if(!passed)
+				++_failed;
+		}
+
+		int Failed() const { return _failed; }
+
+	private:
+		int _failed;
+	};
+
+	bool SameBits(float a, float b)
+	{
+		return memcmp(&a, &b, sizeof(float)) == 0;
+	}
+
+	void TestMatrix(Random& random, uint32_t count, TestReport& report)
+	{
+		double error_multiply = 0.0, error_multiply_vec = 0.0, error_inverse = 0.0, error_inverse_affine = 0.0,
+			error_inverse_rigid = 0.0, error_inverse_perspective = 0.0, error_rotation = 0.0,
+			error_lookat = 0.0, error_transpose = 0.0;
+
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			Mat4x4 a = random.NextMatrix();
+			Mat4x4 b = random.NextMatrix();
+			DMat4x4 da = ToDouble(a);
+			Mat4x4 ab = matrix::Multiply(a, b);
+			error_multiply = std::max(error_multiply, UlpError(&ab.col[0].x, RefMultiply(da, ToDouble(b)).m, 16,
+				RefMultiply(Abs(da), Abs(ToDouble(b))).m));
+
+			Vec4 v(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+			Vec4 mv = matrix::Multiply(a, v);
+			DMat4x4 dv = ToDouble(matrix::CreateIdentity());
+			dv.m[0] = v.x; dv.m[1] = v.y; dv.m[2] = v.z; dv.m[3] = v.w;
+			error_multiply_vec = std::max(error_multiply_vec, UlpError(&mv.x, RefMultiply(da, dv).m, 4, RefMultiply(Abs(da), Abs(dv)).m));
+
+			Mat4x4 t = matrix::Transpose(a);
+			for(int r = 0; r < 4; ++r)
+				for(int c = 0; c < 4; ++c)
+					error_transpose = std::max(error_transpose, SameBits((&t.col[c].x)[r], (&a.col[r].x)[c]) ? 0.0 : 1.0);
+
+			Mat4x4 affine = random.NextAffine();
+			DMat4x4 ref_affine = RefInverse(ToDouble(affine));
+			error_inverse = std::max(error_inverse, UlpError(matrix::Inverse(affine), ref_affine));
+			error_inverse_affine = std::max(error_inverse_affine, UlpError(matrix::InverseAffine(affine), ref_affine));
+
+			Mat4x4 rigid = random.NextRigid();
+			error_inverse_rigid = std::max(error_inverse_rigid, UlpError(matrix::InverseRigid(rigid), RefInverse(ToDouble(rigid))));
+
+			Mat4x4 perspective = random.NextPerspective();
+			error_inverse_perspective = std::max(error_inverse_perspective,
+				UlpError(matrix::InversePerspective(perspective), RefInverse(ToDouble(perspective))));
+
+			float head = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			float pitch = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			float roll = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			error_rotation = std::max(error_rotation, UlpError(matrix::CreateRotationXYZ(head, pitch, roll), RefRotationXYZ(head, pitch, roll)));
+
+			Vec3 eye = random.NextVec3(-100.0f, 100.0f);
+			Vec3 at = random.NextVec3(-100.0f, 100.0f);
+			Vec3 up(0.0f, 1.0f, 0.0f);
+			error_lookat = std::max(error_lookat, UlpError(matrix::LookAt(eye, at, up), RefLookAt(eye, at, up)));
+		}
+
+		report.Result("matrix::Multiply (matrix)", error_multiply, 8.0);
+		report.Result("matrix::Multiply (vector)", error_multiply_vec, 8.0);
+		report.Result("matrix::Transpose", error_transpose, 0.0);
+		report.Result("matrix::Inverse", error_inverse, 32.0);
+		report.Result("matrix::InverseAffine", error_inverse_affine, 32.0);
+		report.Result("matrix::InverseRigid", error_inverse_rigid, 16.0);
+		report.Result("matrix::InversePerspective", error_inverse_perspective, 4.0);
+		report.Result("matrix::CreateRotationXYZ", error_rotation, 8.0);
+		report.Result("matrix::LookAt", error_lookat, 16.0);
+	}
+
+	void TestVector(Random& random, uint32_t count, TestReport& report)
+	{
+		double error_normalize = 0.0, error_length = 0.0, error_cross = 0.0;
+
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			Vec3 v = random.NextVec3(-100.0f, 100.0f);
+			double length = sqrt((double)v.x*v.x + (double)v.y*v.y + (double)v.z*v.z);
+
+			Vec3 n = v;
+			vector::Normalize(n);
+			double ref_n[3] = { v.x / length, v.y / length, v.z / length };
+			error_normalize = std::max(error_normalize, UlpError(&n.x, ref_n, 3));
+
+			float l = vector::Length(v);
+			error_length = std::max(error_length, UlpError(&l, &length, 1));
+
+			Vec3 w = random.NextVec3(-1.0f, 1.0f);
+			Vec3 c = vector::Cross(v, w);
+			double ref_c[3] = { (double)v.y*w.z - (double)v.z*w.y, (double)v.z*w.x - (double)v.x*w.z, (double)v.x*w.y - (double)v.y*w.x };
+			double magnitude_c[3] = { fabs((double)v.y*w.z) + fabs((double)v.z*w.y), fabs((double)v.z*w.x) + fabs((double)v.x*w.z),
+				fabs((double)v.x*w.y) + fabs((double)v.y*w.x) };
+			error_cross = std::max(error_cross, UlpError(&c.x, ref_c, 3, magnitude_c));
+		}
+
+		report.Result("vector::Normalize", error_normalize, 4.0);
+		report.Result("vector::Length", error_length, 2.0);
+		report.Result("vector::Cross", error_cross, 4.0);
+	}
+
+	void TestQuat(Random& random, uint32_t count, TestReport& report)
+	{
+		double error_rotation = 0.0, error_multiply = 0.0, error_rotate = 0.0, error_slerp = 0.0;
+
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			float head = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			float pitch = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			float roll = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			Quat q = quat::CreateRotationXYZ(head, pitch, roll);
+			DMat4x4 ref_q = RefRotationXYZ(head, pitch, roll);
+			error_rotation = std::max(error_rotation, UlpError(quat::ToMatrix(q), ref_q));
+
+			float head2 = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			float pitch2 = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			float roll2 = random.NextFloat(-(float)MATH_PI, (float)MATH_PI);
+			Quat r = quat::CreateRotationXYZ(head2, pitch2, roll2);
+			DMat4x4 ref_r = RefRotationXYZ(head2, pitch2, roll2);
+			error_multiply = std::max(error_multiply, UlpError(quat::ToMatrix(q * r), RefMultiply(ref_q, ref_r)));
+
+			Vec3 v = random.NextVec3(-1.0f, 1.0f);
+			Vec3 rv = quat::Rotate(q, v);
+			double ref_v[3];
+			for(int k = 0; k < 3; ++k)
+				ref_v[k] = ref_q.At(k, 0)*v.x + ref_q.At(k, 1)*v.y + ref_q.At(k, 2)*v.z;
+			error_rotate = std::max(error_rotate, UlpError(&rv.x, ref_v, 3));
+
+			// The end points of an interpolation should give back the input rotations
+			error_slerp = std::max(error_slerp, UlpError(quat::ToMatrix(quat::Slerp(q, r, 0.0f)), ref_q));
+			error_slerp = std::max(error_slerp, UlpError(quat::ToMatrix(quat::Slerp(q, r, 1.0f)), ref_r));
+		}
+
+		report.Result("quat::CreateRotationXYZ (as matrix)", error_rotation, 16.0);
+		report.Result("quat::Multiply (as matrix)", error_multiply, 32.0);
+		report.Result("quat::Rotate", error_rotate, 32.0);
+		report.Result("quat::Slerp (end points)", error_slerp, 32.0);
+	}
+
+	void TestBatch(Random& random, TestReport& report)
+	{
+		// Counts 0 to 67 cover empty input, tails of every length and several full SIMD vectors
+		const uint32_t max_count = 68;
+
+		std::vector<float> x(max_count), y(max_count), z(max_count), radius(max_count);
+		std::vector<float> out_x(max_count), out_y(max_count), out_z(max_count), out_w(max_count), out_radius(max_count);
+
+		uint32_t total = 0, mismatch_points = 0, mismatch_spheres = 0, mismatch_project = 0, mismatch_in_place = 0;
+		for(uint32_t count = 0; count < max_count; ++count)
+		{
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				x[i] = random.NextFloat(-100.0f, 100.0f);
+				y[i] = random.NextFloat(-100.0f, 100.0f);
+				z[i] = random.NextFloat(-100.0f, 100.0f);
+				radius[i] = random.NextFloat(0.0f, 10.0f);
+			}
+			// Guards behind the end, these should never be written
+			out_x[count] = out_radius[count] = out_w[count] = -1.0f;
+
+			Mat4x4 m = random.NextAffine();
+			Mat4x4 projection = matrix::Multiply(random.NextPerspective(), m);
+			float scale = matrix::MaxAxisScale(m);
+
+			matrix::TransformPoints(m, &x[0], &y[0], &z[0], count, &out_x[0], &out_y[0], &out_z[0]);
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				Vec4 p = matrix::Multiply(m, Vec4(x[i], y[i], z[i], 1.0f));
+				if(!SameBits(p.x, out_x[i]) || !SameBits(p.y, out_y[i]) || !SameBits(p.z, out_z[i]))
+					++mismatch_points;
+			}
+
+			matrix::TransformSpheres(m, &x[0], &y[0], &z[0], &radius[0], count, &out_x[0], &out_y[0], &out_z[0], &out_radius[0]);
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				Vec4 p = matrix::Multiply(m, Vec4(x[i], y[i], z[i], 1.0f));
+				if(!SameBits(p.x, out_x[i]) || !SameBits(p.y, out_y[i]) || !SameBits(p.z, out_z[i]) ||
+					!SameBits(radius[i] * scale, out_radius[i]))
+					++mismatch_spheres;
+			}
+
+			matrix::ProjectPoints(projection, &x[0], &y[0], &z[0], count, &out_x[0], &out_y[0], &out_z[0], &out_w[0]);
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				Vec4 p = matrix::Multiply(projection, Vec4(x[i], y[i], z[i], 1.0f));
+				if(!SameBits(p.x, out_x[i]) || !SameBits(p.y, out_y[i]) || !SameBits(p.z, out_z[i]) || !SameBits(p.w, out_w[i]))
+					++mismatch_project;
+			}
+
+			if(out_x[count] != -1.0f || out_radius[count] != -1.0f || out_w[count] != -1.0f)
+			{
+				++mismatch_points; // Wrote past the end
+			}
+
+			// In-place, the output overwrites the input
+			std::vector<float> ix(x), iy(y), iz(z);
+			matrix::TransformPoints(m, &ix[0], &iy[0], &iz[0], count, &ix[0], &iy[0], &iz[0]);
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				Vec4 p = matrix::Multiply(m, Vec4(x[i], y[i], z[i], 1.0f));
+				if(!SameBits(p.x, ix[i]) || !SameBits(p.y, iy[i]) || !SameBits(p.z, iz[i]))
+					++mismatch_in_place;
+			}
+
+			total += count;
+		}
+
+		report.Exact("matrix::TransformPoints", mismatch_points, total);
+		report.Exact("matrix::TransformSpheres", mismatch_spheres, total);
+		report.Exact("matrix::ProjectPoints", mismatch_project, total);
+		report.Exact("matrix::TransformPoints (in-place)", mismatch_in_place, total);
+
+		double error_scale = 0.0;
+		for(uint32_t i = 0; i < 1000; ++i)
+		{
+			Mat4x4 m = random.NextAffine();
+			double ref = 0.0;
+			for(int c = 0; c < 3; ++c)
+			{
+				double length = sqrt((double)m.col[c].x*m.col[c].x + (double)m.col[c].y*m.col[c].y + (double)m.col[c].z*m.col[c].z);
+				ref = std::max(ref, length);
+			}
+			float scale = matrix::MaxAxisScale(m);
+			error_scale = std::max(error_scale, UlpError(&scale, &ref, 1));
+		}
+		report.Result("matrix::MaxAxisScale", error_scale, 2.0);
+	}
+
+	void TestRayBatch(Random& random, TestReport& report)
+	{
+		const uint32_t max_count = 68;
+
+		std::vector<float> x(max_count), y(max_count), z(max_count), radius(max_count);
+		std::vector<float> min_x(max_count), min_y(max_count), min_z(max_count), max_x(max_count), max_y(max_count), max_z(max_count);
+		std::vector<float> distances(max_count);
+		std::vector<uint32_t> hits(max_count / 32 + 2);
+
+		uint32_t total = 0, mismatch_spheres = 0, mismatch_boxes = 0, sphere_hits = 0, box_hits = 0;
+		for(uint32_t count = 0; count < max_count; ++count)
+		{
+			for(uint32_t repeat = 0; repeat < 16; ++repeat)
+			{
+				Vec3 origin = random.NextVec3(-10.0f, 10.0f);
+				Vec3 ray = random.NextVec3(-1.0f, 1.0f);
+				if(repeat % 4 == 0)
+					(&ray.x)[random.Next() % 3] = repeat % 8 ? 0.0f : -0.0f; // Parallel to an axis plane, infinite inverse direction
+				vector::Normalize(ray);
+				Vec3 inv_direction(1.0f / ray.x, 1.0f / ray.y, 1.0f / ray.z);
+				float max_distance = repeat % 2 ? FLT_MAX : random.NextFloat(0.0f, 20.0f);
+
+				for(uint32_t i = 0; i < count; ++i)
+				{
+					// Centered near the ray so that about half of them are hit, some contain the origin
+					Vec3 center = origin + ray * random.NextFloat(-10.0f, 20.0f) + random.NextVec3(-2.0f, 2.0f);
+					Vec3 half_size = random.NextVec3(0.0f, 2.0f);
+					x[i] = center.x; y[i] = center.y; z[i] = center.z;
+					radius[i] = i % 7 ? random.NextFloat(0.0f, 2.0f) : 0.0f;
+					min_x[i] = center.x - half_size.x; min_y[i] = center.y - half_size.y; min_z[i] = center.z - half_size.z;
+					max_x[i] = center.x + half_size.x; max_y[i] = center.y + half_size.y; max_z[i] = center.z + half_size.z;
+				}
+				if(count > 2)
+				{
+					// Box faces exactly at the origin give 0 * infinity = NaN for rays parallel to them
+					min_x[1] = origin.x;
+					max_y[2] = origin.y;
+				}
+				// Guards behind the end, these should never be written
+				distances[count] = -1.0f;
+				hits[count / 32 + 1] = 0xdeadbeef;
+				// Every distance should be written, a NaN with a payload no calculation produces marks the unwritten ones
+				const uint32_t unwritten_bits = 0x7fd5a5a5;
+				float unwritten;
+				memcpy(&unwritten, &unwritten_bits, sizeof(float));
+				std::fill(distances.begin(), distances.begin() + count, unwritten);
+
+				uint32_t hit_count = RaySpheresIntersect(origin, ray, &x[0], &y[0], &z[0], &radius[0], count, &hits[0], &distances[0]);
+				uint32_t expected_count = 0;
+				for(uint32_t i = 0; i < count; ++i)
+				{
+					float distance = 0.0f;
+					bool hit = RaySphereIntersect(origin, ray, Vec3(x[i], y[i], z[i]), radius[i], distance);
+					expected_count += hit ? 1 : 0;
+					if(hit != RayBatchHit(&hits[0], i) || (hit && !SameBits(distance, distances[i])) || SameBits(unwritten, distances[i]))
+						++mismatch_spheres;
+				}
+				if(hit_count != expected_count || distances[count] != -1.0f || hits[count / 32 + 1] != 0xdeadbeef)
+					++mismatch_spheres;
+				sphere_hits += hit_count;
+
+				std::fill(distances.begin(), distances.begin() + count, unwritten);
+				hit_count = RayBoxesIntersect(origin, inv_direction, &min_x[0], &min_y[0], &min_z[0], &max_x[0], &max_y[0], &max_z[0],
+					count, max_distance, &hits[0], &distances[0]);
+				expected_count = 0;
+				for(uint32_t i = 0; i < count; ++i)
+				{
+					Aabb box(Vec3(min_x[i], min_y[i], min_z[i]), Vec3(max_x[i], max_y[i], max_z[i]));
+					float distance = 0.0f;
+					bool hit = aabb::RayIntersect(box, origin, inv_direction, max_distance, distance);
+					expected_count += hit ? 1 : 0;
+					if(hit != RayBatchHit(&hits[0], i) || (hit && !SameBits(distance, distances[i])) || SameBits(unwritten, distances[i]))
+						++mismatch_boxes;
+				}
+				if(hit_count != expected_count || distances[count] != -1.0f || hits[count / 32 + 1] != 0xdeadbeef)
+					++mismatch_boxes;
+				box_hits += hit_count;
+
+				total += count;
+			}
+		}
+
+		report.Exact("RaySpheresIntersect", mismatch_spheres, total);
+		report.Exact("RayBoxesIntersect", mismatch_boxes, total);
+
+		// Make sure the input actually exercises both outcomes
+		if(sphere_hits == 0 || sphere_hits == total || box_hits == 0 || box_hits == total)
+			report.Exact("RayBatch (hit and miss coverage)", 1, total);
+	}
+
+	/// @return Random point (w = 1) around the origin, at distances spread evenly over several orders of magnitude.
+	Vec4 NextPointAround(Random& random)
+	{
+		Vec3 direction = random.NextVec3(-1.0f, 1.0f);
+		vector::Normalize(direction);
+		Vec3 p = direction * expf(random.NextFloat(logf(0.01f), logf(2000.0f)));
+		return Vec4(p.x, p.y, p.z, 1.0f);
+	}
+
+	void TestFrustum(Random& random, uint32_t count, TestReport& report)
+	{
+		// Points are classified in double precision by the clip-space coordinates of the matrix the planes
+		//	are extracted from, points too close to a plane to be classified reliably are skipped.
+		uint32_t mismatch_planes = 0, points_tested = 0, points_inside = 0;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			Mat4x4 view = random.NextRigid();
+			Mat4x4 view_projection = matrix::Multiply(random.NextPerspective(), view);
+			Mat4x4 inverse_view = matrix::InverseRigid(view);
+			Frustum f = frustum::FromMatrix(view_projection);
+			DMat4x4 ref = ToDouble(view_projection);
+
+			Vec4 p = matrix::Multiply(inverse_view, NextPointAround(random));
+			double clip[4];
+			for(int r = 0; r < 4; ++r)
+				clip[r] = ref.At(r, 0)*p.x + ref.At(r, 1)*p.y + ref.At(r, 2)*p.z + ref.At(r, 3);
+
+			double min_margin = DBL_MAX, magnitude = fabs(clip[3]);
+			for(int r = 0; r < 3; ++r)
+			{
+				min_margin = std::min(min_margin, std::min(clip[3] - clip[r], clip[3] + clip[r]));
+				magnitude = std::max(magnitude, fabs(clip[r]));
+			}
+			if(fabs(min_margin) < 1e-4 * magnitude)
+				continue;
+
+			bool inside = min_margin >= 0.0;
+			if(inside != frustum::TestSphere(f, Vec3(p.x, p.y, p.z), 0.0f))
+				++mismatch_planes;
+			points_inside += inside ? 1 : 0;
+			++points_tested;
+		}
+		report.Exact("frustum::FromMatrix", mismatch_planes, points_tested);
+		if(points_inside == 0 || points_inside == points_tested)
+			report.Exact("frustum::FromMatrix (inside and outside coverage)", 1, points_tested);
+
+		// Boxes reported as outside need to have all corners outside, and boxes reported as completely
+		//	inside all corners inside, within a small tolerance for rounding.
+		uint32_t mismatch_boxes = 0, boxes_inside = 0, boxes_outside = 0;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			Mat4x4 view = random.NextRigid();
+			Frustum f = frustum::FromMatrix(matrix::Multiply(random.NextPerspective(), view));
+
+			Vec4 center = matrix::Multiply(matrix::InverseRigid(view), NextPointAround(random));
+			Vec3 half_size = random.NextVec3(0.0f, 1.0f) * expf(random.NextFloat(logf(0.01f), logf(200.0f)));
+			Aabb box(Vec3(center.x, center.y, center.z) - half_size, Vec3(center.x, center.y, center.z) + half_size);
+			float tolerance = 1e-4f * (fabsf(center.x) + fabsf(center.y) + fabsf(center.z) + half_size.x + half_size.y + half_size.z);
+
+			uint32_t plane_mask = Frustum::ALL_PLANES;
+			bool overlaps = frustum::TestAabb(f, box, plane_mask);
+			for(int c = 0; c < 8; ++c)
+			{
+				Vec3 corner(c & 1 ? box.max.x : box.min.x, c & 2 ? box.max.y : box.min.y, c & 4 ? box.max.z : box.min.z);
+				if(!overlaps && frustum::TestSphere(f, corner, -tolerance))
+					++mismatch_boxes;
+				if(overlaps && plane_mask == 0 && !frustum::TestSphere(f, corner, tolerance))
+					++mismatch_boxes;
+			}
+			boxes_outside += overlaps ? 0 : 1;
+			boxes_inside += overlaps && plane_mask == 0 ? 1 : 0;
+		}
+		report.Exact("frustum::TestAabb", mismatch_boxes, count * 8);
+		if(boxes_inside == 0 || boxes_outside == 0)
+			report.Exact("frustum::TestAabb (inside and outside coverage)", 1, count);
+
+		const uint32_t max_count = 68;
+		std::vector<float> x(max_count), y(max_count), z(max_count), radius(max_count);
+		std::vector<uint32_t> visible(max_count + 1);
+
+		uint32_t total = 0, mismatch_spheres = 0, spheres_visible = 0;
+		for(uint32_t batch_count = 0; batch_count < max_count; ++batch_count)
+		{
+			for(uint32_t repeat = 0; repeat < 16; ++repeat)
+			{
+				Mat4x4 view = random.NextRigid();
+				Frustum f = frustum::FromMatrix(matrix::Multiply(random.NextPerspective(), view));
+				Mat4x4 inverse_view = matrix::InverseRigid(view);
+
+				for(uint32_t i = 0; i < batch_count; ++i)
+				{
+					Vec4 center = matrix::Multiply(inverse_view, NextPointAround(random));
+					x[i] = center.x; y[i] = center.y; z[i] = center.z;
+					radius[i] = i % 7 ? random.NextFloat(0.0f, 20.0f) : 0.0f;
+				}
+				// Guard behind the end, this should never be written
+				visible[batch_count] = 0xdeadbeef;
+
+				uint32_t visible_count = frustum::CullSpheres(f, &x[0], &y[0], &z[0], &radius[0], batch_count, &visible[0]);
+				uint32_t expected_count = 0;
+				for(uint32_t i = 0; i < batch_count; ++i)
+				{
+					if(!frustum::TestSphere(f, Vec3(x[i], y[i], z[i]), radius[i]))
+						continue;
+					if(expected_count >= visible_count || visible[expected_count] != i)
+						++mismatch_spheres;
+					++expected_count;
+				}
+				if(visible_count != expected_count || visible[batch_count] != 0xdeadbeef)
+					++mismatch_spheres;
+				spheres_visible += visible_count;
+
+				total += batch_count;
+			}
+		}
+		report.Exact("frustum::CullSpheres", mismatch_spheres, total);
+		if(spheres_visible == 0 || spheres_visible == total)
+			report.Exact("frustum::CullSpheres (inside and outside coverage)", 1, total);
+	}
+
+	/// Random boxes for the occlusion tests, each placed by a transform (translation * scale * rotation).
+	struct OcclusionScene
+	{
+		Vec3 eye;
+		Mat4x4 view_projection;
+		std::vector<Mat4x4> transforms;
+		std::vector<Aabb> boxes;
+
+		/// @param mirror_some Mirror some of the boxes by a negative scale.
+		void AddBoxes(Random& random, uint32_t count, float extent, float min_size, float max_size, bool mirror_some)
+		{
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				Vec3 scale = random.NextVec3(0.5f, 2.0f);
+				if(mirror_some && i % 8 == 0)
+					scale.x = -scale.x;
+				Vec3 angles = random.NextVec3(-(float)MATH_PI, (float)MATH_PI);
+				transforms.push_back(matrix::Multiply(matrix::CreateTranslation(random.NextVec3(-extent, extent)),
+					matrix::Multiply(matrix::CreateScaling(scale), matrix::CreateRotationXYZ(angles.x, angles.y, angles.z))));
+
+				Vec3 half_size = random.NextVec3(min_size, max_size);
+				boxes.push_back(Aabb(Vec3(0.0f, 0.0f, 0.0f) - half_size, half_size));
+			}
+		}
+
+		/// @return Distance along the ray (In units of direction) to the nearest box hit, FLT_MAX if none.
+		float RayCast(const Vec3& origin, const Vec3& direction) const
+		{
+			float nearest = FLT_MAX;
+			for(size_t i = 0; i < boxes.size(); ++i)
+			{
+				Mat4x4 inverse = matrix::InverseAffine(transforms[i]);
+				Vec4 o = matrix::Multiply(inverse, Vec4(origin.x, origin.y, origin.z, 1.0f));
+				Vec4 d = matrix::Multiply(inverse, Vec4(direction.x, direction.y, direction.z, 0.0f));
+
+				float distance;
+				if(aabb::RayIntersect(boxes[i], Vec3(o.x, o.y, o.z), Vec3(1.0f / d.x, 1.0f / d.y, 1.0f / d.z), nearest, distance))
+					nearest = distance;
+			}
+			return nearest;
+		}
+	};
+
+	void TestOcclusion(Random& random, TestReport& report)
+	{
+		OcclusionBuffer buffer(128, 96);
+
+		uint32_t pixels = 0, mismatch_pixels = 0, objects = 0, mismatch_objects = 0, hidden_objects = 0;
+		for(uint32_t scene_index = 0; scene_index < 64; ++scene_index)
+		{
+			OcclusionScene occluders;
+			Vec3 direction = random.NextVec3(-1.0f, 1.0f);
+			vector::Normalize(direction);
+			occluders.eye = direction * random.NextFloat(20.0f, 60.0f);
+			Mat4x4 view = matrix::LookAt(occluders.eye, random.NextVec3(-3.0f, 3.0f), Vec3(0.0f, 1.0f, 0.0f));
+			Mat4x4 projection = matrix::CreatePerspective(random.NextFloat(0.5f, 1.5f), random.NextFloat(1.0f, 2.0f), 0.5f, 500.0f);
+			occluders.view_projection = matrix::Multiply(projection, view);
+			occluders.AddBoxes(random, 24, 8.0f, 0.5f, 4.0f, true);
+
+			buffer.Begin(occluders.view_projection);
+			for(size_t i = 0; i < occluders.boxes.size(); ++i)
+				buffer.AddOccluder(occluders.transforms[i], occluders.boxes[i]);
+			buffer.Finish();
+
+			// Any point within a covered pixel must be behind an occluder at least as near as the depth of the pixel
+			Mat4x4 inverse_view_projection = matrix::Inverse(occluders.view_projection);
+			for(uint32_t y = 0; y < buffer.Height(0); ++y)
+			{
+				for(uint32_t x = 0; x < buffer.Width(0); ++x)
+				{
+					float depth = buffer.Depth(0, x, y);
+					if(depth == 0.0f)
+						continue;
+
+					float ndc_x = (x + random.NextFloat(0.0f, 1.0f)) * 2.0f / buffer.Width(0) - 1.0f;
+					float ndc_y = (y + random.NextFloat(0.0f, 1.0f)) * 2.0f / buffer.Height(0) - 1.0f;
+					Vec4 far_point = matrix::Multiply(inverse_view_projection, Vec4(ndc_x, ndc_y, 1.0f, 1.0f));
+					Vec3 ray = Vec3(far_point.x / far_point.w, far_point.y / far_point.w, far_point.z / far_point.w) - occluders.eye;
+
+					float distance = occluders.RayCast(occluders.eye, ray);
+					Vec3 hit = occluders.eye + ray * distance;
+					Vec4 clip = matrix::Multiply(occluders.view_projection, Vec4(hit.x, hit.y, hit.z, 1.0f));
+					if(distance == FLT_MAX || 1.0f / clip.w < depth * 0.9999f)
+						++mismatch_pixels;
+					++pixels;
+				}
+			}
+
+			// Objects reported as hidden must not have any point visible
+			OcclusionScene objects_scene;
+			objects_scene.AddBoxes(random, 64, 15.0f, 0.1f, 1.5f, false);
+			for(size_t i = 0; i < objects_scene.boxes.size(); ++i)
+			{
+				++objects;
+				if(buffer.TestBox(objects_scene.transforms[i], objects_scene.boxes[i]))
+					continue;
+				++hidden_objects;
+
+				const Aabb& box = objects_scene.boxes[i];
+				for(uint32_t sample = 0; sample < 32; ++sample)
+				{
+					// Corners (Moved slightly inwards) and random points within the box
+					Vec3 p(random.NextFloat(box.min.x, box.max.x), random.NextFloat(box.min.y, box.max.y), random.NextFloat(box.min.z, box.max.z));
+					if(sample < 8)
+						p = Vec3(sample & 1 ? box.max.x : box.min.x, sample & 2 ? box.max.y : box.min.y, sample & 4 ? box.max.z : box.min.z) * 0.99f;
+					Vec4 world = matrix::Multiply(objects_scene.transforms[i], Vec4(p.x, p.y, p.z, 1.0f));
+					Vec4 clip = matrix::Multiply(occluders.view_projection, world);
+					if(fabsf(clip.x) > clip.w || fabsf(clip.y) > clip.w)
+						continue; // Outside the screen
+
+					if(!(occluders.RayCast(occluders.eye, Vec3(world.x, world.y, world.z) - occluders.eye) < 1.0f))
+					{
+						++mismatch_objects;
+						break;
+					}
+				}
+			}
+		}
+
+		report.Exact("OcclusionBuffer (pixel depths)", mismatch_pixels, pixels);
+		report.Exact("OcclusionBuffer::TestBox", mismatch_objects, objects);
+
+		// Make sure the input actually exercises both outcomes
+		if(pixels == 0 || hidden_objects == 0 || hidden_objects == objects)
+			report.Exact("OcclusionBuffer (hidden and visible coverage)", 1, objects);
+	}
+
+	/// Object for the spatial hash tests, the user data of its proxy points to it.
+	struct HashObject
+	{
+		Vec3 position;
+		float radius;
+		uint32_t proxy;
+		bool alive;
+	};
+
+	/// Query callback collecting the user data found, stops the query after limit objects.
+	struct CollectQuery
+	{
+		std::vector<void*>& found;
+		size_t limit;
+
+		CollectQuery(std::vector<void*>& f, size_t l) : found(f), limit(l) {}
+		bool operator()(void* user_data)
+		{
+			found.push_back(user_data);
+			return found.size() < limit;
+		}
+	};
+
+	/// @return True if found holds every object in expected once and nothing else, or limit of them if the query was stopped.
+	bool SameObjects(std::vector<void*>& found, std::vector<void*>& expected, size_t limit)
+	{
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		if(std::adjacent_find(found.begin(), found.end()) != found.end())
+			return false; // Found twice
+		if(!std::includes(expected.begin(), expected.end(), found.begin(), found.end()))
+			return false;
+		return found.size() == std::min(expected.size(), limit);
+	}
+
+	/// Compares the queries of SpatialHash against going through all objects. Positions are compared with the
+	///	same float expressions as the queries, so the results must match exactly.
+	void TestSpatialHash(Random& random, TestReport& report)
+	{
+		struct Setup
+		{
+			float cell_size;
+			float extent; // Objects are placed within [-extent, extent]
+			float min_radius, max_radius;
+			float oversized_radius; // Every 16th object gets a radius up to this, 0 for none
+		};
+		const Setup setups[] =
+		{
+			{ 2.0f, 50.0f, 0.05f, 3.0f, 0.0f }, // Dense, queries rarely need more than a few rings
+			{ 1.0f, 20000.0f, 0.1f, 1.0f, 0.0f }, // Sparse, QueryNearest falls back to going through all cells
+			{ 4.0f, 200.0f, 0.1f, 4.0f, 300.0f } // Objects spanning more than MAX_CELL_SPAN cells
+		};
+		const uint32_t object_count = 1024;
+
+		uint32_t radius_queries = 0, radius_mismatches = 0, radius_found = 0, radius_empty = 0;
+		uint32_t rect_queries = 0, rect_mismatches = 0;
+		uint32_t nearest_queries = 0, nearest_mismatches = 0;
+
+		for(size_t s = 0; s < sizeof(setups) / sizeof(setups[0]); ++s)
+		{
+			const Setup& setup = setups[s];
+			SpatialHash hash(setup.cell_size);
+
+			std::vector<HashObject> objects(object_count); // Never resized, the proxies point into it
+			for(uint32_t i = 0; i < object_count; ++i)
+			{
+				HashObject& object = objects[i];
+				object.position = random.NextVec3(-setup.extent, setup.extent);
+				object.radius = random.NextFloat(setup.min_radius, setup.max_radius);
+				if(setup.oversized_radius > 0.0f && i % 16 == 0)
+					object.radius = random.NextFloat(setup.oversized_radius * 0.1f, setup.oversized_radius);
+				object.proxy = hash.Insert(object.position, object.radius, &object);
+				object.alive = true;
+			}
+
+			std::vector<void*> found, expected;
+			std::vector<float> distances;
+			for(uint32_t pass = 0; pass < 4; ++pass)
+			{
+				uint32_t alive = 0;
+				for(uint32_t i = 0; i < object_count; ++i)
+					alive += objects[i].alive ? 1 : 0;
+				if(hash.Size() != alive)
+					++nearest_mismatches;
+
+				for(uint32_t q = 0; q < 64; ++q)
+				{
+					// Some queries far outside the objects, and some large enough to cover all of them
+					Vec3 center = random.NextVec3(-setup.extent, setup.extent) * (q % 4 == 0 ? 4.0f : 1.0f);
+					float radius = random.NextFloat(0.0f, setup.extent * (q % 8 == 1 ? 2.0f : 0.1f));
+					size_t limit = q % 8 == 2 ? 1 : object_count; // Stop some queries at the first object
+
+					found.clear();
+					expected.clear();
+					CollectQuery radius_query(found, limit);
+					hash.QueryRadius(center, radius, radius_query);
+					for(uint32_t i = 0; i < object_count; ++i)
+					{
+						const HashObject& object = objects[i];
+						float dx = object.position.x - center.x, dz = object.position.z - center.z;
+						float r = object.radius + radius;
+						if(object.alive && !(dx*dx + dz*dz > r*r))
+							expected.push_back(&objects[i]);
+					}
+					if(!SameObjects(found, expected, limit))
+						++radius_mismatches;
+					++radius_queries;
+					radius_found += (uint32_t)found.size();
+					radius_empty += found.empty() ? 1 : 0;
+
+					Vec3 corner = center + random.NextVec3(0.0f, setup.extent * (q % 8 == 1 ? 2.0f : 0.2f));
+					Vec2 min(center.x, center.z), max(corner.x, corner.z);
+					found.clear();
+					expected.clear();
+					CollectQuery rect_query(found, limit);
+					hash.QueryRect(min, max, rect_query);
+					for(uint32_t i = 0; i < object_count; ++i)
+					{
+						const HashObject& object = objects[i];
+						const Vec3& p = object.position;
+						if(object.alive && !(p.x + object.radius < min.x || max.x < p.x - object.radius ||
+							p.z + object.radius < min.y || max.y < p.z - object.radius))
+							expected.push_back(&objects[i]);
+					}
+					if(!SameObjects(found, expected, limit))
+						++rect_mismatches;
+					++rect_queries;
+
+					// Objects at the same distance may come in any order, so the distances are compared
+					uint32_t k = q % 16 == 3 ? object_count * 2 : 1 + random.Next() % 16;
+					hash.QueryNearest(center, k, found);
+					distances.clear();
+					for(uint32_t i = 0; i < object_count; ++i)
+					{
+						const HashObject& object = objects[i];
+						float dx = object.position.x - center.x, dz = object.position.z - center.z;
+						if(object.alive)
+							distances.push_back(dx*dx + dz*dz);
+					}
+					std::sort(distances.begin(), distances.end());
+
+					bool same = found.size() == std::min((size_t)k, distances.size());
+					for(size_t i = 0; i < found.size() && same; ++i)
+					{
+						const HashObject& object = *(const HashObject*)found[i];
+						float dx = object.position.x - center.x, dz = object.position.z - center.z;
+						same = object.alive && dx*dx + dz*dz == distances[i];
+					}
+					std::sort(found.begin(), found.end());
+					if(!same || std::adjacent_find(found.begin(), found.end()) != found.end())
+						++nearest_mismatches;
+					++nearest_queries;
+				}
+
+				// Move some objects within their cells and some far away, remove some and insert them again
+				for(uint32_t i = 0; i < object_count; ++i)
+				{
+					HashObject& object = objects[i];
+					uint32_t action = random.Next() % 8;
+					if(action == 0)
+					{
+						if(object.alive)
+							hash.Remove(object.proxy);
+						else
+							object.proxy = hash.Insert(object.position, object.radius, &object);
+						object.alive = !object.alive;
+					}
+					else if(object.alive && action <= 2)
+					{
+						object.position = object.position + random.NextVec3(-0.1f, 0.1f) * setup.cell_size;
+						hash.Update(object.proxy, object.position, object.radius);
+					}
+					else if(object.alive && action == 3)
+					{
+						object.position = random.NextVec3(-setup.extent, setup.extent);
+						object.radius = random.NextFloat(setup.min_radius, setup.max_radius);
+						hash.Update(object.proxy, object.position, object.radius);
+					}
+				}
+			}
+		}
+
+		report.Exact("SpatialHash::QueryRadius", radius_mismatches, radius_queries);
+		report.Exact("SpatialHash::QueryRect", rect_mismatches, rect_queries);
+		report.Exact("SpatialHash::QueryNearest", nearest_mismatches, nearest_queries);
+
+		// Make sure the input actually finds objects, and misses them
+		if(radius_found == 0 || radius_empty == 0)
+			report.Exact("SpatialHash (found and empty coverage)", 1, radius_queries);
+	}
+
+	//-------------------------------------------------------------------------------
+	// Benchmarks
+
+	/// Runs op for all inputs, repeated until at least min_ops operations have been performed.
+	/// @return Average time in nanoseconds per operation
+	template<typename Op>
+	double Measure(Op& op, uint32_t count, uint32_t min_ops)
+	{
+		// Warm up
+		for(uint32_t i = 0; i < count; ++i)
+			op(i);
+
+		uint32_t repeats = std::max(min_ops / count, 1u);
+		Clock::time_point start = Clock::now();
+		for(uint32_t r = 0; r < repeats; ++r)
+		{
+			for(uint32_t i = 0; i < count; ++i)
+				op(i);
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		return seconds * 1e9 / ((double)repeats * count);
+	}
+
+	/// Input and output for the benchmarks.
+	struct BenchData
+	{
+		std::vector<Mat4x4> matrices;
+		std::vector<Mat4x4> affine;
+		std::vector<Mat4x4> rigid;
+		std::vector<Mat4x4> perspective;
+		std::vector<Vec4> vectors;
+		std::vector<Vec3> points;
+		std::vector<Vec3> angles;
+		std::vector<Quat> quats;
+
+		std::vector<Mat4x4> out_matrices;
+		std::vector<Vec4> out_vectors;
+		std::vector<Vec3> out_points;
+		std::vector<Quat> out_quats;
+	};
+
+	struct MultiplyOp
+	{
+		BenchData& d;
+		MultiplyOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_matrices[i] = matrix::Multiply(d.matrices[i], d.affine[i]); }
+	};
+	struct MultiplyVecOp
+	{
+		BenchData& d;
+		MultiplyVecOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_vectors[i] = matrix::Multiply(d.matrices[i], d.vectors[i]); }
+	};
+	struct InverseOp
+	{
+		BenchData& d;
+		InverseOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_matrices[i] = matrix::Inverse(d.affine[i]); }
+	};
+	struct InverseAffineOp
+	{
+		BenchData& d;
+		InverseAffineOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_matrices[i] = matrix::InverseAffine(d.affine[i]); }
+	};
+	struct InverseRigidOp
+	{
+		BenchData& d;
+		InverseRigidOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_matrices[i] = matrix::InverseRigid(d.rigid[i]); }
+	};
+	struct InversePerspectiveOp
+	{
+		BenchData& d;
+		InversePerspectiveOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_matrices[i] = matrix::InversePerspective(d.perspective[i]); }
+	};
+	struct LookAtOp
+	{
+		BenchData& d;
+		LookAtOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i)
+		{
+			d.out_matrices[i] = matrix::LookAt(d.points[i], d.angles[i], Vec3(0.0f, 1.0f, 0.0f));
+		}
+	};
+	struct RotationOp
+	{
+		BenchData& d;
+		RotationOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_matrices[i] = matrix::CreateRotationXYZ(d.angles[i].x, d.angles[i].y, d.angles[i].z); }
+	};
+	struct QuatRotationOp
+	{
+		BenchData& d;
+		QuatRotationOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_quats[i] = quat::CreateRotationXYZ(d.angles[i].x, d.angles[i].y, d.angles[i].z); }
+	};
+	struct QuatToMatrixOp
+	{
+		BenchData& d;
+		QuatToMatrixOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_matrices[i] = quat::ToMatrix(d.quats[i]); }
+	};
+	struct QuatMultiplyOp
+	{
+		BenchData& d;
+		QuatMultiplyOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i) { d.out_quats[i] = d.quats[i] * d.quats[(i + 1) % d.quats.size()]; }
+	};
+	struct NormalizeOp
+	{
+		BenchData& d;
+		NormalizeOp(BenchData& data) : d(data) {}
+		void operator()(uint32_t i)
+		{
+			Vec3 v = d.points[i];
+			vector::Normalize(v);
+			d.out_points[i] = v;
+		}
+	};
+
+	/// Structure-of-arrays input and output for the batch benchmarks.
+	struct BatchData
+	{
+		Mat4x4 m;
+		std::vector<float> x, y, z, radius;
+		std::vector<float> out_x, out_y, out_z, out_w;
+
+		Frustum frustum;
+		std::vector<uint32_t> visible;
+		uint32_t visible_count;
+	};
+
+	/// One op is one element, transformed one at a time with matrix::Multiply
+	struct ScalarTransformOp
+	{
+		BatchData& d;
+		ScalarTransformOp(BatchData& data) : d(data) {}
+		void operator()(uint32_t i)
+		{
+			Vec4 p = matrix::Multiply(d.m, Vec4(d.x[i], d.y[i], d.z[i], 1.0f));
+			d.out_x[i] = p.x;
+			d.out_y[i] = p.y;
+			d.out_z[i] = p.z;
+		}
+	};
+
+	/// Batch ops process the whole batch in a single call, the results are divided by the batch size.
+	struct TransformPointsOp
+	{
+		BatchData& d;
+		TransformPointsOp(BatchData& data) : d(data) {}
+		void operator()(uint32_t)
+		{
+			matrix::TransformPoints(d.m, &d.x[0], &d.y[0], &d.z[0], (uint32_t)d.x.size(), &d.out_x[0], &d.out_y[0], &d.out_z[0]);
+		}
+	};
+	struct TransformSpheresOp
+	{
+		BatchData& d;
+		TransformSpheresOp(BatchData& data) : d(data) {}
+		void operator()(uint32_t)
+		{
+			matrix::TransformSpheres(d.m, &d.x[0], &d.y[0], &d.z[0], &d.radius[0], (uint32_t)d.x.size(),
+				&d.out_x[0], &d.out_y[0], &d.out_z[0], &d.out_w[0]);
+		}
+	};
+	struct ProjectPointsOp
+	{
+		BatchData& d;
+		ProjectPointsOp(BatchData& data) : d(data) {}
+		void operator()(uint32_t)
+		{
+			matrix::ProjectPoints(d.m, &d.x[0], &d.y[0], &d.z[0], (uint32_t)d.x.size(),
+				&d.out_x[0], &d.out_y[0], &d.out_z[0], &d.out_w[0]);
+		}
+	};
+
+	struct ScalarCullOp
+	{
+		BatchData& d;
+		ScalarCullOp(BatchData& data) : d(data) {}
+		void operator()(uint32_t i)
+		{
+			d.visible_count += frustum::TestSphere(d.frustum, Vec3(d.x[i], d.y[i], d.z[i]), d.radius[i]) ? 1 : 0;
+		}
+	};
+	struct CullSpheresOp
+	{
+		BatchData& d;
+		CullSpheresOp(BatchData& data) : d(data) {}
+		void operator()(uint32_t)
+		{
+			d.visible_count += frustum::CullSpheres(d.frustum, &d.x[0], &d.y[0], &d.z[0], &d.radius[0], (uint32_t)d.x.size(), &d.visible[0]);
+		}
+	};
+
+	/// Occluders and objects for the occlusion benchmarks, with the camera looking at them from outside.
+	struct OcclusionData
+	{
+		OcclusionScene occluders;
+		OcclusionScene objects;
+		OcclusionBuffer buffer;
+		uint32_t visible_count;
+
+		OcclusionData() : buffer(256, 128), visible_count(0) {}
+	};
+
+	struct OcclusionRasterizeOp
+	{
+		OcclusionData& d;
+		OcclusionRasterizeOp(OcclusionData& data) : d(data) {}
+		void operator()(uint32_t)
+		{
+			d.buffer.Begin(d.occluders.view_projection);
+			for(size_t i = 0; i < d.occluders.boxes.size(); ++i)
+				d.buffer.AddOccluder(d.occluders.transforms[i], d.occluders.boxes[i]);
+			d.buffer.Finish();
+		}
+	};
+	struct OcclusionTestOp
+	{
+		OcclusionData& d;
+		OcclusionTestOp(OcclusionData& data) : d(data) {}
+		void operator()(uint32_t i)
+		{
+			d.visible_count += d.buffer.TestBox(d.objects.transforms[i], d.objects.boxes[i]) ? 1 : 0;
+		}
+	};
+
+	/// Chunks that do nothing, measures the cost of starting and joining the threads of parallel::ForEachChunk.
+	struct EmptyChunksOp
+	{
+		uint32_t counts[4];
+		EmptyChunksOp() { counts[0] = counts[1] = counts[2] = counts[3] = 0; }
+		void operator()(uint32_t)
+		{
+			parallel::ForEachChunk(4, 4, *this);
+		}
+		void operator()(uint32_t chunk, uint32_t , uint32_t )
+		{
+			++counts[chunk]; // Each chunk has its own counter
+		}
+	};
+
+	/// Structure-of-arrays spheres and boxes for the ray benchmarks, all placed around the ray.
+	struct RayData
+	{
+		Vec3 origin;
+		Vec3 ray;
+		Vec3 inv_direction;
+		std::vector<float> x, y, z, radius;
+		std::vector<float> min_x, min_y, min_z, max_x, max_y, max_z;
+		std::vector<float> distances;
+		std::vector<uint32_t> hits;
+		uint32_t hit_count;
+	};
+
+	struct ScalarSphereOp
+	{
+		RayData& d;
+		ScalarSphereOp(RayData& data) : d(data) {}
+		void operator()(uint32_t i)
+		{
+			d.hit_count += RaySphereIntersect(d.origin, d.ray, Vec3(d.x[i], d.y[i], d.z[i]), d.radius[i], d.distances[i]) ? 1 : 0;
+		}
+	};
+	struct RaySpheresOp
+	{
+		RayData& d;
+		RaySpheresOp(RayData& data) : d(data) {}
+		void operator()(uint32_t)
+		{
+			d.hit_count += RaySpheresIntersect(d.origin, d.ray, &d.x[0], &d.y[0], &d.z[0], &d.radius[0], (uint32_t)d.x.size(),
+				&d.hits[0], &d.distances[0]);
+		}
+	};
+	struct ScalarBoxOp
+	{
+		RayData& d;
+		ScalarBoxOp(RayData& data) : d(data) {}
+		void operator()(uint32_t i)
+		{
+			Aabb box(Vec3(d.min_x[i], d.min_y[i], d.min_z[i]), Vec3(d.max_x[i], d.max_y[i], d.max_z[i]));
+			d.hit_count += aabb::RayIntersect(box, d.origin, d.inv_direction, FLT_MAX, d.distances[i]) ? 1 : 0;
+		}
+	};
+	struct RayBoxesOp
+	{
+		RayData& d;
+		RayBoxesOp(RayData& data) : d(data) {}
+		void operator()(uint32_t)
+		{
+			d.hit_count += RayBoxesIntersect(d.origin, d.inv_direction, &d.min_x[0], &d.min_y[0], &d.min_z[0],
+				&d.max_x[0], &d.max_y[0], &d.max_z[0], (uint32_t)d.x.size(), FLT_MAX, &d.hits[0], &d.distances[0]);
+		}
+	};
+
+	void PrintBenchmark(const char* name, double ns)
+	{
+		printf("  %-40s %10.2f ns/op\n", name, ns);
+	}
+
+	void RunBenchmarks(Random& random, uint32_t count, uint32_t min_ops)
+	{
+		BenchData d;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			d.matrices.push_back(random.NextMatrix());
+			d.affine.push_back(random.NextAffine());
+			d.rigid.push_back(random.NextRigid());
+			d.perspective.push_back(random.NextPerspective());
+			d.vectors.push_back(Vec4(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), 1.0f));
+			d.points.push_back(random.NextVec3(-100.0f, 100.0f));
+			d.angles.push_back(random.NextVec3(-(float)MATH_PI, (float)MATH_PI));
+			d.quats.push_back(quat::CreateRotationXYZ(d.angles[i].x, d.angles[i].y, d.angles[i].z));
+		}
+		d.out_matrices.resize(count);
+		d.out_vectors.resize(count);
+		d.out_points.resize(count);
+		d.out_quats.resize(count);
+
+		MultiplyOp multiply(d); PrintBenchmark("matrix::Multiply (matrix)", Measure(multiply, count, min_ops));
+		MultiplyVecOp multiply_vec(d); PrintBenchmark("matrix::Multiply (vector)", Measure(multiply_vec, count, min_ops));
+		InverseOp inverse(d); PrintBenchmark("matrix::Inverse", Measure(inverse, count, min_ops));
+		InverseAffineOp inverse_affine(d); PrintBenchmark("matrix::InverseAffine", Measure(inverse_affine, count, min_ops));
+		InverseRigidOp inverse_rigid(d); PrintBenchmark("matrix::InverseRigid", Measure(inverse_rigid, count, min_ops));
+		InversePerspectiveOp inverse_perspective(d); PrintBenchmark("matrix::InversePerspective", Measure(inverse_perspective, count, min_ops));
+		LookAtOp lookat(d); PrintBenchmark("matrix::LookAt", Measure(lookat, count, min_ops));
+		RotationOp rotation(d); PrintBenchmark("matrix::CreateRotationXYZ", Measure(rotation, count, min_ops));
+		QuatRotationOp quat_rotation(d); PrintBenchmark("quat::CreateRotationXYZ", Measure(quat_rotation, count, min_ops));
+		QuatToMatrixOp quat_to_matrix(d); PrintBenchmark("quat::ToMatrix", Measure(quat_to_matrix, count, min_ops));
+		QuatMultiplyOp quat_multiply(d); PrintBenchmark("quat::Multiply", Measure(quat_multiply, count, min_ops));
+		NormalizeOp normalize(d); PrintBenchmark("vector::Normalize", Measure(normalize, count, min_ops));
+
+		BatchData b;
+		b.m = d.affine[0];
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			b.x.push_back(d.points[i].x);
+			b.y.push_back(d.points[i].y);
+			b.z.push_back(d.points[i].z);
+			b.radius.push_back(random.NextFloat(0.0f, 10.0f));
+		}
+		b.out_x.resize(count); b.out_y.resize(count); b.out_z.resize(count); b.out_w.resize(count);
+
+		uint32_t batch_repeats = std::max(min_ops / count, 1u);
+
+		ScalarTransformOp scalar_transform(b); PrintBenchmark("Point transform (matrix::Multiply)", Measure(scalar_transform, count, min_ops));
+		TransformPointsOp transform_points(b); PrintBenchmark("matrix::TransformPoints", Measure(transform_points, batch_repeats, batch_repeats) / count);
+		TransformSpheresOp transform_spheres(b); PrintBenchmark("matrix::TransformSpheres", Measure(transform_spheres, batch_repeats, batch_repeats) / count);
+		ProjectPointsOp project_points(b); PrintBenchmark("matrix::ProjectPoints", Measure(project_points, batch_repeats, batch_repeats) / count);
+
+		// Camera at the origin looking along a random direction, a part of the points are visible
+		Vec3 look = random.NextVec3(-1.0f, 1.0f);
+		b.frustum = frustum::FromMatrix(matrix::Multiply(d.perspective[0], matrix::LookAt(Vec3(0.0f, 0.0f, 0.0f), look, Vec3(0.0f, 1.0f, 0.0f))));
+		b.visible.resize(count);
+		b.visible_count = 0;
+
+		ScalarCullOp scalar_cull(b); PrintBenchmark("frustum::TestSphere", Measure(scalar_cull, count, min_ops));
+		CullSpheresOp cull_spheres(b); PrintBenchmark("frustum::CullSpheres", Measure(cull_spheres, batch_repeats, batch_repeats) / count);
+
+		OcclusionData o;
+		o.occluders.eye = Vec3(0.0f, 10.0f, 60.0f);
+		o.occluders.view_projection = matrix::Multiply(d.perspective[0], matrix::LookAt(o.occluders.eye, Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f)));
+		o.occluders.AddBoxes(random, 256, 20.0f, 0.5f, 4.0f, false);
+		o.objects.AddBoxes(random, count, 25.0f, 0.1f, 1.5f, false);
+
+		uint32_t rasterize_repeats = std::max(min_ops / count / 16, 1u);
+		OcclusionRasterizeOp occlusion_rasterize(o); PrintBenchmark("OcclusionBuffer (per occluder)",
+			Measure(occlusion_rasterize, rasterize_repeats, rasterize_repeats) / o.occluders.boxes.size());
+		OcclusionTestOp occlusion_test(o); PrintBenchmark("OcclusionBuffer::TestBox", Measure(occlusion_test, count, min_ops));
+
+		// A frame with few occluders, to compare against the cost of starting threads for it
+		OcclusionData small;
+		small.occluders.eye = o.occluders.eye;
+		small.occluders.view_projection = o.occluders.view_projection;
+		small.occluders.AddBoxes(random, 16, 20.0f, 0.5f, 4.0f, false);
+		OcclusionRasterizeOp small_rasterize(small); PrintBenchmark("OcclusionBuffer::Finish (16 occluders)",
+			Measure(small_rasterize, rasterize_repeats, rasterize_repeats * 16));
+		EmptyChunksOp empty_chunks; PrintBenchmark("parallel::ForEachChunk (4 empty chunks)",
+			Measure(empty_chunks, rasterize_repeats, rasterize_repeats));
+
+		RayData r;
+		r.origin = Vec3(0.0f, 0.0f, 0.0f);
+		r.ray = random.NextVec3(-1.0f, 1.0f);
+		vector::Normalize(r.ray);
+		r.inv_direction = Vec3(1.0f / r.ray.x, 1.0f / r.ray.y, 1.0f / r.ray.z);
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			Vec3 center = r.ray * random.NextFloat(-10.0f, 100.0f) + random.NextVec3(-4.0f, 4.0f);
+			float size = random.NextFloat(0.0f, 2.0f);
+			r.x.push_back(center.x); r.y.push_back(center.y); r.z.push_back(center.z);
+			r.radius.push_back(size);
+			r.min_x.push_back(center.x - size); r.min_y.push_back(center.y - size); r.min_z.push_back(center.z - size);
+			r.max_x.push_back(center.x + size); r.max_y.push_back(center.y + size); r.max_z.push_back(center.z + size);
+		}
+		r.distances.resize(count);
+		r.hits.resize((count + 31) / 32);
+		r.hit_count = 0;
+
+		ScalarSphereOp scalar_sphere(r); PrintBenchmark("RaySphereIntersect", Measure(scalar_sphere, count, min_ops));
+		RaySpheresOp ray_spheres(r); PrintBenchmark("RaySpheresIntersect", Measure(ray_spheres, batch_repeats, batch_repeats) / count);
+		ScalarBoxOp scalar_box(r); PrintBenchmark("aabb::RayIntersect", Measure(scalar_box, count, min_ops));
+		RayBoxesOp ray_boxes(r); PrintBenchmark("RayBoxesIntersect", Measure(ray_boxes, batch_repeats, batch_repeats) / count);
+
+		// Use the output so the compiler can't remove the work
+		float checksum = d.out_matrices[count / 2].col[0].x + d.out_vectors[count / 2].x + d.out_points[count / 2].x +
+			d.out_quats[count / 2].w + b.out_x[count / 2] + b.out_w[count / 2] + (float)b.visible_count + (float)o.visible_count + (float)r.hit_count +
+			(float)empty_chunks.counts[3];
+		printf("  (checksum %f)\n", checksum);
+	}
+
+	void PrintUsage()
+	{
+		printf("Usage: MathTest [options]\n"
+			"Runs the accuracy tests followed by the benchmarks, the exit code is 1 if any test failed.\n"
+			"Options:\n"
+			"  -test             Only run the accuracy tests\n"
+			"  -bench            Only run the benchmarks\n"
+			"  -count <n>        Number of random inputs for each test and benchmark (Default: 100000)\n"
+			"  -seed <n>         Seed for the random input (Default: 1)\n");
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	using namespace mathtest_internal;
+
+	bool run_tests = true;
+	bool run_benchmarks = true;
+	uint32_t count = 100000;
+	uint32_t seed = 1;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		const char* option = argv[i];
+		if(strcmp(option, "-test") == 0)
+		{
+			run_benchmarks = false;
+		}
+		else if(strcmp(option, "-bench") == 0)
+		{
+			run_tests = false;
+		}
+		else if((strcmp(option, "-count") == 0 || strcmp(option, "-seed") == 0) && i + 1 < argc)
+		{
+			uint32_t value = (uint32_t)strtoul(argv[++i], NULL, 10);
+			if(option[1] == 'c')
+				count = std::max(value, 1u);
+			else
+				seed = value;
+		}
+		else
+		{
+			printf("Unknown option '%s'.\n", option);
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	Random random(seed);
+	int failed = 0;
+
+	if(run_tests)
+	{
+		printf("Accuracy (%d random inputs, seed %d):\n", count, seed);
+
+		TestReport report;
+		TestMatrix(random, count, report);
+		TestVector(random, count, report);
+		TestQuat(random, count, report);
+		TestBatch(random, report);
+		TestRayBatch(random, report);
+		TestFrustum(random, count, report);
+		TestOcclusion(random, report);
+		TestSpatialHash(random, report);
+
+		failed = report.Failed();
+		if(failed)
+			printf("%d test(s) FAILED.\n\n", failed);
+		else
+			printf("All tests passed.\n\n");
+	}
+
+	if(run_benchmarks)
+	{
+		// Inputs are kept small enough to stay in the cache, this measures the math rather than memory
+		uint32_t bench_count = std::min(count, 4096u);
+		printf("Benchmarks (%d inputs, repeated):\n", bench_count);
+		RunBenchmarks(random, bench_count, 1 << 22);
+	}
+
+	return failed ? 1 : 0;
+}
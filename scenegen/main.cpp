@@ -0,0 +1,139 @@
+#include <framework/Common.h>
+
+#include <lab2/Scene.h>
+#include <lab2/SceneGenerator.h>
+#include <lab2/SceneCells.h>
+
+#include <errno.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Command-line tool for generating test scenes, see PrintUsage.
+
+namespace scenegen_internal
+{
+	void PrintUsage()
+	{
+		printf("Usage: SceneGen <output file> [options]\n"
+			"The format is picked from the file extension of the output file, same as when saving a scene.\n"
+			"Options:\n"
+			"  -count <n>        Number of entities, including lights (Default: 1000)\n"
+			"  -lights <n>       Number of lights, only the first %d are used when loading the scene (Default: 4)\n"
+			"  -seed <n>         Seed for the generator (Default: 1)\n"
+			"  -layout <name>    uniform, clustered or overlapping (Default: uniform)\n"
+			"  -extent <f>       Entities are placed within [-extent, extent] (Default: 100)\n"
+			"  -clusters <n>     Number of clusters for the clustered layout (Default: 16)\n"
+			"  -radius <f>       Cluster radius (Default: 10)\n"
+			"  -cells <f>        Saves a cell scene with the specified cell size instead (See scene_cells)\n",
+			(int)Scene::MAX_LIGHT_COUNT);
+	}
+
+	/// @return True if the whole string is a valid unsigned 32-bit number.
+	bool ParseUInt(const char* str, uint32_t& value)
+	{
+		char* end;
+		errno = 0;
+		unsigned long result = strtoul(str, &end, 10);
+		if(end == str || *end != '\0' || errno == ERANGE || str[0] == '-' || result > 0xffffffffUL)
+			return false;
+
+		value = (uint32_t)result;
+		return true;
+	}
+
+	/// @return True if the whole string is a valid finite number.
+	bool ParseFloat(const char* str, float& value)
+	{
+		char* end;
+		errno = 0;
+		double result = strtod(str, &end);
+		if(end == str || *end != '\0' || errno == ERANGE || !(result == result) || result > FLT_MAX || result < -FLT_MAX)
+			return false;
+
+		value = (float)result;
+		return true;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	using namespace scenegen_internal;
+
+	if(argc < 2 || argv[1][0] == '-')
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const char* filename = argv[1];
+	scene_generator::Params params;
+	float cell_size = 0.0f;
+
+	for(int i = 2; i < argc; ++i)
+	{
+		const char* option = argv[i];
+		if(i + 1 >= argc)
+		{
+			printf("Missing value for option '%s'.\n", option);
+			return 1;
+		}
+		const char* value = argv[++i];
+
+		bool valid = true;
+		if(strcmp(option, "-count") == 0)
+			valid = ParseUInt(value, params.entity_count);
+		else if(strcmp(option, "-lights") == 0)
+			valid = ParseUInt(value, params.light_count);
+		else if(strcmp(option, "-seed") == 0)
+			valid = ParseUInt(value, params.seed);
+		else if(strcmp(option, "-extent") == 0)
+			valid = ParseFloat(value, params.extent);
+		else if(strcmp(option, "-clusters") == 0)
+			valid = ParseUInt(value, params.cluster_count);
+		else if(strcmp(option, "-radius") == 0)
+			valid = ParseFloat(value, params.cluster_radius);
+		else if(strcmp(option, "-cells") == 0)
+			valid = ParseFloat(value, cell_size);
+		else if(strcmp(option, "-layout") == 0)
+		{
+			if(!scene_generator::LayoutFromName(value, params.layout))
+			{
+				printf("Unknown layout '%s'.\n", value);
+				return 1;
+			}
+		}
+		else
+		{
+			printf("Unknown option '%s'.\n", option);
+			PrintUsage();
+			return 1;
+		}
+
+		if(!valid)
+		{
+			printf("Invalid value '%s' for option '%s'.\n", value, option);
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	SceneData data;
+	scene_generator::Generate(params, data);
+
+	bool result = false;
+	if(cell_size > 0.0f)
+		result = scene_cells::Save(filename, data, cell_size);
+	else
+		result = scene_file::Save(filename, data);
+
+	if(!result)
+	{
+		printf("Failed to save '%s'.\n", filename);
+		return 1;
+	}
+
+	printf("Generated %d entities (%d lights) to '%s'.\n", data.Size(), (int)data.lights.size(), filename);
+	return 0;
+}
@@ -77,4 +77,56 @@ Program {
 	Frameworks = { "OpenGL", "SDL2" },
 }
 
+Program {
+	Name = "SceneGen",
+	Env = {
+		CPPPATH = { 
+			"lab2",
+			".",
+			"dependencies/SDL2-2.0.1/include",
+			"dependencies/glew/include",
+			{ "/Library/Frameworks/SDL2.framework/Headers"; Config = "macosx-*-*" }
+		}, 
+	},
+	Sources = {
+		"scenegen/main.cpp",
+		"lab2/SceneGenerator.cpp",
+		"lab2/SceneFile.cpp",
+		"lab2/SceneCells.cpp",
+	},
+	Depends = { "Framework" },
+
+	Libs = { 
+		{ 
+			"kernel32.lib", 
+			"user32.lib", 
+			Config = { "win32-*-*", "win64-*-*" } 
+		}
+	},
+}
+
+Program {
+	Name = "MathTest",
+	Env = {
+		CPPPATH = { 
+			".",
+			"dependencies/SDL2-2.0.1/include",
+			"dependencies/glew/include",
+			{ "/Library/Frameworks/SDL2.framework/Headers"; Config = "macosx-*-*" }
+		}, 
+	},
+	Sources = {
+		"mathtest/main.cpp",
+	},
+	Depends = { "Framework" },
+
+	Libs = { 
+		{ 
+			"kernel32.lib", 
+			"user32.lib", 
+			Config = { "win32-*-*", "win64-*-*" } 
+		}
+	},
+}
+
 Default "Lab2"